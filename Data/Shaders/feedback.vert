@@ -0,0 +1,12 @@
+#version 150 core
+
+// The built-in copy of this shader is finalVertexshaderSrc in main.cpp, it's used when this file isn't there or doesn't compile.
+// Save the file while the program runs to print the new results.
+
+in float inValue;
+out float geoValue;
+
+void main()
+{
+	geoValue = sqrt(inValue);
+}
@@ -0,0 +1,48 @@
+#version 150 core
+
+// The built-in copy of this shader is fragmentSource in main.cpp, it's used when this file isn't there or doesn't compile.
+
+in vec3 Color;
+in vec2 Texcoord;
+in float Depth;
+
+out vec4 outColor;
+
+// The small images are in a texture array, HaloInfinite is a texture of its own that the texture manager streams
+uniform sampler2D texHalo;
+uniform sampler2DArray texAtlas;
+uniform vec4 googleRect;
+uniform float googleLayer;
+uniform vec3 extraColor;
+
+// See VirtualTexture.h
+uniform bool virtualHalo;
+uniform sampler2D vtPhysical;
+uniform sampler2D vtIndirection;
+uniform float vtPages;
+uniform float vtLevelCount;
+uniform vec4 vtPage;
+
+vec4 SampleVirtual(vec2 uv)
+{
+	vec2 texel = uv * vtPages * vtPage.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	int level = int(clamp(floor(0.5f * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0f, vtLevelCount - 1.0f));
+
+	uv = clamp(uv, 0.0f, 0.99999f);
+	vec4 entry = texelFetch(vtIndirection, ivec2(uv * (vtPages / exp2(float(level)))), level) * 255.0f;
+	vec2 inPage = fract(uv * (vtPages / exp2(floor(entry.z + 0.5f))));
+	vec2 physical = floor(entry.xy + 0.5f) * vtPage.z + vtPage.y + inPage * vtPage.x;
+	return textureLod(vtPhysical, physical / vtPage.w, 0.0f);
+}
+
+void main()
+{
+	vec4 colHalo = virtualHalo ? SampleVirtual(Texcoord) : texture(texHalo, Texcoord);
+	vec4 colGoogle = texture(texAtlas, vec3(Texcoord * googleRect.zw + googleRect.xy, googleLayer));
+
+	outColor = mix(colHalo, colGoogle, 0.5f);
+	outColor *= vec4(Color, 1.0f);
+	//outColor *= vec4(extraColor, 1.0f);
+}
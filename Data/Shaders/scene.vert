@@ -0,0 +1,32 @@
+#version 150 core
+
+// The built-in copy of this shader is vertexSource in main.cpp, it's used when this file isn't there or doesn't compile.
+// Save the file while the program runs to see the changes.
+
+in vec3 position;
+in vec3 color;
+in vec2 texcoord;
+
+out vec3 Color;
+out vec2 Texcoord;
+out float Depth;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 proj;
+uniform float time;
+
+void main()
+{
+	float redValue = color.r + 0.1f * time;
+	float redSin = sin(redValue);
+	redSin *= 0.5f;
+	redSin += 0.5f;
+	float red = redSin;
+	float blue = 1.0f - red;
+
+	gl_Position = proj * view * model * vec4(position, 1.0f);
+
+	Color = vec3(red, color.g, blue);
+	Texcoord = texcoord;
+}
@@ -0,0 +1,17 @@
+#version 150 core
+
+// The built-in copy of this shader is screenFragmentSource in main.cpp, it's used when this file isn't there or doesn't compile.
+// It has a sobel filter, a blur and a gray scale filter to try out.
+
+in vec2 Texcoord;
+
+out vec4 outColor;
+
+uniform sampler2D texFramebuffer;
+uniform vec2 maxTexcoord;
+
+void main()
+{
+	// The scene only covers the lower left part of the texture, linear filtering mustn't pick up the pixels next to it.
+	outColor = texture(texFramebuffer, min(Texcoord, maxTexcoord));
+}
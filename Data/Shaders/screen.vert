@@ -0,0 +1,16 @@
+#version 150 core
+
+// The built-in copy of this shader is screenVertexSource in main.cpp, it's used when this file isn't there or doesn't compile.
+
+in vec2 position;
+in vec2 texCoord;
+
+out vec2 Texcoord;
+
+uniform vec2 renderScale;
+
+void main()
+{
+	Texcoord = texCoord * renderScale;
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
@@ -0,0 +1,334 @@
+#include "AssetPack.h"
+#include "LzCompression.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+static const char AssetPackMagic[4] = { 'A', 'P', 'A', 'K' };
+static const unsigned int AssetPackVersion = 1;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+unsigned long long HashAssetBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	unsigned long long hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool WriteAssetPack(const char* path, const std::vector<AssetPackInput>& assets, unsigned int alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+	{
+		std::cout << "The alignment of an asset pack has to be a power of 2, not " << alignment << "\n";
+		return false;
+	}
+
+	AssetPackHeader header = {};
+	std::memcpy(header.magic, AssetPackMagic, sizeof(AssetPackMagic));
+	header.version = AssetPackVersion;
+	header.entryCount = (unsigned int)assets.size();
+	header.alignment = alignment;
+
+	std::vector<AssetPackEntry> entries(assets.size());
+	std::string names;
+
+	// What goes into the file for every asset, compressed or not
+	std::vector<std::vector<unsigned char>> compressed(assets.size());
+
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		const AssetPackInput& asset = assets[i];
+		AssetPackEntry& entry = entries[i];
+
+		entry.nameHash = HashAssetBytes(asset.name.data(), asset.name.size());
+		entry.contentHash = HashAssetBytes(asset.data.data(), asset.data.size());
+		entry.size = asset.data.size();
+		entry.storedSize = asset.data.size();
+		entry.nameOffset = (unsigned int)names.size();
+		entry.nameLength = (unsigned int)asset.name.size();
+		entry.compression = AssetCompression::None;
+		names += asset.name;
+
+		if (asset.compress && !asset.data.empty())
+		{
+			std::vector<unsigned char> data = LzCompress(asset.data.data(), asset.data.size());
+			if (data.size() <= asset.data.size() - asset.data.size() / 8)
+			{
+				entry.storedSize = data.size();
+				entry.compression = AssetCompression::Lz;
+				compressed[i] = std::move(data);
+			}
+		}
+	}
+
+	header.namesOffset = sizeof(header) + entries.size() * sizeof(AssetPackEntry);
+	header.namesSize = names.size();
+
+	// Assets with the same contents share their bytes, the one that came first is written
+	size_t offset = (size_t)(header.namesOffset + header.namesSize);
+	std::vector<size_t> written;
+	for (size_t i = 0; i < assets.size(); ++i)
+	{
+		AssetPackEntry& entry = entries[i];
+
+		size_t same = 0;
+		for (; same < written.size(); ++same)
+		{
+			const AssetPackEntry& other = entries[written[same]];
+			if (other.contentHash == entry.contentHash && other.compression == entry.compression && other.size == entry.size
+				&& assets[written[same]].data == assets[i].data)
+				break;
+		}
+
+		if (same < written.size())
+		{
+			entry.offset = entries[written[same]].offset;
+			continue;
+		}
+
+		offset = AlignUp(offset, alignment);
+		entry.offset = offset;
+		offset += (size_t)entry.storedSize;
+		written.push_back(i);
+	}
+
+	// The order in the file stays the order of the assets, only the table is sorted
+	std::vector<AssetPackEntry> table = entries;
+	std::stable_sort(table.begin(), table.end(), [](const AssetPackEntry& a, const AssetPackEntry& b) { return a.nameHash < b.nameHash; });
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)table.data(), table.size() * sizeof(AssetPackEntry));
+	file.write(names.data(), names.size());
+
+	size_t position = (size_t)(header.namesOffset + header.namesSize);
+	std::vector<char> padding(alignment, 0);
+	for (size_t i : written)
+	{
+		const AssetPackEntry& entry = entries[i];
+		file.write(padding.data(), entry.offset - position);
+
+		const std::vector<unsigned char>& data = entry.compression == AssetCompression::None ? assets[i].data : compressed[i];
+		file.write((const char*)data.data(), data.size());
+		position = (size_t)(entry.offset + entry.storedSize);
+	}
+
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+void AssetData::Reset()
+{
+	m_File.Close();
+	m_Storage.clear();
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+AssetPack::AssetPack()
+	: m_Header()
+	, m_Entries(nullptr)
+	, m_Names(nullptr)
+{
+}
+
+bool AssetPack::Open(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	const unsigned char* data = m_File.GetData();
+	size_t size = m_File.GetSize();
+
+	if (size < sizeof(AssetPackHeader))
+	{
+		Close();
+		return false;
+	}
+
+	std::memcpy(&m_Header, data, sizeof(m_Header));
+	if (std::memcmp(m_Header.magic, AssetPackMagic, sizeof(AssetPackMagic)) != 0 || m_Header.version != AssetPackVersion)
+	{
+		std::cout << path << " isn't an asset pack of version " << AssetPackVersion << "\n";
+		Close();
+		return false;
+	}
+
+	// Every check subtracts from the size instead of adding to an offset, a damaged header could make the sum wrap around
+	if ((size - sizeof(AssetPackHeader)) / sizeof(AssetPackEntry) < m_Header.entryCount)
+	{
+		std::cout << path << " is truncated\n";
+		Close();
+		return false;
+	}
+
+	size_t tableEnd = sizeof(AssetPackHeader) + (size_t)m_Header.entryCount * sizeof(AssetPackEntry);
+	if (m_Header.namesOffset < tableEnd || m_Header.namesOffset > size || m_Header.namesSize > size - m_Header.namesOffset)
+	{
+		std::cout << path << " is truncated\n";
+		Close();
+		return false;
+	}
+
+	m_Entries = (const AssetPackEntry*)(data + sizeof(AssetPackHeader));
+	m_Names = (const char*)(data + m_Header.namesOffset);
+
+	// Reading an asset only has to check its own entry against the data after this
+	for (unsigned int i = 0; i < m_Header.entryCount; ++i)
+	{
+		const AssetPackEntry& entry = m_Entries[i];
+		if (entry.offset > size || entry.storedSize > size - entry.offset || (unsigned long long)entry.nameOffset + entry.nameLength > m_Header.namesSize)
+		{
+			std::cout << path << " is truncated\n";
+			Close();
+			return false;
+		}
+
+		// Find does a binary search, which would miss assets in a table that isn't sorted
+		if (i > 0 && entry.nameHash < m_Entries[i - 1].nameHash)
+		{
+			std::cout << path << " has a table of contents that isn't sorted\n";
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AssetPack::Close()
+{
+	m_File.Close();
+	m_Header = AssetPackHeader();
+	m_Entries = nullptr;
+	m_Names = nullptr;
+}
+
+std::string AssetPack::GetName(int index) const
+{
+	const AssetPackEntry& entry = m_Entries[index];
+	return std::string(m_Names + entry.nameOffset, entry.nameLength);
+}
+
+int AssetPack::Find(const std::string& name) const
+{
+	if (!IsOpen())
+		return -1;
+
+	unsigned long long hash = HashAssetBytes(name.data(), name.size());
+	const AssetPackEntry* end = m_Entries + m_Header.entryCount;
+	const AssetPackEntry* entry = std::lower_bound(m_Entries, end, hash, [](const AssetPackEntry& e, unsigned long long h) { return e.nameHash < h; });
+
+	// Names with the same hash are next to each other
+	for (; entry != end && entry->nameHash == hash; ++entry)
+	{
+		if (entry->nameLength == name.size() && std::memcmp(m_Names + entry->nameOffset, name.data(), name.size()) == 0)
+			return (int)(entry - m_Entries);
+	}
+
+	return -1;
+}
+
+bool AssetPack::Read(int index, AssetData& data) const
+{
+	data.Reset();
+
+	const AssetPackEntry& entry = m_Entries[index];
+	const unsigned char* stored = m_File.GetData() + entry.offset;
+
+	if (entry.compression == AssetCompression::None)
+	{
+		data.m_Data = stored;
+		data.m_Size = (size_t)entry.size;
+		return true;
+	}
+
+	if (entry.compression != AssetCompression::Lz)
+		return false;
+
+	data.m_Storage.resize((size_t)entry.size);
+	if (!LzDecompress(stored, (size_t)entry.storedSize, data.m_Storage.data(), data.m_Storage.size()))
+	{
+		std::cout << "Asset " << GetName(index) << " is damaged\n";
+		data.Reset();
+		return false;
+	}
+
+	data.m_Data = data.m_Storage.data();
+	data.m_Size = data.m_Storage.size();
+	return true;
+}
+
+bool AssetPack::Verify(int index) const
+{
+	AssetData data;
+	if (!Read(index, data))
+		return false;
+
+	return HashAssetBytes(data.GetData(), data.GetSize()) == m_Entries[index].contentHash;
+}
+
+static const AssetPack* g_MountedPack = nullptr;
+static std::string g_MountRoot;
+
+void MountAssetPack(const AssetPack* pack, const std::string& root)
+{
+	g_MountedPack = pack;
+	g_MountRoot = root;
+}
+
+// Index of the asset in the mounted pack, -1 when it isn't there
+static int FindMountedAsset(const std::string& path)
+{
+	if (!g_MountedPack || path.compare(0, g_MountRoot.size(), g_MountRoot) != 0)
+		return -1;
+
+	std::string name = path.substr(g_MountRoot.size());
+	std::replace(name.begin(), name.end(), '\\', '/');
+	return g_MountedPack->Find(name);
+}
+
+bool ReadAsset(const std::string& path, AssetData& data)
+{
+	int index = FindMountedAsset(path);
+	if (index != -1)
+		return g_MountedPack->Read(index, data);
+
+	data.Reset();
+	if (!data.m_File.Open(path.c_str()))
+		return false;
+
+	data.m_Data = data.m_File.GetData();
+	data.m_Size = data.m_File.GetSize();
+	return true;
+}
+
+bool AssetExists(const std::string& path)
+{
+	return FindMountedAsset(path) != -1 || std::ifstream(path).good();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Many assets in one file, made by Tools/AssetPacker. The file is memory mapped, so an asset is read without opening a file,
+// and one that isn't compressed is used straight from the mapping without being copied. Several programs that use the same pack
+// share the pages of the mapping, where reading the files into buffers of their own would have a copy of everything in each.
+//
+// The file starts with a header and the table of contents, sorted by the hash of the names so an asset is found with a binary search.
+// Then the names, and the assets, each one starting at a multiple of the alignment in the header.
+// Every asset has a hash of its contents to check it, assets with the same contents are only stored once.
+struct AssetPackHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int alignment;
+
+	unsigned long long namesOffset;
+	unsigned long long namesSize;
+};
+
+enum class AssetCompression : unsigned int
+{
+	None,
+	Lz
+};
+
+struct AssetPackEntry
+{
+	unsigned long long nameHash;
+	unsigned long long contentHash;
+
+	unsigned long long offset;
+	unsigned long long storedSize;
+	unsigned long long size;
+
+	unsigned int nameOffset;
+	unsigned int nameLength;
+	AssetCompression compression;
+	unsigned int reserved;
+};
+
+// 64 bit FNV-1a, for the names and the contents of the assets
+unsigned long long HashAssetBytes(const void* data, size_t size);
+
+struct AssetPackInput
+{
+	// Relative path with forward slashes, like "Shaders/scene.vert"
+	std::string name;
+	std::vector<unsigned char> data;
+
+	// Compressed with LzCompression when that makes it at least 1/8 smaller
+	bool compress;
+};
+
+// Writes a pack with the assets in the order they're given. alignment has to be a power of 2.
+bool WriteAssetPack(const char* path, const std::vector<AssetPackInput>& assets, unsigned int alignment = 4096);
+
+// The bytes of an asset. An asset that isn't compressed points into the mapping of its pack or of its own file,
+// a compressed one is decompressed into memory of its own.
+class AssetData
+{
+public:
+	AssetData() : m_Data(nullptr), m_Size(0) {}
+
+	AssetData(const AssetData&) = delete;
+	AssetData& operator=(const AssetData&) = delete;
+
+	bool IsValid() const { return m_Data != nullptr; }
+	const unsigned char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	friend class AssetPack;
+	friend bool ReadAsset(const std::string& path, AssetData& data);
+
+	void Reset();
+
+	MappedFile m_File;
+	std::vector<unsigned char> m_Storage;
+	const unsigned char* m_Data;
+	size_t m_Size;
+};
+
+class AssetPack
+{
+public:
+	AssetPack();
+
+	AssetPack(const AssetPack&) = delete;
+	AssetPack& operator=(const AssetPack&) = delete;
+
+	// Returns false when the file doesn't exist or isn't a valid pack
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	// Index of the asset, -1 when it isn't in the pack
+	int Find(const std::string& name) const;
+
+	int GetEntryCount() const { return (int)m_Header.entryCount; }
+	const AssetPackEntry& GetEntry(int index) const { return m_Entries[index]; }
+	std::string GetName(int index) const;
+
+	// Can be called from any thread, the pack is only read
+	bool Read(int index, AssetData& data) const;
+
+	// Compares the contents with the hash that was stored when the pack was made
+	bool Verify(int index) const;
+
+private:
+	MappedFile m_File;
+	AssetPackHeader m_Header;
+	const AssetPackEntry* m_Entries;
+	const char* m_Names;
+};
+
+// Makes ReadAsset look in the pack for paths that start with root, e.g. "../../Data/" finds "../../Data/img.png" as "img.png".
+// Call it before any loader thread runs, and keep the pack open for as long as anything loads. nullptr goes back to loose files.
+void MountAssetPack(const AssetPack* pack, const std::string& root);
+
+// Reads an asset from the mounted pack, or maps the loose file when the pack doesn't have it.
+// Everything in the pack is read from the pack, so hot reloading only sees files that aren't in it.
+bool ReadAsset(const std::string& path, AssetData& data);
+
+// Whether ReadAsset would find the asset
+bool AssetExists(const std::string& path);
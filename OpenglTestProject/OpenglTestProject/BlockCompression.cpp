@@ -0,0 +1,497 @@
+#include "BlockCompression.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// SSE2 is always there on x64, on x86 it's enabled with /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#endif
+
+// The 16 pixels of a block with one array per channel, so 4 pixels fit in one SSE register
+struct BlockPixels
+{
+	float r[16];
+	float g[16];
+	float b[16];
+};
+
+static void LoadBlockPixels(const unsigned char* rgba, BlockPixels& pixels)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		pixels.r[i] = rgba[i * 4 + 0];
+		pixels.g[i] = rgba[i * 4 + 1];
+		pixels.b[i] = rgba[i * 4 + 2];
+	}
+}
+
+static unsigned short Pack565(const float color[3])
+{
+	int r = std::min(std::max((int)(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+	int g = std::min(std::max((int)(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+	int b = std::min(std::max((int)(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+// Expands the same way the GPU does, by repeating the high bits in the empty low bits
+static void Unpack565(unsigned short packed, int color[3])
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+#ifdef BLOCK_COMPRESSION_SSE2
+static float HorizontalSum(__m128 value)
+{
+	__m128 shuffled = _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(value, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	sums = _mm_add_ss(sums, shuffled);
+	return _mm_cvtss_f32(sums);
+}
+#endif
+
+// Fits a line through the colors of the block: the endpoints are the extremes of the colors along their principal axis.
+// That's much better than the corners of the bounding box for blocks with a gradient that isn't along the box's diagonal.
+static void FindEndpoints(const BlockPixels& pixels, float minColor[3], float maxColor[3])
+{
+	float mean[3];
+	float covariance[6];
+
+#ifdef BLOCK_COMPRESSION_SSE2
+	__m128 sumR = _mm_setzero_ps();
+	__m128 sumG = _mm_setzero_ps();
+	__m128 sumB = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4)
+	{
+		sumR = _mm_add_ps(sumR, _mm_loadu_ps(pixels.r + i));
+		sumG = _mm_add_ps(sumG, _mm_loadu_ps(pixels.g + i));
+		sumB = _mm_add_ps(sumB, _mm_loadu_ps(pixels.b + i));
+	}
+	mean[0] = HorizontalSum(sumR) / 16.0f;
+	mean[1] = HorizontalSum(sumG) / 16.0f;
+	mean[2] = HorizontalSum(sumB) / 16.0f;
+
+	__m128 meanR = _mm_set1_ps(mean[0]);
+	__m128 meanG = _mm_set1_ps(mean[1]);
+	__m128 meanB = _mm_set1_ps(mean[2]);
+	__m128 rr = _mm_setzero_ps();
+	__m128 rg = _mm_setzero_ps();
+	__m128 rb = _mm_setzero_ps();
+	__m128 gg = _mm_setzero_ps();
+	__m128 gb = _mm_setzero_ps();
+	__m128 bb = _mm_setzero_ps();
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 r = _mm_sub_ps(_mm_loadu_ps(pixels.r + i), meanR);
+		__m128 g = _mm_sub_ps(_mm_loadu_ps(pixels.g + i), meanG);
+		__m128 b = _mm_sub_ps(_mm_loadu_ps(pixels.b + i), meanB);
+		rr = _mm_add_ps(rr, _mm_mul_ps(r, r));
+		rg = _mm_add_ps(rg, _mm_mul_ps(r, g));
+		rb = _mm_add_ps(rb, _mm_mul_ps(r, b));
+		gg = _mm_add_ps(gg, _mm_mul_ps(g, g));
+		gb = _mm_add_ps(gb, _mm_mul_ps(g, b));
+		bb = _mm_add_ps(bb, _mm_mul_ps(b, b));
+	}
+	covariance[0] = HorizontalSum(rr);
+	covariance[1] = HorizontalSum(rg);
+	covariance[2] = HorizontalSum(rb);
+	covariance[3] = HorizontalSum(gg);
+	covariance[4] = HorizontalSum(gb);
+	covariance[5] = HorizontalSum(bb);
+#else
+	mean[0] = mean[1] = mean[2] = 0.0f;
+	for (int i = 0; i < 16; ++i)
+	{
+		mean[0] += pixels.r[i];
+		mean[1] += pixels.g[i];
+		mean[2] += pixels.b[i];
+	}
+	mean[0] /= 16.0f;
+	mean[1] /= 16.0f;
+	mean[2] /= 16.0f;
+
+	for (int i = 0; i < 6; ++i)
+		covariance[i] = 0.0f;
+
+	for (int i = 0; i < 16; ++i)
+	{
+		float r = pixels.r[i] - mean[0];
+		float g = pixels.g[i] - mean[1];
+		float b = pixels.b[i] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+#endif
+
+	// Power iteration converges to the eigenvector with the largest eigenvalue, the direction the colors vary most in.
+	// Start from the row of the channel that varies most, so the start is never perpendicular to the answer.
+	float axis[3];
+	if (covariance[0] >= covariance[3] && covariance[0] >= covariance[5])
+	{
+		axis[0] = covariance[0]; axis[1] = covariance[1]; axis[2] = covariance[2];
+	}
+	else if (covariance[3] >= covariance[5])
+	{
+		axis[0] = covariance[1]; axis[1] = covariance[3]; axis[2] = covariance[4];
+	}
+	else
+	{
+		axis[0] = covariance[2]; axis[1] = covariance[4]; axis[2] = covariance[5];
+	}
+
+	for (int iteration = 0; iteration < 8; ++iteration)
+	{
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+		float largest = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+		if (largest < 1e-6f)
+			break;
+
+		axis[0] = x / largest;
+		axis[1] = y / largest;
+		axis[2] = z / largest;
+	}
+
+	float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	if (length < 1e-6f)
+	{
+		// Every pixel has the same color
+		for (int c = 0; c < 3; ++c)
+			minColor[c] = maxColor[c] = mean[c];
+		return;
+	}
+
+	axis[0] /= length;
+	axis[1] /= length;
+	axis[2] /= length;
+
+	float minT = 0.0f;
+	float maxT = 0.0f;
+	for (int i = 0; i < 16; ++i)
+	{
+		float t = (pixels.r[i] - mean[0]) * axis[0] + (pixels.g[i] - mean[1]) * axis[1] + (pixels.b[i] - mean[2]) * axis[2];
+		minT = std::min(minT, t);
+		maxT = std::max(maxT, t);
+	}
+
+	for (int c = 0; c < 3; ++c)
+	{
+		minColor[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+		maxColor[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+	}
+}
+
+// Picks the closest of the 4 palette colors for every pixel.
+// The palette lies on a line, so projecting a pixel onto the line and rounding gives the closest color.
+static unsigned int SelectColorIndices(const BlockPixels& pixels, const int color0[3], const int color1[3])
+{
+	float dr = (float)(color1[0] - color0[0]);
+	float dg = (float)(color1[1] - color0[1]);
+	float db = (float)(color1[2] - color0[2]);
+	float lengthSquared = dr * dr + dg * dg + db * db;
+	if (lengthSquared == 0.0f)
+		return 0;
+
+	// Position along the line, 0 is color0 and 3 is color1.
+	// In the block the order is color0, color1, 2/3 color0 + 1/3 color1, 1/3 color0 + 2/3 color1.
+	static const unsigned int indexOfStep[4] = { 0, 2, 3, 1 };
+	float scale = 3.0f / lengthSquared;
+	int steps[16];
+
+#ifdef BLOCK_COMPRESSION_SSE2
+	__m128 r0 = _mm_set1_ps((float)color0[0]);
+	__m128 g0 = _mm_set1_ps((float)color0[1]);
+	__m128 b0 = _mm_set1_ps((float)color0[2]);
+	__m128 directionR = _mm_set1_ps(dr * scale);
+	__m128 directionG = _mm_set1_ps(dg * scale);
+	__m128 directionB = _mm_set1_ps(db * scale);
+	__m128 zero = _mm_setzero_ps();
+	__m128 three = _mm_set1_ps(3.0f);
+
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pixels.r + i), r0), directionR);
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pixels.g + i), g0), directionG));
+		t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(pixels.b + i), b0), directionB));
+		t = _mm_min_ps(_mm_max_ps(t, zero), three);
+
+		// Rounds to the nearest integer
+		_mm_storeu_si128((__m128i*)(steps + i), _mm_cvtps_epi32(t));
+	}
+#else
+	for (int i = 0; i < 16; ++i)
+	{
+		float t = ((pixels.r[i] - color0[0]) * dr + (pixels.g[i] - color0[1]) * dg + (pixels.b[i] - color0[2]) * db) * scale;
+		t = std::min(std::max(t, 0.0f), 3.0f);
+		steps[i] = (int)(t + 0.5f);
+	}
+#endif
+
+	unsigned int indices = 0;
+	for (int i = 0; i < 16; ++i)
+		indices |= indexOfStep[steps[i]] << (i * 2);
+
+	return indices;
+}
+
+static void CompressColorBlock(const unsigned char* rgba, unsigned char* block)
+{
+	BlockPixels pixels;
+	LoadBlockPixels(rgba, pixels);
+
+	float minColor[3];
+	float maxColor[3];
+	FindEndpoints(pixels, minColor, maxColor);
+
+	// color0 has to be the larger number, otherwise the GPU reads the block in 3 color mode with transparent black.
+	unsigned short packed0 = Pack565(maxColor);
+	unsigned short packed1 = Pack565(minColor);
+	if (packed0 < packed1)
+		std::swap(packed0, packed1);
+
+	// When both are the same every index is 0 and the mode doesn't matter
+	unsigned int indices = 0;
+	if (packed0 != packed1)
+	{
+		int color0[3];
+		int color1[3];
+		Unpack565(packed0, color0);
+		Unpack565(packed1, color1);
+		indices = SelectColorIndices(pixels, color0, color1);
+	}
+
+	block[0] = (unsigned char)(packed0 & 0xFF);
+	block[1] = (unsigned char)(packed0 >> 8);
+	block[2] = (unsigned char)(packed1 & 0xFF);
+	block[3] = (unsigned char)(packed1 >> 8);
+	for (int i = 0; i < 4; ++i)
+		block[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+}
+
+static void CompressAlphaBlock(const unsigned char* rgba, unsigned char* block)
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; ++i)
+	{
+		minAlpha = std::min(minAlpha, (int)rgba[i * 4 + 3]);
+		maxAlpha = std::max(maxAlpha, (int)rgba[i * 4 + 3]);
+	}
+
+	// With alpha0 > alpha1 there are 6 values between them, alpha0 first.
+	// Step 0 is alpha0 and step 7 is alpha1, the steps in between have index 2 to 7.
+	static const unsigned long long indexOfStep[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+
+	unsigned long long indices = 0;
+	if (maxAlpha > minAlpha)
+	{
+		float scale = 7.0f / (maxAlpha - minAlpha);
+		for (int i = 0; i < 16; ++i)
+		{
+			int step = (int)((maxAlpha - rgba[i * 4 + 3]) * scale + 0.5f);
+			indices |= indexOfStep[step] << (i * 3);
+		}
+	}
+
+	block[0] = (unsigned char)maxAlpha;
+	block[1] = (unsigned char)minAlpha;
+	for (int i = 0; i < 6; ++i)
+		block[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+}
+
+static void DecompressColorBlock(const unsigned char* block, unsigned char* rgba, bool allowThreeColors)
+{
+	unsigned short packed0 = (unsigned short)(block[0] | (block[1] << 8));
+	unsigned short packed1 = (unsigned short)(block[2] | (block[3] << 8));
+
+	int palette[4][4];
+	Unpack565(packed0, palette[0]);
+	Unpack565(packed1, palette[1]);
+	palette[0][3] = palette[1][3] = 255;
+
+	if (packed0 > packed1 || !allowThreeColors)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		palette[2][3] = palette[3][3] = 255;
+	}
+	else
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = 0;
+	}
+
+	unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+	for (int i = 0; i < 16; ++i)
+	{
+		const int* color = palette[(indices >> (i * 2)) & 3];
+		for (int c = 0; c < 4; ++c)
+			rgba[i * 4 + c] = (unsigned char)color[c];
+	}
+}
+
+static void DecompressAlphaBlock(const unsigned char* block, unsigned char* rgba)
+{
+	int palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+
+	if (palette[0] > palette[1])
+	{
+		for (int i = 1; i < 7; ++i)
+			palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; ++i)
+			palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	unsigned long long indices = 0;
+	for (int i = 0; i < 6; ++i)
+		indices |= (unsigned long long)block[2 + i] << (i * 8);
+
+	for (int i = 0; i < 16; ++i)
+		rgba[i * 4 + 3] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+}
+
+bool IsBlockCompressed(TextureFormat format)
+{
+	return format == TextureFormat::BC1 || format == TextureFormat::BC3;
+}
+
+size_t GetBlockBytes(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return 8;
+	case TextureFormat::BC3:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+size_t GetTextureBytes(TextureFormat format, int width, int height)
+{
+	if (IsBlockCompressed(format))
+		return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+
+	return (size_t)width * height * GetBlockBytes(format);
+}
+
+void CompressBC1Block(const unsigned char* rgba, unsigned char* block)
+{
+	CompressColorBlock(rgba, block);
+}
+
+void CompressBC3Block(const unsigned char* rgba, unsigned char* block)
+{
+	CompressAlphaBlock(rgba, block);
+	CompressColorBlock(rgba, block + 8);
+}
+
+void DecompressBC1Block(const unsigned char* block, unsigned char* rgba)
+{
+	DecompressColorBlock(block, rgba, true);
+}
+
+void DecompressBC3Block(const unsigned char* block, unsigned char* rgba)
+{
+	// The color part of BC3 is always read with 4 colors
+	DecompressColorBlock(block + 8, rgba, false);
+	DecompressAlphaBlock(block, rgba);
+}
+
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, int width, int height, TextureFormat format)
+{
+	if (!IsBlockCompressed(format))
+		return std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4);
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+	std::vector<unsigned char> blocks(GetTextureBytes(format, width, height));
+
+	unsigned char pixels[64];
+	for (int blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (int blockX = 0; blockX < blocksX; ++blockX)
+		{
+			for (int y = 0; y < 4; ++y)
+			{
+				int sourceY = std::min(blockY * 4 + y, height - 1);
+				for (int x = 0; x < 4; ++x)
+				{
+					int sourceX = std::min(blockX * 4 + x, width - 1);
+					std::memcpy(pixels + (y * 4 + x) * 4, rgba + ((size_t)sourceY * width + sourceX) * 4, 4);
+				}
+			}
+
+			unsigned char* block = &blocks[((size_t)blockY * blocksX + blockX) * blockBytes];
+			if (format == TextureFormat::BC1)
+				CompressBC1Block(pixels, block);
+			else
+				CompressBC3Block(pixels, block);
+		}
+	}
+
+	return blocks;
+}
+
+std::vector<unsigned char> DecompressImage(const unsigned char* blocks, int width, int height, TextureFormat format)
+{
+	if (!IsBlockCompressed(format))
+		return std::vector<unsigned char>(blocks, blocks + (size_t)width * height * 4);
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+	std::vector<unsigned char> rgba((size_t)width * height * 4);
+
+	unsigned char pixels[64];
+	for (int blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (int blockX = 0; blockX < blocksX; ++blockX)
+		{
+			const unsigned char* block = blocks + ((size_t)blockY * blocksX + blockX) * blockBytes;
+			if (format == TextureFormat::BC1)
+				DecompressBC1Block(block, pixels);
+			else
+				DecompressBC3Block(block, pixels);
+
+			for (int y = 0; y < 4 && blockY * 4 + y < height; ++y)
+			{
+				for (int x = 0; x < 4 && blockX * 4 + x < width; ++x)
+					std::memcpy(&rgba[((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4], pixels + (y * 4 + x) * 4, 4);
+			}
+		}
+	}
+
+	return rgba;
+}
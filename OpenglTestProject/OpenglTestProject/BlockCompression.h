@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Formats a texture can be stored in on disk and on the GPU.
+// BC1 (DXT1) stores a 4x4 block of pixels in 8 bytes: 2 colors in 565 and a 2 bit index per pixel
+// picking one of 4 colors on the line between them. That's 8 times smaller than RGBA8, but without alpha.
+// BC3 (DXT5) adds 8 bytes per block for alpha: 2 alpha values and a 3 bit index per pixel, 4 times smaller than RGBA8.
+enum class TextureFormat
+{
+	RGBA8,
+	BC1,
+	BC3
+};
+
+bool IsBlockCompressed(TextureFormat format);
+
+// Bytes of a single 4x4 block, or of a single pixel for uncompressed formats
+size_t GetBlockBytes(TextureFormat format);
+
+// Bytes of a whole image. Block compressed images are padded to a multiple of 4 pixels.
+size_t GetTextureBytes(TextureFormat format, int width, int height);
+
+// Encode a single block of 4x4 RGBA8 pixels, stored row by row
+void CompressBC1Block(const unsigned char* rgba, unsigned char* block);
+void CompressBC3Block(const unsigned char* rgba, unsigned char* block);
+
+void DecompressBC1Block(const unsigned char* block, unsigned char* rgba);
+void DecompressBC3Block(const unsigned char* block, unsigned char* rgba);
+
+// Encodes a whole RGBA8 image. Blocks sticking out of the image repeat its edge pixels.
+std::vector<unsigned char> CompressImage(const unsigned char* rgba, int width, int height, TextureFormat format);
+
+// Decodes a block compressed image back to RGBA8, for when the GPU can't sample the compressed format.
+std::vector<unsigned char> DecompressImage(const unsigned char* blocks, int width, int height, TextureFormat format);
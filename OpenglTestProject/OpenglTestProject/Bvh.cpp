@@ -0,0 +1,637 @@
+#include "Bvh.h"
+
+#include <algorithm>
+#include <utility>
+#include <cfloat>
+#include <cmath>
+
+// SSE2 is always there on x64 and on x86 it's enabled with /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+// The operations the node tests need on the 4 children of a node
+#if defined(BVH_SSE2)
+typedef __m128 Lanes;
+static inline Lanes Broadcast(float value) { return _mm_set1_ps(value); }
+static inline Lanes Load(const float* values) { return _mm_loadu_ps(values); }
+static inline void Store(float* values, Lanes a) { _mm_storeu_ps(values, a); }
+static inline Lanes AddLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes SubtractLanes(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+static inline Lanes MultiplyLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes MinLanes(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+static inline Lanes MaxLanes(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+static inline int LessMask(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+static inline int LessEqualMask(Lanes a, Lanes b) { return _mm_movemask_ps(_mm_cmple_ps(a, b)); }
+#else
+struct Lanes
+{
+	float values[4];
+};
+
+template<typename Operation>
+static inline Lanes Combine(Lanes a, Lanes b, Operation operation)
+{
+	Lanes result;
+	for (int lane = 0; lane < 4; ++lane)
+		result.values[lane] = operation(a.values[lane], b.values[lane]);
+	return result;
+}
+
+template<typename Compare>
+static inline int CompareMask(Lanes a, Lanes b, Compare compare)
+{
+	int mask = 0;
+	for (int lane = 0; lane < 4; ++lane)
+		mask |= compare(a.values[lane], b.values[lane]) ? 1 << lane : 0;
+	return mask;
+}
+
+static inline Lanes Broadcast(float value) { return Lanes{ { value, value, value, value } }; }
+static inline Lanes Load(const float* values) { return Lanes{ { values[0], values[1], values[2], values[3] } }; }
+static inline void Store(float* values, Lanes a) { std::copy(a.values, a.values + 4, values); }
+static inline Lanes AddLanes(Lanes a, Lanes b) { return Combine(a, b, [](float x, float y) { return x + y; }); }
+static inline Lanes SubtractLanes(Lanes a, Lanes b) { return Combine(a, b, [](float x, float y) { return x - y; }); }
+static inline Lanes MultiplyLanes(Lanes a, Lanes b) { return Combine(a, b, [](float x, float y) { return x * y; }); }
+static inline Lanes MinLanes(Lanes a, Lanes b) { return Combine(a, b, [](float x, float y) { return x < y ? x : y; }); }
+static inline Lanes MaxLanes(Lanes a, Lanes b) { return Combine(a, b, [](float x, float y) { return x > y ? x : y; }); }
+static inline int LessMask(Lanes a, Lanes b) { return CompareMask(a, b, [](float x, float y) { return x < y; }); }
+static inline int LessEqualMask(Lanes a, Lanes b) { return CompareMask(a, b, [](float x, float y) { return x <= y; }); }
+#endif
+
+// Centroids are sorted into this many bins along every axis and the split is made between two of them
+static const int BinCount = 16;
+
+// Half the surface area of a box, which is all the heuristic needs to compare boxes
+static float GetSurfaceArea(const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 size = max - min;
+	return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+// A direction of 0 on an axis gives a huge number instead of infinity, which would become NaN for boxes touching the origin
+static glm::vec3 GetInverseDirection(const glm::vec3& direction)
+{
+	glm::vec3 inverse;
+	for (int axis = 0; axis < 3; ++axis)
+		inverse[axis] = 1.0f / (std::fabs(direction[axis]) > 1e-20f ? direction[axis] : 1e-20f);
+	return inverse;
+}
+
+struct RayLanes
+{
+	Lanes originX, originY, originZ;
+	Lanes inverseX, inverseY, inverseZ;
+};
+
+static RayLanes GetRayLanes(const glm::vec3& origin, const glm::vec3& direction)
+{
+	glm::vec3 inverse = GetInverseDirection(direction);
+	return RayLanes{ Broadcast(origin.x), Broadcast(origin.y), Broadcast(origin.z), Broadcast(inverse.x), Broadcast(inverse.y), Broadcast(inverse.z) };
+}
+
+// Slab test of the ray against 4 boxes (Kay and Kajiya). Writes where the ray enters the boxes to entry
+// and returns a bit for every box that it enters before maxDistance and leaves after 0.
+static int IntersectRay(const RayLanes& ray, const float* minX, const float* minY, const float* minZ,
+	const float* maxX, const float* maxY, const float* maxZ, float maxDistance, float* entry)
+{
+	Lanes x1 = MultiplyLanes(SubtractLanes(Load(minX), ray.originX), ray.inverseX);
+	Lanes x2 = MultiplyLanes(SubtractLanes(Load(maxX), ray.originX), ray.inverseX);
+	Lanes y1 = MultiplyLanes(SubtractLanes(Load(minY), ray.originY), ray.inverseY);
+	Lanes y2 = MultiplyLanes(SubtractLanes(Load(maxY), ray.originY), ray.inverseY);
+	Lanes z1 = MultiplyLanes(SubtractLanes(Load(minZ), ray.originZ), ray.inverseZ);
+	Lanes z2 = MultiplyLanes(SubtractLanes(Load(maxZ), ray.originZ), ray.inverseZ);
+
+	Lanes enter = MaxLanes(MaxLanes(MinLanes(x1, x2), MinLanes(y1, y2)), MaxLanes(MinLanes(z1, z2), Broadcast(0.0f)));
+	Lanes leave = MinLanes(MinLanes(MaxLanes(x1, x2), MaxLanes(y1, y2)), MinLanes(MaxLanes(z1, z2), Broadcast(maxDistance)));
+	Store(entry, enter);
+	return LessEqualMask(enter, leave);
+}
+
+Bvh::Bvh()
+	: m_LastDirtyNode(-1)
+	, m_BuildCost(0.0f)
+{
+}
+
+int Bvh::Add(const glm::vec3& min, const glm::vec3& max)
+{
+	m_Bounds.push_back(Bounds{ min, max });
+	m_ObjectNodes.push_back(-1);
+	return (int)m_Bounds.size() - 1;
+}
+
+void Bvh::Set(int object, const glm::vec3& min, const glm::vec3& max)
+{
+	m_Bounds[object] = Bounds{ min, max };
+
+	int node = m_ObjectNodes[object];
+	if (node >= 0)
+		m_LastDirtyNode = std::max(m_LastDirtyNode, node);
+
+	// The nodes above a dirty node are dirty already
+	for (; node >= 0 && !m_NodeDirty[node]; node = m_Nodes[node].parent)
+		m_NodeDirty[node] = 1;
+}
+
+void Bvh::Clear()
+{
+	m_Bounds.clear();
+	m_Nodes.clear();
+	m_Objects.clear();
+	m_ObjectNodes.clear();
+	m_NodeDirty.clear();
+	m_LastDirtyNode = -1;
+	m_BuildCost = 0.0f;
+}
+
+void Bvh::Build()
+{
+	int count = (int)m_Bounds.size();
+	m_Nodes.clear();
+	m_Objects.resize(count);
+	m_ObjectNodes.assign(count, -1);
+	m_LastDirtyNode = -1;
+
+	std::vector<BuildObject> objects(count);
+	for (int object = 0; object < count; ++object)
+	{
+		const Bounds& bounds = m_Bounds[object];
+		objects[object] = BuildObject{ bounds, (bounds.min + bounds.max) * 0.5f, (unsigned int)object };
+	}
+
+	// Every node but the last ones holds 4 children, so there are about a third as many nodes as objects
+	if (count > 0)
+	{
+		m_Nodes.reserve(count / 3 + 1);
+		BuildNode(-1, 0, count, objects);
+	}
+
+	for (int i = 0; i < count; ++i)
+		m_Objects[i] = objects[i].object;
+
+	m_NodeDirty.assign(m_Nodes.size(), 0);
+	m_BuildCost = GetCost();
+}
+
+int Bvh::BuildNode(int parent, int first, int count, std::vector<BuildObject>& objects)
+{
+	int node = (int)m_Nodes.size();
+	m_Nodes.push_back(Node());
+	m_Nodes[node].parent = parent;
+	m_Nodes[node].first = first;
+	m_Nodes[node].count = count;
+
+	// Split the objects in two and keep splitting the part with the largest surface area until there are 4 parts,
+	// which is where a binary tree would have the children of its children
+	int partFirst[4] = { first };
+	int partCount[4] = { count };
+	float partArea[4] = { 0.0f };
+	int partTotal = 1;
+	while (partTotal < 4)
+	{
+		int largest = -1;
+		for (int part = 0; part < partTotal; ++part)
+		{
+			if (partCount[part] > 1 && (largest < 0 || partArea[part] > partArea[largest]))
+				largest = part;
+		}
+
+		if (largest < 0)
+			break;
+
+		int end = partFirst[largest] + partCount[largest];
+		int split = Split(partFirst[largest], partCount[largest], objects, partArea[largest], partArea[partTotal]);
+		partCount[largest] = split - partFirst[largest];
+		partFirst[partTotal] = split;
+		partCount[partTotal] = end - split;
+		++partTotal;
+	}
+
+	// A part of one object is a child of the node itself
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		if (slot >= partTotal)
+		{
+			SetChild(m_Nodes[node], slot, EmptyChild, Bounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) });
+		}
+		else if (partCount[slot] == 1)
+		{
+			int object = (int)objects[partFirst[slot]].object;
+			m_ObjectNodes[object] = node;
+			SetChild(m_Nodes[node], slot, ~object, m_Bounds[object]);
+		}
+		else
+		{
+			int child = BuildNode(node, partFirst[slot], partCount[slot], objects);
+			SetChild(m_Nodes[node], slot, child, GetNodeBounds(child));
+		}
+	}
+
+	return node;
+}
+
+// Sorts the objects from first to first + count - 1 into two parts and returns where the second one starts
+int Bvh::Split(int first, int count, std::vector<BuildObject>& objects, float& firstArea, float& secondArea)
+{
+	glm::vec3 centroidMin(FLT_MAX);
+	glm::vec3 centroidMax(-FLT_MAX);
+	for (int i = first; i < first + count; ++i)
+	{
+		centroidMin = glm::min(centroidMin, objects[i].centroid);
+		centroidMax = glm::max(centroidMax, objects[i].centroid);
+	}
+
+	glm::vec3 extent = centroidMax - centroidMin;
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+	float bestFirstArea = 0.0f;
+	float bestSecondArea = 0.0f;
+
+	// All three axes are binned in one pass over the objects. Most splits are of a few objects near the leaves,
+	// which get as many bins as objects so the sweeps over the bins don't take longer than the objects.
+	int binCount = std::min(count, BinCount);
+	Bounds bins[3][BinCount];
+	int binCounts[3][BinCount] = {};
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (int bin = 0; bin < binCount; ++bin)
+			bins[axis][bin] = Bounds{ glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	}
+
+	glm::vec3 scale(0.0f);
+	for (int axis = 0; axis < 3; ++axis)
+		scale[axis] = extent[axis] > 0.0f ? binCount / extent[axis] : 0.0f;
+
+	for (int i = first; i < first + count; ++i)
+	{
+		const BuildObject& object = objects[i];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			Bounds& bin = bins[axis][std::min((int)((object.centroid[axis] - centroidMin[axis]) * scale[axis]), binCount - 1)];
+			bin.min = glm::min(bin.min, object.bounds.min);
+			bin.max = glm::max(bin.max, object.bounds.max);
+			++binCounts[axis][&bin - bins[axis]];
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (extent[axis] <= 0.0f)
+			continue;
+
+		// The area and object count right of every split from one sweep to the left, then the cost of every split on the way back
+		float rightAreas[BinCount];
+		int rightCounts[BinCount];
+		Bounds right = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		int rightCount = 0;
+		for (int bin = binCount - 1; bin > 0; --bin)
+		{
+			right.min = glm::min(right.min, bins[axis][bin].min);
+			right.max = glm::max(right.max, bins[axis][bin].max);
+			rightCount += binCounts[axis][bin];
+			rightAreas[bin] = GetSurfaceArea(right.min, right.max);
+			rightCounts[bin] = rightCount;
+		}
+
+		Bounds left = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+		int leftCount = 0;
+		for (int bin = 1; bin < binCount; ++bin)
+		{
+			left.min = glm::min(left.min, bins[axis][bin - 1].min);
+			left.max = glm::max(left.max, bins[axis][bin - 1].max);
+			leftCount += binCounts[axis][bin - 1];
+			if (leftCount == 0 || rightCounts[bin] == 0)
+				continue;
+
+			float leftArea = GetSurfaceArea(left.min, left.max);
+			float cost = leftArea * leftCount + rightAreas[bin] * rightCounts[bin];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = bin;
+				bestFirstArea = leftArea;
+				bestSecondArea = rightAreas[bin];
+			}
+		}
+	}
+
+	// Objects with the same centroid can't be told apart by position, so they're split in half
+	if (bestAxis < 0)
+	{
+		int middle = first + count / 2;
+		Bounds bounds = GetBounds(first, count, objects);
+		firstArea = secondArea = GetSurfaceArea(bounds.min, bounds.max);
+		return middle;
+	}
+
+	firstArea = bestFirstArea;
+	secondArea = bestSecondArea;
+
+	auto split = std::partition(objects.begin() + first, objects.begin() + first + count, [&](const BuildObject& object)
+	{
+		return std::min((int)((object.centroid[bestAxis] - centroidMin[bestAxis]) * scale[bestAxis]), binCount - 1) < bestBin;
+	});
+	return (int)(split - objects.begin());
+}
+
+Bvh::Bounds Bvh::GetBounds(int first, int count, const std::vector<BuildObject>& objects)
+{
+	Bounds bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	for (int i = first; i < first + count; ++i)
+	{
+		bounds.min = glm::min(bounds.min, objects[i].bounds.min);
+		bounds.max = glm::max(bounds.max, objects[i].bounds.max);
+	}
+	return bounds;
+}
+
+Bvh::Bounds Bvh::GetNodeBounds(int node) const
+{
+	const Node& n = m_Nodes[node];
+	Bounds bounds = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		if (n.children[slot] == EmptyChild)
+			continue;
+
+		bounds.min = glm::min(bounds.min, glm::vec3(n.minX[slot], n.minY[slot], n.minZ[slot]));
+		bounds.max = glm::max(bounds.max, glm::vec3(n.maxX[slot], n.maxY[slot], n.maxZ[slot]));
+	}
+	return bounds;
+}
+
+void Bvh::SetChild(Node& node, int slot, int child, const Bounds& bounds)
+{
+	node.children[slot] = child;
+	node.minX[slot] = bounds.min.x;
+	node.minY[slot] = bounds.min.y;
+	node.minZ[slot] = bounds.min.z;
+	node.maxX[slot] = bounds.max.x;
+	node.maxY[slot] = bounds.max.y;
+	node.maxZ[slot] = bounds.max.z;
+}
+
+void Bvh::UpdateNode(int node)
+{
+	Node& n = m_Nodes[node];
+	for (int slot = 0; slot < 4; ++slot)
+	{
+		int child = n.children[slot];
+		if (child == EmptyChild)
+			continue;
+
+		SetChild(n, slot, child, child < 0 ? m_Bounds[~child] : GetNodeBounds(child));
+	}
+}
+
+// Children always come after their parent, so going back from the last dirty node updates every node after the nodes below it
+void Bvh::Refit()
+{
+	for (int node = m_LastDirtyNode; node >= 0; --node)
+	{
+		if (!m_NodeDirty[node])
+			continue;
+
+		m_NodeDirty[node] = 0;
+		UpdateNode(node);
+	}
+
+	m_LastDirtyNode = -1;
+}
+
+// A query reaches a node about as often as its surface area relative to the root, and then tests its 4 children
+float Bvh::GetCost() const
+{
+	if (m_Nodes.empty())
+		return 0.0f;
+
+	Bounds root = GetNodeBounds(0);
+	float rootArea = GetSurfaceArea(root.min, root.max);
+	double area = 0.0;
+	for (int node = 0; node < (int)m_Nodes.size(); ++node)
+	{
+		Bounds bounds = GetNodeBounds(node);
+		area += GetSurfaceArea(bounds.min, bounds.max);
+	}
+
+	return rootArea > 0.0f ? (float)(area / rootArea) : (float)m_Nodes.size();
+}
+
+float Bvh::GetCostGrowth() const
+{
+	return m_BuildCost > 0.0f ? GetCost() / m_BuildCost : 1.0f;
+}
+
+void Bvh::AppendObjects(int child, std::vector<unsigned int>& result) const
+{
+	if (child < 0)
+	{
+		result.push_back((unsigned int)~child);
+		return;
+	}
+
+	const Node& node = m_Nodes[child];
+	result.insert(result.end(), m_Objects.begin() + node.first, m_Objects.begin() + node.first + node.count);
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const
+{
+	result.clear();
+	if (m_Nodes.empty())
+		return;
+
+	// Every node on the stack comes with the planes it isn't completely inside of, only those are tested on its children
+	const int AllPlanes = (1 << Frustum::PlaneCount) - 1;
+	std::vector<std::pair<int, int>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0, AllPlanes));
+
+	Lanes zero = Broadcast(0.0f);
+	while (!stack.empty())
+	{
+		const Node& node = m_Nodes[stack.back().first];
+		int planes = stack.back().second;
+		stack.pop_back();
+
+		int outside = 0;
+		int inside[Frustum::PlaneCount];
+		for (int i = 0; i < Frustum::PlaneCount; ++i)
+		{
+			inside[i] = 0xf;
+			if (!(planes & (1 << i)))
+				continue;
+
+			// Like Frustum::IsAabbVisible the corner furthest along the normal says whether a child is outside,
+			// and the corner furthest against it whether the child is completely inside
+			const glm::vec4& plane = frustum.GetPlane(i);
+			Lanes normalX = Broadcast(plane.x);
+			Lanes normalY = Broadcast(plane.y);
+			Lanes normalZ = Broadcast(plane.z);
+			Lanes distance = Broadcast(plane.w);
+
+			Lanes outerX = Load(plane.x >= 0.0f ? node.maxX : node.minX);
+			Lanes outerY = Load(plane.y >= 0.0f ? node.maxY : node.minY);
+			Lanes outerZ = Load(plane.z >= 0.0f ? node.maxZ : node.minZ);
+			Lanes innerX = Load(plane.x >= 0.0f ? node.minX : node.maxX);
+			Lanes innerY = Load(plane.y >= 0.0f ? node.minY : node.maxY);
+			Lanes innerZ = Load(plane.z >= 0.0f ? node.minZ : node.maxZ);
+
+			Lanes outer = AddLanes(AddLanes(AddLanes(MultiplyLanes(normalX, outerX), MultiplyLanes(normalY, outerY)), MultiplyLanes(normalZ, outerZ)), distance);
+			Lanes inner = AddLanes(AddLanes(AddLanes(MultiplyLanes(normalX, innerX), MultiplyLanes(normalY, innerY)), MultiplyLanes(normalZ, innerZ)), distance);
+			outside |= LessMask(outer, zero);
+			inside[i] = ~LessMask(inner, zero) & 0xf;
+		}
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			int child = node.children[slot];
+			if (child == EmptyChild || (outside & (1 << slot)))
+				continue;
+
+			int childPlanes = 0;
+			for (int i = 0; i < Frustum::PlaneCount; ++i)
+			{
+				if ((planes & (1 << i)) && !(inside[i] & (1 << slot)))
+					childPlanes |= 1 << i;
+			}
+
+			if (child < 0 || childPlanes == 0)
+				AppendObjects(child, result);
+			else
+				stack.push_back(std::make_pair(child, childPlanes));
+		}
+	}
+}
+
+void Bvh::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<unsigned int>& result) const
+{
+	result.clear();
+	if (m_Nodes.empty())
+		return;
+
+	RayLanes ray = GetRayLanes(origin, direction);
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+
+		float entry[4];
+		int hits = IntersectRay(ray, node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, maxDistance, entry);
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			int child = node.children[slot];
+			if (child == EmptyChild || !(hits & (1 << slot)))
+				continue;
+
+			if (child < 0)
+				result.push_back((unsigned int)~child);
+			else
+				stack.push_back(child);
+		}
+	}
+}
+
+int Bvh::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance) const
+{
+	if (m_Nodes.empty())
+		return -1;
+
+	// Nodes are visited from near to far, so once a box was hit the nodes further away than it are skipped
+	RayLanes ray = GetRayLanes(origin, direction);
+	std::vector<std::pair<float, int>> stack;
+	stack.reserve(64);
+	stack.push_back(std::make_pair(0.0f, 0));
+
+	int closest = -1;
+	float closestDistance = maxDistance;
+	while (!stack.empty())
+	{
+		float nodeEntry = stack.back().first;
+		const Node& node = m_Nodes[stack.back().second];
+		stack.pop_back();
+		if (nodeEntry > closestDistance)
+			continue;
+
+		float entry[4];
+		int hits = IntersectRay(ray, node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ, closestDistance, entry);
+
+		std::pair<float, int> children[4];
+		int childCount = 0;
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			int child = node.children[slot];
+			if (child == EmptyChild || !(hits & (1 << slot)))
+				continue;
+
+			if (child >= 0)
+				children[childCount++] = std::make_pair(entry[slot], child);
+			else if (entry[slot] < closestDistance || closest < 0)
+			{
+				closest = ~child;
+				closestDistance = entry[slot];
+			}
+		}
+
+		// The nearest child goes on top
+		for (int i = 1; i < childCount; ++i)
+		{
+			for (int j = i; j > 0 && children[j].first > children[j - 1].first; --j)
+				std::swap(children[j], children[j - 1]);
+		}
+		stack.insert(stack.end(), children, children + childCount);
+	}
+
+	if (closest >= 0 && distance)
+		*distance = closestDistance;
+	return closest;
+}
+
+void Bvh::QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const
+{
+	result.clear();
+	if (m_Nodes.empty())
+		return;
+
+	Lanes centerX = Broadcast(center.x);
+	Lanes centerY = Broadcast(center.y);
+	Lanes centerZ = Broadcast(center.z);
+	Lanes radiusSquared = Broadcast(radius * radius);
+	Lanes zero = Broadcast(0.0f);
+
+	std::vector<int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = m_Nodes[stack.back()];
+		stack.pop_back();
+
+		// How far the center is outside of every child along each axis, 0 when it's between the sides
+		Lanes x = AddLanes(MaxLanes(SubtractLanes(Load(node.minX), centerX), zero), MaxLanes(SubtractLanes(centerX, Load(node.maxX)), zero));
+		Lanes y = AddLanes(MaxLanes(SubtractLanes(Load(node.minY), centerY), zero), MaxLanes(SubtractLanes(centerY, Load(node.maxY)), zero));
+		Lanes z = AddLanes(MaxLanes(SubtractLanes(Load(node.minZ), centerZ), zero), MaxLanes(SubtractLanes(centerZ, Load(node.maxZ)), zero));
+		Lanes distanceSquared = AddLanes(AddLanes(MultiplyLanes(x, x), MultiplyLanes(y, y)), MultiplyLanes(z, z));
+		int hits = LessEqualMask(distanceSquared, radiusSquared);
+
+		for (int slot = 0; slot < 4; ++slot)
+		{
+			int child = node.children[slot];
+			if (child == EmptyChild || !(hits & (1 << slot)))
+				continue;
+
+			if (child < 0)
+				result.push_back((unsigned int)~child);
+			else
+				stack.push_back(child);
+		}
+	}
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+#include <vector>
+
+// Bounding volume hierarchy over the AABBs of the objects in a scene, for culling and queries that shouldn't look at every object.
+// Every node has up to 4 children, which are other nodes or objects, and keeps their bounds as one array per component
+// so all 4 are tested against a frustum, ray or sphere in one go with SSE2.
+// Built top down by splitting the objects where the surface area heuristic over binned centroids says
+// (Wald, "On fast Construction of SAH-based Bounding Volume Hierarchies").
+// Moving objects only refits the nodes above them, which keeps the queries right but makes the tree slower
+// the further they move from where they were built, so build again when GetCostGrowth gets too high.
+// Doesn't touch OpenGL, so it can run on any thread.
+class Bvh
+{
+public:
+	Bvh();
+
+	// Returns the index of the object. Objects added after Build are only found after the next Build.
+	int Add(const glm::vec3& min, const glm::vec3& max);
+
+	// The nodes above the object are updated by the next Refit
+	void Set(int object, const glm::vec3& min, const glm::vec3& max);
+
+	void Clear();
+
+	void Build();
+	void Refit();
+
+	// How much more the surface area heuristic says a query costs than right after Build
+	float GetCostGrowth() const;
+
+	int GetCount() const { return (int)m_Bounds.size(); }
+	int GetNodeCount() const { return (int)m_Nodes.size(); }
+	const glm::vec3& GetMin(int object) const { return m_Bounds[object].min; }
+	const glm::vec3& GetMax(int object) const { return m_Bounds[object].max; }
+
+	// The queries write the indices of the objects whose box they touch to result, in no particular order.
+	// Children of a node that is completely inside the frustum aren't tested anymore.
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result) const;
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<unsigned int>& result) const;
+	void QuerySphere(const glm::vec3& center, float radius, std::vector<unsigned int>& result) const;
+
+	// Returns the object whose box the ray enters first, or -1 when it hits none before maxDistance.
+	// Distances are in lengths of direction, the one to the box is written to distance.
+	int Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance = nullptr) const;
+
+private:
+	struct Bounds
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+
+	struct Node
+	{
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+
+		// The index of a child node, ~object for an object or EmptyChild
+		int children[4];
+
+		int parent;
+
+		// The objects below the node are m_Objects[first] to m_Objects[first + count - 1]
+		int first;
+		int count;
+	};
+
+	// Build sorts these instead of the object indices, so splitting reads them one after the other
+	struct BuildObject
+	{
+		Bounds bounds;
+		glm::vec3 centroid;
+		unsigned int object;
+	};
+
+	static const int EmptyChild = -0x7fffffff - 1;
+
+	int BuildNode(int parent, int first, int count, std::vector<BuildObject>& objects);
+	static int Split(int first, int count, std::vector<BuildObject>& objects, float& firstArea, float& secondArea);
+	static Bounds GetBounds(int first, int count, const std::vector<BuildObject>& objects);
+	Bounds GetNodeBounds(int node) const;
+	void SetChild(Node& node, int slot, int child, const Bounds& bounds);
+	void UpdateNode(int node);
+	void AppendObjects(int child, std::vector<unsigned int>& result) const;
+	float GetCost() const;
+
+	std::vector<Bounds> m_Bounds;
+	std::vector<Node> m_Nodes;
+
+	// Object indices in the order of the leaves, so every node covers a range of them
+	std::vector<unsigned int> m_Objects;
+
+	// The node the object is a child of, -1 when it was added after Build
+	std::vector<int> m_ObjectNodes;
+
+	// Set marks the nodes from the object up to the root, Refit updates them from the last one back
+	std::vector<char> m_NodeDirty;
+	int m_LastDirtyNode;
+
+	float m_BuildCost;
+};
@@ -0,0 +1,225 @@
+#include "DdsFile.h"
+#include "MipGenerator.h"
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <algorithm>
+
+// DDS is a 4 byte magic number followed by a 124 byte header of 31 little endian 32 bit values,
+// after that the levels follow each other without any padding.
+static const unsigned int DdsMagic = 0x20534444; // "DDS "
+static const size_t DdsHeaderSize = 124;
+
+// Positions of the values in the header, counted in 32 bit values
+enum DdsHeaderField
+{
+	HeaderSize = 0,
+	HeaderFlags = 1,
+	HeaderHeight = 2,
+	HeaderWidth = 3,
+	HeaderPitchOrLinearSize = 4,
+	HeaderMipMapCount = 6,
+	PixelFormatSize = 18,
+	PixelFormatFlags = 19,
+	PixelFormatFourCC = 20,
+	PixelFormatBitCount = 21,
+	PixelFormatRedMask = 22,
+	PixelFormatGreenMask = 23,
+	PixelFormatBlueMask = 24,
+	PixelFormatAlphaMask = 25,
+	HeaderCaps = 26,
+	HeaderFieldCount = 31
+};
+
+static const unsigned int DdsdCaps = 0x1;
+static const unsigned int DdsdHeight = 0x2;
+static const unsigned int DdsdWidth = 0x4;
+static const unsigned int DdsdPitch = 0x8;
+static const unsigned int DdsdPixelFormat = 0x1000;
+static const unsigned int DdsdMipMapCount = 0x20000;
+static const unsigned int DdsdLinearSize = 0x80000;
+
+static const unsigned int DdpfAlphaPixels = 0x1;
+static const unsigned int DdpfFourCC = 0x4;
+static const unsigned int DdpfRgb = 0x40;
+
+static const unsigned int DdsCapsComplex = 0x8;
+static const unsigned int DdsCapsTexture = 0x1000;
+static const unsigned int DdsCapsMipMap = 0x400000;
+
+static unsigned int MakeFourCC(char a, char b, char c, char d)
+{
+	return (unsigned int)(unsigned char)a | ((unsigned int)(unsigned char)b << 8) | ((unsigned int)(unsigned char)c << 16) | ((unsigned int)(unsigned char)d << 24);
+}
+
+static unsigned int ReadUInt(const unsigned char* data)
+{
+	return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+bool ParseDds(const unsigned char* data, size_t size, TextureImage& image)
+{
+	if (size < 4 + DdsHeaderSize || ReadUInt(data) != DdsMagic)
+	{
+		std::cout << "Not a DDS file\n";
+		return false;
+	}
+
+	unsigned int header[HeaderFieldCount];
+	for (int i = 0; i < HeaderFieldCount; ++i)
+		header[i] = ReadUInt(data + 4 + i * 4);
+
+	if (header[HeaderSize] != DdsHeaderSize)
+	{
+		std::cout << "DDS header has an unexpected size\n";
+		return false;
+	}
+
+	unsigned int pixelFlags = header[PixelFormatFlags];
+	if (pixelFlags & DdpfFourCC)
+	{
+		unsigned int fourCC = header[PixelFormatFourCC];
+		if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+			image.format = TextureFormat::BC1;
+		else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+			image.format = TextureFormat::BC3;
+		else
+		{
+			// DX10 headers, BC7 and the other DXT variants aren't supported
+			std::cout << "Unsupported DDS format " << std::string((const char*)&data[4 + PixelFormatFourCC * 4], 4) << "\n";
+			return false;
+		}
+	}
+	else if ((pixelFlags & DdpfRgb) && header[PixelFormatBitCount] == 32
+		&& header[PixelFormatRedMask] == 0x000000FF && header[PixelFormatGreenMask] == 0x0000FF00
+		&& header[PixelFormatBlueMask] == 0x00FF0000)
+	{
+		image.format = TextureFormat::RGBA8;
+	}
+	else
+	{
+		std::cout << "Unsupported DDS pixel format\n";
+		return false;
+	}
+
+	if (header[HeaderWidth] == 0 || header[HeaderHeight] == 0 || header[HeaderWidth] > 0x7FFFFFFF || header[HeaderHeight] > 0x7FFFFFFF)
+	{
+		std::cout << "DDS file has an invalid size\n";
+		return false;
+	}
+
+	image.width = (int)header[HeaderWidth];
+	image.height = (int)header[HeaderHeight];
+	image.srgb = false;
+
+	// A chain never goes below 1x1, more levels than that would shift the size by 32 bits or more
+	int levelCount = 1;
+	if ((header[HeaderFlags] & DdsdMipMapCount) && header[HeaderMipMapCount] > 0)
+		levelCount = (int)std::min(header[HeaderMipMapCount], (unsigned int)GetMipLevelCount(image.width, image.height));
+
+	// The levels have to fit into the file, every one of them is at least a block
+	if ((size - 4 - DdsHeaderSize) / GetBlockBytes(image.format) < (size_t)levelCount)
+	{
+		std::cout << "DDS file is too small for " << levelCount << " levels\n";
+		return false;
+	}
+
+	image.levels.clear();
+
+	size_t offset = 4 + DdsHeaderSize;
+	for (int level = 0; level < levelCount; ++level)
+	{
+		TextureLevel textureLevel;
+		textureLevel.width = std::max(1, image.width >> level);
+		textureLevel.height = std::max(1, image.height >> level);
+		textureLevel.size = GetTextureBytes(image.format, textureLevel.width, textureLevel.height);
+
+		if (offset + textureLevel.size > size)
+		{
+			std::cout << "DDS file is cut off at level " << level << "\n";
+			return false;
+		}
+
+		textureLevel.data = data + offset;
+		offset += textureLevel.size;
+
+		image.levels.push_back(textureLevel);
+	}
+
+	return true;
+}
+
+bool WriteDds(const char* path, TextureFormat format, int width, int height, const std::vector<std::vector<unsigned char>>& levels)
+{
+	if (levels.empty())
+		return false;
+
+	unsigned int header[HeaderFieldCount] = {};
+	header[HeaderSize] = DdsHeaderSize;
+	header[HeaderFlags] = DdsdCaps | DdsdHeight | DdsdWidth | DdsdPixelFormat;
+	header[HeaderHeight] = (unsigned int)height;
+	header[HeaderWidth] = (unsigned int)width;
+	header[PixelFormatSize] = 32;
+	header[HeaderCaps] = DdsCapsTexture;
+
+	if (levels.size() > 1)
+	{
+		header[HeaderFlags] |= DdsdMipMapCount;
+		header[HeaderMipMapCount] = (unsigned int)levels.size();
+		header[HeaderCaps] |= DdsCapsComplex | DdsCapsMipMap;
+	}
+
+	if (IsBlockCompressed(format))
+	{
+		header[HeaderFlags] |= DdsdLinearSize;
+		header[HeaderPitchOrLinearSize] = (unsigned int)GetTextureBytes(format, width, height);
+		header[PixelFormatFlags] = DdpfFourCC;
+		header[PixelFormatFourCC] = format == TextureFormat::BC1 ? MakeFourCC('D', 'X', 'T', '1') : MakeFourCC('D', 'X', 'T', '5');
+	}
+	else
+	{
+		header[HeaderFlags] |= DdsdPitch;
+		header[HeaderPitchOrLinearSize] = (unsigned int)width * 4;
+		header[PixelFormatFlags] = DdpfRgb | DdpfAlphaPixels;
+		header[PixelFormatBitCount] = 32;
+		header[PixelFormatRedMask] = 0x000000FF;
+		header[PixelFormatGreenMask] = 0x0000FF00;
+		header[PixelFormatBlueMask] = 0x00FF0000;
+		header[PixelFormatAlphaMask] = 0xFF000000;
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	// Written byte by byte so the file is little endian on every machine
+	unsigned char bytes[4 + DdsHeaderSize];
+	unsigned int values[1 + HeaderFieldCount];
+	values[0] = DdsMagic;
+	std::copy(header, header + HeaderFieldCount, values + 1);
+	for (int i = 0; i < 1 + HeaderFieldCount; ++i)
+	{
+		for (int b = 0; b < 4; ++b)
+			bytes[i * 4 + b] = (unsigned char)((values[i] >> (b * 8)) & 0xFF);
+	}
+	file.write((const char*)bytes, sizeof(bytes));
+
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+		if (levels[level].size() != GetTextureBytes(format, levelWidth, levelHeight))
+		{
+			std::cout << "Level " << level << " of " << path << " has the wrong size\n";
+			return false;
+		}
+
+		file.write((const char*)levels[level].data(), levels[level].size());
+	}
+
+	return (bool)file;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "BlockCompression.h"
+
+#include <vector>
+#include <cstddef>
+
+// One mip level of a texture, pointing into memory owned by someone else
+struct TextureLevel
+{
+	int width;
+	int height;
+	const unsigned char* data;
+	size_t size;
+};
+
+struct TextureImage
+{
+	TextureFormat format;
+	int width;
+	int height;
+
+	// The colors are sRGB encoded and the GPU decodes them when they're sampled
+	bool srgb;
+
+	// Level 0 is the full size image, every next level is half the size
+	std::vector<TextureLevel> levels;
+
+	TextureImage() : format(TextureFormat::RGBA8), width(0), height(0), srgb(false) {}
+};
+
+// Reads the header of a DDS file in memory. The levels point into data, so it has to stay alive while they're used.
+// Only the formats in TextureFormat are supported: DXT1, DXT5 and 32 bit RGBA. Without a DX10 header DDS can't say
+// whether the colors are sRGB, so they never are.
+bool ParseDds(const unsigned char* data, size_t size, TextureImage& image);
+
+// Writes the levels to a DDS file, level 0 first.
+// Rows are stored in the order they're given, like every other loader here they're uploaded top row first.
+bool WriteDds(const char* path, TextureFormat format, int width, int height, const std::vector<std::vector<unsigned char>>& levels);
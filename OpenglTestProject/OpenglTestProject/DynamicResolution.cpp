@@ -0,0 +1,79 @@
+#include "DynamicResolution.h"
+
+#include <cmath>
+#include <algorithm>
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings)
+	: m_Settings(settings)
+{
+	Reset();
+}
+
+void DynamicResolution::SetSettings(const DynamicResolutionSettings& settings)
+{
+	m_Settings = settings;
+	m_Scale = Clamp(m_Scale);
+}
+
+bool DynamicResolution::Update(float gpuMilliseconds)
+{
+	if (!m_HasMeasurement)
+	{
+		m_SmoothedMilliseconds = gpuMilliseconds;
+		m_HasMeasurement = true;
+	}
+	else
+	{
+		m_SmoothedMilliseconds += (gpuMilliseconds - m_SmoothedMilliseconds) * m_Settings.smoothing;
+	}
+
+	if (m_Cooldown > 0)
+	{
+		--m_Cooldown;
+		return false;
+	}
+
+	float target = m_Settings.targetMilliseconds;
+	float scale = m_Scale;
+
+	if (m_SmoothedMilliseconds > target)
+	{
+		// The GPU time of the scene mostly depends on the amount of pixels, which goes with the square of the scale.
+		// Jump straight to the scale that should hit the target, rounded down to a step.
+		scale = m_Scale * std::sqrt(target / m_SmoothedMilliseconds);
+		scale = std::floor(scale / m_Settings.scaleStep) * m_Settings.scaleStep;
+	}
+	else if (m_SmoothedMilliseconds < target * m_Settings.increaseThreshold)
+	{
+		// Going up is done one step at a time, overshooting would cost a dropped frame.
+		scale = m_Scale + m_Settings.scaleStep;
+	}
+
+	scale = Clamp(scale);
+	if (std::fabs(scale - m_Scale) < 0.001f)
+		return false;
+
+	// Estimate what the GPU time will be at the new scale until the measurements catch up
+	m_SmoothedMilliseconds *= (scale * scale) / (m_Scale * m_Scale);
+	m_Scale = scale;
+	m_Cooldown = m_Settings.cooldownFrames;
+	return true;
+}
+
+void DynamicResolution::Reset()
+{
+	m_Scale = m_Settings.maxScale;
+	m_SmoothedMilliseconds = 0.0f;
+	m_HasMeasurement = false;
+	m_Cooldown = 0;
+}
+
+int DynamicResolution::GetScaledSize(int fullSize) const
+{
+	return std::max(1, (int)(fullSize * m_Scale + 0.5f));
+}
+
+float DynamicResolution::Clamp(float scale) const
+{
+	return std::min(std::max(scale, m_Settings.minScale), m_Settings.maxScale);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+struct DynamicResolutionSettings
+{
+	// GPU time the measured passes may take per frame
+	float targetMilliseconds = 8.0f;
+
+	// Bounds of the render scale, the size of the scene relative to the window on each axis
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+
+	// The scale only goes up again when the GPU time is below this fraction of the target,
+	// otherwise it would go back and forth between 2 steps around the target.
+	float increaseThreshold = 0.85f;
+
+	// The scale changes in steps of this size. A step only changes the viewport the scene is drawn with
+	// and how much of the targets the screen pass samples, the render targets keep their size.
+	float scaleStep = 0.05f;
+
+	// Weight of the newest measurement in the smoothed GPU time
+	float smoothing = 0.2f;
+
+	// Measurements arrive a few frames late, so after a change wait until they show its effect
+	int cooldownFrames = 10;
+};
+
+// Picks the render scale of the scene from GPU timings, so the frame rate stays stable when the load changes.
+// The scene is rendered into the lower left part of its full size targets and scaled up to the window by the screen pass,
+// so changing the scale never creates new render targets.
+class DynamicResolution
+{
+public:
+	explicit DynamicResolution(const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+
+	void SetSettings(const DynamicResolutionSettings& settings);
+	const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+	// Feed one new GPU measurement, returns true when the scale changed
+	bool Update(float gpuMilliseconds);
+
+	// Goes back to the maximum scale and forgets the measurements
+	void Reset();
+
+	float GetScale() const { return m_Scale; }
+	float GetSmoothedMilliseconds() const { return m_SmoothedMilliseconds; }
+
+	// Size in pixels of the scaled part of a full size target, at least 1
+	int GetScaledSize(int fullSize) const;
+
+private:
+	float Clamp(float scale) const;
+
+	DynamicResolutionSettings m_Settings;
+
+	float m_Scale;
+	float m_SmoothedMilliseconds;
+	bool m_HasMeasurement;
+	int m_Cooldown;
+};
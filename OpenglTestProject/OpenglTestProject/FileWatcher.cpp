@@ -0,0 +1,157 @@
+#include "FileWatcher.h"
+
+#include <iostream>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#endif
+
+// How often the fallback looks at the modification times
+static const std::chrono::milliseconds PollInterval(250);
+
+FileWatcher::FileWatcher()
+	: m_Inotify(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+	Destroy();
+}
+
+bool FileWatcher::Create()
+{
+	Destroy();
+
+#ifdef __linux__
+	m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_Inotify == -1)
+		std::cout << "inotify isn't available, looking at the modification times of watched files instead\n";
+#endif
+
+	m_LastCheck = std::chrono::steady_clock::now();
+	return true;
+}
+
+void FileWatcher::Destroy()
+{
+#ifdef __linux__
+	// Closing the descriptor removes all of its watches
+	if (m_Inotify != -1)
+		close(m_Inotify);
+#endif
+
+	m_Inotify = -1;
+	m_Files.clear();
+}
+
+void FileWatcher::GetFileTime(const std::string& path, long long& modified, long long& size)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+	{
+		modified = -1;
+		size = -1;
+		return;
+	}
+
+	modified = (long long)info.st_mtime;
+	size = (long long)info.st_size;
+}
+
+void FileWatcher::Watch(const std::string& path)
+{
+	for (const WatchedFile& file : m_Files)
+	{
+		if (file.path == path)
+			return;
+	}
+
+	size_t slash = path.find_last_of("/\\");
+
+	WatchedFile file;
+	file.path = path;
+	file.name = slash == std::string::npos ? path : path.substr(slash + 1);
+	file.watch = -1;
+	GetFileTime(path, file.modified, file.size);
+
+#ifdef __linux__
+	// Editors often save by writing a new file and renaming it over the old one, which a watch on the file itself
+	// would lose track of. The directory is watched instead, a directory that is watched already gives back the same watch.
+	if (m_Inotify != -1)
+	{
+		std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+		file.watch = inotify_add_watch(m_Inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (file.watch == -1)
+			std::cout << "Can't watch " << directory << "\n";
+	}
+#endif
+
+	m_Files.push_back(file);
+}
+
+std::vector<std::string> FileWatcher::Poll()
+{
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	if (m_Inotify != -1)
+	{
+		alignas(inotify_event) char buffer[4096];
+		for (;;)
+		{
+			ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+			if (length <= 0)
+				break;
+
+			for (char* next = buffer; next < buffer + length; next += sizeof(inotify_event) + ((inotify_event*)next)->len)
+			{
+				const inotify_event* event = (const inotify_event*)next;
+				if (event->len == 0)
+					continue;
+
+				for (const WatchedFile& file : m_Files)
+				{
+					if (file.watch == event->wd && file.name == event->name)
+						changed.push_back(file.path);
+				}
+			}
+		}
+	}
+#endif
+
+	// Files that couldn't get a watch, or all of them when there's no inotify
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_LastCheck >= PollInterval)
+	{
+		m_LastCheck = now;
+
+		for (WatchedFile& file : m_Files)
+		{
+			if (file.watch != -1)
+				continue;
+
+			long long modified, size;
+			GetFileTime(file.path, modified, size);
+
+			// The time only has a resolution of seconds on some file systems, the size catches most quick saves
+			if (modified != file.modified || size != file.size)
+			{
+				file.modified = modified;
+				file.size = size;
+				if (modified != -1)
+					changed.push_back(file.path);
+			}
+		}
+	}
+
+	std::sort(changed.begin(), changed.end());
+	changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+	return changed;
+}
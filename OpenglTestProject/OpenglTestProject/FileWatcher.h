@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Tells which of a set of files were written to, without ever blocking.
+// On Linux the directories of the files are watched with inotify, so a save is noticed the moment the editor closes the file.
+// Everywhere else the modification times are compared a few times per second.
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool Create();
+	void Destroy();
+
+	// The file doesn't have to exist yet, creating it counts as a change
+	void Watch(const std::string& path);
+
+	// Watched files that changed since the last call, with the path they were watched with.
+	// A file that was saved several times is in there once.
+	std::vector<std::string> Poll();
+
+private:
+	struct WatchedFile
+	{
+		std::string path;
+		std::string name;
+
+		// inotify watch of the directory
+		int watch;
+
+		// What the file looked like the last time it was checked, for the fallback
+		long long modified;
+		long long size;
+	};
+
+	static void GetFileTime(const std::string& path, long long& modified, long long& size);
+
+	std::vector<WatchedFile> m_Files;
+
+	int m_Inotify;
+	std::chrono::steady_clock::time_point m_LastCheck;
+};
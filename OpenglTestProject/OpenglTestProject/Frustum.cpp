@@ -0,0 +1,63 @@
+#include "Frustum.h"
+
+Frustum::Frustum()
+{
+	for (int i = 0; i < PlaneCount; ++i)
+		m_Planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Frustum::Frustum(const glm::mat4& viewProj)
+{
+	Extract(viewProj);
+}
+
+void Frustum::Extract(const glm::mat4& viewProj)
+{
+	// GLM stores matrices column by column, so gather the rows first.
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; ++i)
+		rows[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+	// A clip space point is inside when -w <= x <= w, -w <= y <= w and -w <= z <= w.
+	// Each of these 6 inequalities is a plane in world space.
+	m_Planes[Left] = rows[3] + rows[0];
+	m_Planes[Right] = rows[3] - rows[0];
+	m_Planes[Bottom] = rows[3] + rows[1];
+	m_Planes[Top] = rows[3] - rows[1];
+	m_Planes[Near] = rows[3] + rows[2];
+	m_Planes[Far] = rows[3] - rows[2];
+
+	// Normalize so the plane equation returns real distances, which the sphere test needs.
+	for (int i = 0; i < PlaneCount; ++i)
+		m_Planes[i] /= glm::length(glm::vec3(m_Planes[i]));
+}
+
+bool Frustum::IsSphereVisible(const glm::vec3& center, float radius) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		if (glm::dot(glm::vec3(m_Planes[i]), center) + m_Planes[i].w < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+bool Frustum::IsAabbVisible(const glm::vec3& min, const glm::vec3& max) const
+{
+	for (int i = 0; i < PlaneCount; ++i)
+	{
+		// Only the corner that lies furthest along the plane normal has to be tested.
+		// If even that one is outside, the whole box is.
+		glm::vec3 normal(m_Planes[i]);
+		glm::vec3 corner(
+			normal.x >= 0.0f ? max.x : min.x,
+			normal.y >= 0.0f ? max.y : min.y,
+			normal.z >= 0.0f ? max.z : min.z);
+
+		if (glm::dot(normal, corner) + m_Planes[i].w < 0.0f)
+			return false;
+	}
+
+	return true;
+}
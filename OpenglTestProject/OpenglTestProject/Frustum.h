@@ -0,0 +1,36 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// The view frustum is the part of the world that ends up on the screen.
+// It's bounded by 6 planes which can be read straight from the combined proj * view matrix
+// (Gribb & Hartmann, "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix").
+// Every plane is stored as (normal, distance) with the normal pointing into the frustum,
+// so a point p is inside when dot(normal, p) + distance >= 0 for all planes.
+class Frustum
+{
+public:
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		PlaneCount
+	};
+
+	Frustum();
+	explicit Frustum(const glm::mat4& viewProj);
+
+	void Extract(const glm::mat4& viewProj);
+
+	bool IsSphereVisible(const glm::vec3& center, float radius) const;
+	bool IsAabbVisible(const glm::vec3& min, const glm::vec3& max) const;
+
+	const glm::vec4& GetPlane(int index) const { return m_Planes[index]; }
+
+private:
+	glm::vec4 m_Planes[PlaneCount];
+};
@@ -0,0 +1,299 @@
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+// SSE2 is always there on x64 and on x86 it's enabled with /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+// The AVX loop is compiled into every x86 build and only runs when the CPU has AVX, so the program still starts on CPUs without it.
+// MSVC compiles AVX intrinsics without /arch:AVX, GCC and Clang need the target attribute on the functions that use them.
+#if defined(FRUSTUM_CULLER_SSE2) && (defined(_MSC_VER) || defined(__GNUC__))
+#define FRUSTUM_CULLER_AVX
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX_FUNCTION
+#else
+#define AVX_FUNCTION __attribute__((target("avx")))
+#endif
+#endif
+
+// The operations the culling loops need on a group of objects
+#if defined(FRUSTUM_CULLER_SSE2)
+typedef __m128 Lanes;
+static const size_t LaneCount = 4;
+static inline Lanes Broadcast(float value) { return _mm_set1_ps(value); }
+static inline Lanes Load(const float* values) { return _mm_loadu_ps(values); }
+static inline Lanes AddLanes(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+static inline Lanes MultiplyLanes(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+static inline Lanes MinLanes(Lanes a, Lanes b) { return _mm_min_ps(a, b); }
+static inline int NotNegative(Lanes a) { return _mm_movemask_ps(_mm_cmpge_ps(a, _mm_setzero_ps())); }
+#endif
+
+#if defined(FRUSTUM_CULLER_AVX)
+typedef __m256 WideLanes;
+static const size_t WideLaneCount = 8;
+AVX_FUNCTION static inline WideLanes BroadcastWide(float value) { return _mm256_set1_ps(value); }
+AVX_FUNCTION static inline WideLanes LoadWide(const float* values) { return _mm256_loadu_ps(values); }
+AVX_FUNCTION static inline WideLanes AddWide(WideLanes a, WideLanes b) { return _mm256_add_ps(a, b); }
+AVX_FUNCTION static inline WideLanes MultiplyWide(WideLanes a, WideLanes b) { return _mm256_mul_ps(a, b); }
+AVX_FUNCTION static inline WideLanes MinWide(WideLanes a, WideLanes b) { return _mm256_min_ps(a, b); }
+AVX_FUNCTION static inline int NotNegativeWide(WideLanes a) { return _mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_GE_OQ)); }
+
+// The CPU has to have AVX and the OS has to save the upper halves of the registers on a context switch
+static bool HasAvx()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+	return osSavesYmm && (info[2] & (1 << 28)) != 0;
+#else
+	// Checks the OS support as well
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+
+static bool UseAvx()
+{
+	static const bool useAvx = HasAvx();
+	return useAvx;
+}
+#endif
+
+// The arrays are padded to a multiple of the widest lanes, so the SIMD loops never need a scalar tail
+static const int Padding = 8;
+
+// A padding object is outside of every plane
+static const float NeverVisibleRadius = -1e30f;
+
+void TransformAabb(const glm::mat4& matrix, glm::vec3& min, glm::vec3& max)
+{
+	glm::vec3 newMin(matrix[3]);
+	glm::vec3 newMax(matrix[3]);
+
+	// Every element of the matrix scales one side of the box, the smaller product goes to the min and the larger to the max
+	for (int column = 0; column < 3; ++column)
+	{
+		for (int row = 0; row < 3; ++row)
+		{
+			float a = matrix[column][row] * min[column];
+			float b = matrix[column][row] * max[column];
+			newMin[row] += std::min(a, b);
+			newMax[row] += std::max(a, b);
+		}
+	}
+
+	min = newMin;
+	max = newMax;
+}
+
+FrustumCuller::FrustumCuller()
+	: m_Count(0)
+{
+}
+
+int FrustumCuller::Add(const glm::vec3& min, const glm::vec3& max)
+{
+	int object = m_Count++;
+	if ((size_t)m_Count > m_Radius.size())
+	{
+		size_t size = m_Radius.size() + Padding;
+		for (std::vector<float>* component : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ })
+			component->resize(size, 0.0f);
+		m_Radius.resize(size, NeverVisibleRadius);
+	}
+
+	Set(object, min, max);
+	return object;
+}
+
+int FrustumCuller::AddSphere(const glm::vec3& center, float radius)
+{
+	int object = Add(center, center);
+	SetSphere(object, center, radius);
+	return object;
+}
+
+void FrustumCuller::Set(int object, const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 extent = (max - min) * 0.5f;
+	Set(object, (min + max) * 0.5f, extent, glm::length(extent));
+}
+
+void FrustumCuller::SetSphere(int object, const glm::vec3& center, float radius)
+{
+	Set(object, center, glm::vec3(radius), radius);
+}
+
+void FrustumCuller::Set(int object, const glm::vec3& center, const glm::vec3& extent, float radius)
+{
+	m_CenterX[object] = center.x;
+	m_CenterY[object] = center.y;
+	m_CenterZ[object] = center.z;
+	m_ExtentX[object] = extent.x;
+	m_ExtentY[object] = extent.y;
+	m_ExtentZ[object] = extent.z;
+	m_Radius[object] = radius;
+}
+
+void FrustumCuller::Clear()
+{
+	m_Count = 0;
+	for (std::vector<float>* component : { &m_CenterX, &m_CenterY, &m_CenterZ, &m_ExtentX, &m_ExtentY, &m_ExtentZ, &m_Radius })
+		component->clear();
+}
+
+int FrustumCuller::GetLaneCount()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+	if (UseAvx())
+		return 8;
+#endif
+#if defined(FRUSTUM_CULLER_SSE2)
+	return 4;
+#else
+	return 1;
+#endif
+}
+
+// For every plane, the distance of the center minus whichever of the sphere and the box reaches less far towards the outside
+// is how far the object is inside. The smallest of these over all planes is negative when the object is outside of one.
+void FrustumCuller::Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+#if defined(FRUSTUM_CULLER_AVX)
+	if (UseAvx())
+	{
+		CullAvx(frustum, visible);
+		return;
+	}
+#endif
+
+#if defined(FRUSTUM_CULLER_SSE2)
+	Lanes normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+	Lanes absX[Frustum::PlaneCount], absY[Frustum::PlaneCount], absZ[Frustum::PlaneCount];
+	for (int i = 0; i < Frustum::PlaneCount; ++i)
+	{
+		const glm::vec4& plane = frustum.GetPlane(i);
+		normalX[i] = Broadcast(plane.x);
+		normalY[i] = Broadcast(plane.y);
+		normalZ[i] = Broadcast(plane.z);
+		distance[i] = Broadcast(plane.w);
+		absX[i] = Broadcast(std::fabs(plane.x));
+		absY[i] = Broadcast(std::fabs(plane.y));
+		absZ[i] = Broadcast(std::fabs(plane.z));
+	}
+
+	// Every lane writes its index and only moves the end on when it is visible, so there's room for one more group
+	visible.resize(m_Radius.size() + Padding);
+	unsigned int* out = visible.data();
+	size_t count = 0;
+
+	for (size_t first = 0; first < (size_t)m_Count; first += LaneCount)
+	{
+		Lanes x = Load(&m_CenterX[first]);
+		Lanes y = Load(&m_CenterY[first]);
+		Lanes z = Load(&m_CenterZ[first]);
+		Lanes extentX = Load(&m_ExtentX[first]);
+		Lanes extentY = Load(&m_ExtentY[first]);
+		Lanes extentZ = Load(&m_ExtentZ[first]);
+		Lanes radius = Load(&m_Radius[first]);
+
+		Lanes inside = Broadcast(1e30f);
+		for (int i = 0; i < Frustum::PlaneCount; ++i)
+		{
+			Lanes d = AddLanes(AddLanes(MultiplyLanes(normalX[i], x), MultiplyLanes(normalY[i], y)), AddLanes(MultiplyLanes(normalZ[i], z), distance[i]));
+			Lanes box = AddLanes(AddLanes(MultiplyLanes(absX[i], extentX), MultiplyLanes(absY[i], extentY)), MultiplyLanes(absZ[i], extentZ));
+			inside = MinLanes(inside, AddLanes(d, MinLanes(radius, box)));
+		}
+
+		int mask = NotNegative(inside);
+		for (size_t lane = 0; lane < LaneCount; ++lane)
+		{
+			out[count] = (unsigned int)(first + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	visible.resize(count);
+#else
+	CullScalar(frustum, visible);
+#endif
+}
+
+#if defined(FRUSTUM_CULLER_AVX)
+// The same as the SSE2 loop in Cull, 8 objects at a time
+AVX_FUNCTION void FrustumCuller::CullAvx(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+	WideLanes normalX[Frustum::PlaneCount], normalY[Frustum::PlaneCount], normalZ[Frustum::PlaneCount], distance[Frustum::PlaneCount];
+	WideLanes absX[Frustum::PlaneCount], absY[Frustum::PlaneCount], absZ[Frustum::PlaneCount];
+	for (int i = 0; i < Frustum::PlaneCount; ++i)
+	{
+		const glm::vec4& plane = frustum.GetPlane(i);
+		normalX[i] = BroadcastWide(plane.x);
+		normalY[i] = BroadcastWide(plane.y);
+		normalZ[i] = BroadcastWide(plane.z);
+		distance[i] = BroadcastWide(plane.w);
+		absX[i] = BroadcastWide(std::fabs(plane.x));
+		absY[i] = BroadcastWide(std::fabs(plane.y));
+		absZ[i] = BroadcastWide(std::fabs(plane.z));
+	}
+
+	visible.resize(m_Radius.size() + Padding);
+	unsigned int* out = visible.data();
+	size_t count = 0;
+
+	for (size_t first = 0; first < (size_t)m_Count; first += WideLaneCount)
+	{
+		WideLanes x = LoadWide(&m_CenterX[first]);
+		WideLanes y = LoadWide(&m_CenterY[first]);
+		WideLanes z = LoadWide(&m_CenterZ[first]);
+		WideLanes extentX = LoadWide(&m_ExtentX[first]);
+		WideLanes extentY = LoadWide(&m_ExtentY[first]);
+		WideLanes extentZ = LoadWide(&m_ExtentZ[first]);
+		WideLanes radius = LoadWide(&m_Radius[first]);
+
+		WideLanes inside = BroadcastWide(1e30f);
+		for (int i = 0; i < Frustum::PlaneCount; ++i)
+		{
+			WideLanes d = AddWide(AddWide(MultiplyWide(normalX[i], x), MultiplyWide(normalY[i], y)), AddWide(MultiplyWide(normalZ[i], z), distance[i]));
+			WideLanes box = AddWide(AddWide(MultiplyWide(absX[i], extentX), MultiplyWide(absY[i], extentY)), MultiplyWide(absZ[i], extentZ));
+			inside = MinWide(inside, AddWide(d, MinWide(radius, box)));
+		}
+
+		int mask = NotNegativeWide(inside);
+		for (size_t lane = 0; lane < WideLaneCount; ++lane)
+		{
+			out[count] = (unsigned int)(first + lane);
+			count += (mask >> lane) & 1;
+		}
+	}
+
+	// Without /arch:AVX the code around this uses the old SSE encoding, which is slow right after 256 bit instructions
+	_mm256_zeroupper();
+	visible.resize(count);
+}
+#endif
+
+void FrustumCuller::CullScalar(const Frustum& frustum, std::vector<unsigned int>& visible) const
+{
+	visible.clear();
+	for (int object = 0; object < m_Count; ++object)
+	{
+		float inside = 1e30f;
+		for (int i = 0; i < Frustum::PlaneCount; ++i)
+		{
+			const glm::vec4& plane = frustum.GetPlane(i);
+			float d = plane.x * m_CenterX[object] + plane.y * m_CenterY[object] + plane.z * m_CenterZ[object] + plane.w;
+			float box = std::fabs(plane.x) * m_ExtentX[object] + std::fabs(plane.y) * m_ExtentY[object] + std::fabs(plane.z) * m_ExtentZ[object];
+			inside = std::min(inside, d + std::min(m_Radius[object], box));
+		}
+
+		if (inside >= 0.0f)
+			visible.push_back((unsigned int)object);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+#include <vector>
+
+// The bounds of the box from min to max after the matrix, so they contain the transformed box (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+void TransformAabb(const glm::mat4& matrix, glm::vec3& min, glm::vec3& max);
+
+// Frustum culling for many objects at once. Every object has a bounding sphere and an AABB around the same center,
+// which are stored as one array per component so 8 objects are tested in one go with AVX, 4 with SSE2.
+// AVX is picked at runtime when the CPU has it, the build itself only needs SSE2.
+// An object is culled when its sphere or its box is completely outside one of the 6 planes of the Frustum.
+// Doesn't touch OpenGL, so it can run on any thread.
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+
+	// Returns the index of the object. Its bounding sphere is the one around the box.
+	int Add(const glm::vec3& min, const glm::vec3& max);
+
+	// An object with only a bounding sphere, its box is the one around the sphere
+	int AddSphere(const glm::vec3& center, float radius);
+
+	void Set(int object, const glm::vec3& min, const glm::vec3& max);
+	void SetSphere(int object, const glm::vec3& center, float radius);
+
+	void Clear();
+	int GetCount() const { return m_Count; }
+
+	// Writes the indices of the objects that are at least partly in the frustum to visible, in ascending order
+	void Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	// The same one object at a time, to compare with
+	void CullScalar(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	// 8 with AVX, 4 with SSE2 and 1 without either
+	static int GetLaneCount();
+
+private:
+	void CullAvx(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+	void Set(int object, const glm::vec3& center, const glm::vec3& extent, float radius);
+
+	int m_Count;
+
+	// Padded to a multiple of 8 with objects that are never visible
+	std::vector<float> m_CenterX;
+	std::vector<float> m_CenterY;
+	std::vector<float> m_CenterZ;
+	std::vector<float> m_ExtentX;
+	std::vector<float> m_ExtentY;
+	std::vector<float> m_ExtentZ;
+	std::vector<float> m_Radius;
+};
@@ -0,0 +1,430 @@
+#include "GpuCuller.h"
+#include "ShaderLibrary.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+const char* gpuCulledVertexSource = R"glsl(
+#version 150 core
+
+in vec3 position;
+in vec3 color;
+in mat4 instanceModel;
+
+out vec3 Color;
+
+uniform mat4 dequantization;
+uniform mat4 view;
+uniform mat4 proj;
+
+void main()
+{
+	Color = color;
+	gl_Position = proj * view * instanceModel * dequantization * vec4(position, 1.0f);
+}
+)glsl";
+
+const char* gpuCulledFragmentSource = R"glsl(
+#version 150 core
+
+in vec3 Color;
+
+out vec4 outColor;
+
+void main()
+{
+	outColor = vec4(Color, 1.0f);
+}
+)glsl";
+
+// The box around the mesh after the model matrix is found like TransformAabb does it,
+// then it's outside when it's completely behind one of the planes like in FrustumCuller
+static const char* cullVertexSource = R"glsl(
+#version 150 core
+
+in vec4 model0;
+in vec4 model1;
+in vec4 model2;
+in vec4 model3;
+
+out vec4 Model0;
+out vec4 Model1;
+out vec4 Model2;
+out vec4 Model3;
+out float Visible;
+
+uniform vec4 planes[6];
+uniform vec3 boundsCenter;
+uniform vec3 boundsExtent;
+
+void main()
+{
+	vec3 center = (mat4(model0, model1, model2, model3) * vec4(boundsCenter, 1.0f)).xyz;
+	vec3 extent = abs(model0.xyz) * boundsExtent.x + abs(model1.xyz) * boundsExtent.y + abs(model2.xyz) * boundsExtent.z;
+
+	Visible = 1.0f;
+	for (int i = 0; i < 6; ++i)
+	{
+		if (dot(planes[i].xyz, center) + planes[i].w < -dot(abs(planes[i].xyz), extent))
+			Visible = 0.0f;
+	}
+
+	Model0 = model0;
+	Model1 = model1;
+	Model2 = model2;
+	Model3 = model3;
+}
+)glsl";
+
+// Only visible instances are emitted, transform feedback packs them together in the output buffer
+static const char* cullGeometrySource = R"glsl(
+#version 150 core
+
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in vec4 Model0[];
+in vec4 Model1[];
+in vec4 Model2[];
+in vec4 Model3[];
+in float Visible[];
+
+out vec4 instance0;
+out vec4 instance1;
+out vec4 instance2;
+out vec4 instance3;
+
+void main()
+{
+	if (Visible[0] == 0.0f)
+		return;
+
+	instance0 = Model0[0];
+	instance1 = Model1[0];
+	instance2 = Model2[0];
+	instance3 = Model3[0];
+	EmitVertex();
+	EndPrimitive();
+}
+)glsl";
+
+// Points to the 4 columns of the matrices in buffer from location on, one matrix per vertex or per instance
+static void SpecifyMatrixAttributes(GLuint buffer, GLuint location, GLuint divisor)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (GLuint column = 0; column < 4; ++column)
+	{
+		glEnableVertexAttribArray(location + column);
+		glVertexAttribPointer(location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+		if (GLEW_VERSION_3_3)
+			glVertexAttribDivisor(location + column, divisor);
+		else
+			glVertexAttribDivisorARB(location + column, divisor);
+	}
+}
+
+GpuCuller::GpuCuller()
+	: m_Program(0)
+	, m_UniPlanes(-1)
+	, m_UniBoundsCenter(-1)
+	, m_UniBoundsExtent(-1)
+	, m_BoundsCenter(0.0f)
+	, m_BoundsExtent(0.0f)
+	, m_InputVao(0)
+	, m_InputBuffer(0)
+	, m_MaxInstances(0)
+	, m_InstanceCount(0)
+	, m_DrawBuffer(0)
+	, m_NextQuery(0)
+	, m_IndirectBuffer(0)
+	, m_Indirect(false)
+	, m_VisibleCount(0)
+{
+	m_Shaders[0] = m_Shaders[1] = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		m_OutputBuffers[i] = 0;
+		m_Queries[i] = 0;
+		m_Pending[i] = false;
+		m_Counts[i] = 0;
+	}
+}
+
+GpuCuller::~GpuCuller()
+{
+	Destroy();
+}
+
+bool GpuCuller::Create(int maxInstances)
+{
+	Destroy();
+
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_instanced_arrays)
+	{
+		std::cout << "GpuCuller needs OpenGL 3.3 or ARB_instanced_arrays\n";
+		return false;
+	}
+
+	m_Indirect = (GLEW_VERSION_4_4 || GLEW_ARB_query_buffer_object) && (GLEW_VERSION_4_0 || GLEW_ARB_draw_indirect);
+	m_MaxInstances = std::max(maxInstances, 1);
+
+	m_Shaders[0] = CompileShader(GL_VERTEX_SHADER, cullVertexSource, "Culling vertex shader");
+	m_Shaders[1] = CompileShader(GL_GEOMETRY_SHADER, cullGeometrySource, "Culling geometry shader");
+
+	m_Program = glCreateProgram();
+	glAttachShader(m_Program, m_Shaders[0]);
+	glAttachShader(m_Program, m_Shaders[1]);
+	glBindAttribLocation(m_Program, 0, "model0");
+	glBindAttribLocation(m_Program, 1, "model1");
+	glBindAttribLocation(m_Program, 2, "model2");
+	glBindAttribLocation(m_Program, 3, "model3");
+
+	// Interleaved the 4 columns are a mat4 again
+	const char* feedbackVaryings[] = { "instance0", "instance1", "instance2", "instance3" };
+	glTransformFeedbackVaryings(m_Program, 4, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
+	glLinkProgram(m_Program);
+
+	GLint status;
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		std::cout << "Culling program link error\n";
+		Destroy();
+		return false;
+	}
+
+	m_UniPlanes = glGetUniformLocation(m_Program, "planes");
+	m_UniBoundsCenter = glGetUniformLocation(m_Program, "boundsCenter");
+	m_UniBoundsExtent = glGetUniformLocation(m_Program, "boundsExtent");
+
+	GLsizeiptr bufferSize = m_MaxInstances * sizeof(glm::mat4);
+	glGenBuffers(1, &m_InputBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_InputBuffer);
+	glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
+
+	// The GPU writes these and reads them again, the CPU never touches them
+	glGenBuffers(2, m_OutputBuffers);
+	for (GLuint buffer : m_OutputBuffers)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, bufferSize, nullptr, GL_DYNAMIC_COPY);
+	}
+
+	glGenVertexArrays(1, &m_InputVao);
+	glBindVertexArray(m_InputVao);
+	SpecifyMatrixAttributes(m_InputBuffer, 0, 0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenQueries(2, m_Queries);
+
+	if (m_Indirect)
+	{
+		GLuint command[5] = { 0, 0, 0, 0, 0 };
+		glGenBuffers(1, &m_IndirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), command, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	return true;
+}
+
+void GpuCuller::Destroy()
+{
+	if (m_IndirectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_IndirectBuffer);
+		m_IndirectBuffer = 0;
+	}
+
+	if (m_Queries[0] != 0)
+	{
+		glDeleteQueries(2, m_Queries);
+		m_Queries[0] = m_Queries[1] = 0;
+	}
+
+	if (m_InputVao != 0)
+	{
+		glDeleteVertexArrays(1, &m_InputVao);
+		glDeleteBuffers(1, &m_InputBuffer);
+		glDeleteBuffers(2, m_OutputBuffers);
+		m_InputVao = 0;
+		m_InputBuffer = 0;
+		m_OutputBuffers[0] = m_OutputBuffers[1] = 0;
+	}
+
+	if (m_Program != 0)
+	{
+		glDeleteProgram(m_Program);
+		glDeleteShader(m_Shaders[0]);
+		glDeleteShader(m_Shaders[1]);
+		m_Program = 0;
+		m_Shaders[0] = m_Shaders[1] = 0;
+	}
+
+	for (int i = 0; i < 2; ++i)
+	{
+		m_Pending[i] = false;
+		m_Counts[i] = 0;
+	}
+
+	m_InstanceCount = 0;
+	m_VisibleCount = 0;
+	m_DrawBuffer = 0;
+	m_NextQuery = 0;
+}
+
+void GpuCuller::SetBounds(const glm::vec3& min, const glm::vec3& max)
+{
+	m_BoundsCenter = (min + max) * 0.5f;
+	m_BoundsExtent = (max - min) * 0.5f;
+}
+
+void GpuCuller::SetInstances(const glm::mat4* models, int count)
+{
+	if (m_Program == 0)
+		return;
+
+	m_InstanceCount = std::min(count, m_MaxInstances);
+	glBindBuffer(GL_ARRAY_BUFFER, m_InputBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, m_InstanceCount * sizeof(glm::mat4), models);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuCuller::Cull(const Frustum& frustum)
+{
+	if (m_Program == 0)
+		return;
+
+	if (m_Indirect)
+	{
+		// Only to tell how many instances are visible, a query that isn't done yet is simply used again
+		int query = m_NextQuery;
+		m_NextQuery = 1 - m_NextQuery;
+		if (m_Pending[query])
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(m_Queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint count = 0;
+				glGetQueryObjectuiv(m_Queries[query], GL_QUERY_RESULT, &count);
+				m_VisibleCount = (int)count;
+			}
+		}
+
+		RunCull(frustum, m_OutputBuffers[0], m_Queries[query]);
+		m_Pending[query] = true;
+
+		// With a query buffer bound the result goes into the instance count of the command at offset 4, the GPU waits for it
+		glBindBuffer(GL_QUERY_BUFFER, m_IndirectBuffer);
+		glGetQueryObjectuiv(m_Queries[query], GL_QUERY_RESULT, (GLuint*)sizeof(GLuint));
+		glBindBuffer(GL_QUERY_BUFFER, 0);
+		return;
+	}
+
+	// The buffer that was culled into last time is drawn as soon as its count came back, until then it isn't culled into again
+	int cull = 1 - m_DrawBuffer;
+	if (m_Pending[cull])
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(m_Queries[cull], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return;
+
+		GLuint count = 0;
+		glGetQueryObjectuiv(m_Queries[cull], GL_QUERY_RESULT, &count);
+		m_Counts[cull] = (int)count;
+		m_VisibleCount = (int)count;
+		m_Pending[cull] = false;
+
+		m_DrawBuffer = cull;
+		cull = 1 - cull;
+	}
+
+	RunCull(frustum, m_OutputBuffers[cull], m_Queries[cull]);
+	m_Pending[cull] = true;
+}
+
+void GpuCuller::RunCull(const Frustum& frustum, GLuint outputBuffer, GLuint query)
+{
+	glm::vec4 planes[Frustum::PlaneCount];
+	for (int i = 0; i < Frustum::PlaneCount; ++i)
+		planes[i] = frustum.GetPlane(i);
+
+	glUseProgram(m_Program);
+	glUniform4fv(m_UniPlanes, Frustum::PlaneCount, glm::value_ptr(planes[0]));
+	glUniform3fv(m_UniBoundsCenter, 1, glm::value_ptr(m_BoundsCenter));
+	glUniform3fv(m_UniBoundsExtent, 1, glm::value_ptr(m_BoundsExtent));
+
+	// Nothing is rasterized, the points only go through the shaders into the output buffer
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(m_InputVao);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, outputBuffer);
+
+	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, m_InstanceCount);
+	glEndTransformFeedback();
+	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram(0);
+}
+
+void GpuCuller::BindInstances(GLuint modelLocation)
+{
+	SpecifyMatrixAttributes(m_OutputBuffers[m_Indirect ? 0 : m_DrawBuffer], modelLocation, 1);
+}
+
+void GpuCuller::DrawElements(GLuint modelLocation, GLenum mode, GLsizei count, GLenum type, size_t indexOffset)
+{
+	if (m_Program == 0)
+		return;
+
+	BindInstances(modelLocation);
+
+	if (!m_Indirect)
+	{
+		if (m_Counts[m_DrawBuffer] > 0)
+			glDrawElementsInstanced(mode, count, type, (void*)indexOffset, m_Counts[m_DrawBuffer]);
+		return;
+	}
+
+	// DrawElementsIndirectCommand is count, instanceCount, firstIndex, baseVertex and baseInstance, the instance count is left alone
+	GLuint indexSize = type == GL_UNSIGNED_BYTE ? 1 : type == GL_UNSIGNED_SHORT ? 2 : 4;
+	GLuint first[3] = { (GLuint)(indexOffset / indexSize), 0, 0 };
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint), &count);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 2 * sizeof(GLuint), sizeof(first), first);
+	glDrawElementsIndirect(mode, type, nullptr);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuCuller::DrawArrays(GLuint modelLocation, GLenum mode, GLint first, GLsizei count)
+{
+	if (m_Program == 0)
+		return;
+
+	BindInstances(modelLocation);
+
+	if (!m_Indirect)
+	{
+		if (m_Counts[m_DrawBuffer] > 0)
+			glDrawArraysInstanced(mode, first, count, m_Counts[m_DrawBuffer]);
+		return;
+	}
+
+	// DrawArraysIndirectCommand is count, instanceCount, first and baseInstance
+	GLuint rest[2] = { (GLuint)first, 0 };
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint), &count);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 2 * sizeof(GLuint), sizeof(rest), rest);
+	glDrawArraysIndirect(mode, nullptr);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+// Shaders that draw the instances of a mesh with the matrices of GpuCuller in the mat4 input instanceModel.
+// They use the same position/color layout as the scene vertices, the dequantization of the mesh goes into its uniform.
+extern const char* gpuCulledVertexSource;
+extern const char* gpuCulledFragmentSource;
+
+// Frustum culling of the instances of one mesh on the GPU, so drawing thousands of instances never needs the CPU to look at them.
+// Every instance is a model matrix in a buffer. Cull draws the matrices as points with transform feedback and the rasterizer off:
+// the vertex shader tests the bounds of the mesh moved by the matrix against the frustum planes, and a geometry shader only
+// passes the matrices of the visible instances on, so they end up packed together in a second buffer that Draw reads per instance.
+// How many made it is counted by a GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN query:
+// - With ARB_query_buffer_object and ARB_draw_indirect the GPU copies the count into an indirect draw command itself.
+// - Otherwise the count is read once the query is done, without waiting. Cull writes into one of two buffers while the other one
+//   is drawn, so what is drawn was culled a frame or two ago.
+// glDrawTransformFeedbackInstanced isn't used, it draws the captured points themselves instead of instances of a mesh.
+class GpuCuller
+{
+public:
+	GpuCuller();
+	~GpuCuller();
+
+	GpuCuller(const GpuCuller&) = delete;
+	GpuCuller& operator=(const GpuCuller&) = delete;
+
+	bool Create(int maxInstances);
+	void Destroy();
+
+	// The box around the mesh in its own space
+	void SetBounds(const glm::vec3& min, const glm::vec3& max);
+
+	// Copies the model matrices of the instances to the GPU, at most the maxInstances given to Create
+	void SetInstances(const glm::mat4* models, int count);
+	int GetInstanceCount() const { return m_InstanceCount; }
+
+	void Cull(const Frustum& frustum);
+
+	// Draws the visible instances with the program and vertex array that are bound. The model matrix of an instance
+	// goes to the mat4 attribute at modelLocation, which takes up 4 locations. The attributes stay set up in the vertex array.
+	void DrawElements(GLuint modelLocation, GLenum mode, GLsizei count, GLenum type, size_t indexOffset);
+	void DrawArrays(GLuint modelLocation, GLenum mode, GLint first, GLsizei count);
+
+	// The last count the CPU read back, only for statistics
+	int GetVisibleCount() const { return m_VisibleCount; }
+
+	bool IsIndirect() const { return m_Indirect; }
+
+private:
+	void RunCull(const Frustum& frustum, GLuint outputBuffer, GLuint query);
+	void BindInstances(GLuint modelLocation);
+
+	GLuint m_Shaders[2];
+	GLuint m_Program;
+	GLint m_UniPlanes;
+	GLint m_UniBoundsCenter;
+	GLint m_UniBoundsExtent;
+	glm::vec3 m_BoundsCenter;
+	glm::vec3 m_BoundsExtent;
+
+	GLuint m_InputVao;
+	GLuint m_InputBuffer;
+	int m_MaxInstances;
+	int m_InstanceCount;
+
+	// The visible matrices. Without the indirect draw one is culled into while the other one is drawn,
+	// with the indirect draw the first one is used for both and the queries take turns so the last count can be read back.
+	GLuint m_OutputBuffers[2];
+	GLuint m_Queries[2];
+	bool m_Pending[2];
+	int m_Counts[2];
+	int m_DrawBuffer;
+	int m_NextQuery;
+
+	// Holds one DrawElementsIndirectCommand or DrawArraysIndirectCommand, the GPU writes their instance count
+	GLuint m_IndirectBuffer;
+	bool m_Indirect;
+
+	int m_VisibleCount;
+};
@@ -0,0 +1,134 @@
+#include "GpuTimer.h"
+
+#include <iostream>
+
+GpuTimer::GpuTimer()
+	: m_First(0)
+	, m_Pending(0)
+	, m_Running(false)
+	, m_Discard(0)
+	, m_LastMilliseconds(0.0f)
+	, m_TotalMilliseconds(0.0)
+	, m_SampleCount(0)
+	, m_ResultCount(0)
+{
+	for (int i = 0; i < QueryCount; ++i)
+		m_Queries[i] = 0;
+}
+
+GpuTimer::~GpuTimer()
+{
+	Destroy();
+}
+
+bool GpuTimer::Create()
+{
+	Destroy();
+
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_timer_query)
+	{
+		std::cout << "GpuTimer needs OpenGL 3.3 or ARB_timer_query\n";
+		return false;
+	}
+
+	glGenQueries(QueryCount, m_Queries);
+	return true;
+}
+
+void GpuTimer::Destroy()
+{
+	if (m_Queries[0] == 0)
+		return;
+
+	glDeleteQueries(QueryCount, m_Queries);
+	for (int i = 0; i < QueryCount; ++i)
+		m_Queries[i] = 0;
+
+	m_First = 0;
+	m_Pending = 0;
+	m_Running = false;
+	m_Discard = 0;
+}
+
+void GpuTimer::Begin()
+{
+	if (!IsSupported())
+		return;
+
+	if (m_Running)
+	{
+		std::cout << "GpuTimer::Begin called twice without End\n";
+		return;
+	}
+
+	// All queries still in flight, the oldest one has to be read back before it can be reused
+	Collect(m_Pending == QueryCount);
+
+	GLuint query = m_Queries[(m_First + m_Pending) % QueryCount];
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	m_Running = true;
+}
+
+void GpuTimer::End()
+{
+	if (!m_Running)
+		return;
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_Running = false;
+	++m_Pending;
+}
+
+float GpuTimer::GetAverageMilliseconds() const
+{
+	if (m_SampleCount == 0)
+		return 0.0f;
+
+	return (float)(m_TotalMilliseconds / m_SampleCount);
+}
+
+void GpuTimer::ResetAverage()
+{
+	// Queries that are still in flight measured commands from before the reset, so they don't count.
+	m_Discard = m_Pending;
+	m_TotalMilliseconds = 0.0;
+	m_SampleCount = 0;
+}
+
+void GpuTimer::Collect(bool wait)
+{
+	while (m_Pending > 0)
+	{
+		GLuint query = m_Queries[m_First];
+
+		if (!wait)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available)
+				return;
+		}
+
+		// Blocks when the result isn't available yet
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+
+		m_LastMilliseconds = (float)(nanoseconds / 1000000.0);
+		++m_ResultCount;
+		if (m_Discard > 0)
+		{
+			--m_Discard;
+		}
+		else
+		{
+			m_TotalMilliseconds += m_LastMilliseconds;
+			++m_SampleCount;
+		}
+
+		m_First = (m_First + 1) % QueryCount;
+		--m_Pending;
+
+		// Only wait for the oldest one, the others are read if they happen to be done as well
+		wait = false;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+// Measures how long the GPU spends on the commands between Begin and End with GL_TIME_ELAPSED queries.
+// The GPU runs a few frames behind the CPU, so asking for a result right away would stall until it caught up.
+// Instead the timer keeps a few queries in flight and reads back the oldest ones once they're available,
+// which means a measurement arrives a couple of frames after it was made.
+// Time elapsed queries can't be nested, so only one timer may be between Begin and End at a time.
+// They need OpenGL 3.3 or ARB_timer_query. Without them Create fails, Begin and End do nothing and no result ever arrives.
+class GpuTimer
+{
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+
+	// Returns false when the GPU can't measure time
+	bool Create();
+	void Destroy();
+
+	bool IsSupported() const { return m_Queries[0] != 0; }
+
+	void Begin();
+	void End();
+
+	// Most recent measurement that came back from the GPU
+	float GetMilliseconds() const { return m_LastMilliseconds; }
+
+	// Average of all measurements since the last ResetAverage
+	float GetAverageMilliseconds() const;
+	int GetSampleCount() const { return m_SampleCount; }
+	void ResetAverage();
+
+	// Number of measurements that came back since the timer was created, to tell when GetMilliseconds has a new value
+	unsigned int GetResultCount() const { return m_ResultCount; }
+
+private:
+	// Reads back finished queries, waits for the oldest one if wait is set
+	void Collect(bool wait);
+
+	static const int QueryCount = 4;
+
+	GLuint m_Queries[QueryCount];
+
+	// Ring buffer of queries that are waiting for their result, oldest first
+	int m_First;
+	int m_Pending;
+	bool m_Running;
+
+	// Pending queries that were started before the last ResetAverage
+	int m_Discard;
+
+	float m_LastMilliseconds;
+	double m_TotalMilliseconds;
+	int m_SampleCount;
+	unsigned int m_ResultCount;
+};
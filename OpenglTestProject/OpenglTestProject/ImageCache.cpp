@@ -0,0 +1,416 @@
+#include "ImageCache.h"
+#include "AssetPack.h"
+#include "MappedFile.h"
+
+// The implementation is compiled in main.cpp
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#else
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+static const char ImageCacheMagic[4] = { 'I', 'M', 'G', 'C' };
+
+// Goes up whenever the decoder or the mip generator make different pixels, which makes every key different as well
+static const unsigned int ImageCacheVersion = 1;
+
+static const char* ImageCacheExtension = ".imgc";
+static const size_t FirstLevelAlignment = 4096;
+static const size_t LevelAlignment = 16;
+
+struct ImageCacheHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned long long key;
+
+	// What the image was made with, to tell whether the source changed
+	unsigned int filter;
+	unsigned int format;
+	int maxLevels;
+
+	int width;
+	int height;
+	unsigned int levelCount;
+	unsigned int sourcePathLength;
+	unsigned int reserved;
+};
+
+struct ImageCacheLevel
+{
+	unsigned long long offset;
+	unsigned long long size;
+};
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool DecodeImageFile(const unsigned char* data, size_t size, MipFilter filter, TextureFormat format, int maxLevels, DecodedImage& image)
+{
+	image = DecodedImage();
+
+	int width, height;
+	unsigned char* rgba = stbi_load_from_memory(data, (int)size, &width, &height, nullptr, STBI_rgb_alpha);
+	if (!rgba)
+		return false;
+
+	image.format = format;
+	image.width = width;
+	image.height = height;
+	image.levels = GenerateMipChain(rgba, width, height, filter, true, maxLevels);
+	stbi_image_free(rgba);
+
+	if (IsBlockCompressed(format))
+	{
+		for (size_t level = 0; level < image.levels.size(); ++level)
+			image.levels[level] = CompressImage(image.levels[level].data(), std::max(1, width >> level), std::max(1, height >> level), format);
+	}
+
+	return true;
+}
+
+unsigned long long MakeImageCacheKey(const unsigned char* data, size_t size, MipFilter filter, TextureFormat format, int maxLevels)
+{
+	// A single level isn't filtered at all
+	if (maxLevels == 1)
+		filter = MipFilter::Box;
+
+	unsigned long long parameters[5] = { HashAssetBytes(data, size), ImageCacheVersion, (unsigned long long)filter, (unsigned long long)format, (unsigned long long)maxLevels };
+	return HashAssetBytes(parameters, sizeof(parameters));
+}
+
+static void TouchFile(const std::string& path)
+{
+#ifdef _WIN32
+	_utime(path.c_str(), NULL);
+#else
+	utime(path.c_str(), NULL);
+#endif
+}
+
+static std::vector<std::string> ListCacheFiles(const std::string& directory)
+{
+	std::vector<std::string> names;
+	size_t extensionLength = std::strlen(ImageCacheExtension);
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA((directory + "/*" + ImageCacheExtension).c_str(), &found);
+	if (find == INVALID_HANDLE_VALUE)
+		return names;
+
+	do
+	{
+		names.push_back(found.cFileName);
+	} while (FindNextFileA(find, &found));
+	FindClose(find);
+#else
+	DIR* dir = opendir(directory.c_str());
+	if (!dir)
+		return names;
+
+	while (dirent* entry = readdir(dir))
+	{
+		std::string name = entry->d_name;
+		if (name.size() > extensionLength && name.compare(name.size() - extensionLength, extensionLength, ImageCacheExtension) == 0)
+			names.push_back(name);
+	}
+	closedir(dir);
+#endif
+
+	return names;
+}
+
+bool ImageCache::Create(const std::string& directory)
+{
+	m_Directory = directory;
+	while (!m_Directory.empty() && (m_Directory.back() == '/' || m_Directory.back() == '\\'))
+		m_Directory.pop_back();
+
+#ifdef _WIN32
+	_mkdir(m_Directory.c_str());
+#else
+	mkdir(m_Directory.c_str(), 0755);
+#endif
+
+	struct stat info;
+	if (stat(m_Directory.c_str(), &info) != 0 || (info.st_mode & S_IFDIR) == 0)
+	{
+		std::cout << "Can't create the image cache " << m_Directory << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+std::string ImageCache::GetPath(unsigned long long key) const
+{
+	std::ostringstream path;
+	path << m_Directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ImageCacheExtension;
+	return path.str();
+}
+
+// Checks the header and the level table against the size of the file, returns nullptr when they don't fit
+static const ImageCacheHeader* GetValidHeader(const MappedFile& file)
+{
+	if (file.GetSize() < sizeof(ImageCacheHeader))
+		return nullptr;
+
+	const ImageCacheHeader* header = (const ImageCacheHeader*)file.GetData();
+	if (std::memcmp(header->magic, ImageCacheMagic, sizeof(ImageCacheMagic)) != 0 || header->version != ImageCacheVersion)
+		return nullptr;
+
+	// A mip chain can't have more levels than it takes to get down to 1x1
+	TextureFormat format = (TextureFormat)header->format;
+	if (format != TextureFormat::RGBA8 && format != TextureFormat::BC1 && format != TextureFormat::BC3)
+		return nullptr;
+	if (header->width <= 0 || header->height <= 0 || header->levelCount == 0
+		|| header->levelCount > (unsigned int)GetMipLevelCount(header->width, header->height))
+		return nullptr;
+
+	// Subtracting from the size instead of adding to an offset, a damaged file could make the sum wrap around
+	size_t size = file.GetSize();
+	size_t tableEnd = sizeof(ImageCacheHeader) + header->levelCount * sizeof(ImageCacheLevel);
+	if (tableEnd > size || header->sourcePathLength > size - tableEnd)
+		return nullptr;
+
+	// Every level has to be exactly as big as its size needs, the upload reads that many bytes from it
+	const ImageCacheLevel* levels = (const ImageCacheLevel*)(file.GetData() + sizeof(ImageCacheHeader));
+	for (unsigned int level = 0; level < header->levelCount; ++level)
+	{
+		if (levels[level].offset > size || levels[level].size > size - levels[level].offset)
+			return nullptr;
+
+		size_t expected = GetTextureBytes(format, std::max(1, header->width >> level), std::max(1, header->height >> level));
+		if (levels[level].size != expected)
+			return nullptr;
+	}
+
+	return header;
+}
+
+bool ImageCache::Load(unsigned long long key, DecodedImage& image) const
+{
+	std::string path = GetPath(key);
+
+	MappedFile file;
+	if (!file.Open(path.c_str()))
+		return false;
+
+	const ImageCacheHeader* header = GetValidHeader(file);
+	if (!header || header->key != key)
+		return false;
+
+	image.format = (TextureFormat)header->format;
+	image.width = header->width;
+	image.height = header->height;
+	image.levels.resize(header->levelCount);
+
+	const ImageCacheLevel* levels = (const ImageCacheLevel*)(file.GetData() + sizeof(ImageCacheHeader));
+	for (unsigned int level = 0; level < header->levelCount; ++level)
+	{
+		const unsigned char* data = file.GetData() + levels[level].offset;
+		image.levels[level].assign(data, data + levels[level].size);
+	}
+
+	file.Close();
+	TouchFile(path);
+	return true;
+}
+
+bool ImageCache::Store(unsigned long long key, const std::string& sourcePath, MipFilter filter, int maxLevels, const DecodedImage& image) const
+{
+	ImageCacheHeader header = {};
+	std::memcpy(header.magic, ImageCacheMagic, sizeof(ImageCacheMagic));
+	header.version = ImageCacheVersion;
+	header.key = key;
+	header.filter = (unsigned int)filter;
+	header.format = (unsigned int)image.format;
+	header.maxLevels = maxLevels;
+	header.width = image.width;
+	header.height = image.height;
+	header.levelCount = (unsigned int)image.levels.size();
+	header.sourcePathLength = (unsigned int)sourcePath.size();
+
+	std::vector<ImageCacheLevel> levels(image.levels.size());
+	size_t offset = AlignUp(sizeof(header) + levels.size() * sizeof(ImageCacheLevel) + sourcePath.size(), FirstLevelAlignment);
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		levels[level].offset = offset;
+		levels[level].size = image.levels[level].size();
+		offset = AlignUp(offset + image.levels[level].size(), LevelAlignment);
+	}
+
+	// Unique for every store of every thread of every program
+	static std::atomic<unsigned int> storeCount(0);
+	std::ostringstream temporaryPath;
+	temporaryPath << GetPath(key) << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << "."
+		<< std::chrono::steady_clock::now().time_since_epoch().count() << "." << storeCount++ << ".tmp";
+
+	{
+		std::ofstream file(temporaryPath.str(), std::ios::binary);
+		if (!file)
+			return false;
+
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)levels.data(), levels.size() * sizeof(ImageCacheLevel));
+		file.write(sourcePath.data(), sourcePath.size());
+
+		size_t position = sizeof(header) + levels.size() * sizeof(ImageCacheLevel) + sourcePath.size();
+		std::vector<char> padding(FirstLevelAlignment, 0);
+		for (size_t level = 0; level < levels.size(); ++level)
+		{
+			file.write(padding.data(), (size_t)levels[level].offset - position);
+			file.write((const char*)image.levels[level].data(), image.levels[level].size());
+			position = (size_t)(levels[level].offset + levels[level].size);
+		}
+
+		if (!file)
+		{
+			file.close();
+			std::remove(temporaryPath.str().c_str());
+			return false;
+		}
+	}
+
+	// Renaming over an existing file fails on Windows, then another program stored the same image first
+	if (std::rename(temporaryPath.str().c_str(), GetPath(key).c_str()) != 0)
+	{
+		std::remove(temporaryPath.str().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+ImageCacheStats ImageCache::GetStats() const
+{
+	ImageCacheStats stats;
+	for (const std::string& name : ListCacheFiles(m_Directory))
+	{
+		struct stat info;
+		if (stat((m_Directory + "/" + name).c_str(), &info) != 0)
+			continue;
+
+		++stats.entryCount;
+		stats.bytes += (unsigned long long)info.st_size;
+	}
+
+	return stats;
+}
+
+ImageCacheStats ImageCache::Collect(unsigned long long maxBytes) const
+{
+	struct CacheFile
+	{
+		std::string path;
+		unsigned long long bytes;
+		long long lastUsed;
+	};
+
+	ImageCacheStats stats;
+	std::vector<CacheFile> kept;
+
+	for (const std::string& name : ListCacheFiles(m_Directory))
+	{
+		CacheFile cacheFile;
+		cacheFile.path = m_Directory + "/" + name;
+
+		struct stat info;
+		if (stat(cacheFile.path.c_str(), &info) != 0)
+			continue;
+
+		cacheFile.bytes = (unsigned long long)info.st_size;
+		cacheFile.lastUsed = (long long)info.st_mtime;
+
+		bool invalid = false;
+		bool stale = false;
+		{
+			MappedFile file;
+			const ImageCacheHeader* header = file.Open(cacheFile.path.c_str()) ? GetValidHeader(file) : nullptr;
+			if (!header)
+			{
+				invalid = true;
+			}
+			else
+			{
+				// A source that changed gets another key, nothing will ever load this one again
+				const char* sourcePath = (const char*)file.GetData() + sizeof(ImageCacheHeader) + header->levelCount * sizeof(ImageCacheLevel);
+				MappedFile source;
+				if (source.Open(std::string(sourcePath, header->sourcePathLength).c_str()))
+				{
+					unsigned long long key = MakeImageCacheKey(source.GetData(), source.GetSize(), (MipFilter)header->filter, (TextureFormat)header->format, header->maxLevels);
+					stale = key != header->key;
+				}
+			}
+		}
+
+		if (invalid || stale)
+		{
+			if (std::remove(cacheFile.path.c_str()) == 0)
+			{
+				if (invalid)
+					++stats.removedInvalid;
+				else
+					++stats.removedStale;
+				stats.removedBytes += cacheFile.bytes;
+			}
+			continue;
+		}
+
+		kept.push_back(cacheFile);
+		stats.bytes += cacheFile.bytes;
+	}
+
+	// The least recently used first
+	std::sort(kept.begin(), kept.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUsed < b.lastUsed; });
+
+	size_t next = 0;
+	while (stats.bytes > maxBytes && next < kept.size())
+	{
+		const CacheFile& cacheFile = kept[next++];
+		if (std::remove(cacheFile.path.c_str()) != 0)
+			continue;
+
+		stats.bytes -= cacheFile.bytes;
+		stats.removedBytes += cacheFile.bytes;
+		++stats.removedOld;
+	}
+
+	stats.entryCount = (int)(kept.size() - stats.removedOld);
+	return stats;
+}
+
+static const ImageCache* g_ImageCache = nullptr;
+
+void SetImageCache(const ImageCache* cache)
+{
+	g_ImageCache = cache;
+}
+
+const ImageCache* GetImageCache()
+{
+	return g_ImageCache;
+}
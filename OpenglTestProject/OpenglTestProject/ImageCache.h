@@ -0,0 +1,88 @@
+#pragma once
+
+#include "BlockCompression.h"
+#include "MipGenerator.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// An image decoded by stb_image with its whole mip chain, owning its pixels.
+// Width and height are the size of the first level.
+struct DecodedImage
+{
+	TextureFormat format;
+	int width;
+	int height;
+
+	// Set for levels copied from an sRGB KTX2 file, decoded images are uploaded as they always were
+	bool srgb;
+
+	std::vector<std::vector<unsigned char>> levels;
+
+	DecodedImage() : format(TextureFormat::RGBA8), width(0), height(0), srgb(false) {}
+};
+
+// Decodes a PNG, JPG or any other image stb_image knows from memory and builds its mip chain, in RGBA8 or block compressed.
+// maxLevels stops the chain early, 0 goes all the way down to 1x1. Doesn't touch OpenGL, so it can run on any thread.
+bool DecodeImageFile(const unsigned char* data, size_t size, MipFilter filter, TextureFormat format, int maxLevels, DecodedImage& image);
+
+// Everything that decides what DecodeImageFile makes out of a file: the hash of its contents and the parameters.
+// The same file with the same parameters always gives the same key, wherever it is and whatever it's called.
+unsigned long long MakeImageCacheKey(const unsigned char* data, size_t size, MipFilter filter, TextureFormat format, int maxLevels);
+
+struct ImageCacheStats
+{
+	int entryCount;
+	unsigned long long bytes;
+
+	int removedInvalid;
+	int removedStale;
+	int removedOld;
+	unsigned long long removedBytes;
+
+	ImageCacheStats() : entryCount(0), bytes(0), removedInvalid(0), removedStale(0), removedOld(0), removedBytes(0) {}
+};
+
+// Decoded images on disk, so a start with a warm cache never decodes a PNG or builds a mip chain.
+// Every image is a file named after its key: a header, the offset and size of every level and the path of the source it was made from,
+// then the levels. They start at 4 KB into the file, each one at a multiple of 16 bytes.
+// A cached image is read from a memory mapping, that makes it a memcpy of pages that are usually in the page cache already.
+//
+// Reading a file touches it, so its modification time is when it was last used and Collect removes the oldest ones first.
+// Load and Store can be called from any thread, two programs that store the same image at once write the same bytes.
+class ImageCache
+{
+public:
+	ImageCache() {}
+
+	// Creates the directory when it isn't there
+	bool Create(const std::string& directory);
+
+	const std::string& GetDirectory() const { return m_Directory; }
+
+	// Returns false when the image isn't in the cache, or its file is damaged
+	bool Load(unsigned long long key, DecodedImage& image) const;
+
+	// Writes the image to a temporary file first and renames it, so a program that reads at the same time never sees half of it
+	// The filter and maxLevels it was decoded with are stored, so Collect can tell whether the source changed.
+	bool Store(unsigned long long key, const std::string& sourcePath, MipFilter filter, int maxLevels, const DecodedImage& image) const;
+
+	// Removes the files that are damaged or of an older version and the ones whose source changed since they were made,
+	// then the ones that weren't used the longest time ago until the rest fits in maxBytes.
+	// The source paths are the ones the images were loaded with, so sources that aren't found from here are left alone.
+	ImageCacheStats Collect(unsigned long long maxBytes) const;
+
+	// Counts the images and their bytes without removing anything
+	ImageCacheStats GetStats() const;
+
+	std::string GetPath(unsigned long long key) const;
+
+private:
+	std::string m_Directory;
+};
+
+// The cache DecodeImage of TextureLoader uses, nullptr to decode every time.
+// Set it before any loader thread runs.
+void SetImageCache(const ImageCache* cache);
+const ImageCache* GetImageCache();
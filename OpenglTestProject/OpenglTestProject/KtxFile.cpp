@@ -0,0 +1,144 @@
+#include "KtxFile.h"
+#include "MipGenerator.h"
+
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+// A KTX2 file starts with a 12 byte identifier, a header of 9 32 bit values and an index of where the other parts are.
+// After that comes the level index, with the offset and length of every level. The levels themselves are stored
+// smallest first, so a streaming loader can show something before the large levels are in.
+static const unsigned char Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static const size_t Ktx2HeaderSize = 80;
+static const size_t Ktx2LevelIndexEntrySize = 24;
+
+// Offsets of the header values we use
+static const size_t VkFormatOffset = 12;
+static const size_t PixelWidthOffset = 20;
+static const size_t PixelHeightOffset = 24;
+static const size_t PixelDepthOffset = 28;
+static const size_t LayerCountOffset = 32;
+static const size_t FaceCountOffset = 36;
+static const size_t LevelCountOffset = 40;
+static const size_t SupercompressionSchemeOffset = 44;
+
+// KTX2 names its formats with the values of VkFormat
+enum VkFormat
+{
+	VkFormatR8G8B8A8Unorm = 37,
+	VkFormatR8G8B8A8Srgb = 43,
+	VkFormatBC1RgbUnorm = 131,
+	VkFormatBC1RgbSrgb = 132,
+	VkFormatBC1RgbaUnorm = 133,
+	VkFormatBC1RgbaSrgb = 134,
+	VkFormatBC3Unorm = 137,
+	VkFormatBC3Srgb = 138
+};
+
+static unsigned int ReadUInt(const unsigned char* data)
+{
+	return (unsigned int)data[0] | ((unsigned int)data[1] << 8) | ((unsigned int)data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+static unsigned long long ReadUInt64(const unsigned char* data)
+{
+	return (unsigned long long)ReadUInt(data) | ((unsigned long long)ReadUInt(data + 4) << 32);
+}
+
+bool IsKtx2(const unsigned char* data, size_t size)
+{
+	return size >= sizeof(Ktx2Identifier) && std::memcmp(data, Ktx2Identifier, sizeof(Ktx2Identifier)) == 0;
+}
+
+bool ParseKtx2(const unsigned char* data, size_t size, TextureImage& image)
+{
+	if (size < Ktx2HeaderSize || !IsKtx2(data, size))
+	{
+		std::cout << "Not a KTX2 file\n";
+		return false;
+	}
+
+	unsigned int vkFormat = ReadUInt(data + VkFormatOffset);
+	switch (vkFormat)
+	{
+	case VkFormatR8G8B8A8Unorm:
+	case VkFormatR8G8B8A8Srgb:
+		image.format = TextureFormat::RGBA8;
+		break;
+	case VkFormatBC1RgbUnorm:
+	case VkFormatBC1RgbSrgb:
+	case VkFormatBC1RgbaUnorm:
+	case VkFormatBC1RgbaSrgb:
+		image.format = TextureFormat::BC1;
+		break;
+	case VkFormatBC3Unorm:
+	case VkFormatBC3Srgb:
+		image.format = TextureFormat::BC3;
+		break;
+	default:
+		std::cout << "Unsupported KTX2 format " << vkFormat << "\n";
+		return false;
+	}
+
+	image.srgb = vkFormat == VkFormatR8G8B8A8Srgb || vkFormat == VkFormatBC1RgbSrgb || vkFormat == VkFormatBC1RgbaSrgb || vkFormat == VkFormatBC3Srgb;
+
+	if (ReadUInt(data + PixelDepthOffset) > 0 || ReadUInt(data + LayerCountOffset) > 0 || ReadUInt(data + FaceCountOffset) != 1)
+	{
+		std::cout << "Only 2D KTX2 textures are supported, no 3D textures, arrays or cube maps\n";
+		return false;
+	}
+
+	// Supercompressed levels (Basis, zstd) would have to be inflated first, which is what this format is meant to avoid
+	if (ReadUInt(data + SupercompressionSchemeOffset) != 0)
+	{
+		std::cout << "Supercompressed KTX2 files are not supported\n";
+		return false;
+	}
+
+	unsigned int width = ReadUInt(data + PixelWidthOffset);
+	unsigned int height = ReadUInt(data + PixelHeightOffset);
+	if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF)
+	{
+		std::cout << "KTX2 file has an invalid size\n";
+		return false;
+	}
+
+	image.width = (int)width;
+	image.height = (int)height;
+
+	// 0 levels asks the loader to generate the mipmaps, only the base level is stored then.
+	// A chain never goes below 1x1, more levels than that would shift the size by 32 bits or more.
+	unsigned int storedLevelCount = ReadUInt(data + LevelCountOffset);
+	int levelCount = (int)std::max(1u, std::min(storedLevelCount, (unsigned int)GetMipLevelCount(image.width, image.height)));
+	if (Ktx2HeaderSize + levelCount * Ktx2LevelIndexEntrySize > size)
+	{
+		std::cout << "KTX2 level index is cut off\n";
+		return false;
+	}
+
+	image.levels.clear();
+
+	for (int level = 0; level < levelCount; ++level)
+	{
+		const unsigned char* entry = data + Ktx2HeaderSize + level * Ktx2LevelIndexEntrySize;
+		unsigned long long offset = ReadUInt64(entry);
+		unsigned long long length = ReadUInt64(entry + 8);
+
+		TextureLevel textureLevel;
+		textureLevel.width = std::max(1, image.width >> level);
+		textureLevel.height = std::max(1, image.height >> level);
+		textureLevel.size = GetTextureBytes(image.format, textureLevel.width, textureLevel.height);
+
+		if (length != textureLevel.size || offset + length > size)
+		{
+			std::cout << "KTX2 level " << level << " has the wrong size or is cut off\n";
+			return false;
+		}
+
+		textureLevel.data = data + offset;
+		image.levels.push_back(textureLevel);
+	}
+
+	return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "DdsFile.h"
+
+// Reads the header and level index of a KTX2 file in memory, the levels point into data.
+// Only plain 2D textures without supercompression are supported, in the formats of TextureFormat.
+bool ParseKtx2(const unsigned char* data, size_t size, TextureImage& image);
+
+// Whether the data starts with the KTX2 identifier
+bool IsKtx2(const unsigned char* data, size_t size);
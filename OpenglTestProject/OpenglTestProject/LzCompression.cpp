@@ -0,0 +1,174 @@
+#include "LzCompression.h"
+
+#include <cstring>
+#include <cstdint>
+
+static const size_t MinMatch = 4;
+static const size_t MaxOffset = 65535;
+
+// Matches stop 5 bytes before the end and can't start in the last 12, like LZ4 does, so decoders may copy in bigger steps
+static const size_t LastLiterals = 5;
+static const size_t MatchStartLimit = 12;
+
+static const int HashBits = 16;
+
+static uint32_t Read32(const unsigned char* data)
+{
+	uint32_t value;
+	std::memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static uint32_t Hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+static void WriteLength(std::vector<unsigned char>& output, size_t length)
+{
+	while (length >= 255)
+	{
+		output.push_back(255);
+		length -= 255;
+	}
+	output.push_back((unsigned char)length);
+}
+
+static void WriteSequence(std::vector<unsigned char>& output, const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+	size_t matchCode = matchLength > 0 ? matchLength - MinMatch : 0;
+
+	unsigned char token = (unsigned char)((literalCount < 15 ? literalCount : 15) << 4);
+	token |= (unsigned char)(matchCode < 15 ? matchCode : 15);
+	output.push_back(token);
+
+	if (literalCount >= 15)
+		WriteLength(output, literalCount - 15);
+	output.insert(output.end(), literals, literals + literalCount);
+
+	if (matchLength == 0)
+		return;
+
+	output.push_back((unsigned char)(offset & 0xFF));
+	output.push_back((unsigned char)(offset >> 8));
+
+	if (matchCode >= 15)
+		WriteLength(output, matchCode - 15);
+}
+
+std::vector<unsigned char> LzCompress(const unsigned char* data, size_t size)
+{
+	std::vector<unsigned char> output;
+	output.reserve(size / 2 + 16);
+
+	size_t anchor = 0;
+
+	if (size > MatchStartLimit)
+	{
+		// Last position a sequence was seen at, + 1 so 0 is empty
+		std::vector<size_t> table((size_t)1 << HashBits, 0);
+
+		size_t matchLimit = size - LastLiterals;
+		size_t position = 0;
+		while (position < size - MatchStartLimit)
+		{
+			uint32_t sequence = Read32(data + position);
+			size_t& entry = table[Hash(sequence)];
+			size_t candidate = entry;
+			entry = position + 1;
+
+			if (candidate == 0 || position - (candidate - 1) > MaxOffset || Read32(data + candidate - 1) != sequence)
+			{
+				++position;
+				continue;
+			}
+
+			size_t match = candidate - 1;
+			size_t length = MinMatch;
+			while (position + length < matchLimit && data[match + length] == data[position + length])
+				++length;
+
+			WriteSequence(output, data + anchor, position - anchor, position - match, length);
+
+			position += length;
+			anchor = position;
+		}
+	}
+
+	WriteSequence(output, data + anchor, size - anchor, 0, 0);
+	return output;
+}
+
+static bool ReadLength(const unsigned char*& input, const unsigned char* end, size_t& length)
+{
+	unsigned char byte;
+	do
+	{
+		if (input == end)
+			return false;
+
+		byte = *input++;
+		length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+bool LzDecompress(const unsigned char* compressed, size_t compressedSize, unsigned char* data, size_t size)
+{
+	const unsigned char* input = compressed;
+	const unsigned char* inputEnd = compressed + compressedSize;
+	unsigned char* output = data;
+	unsigned char* outputEnd = data + size;
+
+	while (input < inputEnd)
+	{
+		unsigned char token = *input++;
+
+		size_t literalCount = token >> 4;
+		if (literalCount == 15 && !ReadLength(input, inputEnd, literalCount))
+			return false;
+
+		if (literalCount > (size_t)(inputEnd - input) || literalCount > (size_t)(outputEnd - output))
+			return false;
+
+		std::memcpy(output, input, literalCount);
+		input += literalCount;
+		output += literalCount;
+
+		// The last sequence has no match
+		if (input == inputEnd)
+			break;
+
+		if (inputEnd - input < 2)
+			return false;
+
+		size_t offset = input[0] | (input[1] << 8);
+		input += 2;
+		if (offset == 0 || offset > (size_t)(output - data))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+			return false;
+		matchLength += MinMatch;
+
+		if (matchLength > (size_t)(outputEnd - output))
+			return false;
+
+		// The match can overlap what it writes, a short offset repeats the same bytes
+		const unsigned char* match = output - offset;
+		if (offset >= matchLength)
+		{
+			std::memcpy(output, match, matchLength);
+			output += matchLength;
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+				*output++ = *match++;
+		}
+	}
+
+	return output == outputEnd;
+}
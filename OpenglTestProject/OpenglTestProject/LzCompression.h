@@ -0,0 +1,15 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// A small LZ77 compressor in the block format of LZ4. It only finds matches with a single hash table, so it's nowhere near
+// as small as zlib, but decompressing is little more than a memcpy, fast enough to do while loading instead of reading more bytes.
+//
+// Every sequence is a token with the number of literals in the high 4 bits and the match length - 4 in the low 4 bits,
+// 15 meaning more bytes follow. Then the literals, the 2 byte offset of the match and the rest of its length.
+// The last sequence only has literals.
+std::vector<unsigned char> LzCompress(const unsigned char* data, size_t size);
+
+// Decompresses into a buffer of exactly the original size, returns false when the data is damaged
+bool LzDecompress(const unsigned char* compressed, size_t compressedSize, unsigned char* data, size_t size);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Maps a whole file into memory read only. The operating system pages it in when it's touched,
+// so nothing is copied into a buffer of our own and a file that is already in the page cache costs no I/O at all.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Returns false when the file doesn't exist, is empty or can't be mapped
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_Data != nullptr; }
+	const unsigned char* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+	const unsigned char* m_Data;
+	size_t m_Size;
+};
@@ -0,0 +1,191 @@
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cfloat>
+
+VertexQuantization GetSupportedQuantization()
+{
+	VertexQuantization quantization = VertexQuantization::Compact();
+	if (!GLEW_VERSION_3_3 && !GLEW_ARB_vertex_type_2_10_10_10_rev)
+	{
+		quantization.color = VertexAttributeType::UnsignedByte;
+		quantization.normal = VertexAttributeType::Short;
+	}
+
+	return quantization;
+}
+
+Mesh::Mesh()
+	: m_VertexBuffer(0)
+	, m_IndexBuffer(0)
+	, m_IndexType(GL_UNSIGNED_INT)
+	, m_Attributes(0)
+	, m_Dequantization(1.0f)
+	, m_VertexCount(0)
+	, m_IndexCount(0)
+	, m_BoundsMin(0.0f)
+	, m_BoundsMax(0.0f)
+{
+}
+
+Mesh::~Mesh()
+{
+	Destroy();
+}
+
+void Mesh::Upload(const void* vertices, size_t vertexBytes, const void* indices, size_t indexBytes)
+{
+	glGenBuffers(1, &m_VertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertices, GL_STATIC_DRAW);
+
+	// Binding an element buffer changes the vertex array that is bound, so it's only bound to one by VertexArrayCache::Bind
+	glGenBuffers(1, &m_IndexBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_IndexBuffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, indexBytes, indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+bool Mesh::Create(const MeshFile& file)
+{
+	Destroy();
+
+	const MeshFileHeader& header = file.GetHeader();
+	m_Attributes = header.attributes;
+	m_Format = file.GetVertexFormat();
+	m_Dequantization = file.GetDequantization();
+	m_VertexCount = header.vertexCount;
+	m_IndexCount = header.indexCount;
+	m_IndexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	m_Lods.assign(header.lods, header.lods + header.lodCount);
+	m_BoundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+	m_BoundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+
+	Upload(file.GetVertices(), file.GetVertexBytes(), file.GetIndices(), file.GetIndexBytes());
+	return true;
+}
+
+bool Mesh::Create(const MeshData& mesh)
+{
+	Destroy();
+
+	m_Attributes = mesh.attributes;
+	m_Format = MakeMeshVertexFormat(mesh.attributes, VertexQuantization());
+	m_Dequantization = glm::mat4(1.0f);
+	m_VertexCount = (unsigned int)mesh.GetVertexCount();
+	m_IndexType = GL_UNSIGNED_INT;
+	m_BoundsMin = mesh.boundsMin;
+	m_BoundsMax = mesh.boundsMax;
+
+	// The levels of detail go after the full mesh in one index buffer, like in a mesh file
+	std::vector<unsigned int> indices = mesh.indices;
+	m_Lods.assign(1, MeshFileLod());
+	m_Lods[0].indexCount = (unsigned int)mesh.indices.size();
+	for (const MeshLod& lod : mesh.lods)
+	{
+		MeshFileLod range = {};
+		range.indexOffset = (unsigned int)indices.size();
+		range.indexCount = (unsigned int)lod.indices.size();
+		range.error = lod.error;
+		m_Lods.push_back(range);
+		indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+	}
+	m_IndexCount = (unsigned int)indices.size();
+
+	Upload(mesh.vertices.data(), mesh.vertices.size() * sizeof(float), indices.data(), indices.size() * sizeof(unsigned int));
+	return true;
+}
+
+bool Mesh::Load(const std::string& objPath, const std::string& cachePath)
+{
+	unsigned long long sourceSize = 0;
+	long long sourceTime = 0;
+	bool onDisk = GetFileStamp(objPath, sourceSize, sourceTime);
+
+	VertexQuantization quantization = GetSupportedQuantization();
+
+	MeshFile file;
+	if (file.Open(cachePath.c_str()) && (!onDisk || file.IsMadeFrom(sourceSize, sourceTime)) && file.GetQuantization() == quantization)
+		return Create(file);
+
+	MeshData mesh;
+	if (!LoadObj(objPath, mesh))
+		return false;
+
+	OptimizeMesh(mesh);
+	GenerateLods(mesh);
+
+	if (WriteMeshFile(cachePath.c_str(), mesh, quantization, sourceSize, sourceTime) && file.Open(cachePath.c_str()))
+		return Create(file);
+
+	std::cout << "The mesh " << objPath << " will be parsed again next time\n";
+	return Create(mesh);
+}
+
+void Mesh::Destroy()
+{
+	if (m_VertexBuffer != 0)
+		glDeleteBuffers(1, &m_VertexBuffer);
+	if (m_IndexBuffer != 0)
+		glDeleteBuffers(1, &m_IndexBuffer);
+
+	m_VertexBuffer = 0;
+	m_IndexBuffer = 0;
+	m_VertexCount = 0;
+	m_IndexCount = 0;
+	m_Lods.clear();
+}
+
+void Mesh::Draw(int lod) const
+{
+	if (m_Lods.empty())
+		return;
+
+	const MeshFileLod& range = m_Lods[std::min(std::max(lod, 0), (int)m_Lods.size() - 1)];
+	size_t indexSize = m_IndexType == GL_UNSIGNED_SHORT ? 2 : 4;
+	glDrawElements(GL_TRIANGLES, range.indexCount, m_IndexType, (void*)(range.indexOffset * indexSize));
+}
+
+float GetProjectedSize(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, float screenHeight)
+{
+	glm::vec3 extent = mesh.GetBoundsMax() - mesh.GetBoundsMin();
+	glm::vec3 center = (mesh.GetBoundsMin() + mesh.GetBoundsMax()) * 0.5f;
+
+	// The largest scale of the model matrix
+	float scale = std::max(std::max(glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1]))), glm::length(glm::vec3(model[2])));
+	float size = std::max(std::max(extent.x, extent.y), extent.z) * scale;
+
+	// A camera inside the bounds sees the whole mesh up close
+	float distance = -(view * model * glm::vec4(center, 1.0f)).z;
+	if (distance <= glm::length(extent) * scale * 0.5f)
+		return FLT_MAX;
+
+	// proj[1][1] is the cotangent of half the vertical field of view
+	return size / distance * proj[1][1] * screenHeight * 0.5f;
+}
+
+LodSelector::LodSelector(float maxPixelError, float hysteresis)
+	: m_MaxPixelError(maxPixelError)
+	, m_Hysteresis(hysteresis)
+	, m_Lod(0)
+{
+}
+
+int LodSelector::Select(const Mesh& mesh, float projectedSize)
+{
+	int lodCount = mesh.GetLodCount();
+	m_Lod = std::min(m_Lod, std::max(lodCount - 1, 0));
+
+	// Finer while the level is off by too much
+	while (m_Lod > 0 && mesh.GetLod(m_Lod).error * projectedSize > m_MaxPixelError)
+		--m_Lod;
+
+	// Coarser while the next level is off by clearly less than allowed
+	while (m_Lod + 1 < lodCount && mesh.GetLod(m_Lod + 1).error * projectedSize <= m_MaxPixelError * (1.0f - m_Hysteresis))
+		++m_Lod;
+
+	return m_Lod;
+}
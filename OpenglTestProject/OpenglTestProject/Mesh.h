@@ -0,0 +1,104 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+#include "MeshFile.h"
+#include "VertexFormat.h"
+#include "VertexLayout.h"
+
+#include <string>
+#include <vector>
+
+// The compact quantization when the GPU can read 10-10-10-2 vertices, core from OpenGL 3.3 on. Otherwise colors are bytes and normals shorts.
+VertexQuantization GetSupportedQuantization();
+
+// An indexed triangle mesh in a vertex buffer and an index buffer.
+// The vertex arrays stay with whoever draws the mesh, meshes of one format share one from VertexArrayCache:
+//   vertexArrays.Bind(vertexArrays.Get(program, mesh.GetVertexFormat()), mesh.GetVertexBuffer(), mesh.GetIndexBuffer());
+class Mesh
+{
+public:
+	Mesh();
+	~Mesh();
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// Uploads the vertices and indices straight from the memory mapping of the file
+	bool Create(const MeshFile& file);
+
+	// Uploads the vertices as floats
+	bool Create(const MeshData& mesh);
+
+	// Uploads the mesh file at cachePath when it was made from the OBJ as it is now, with GetSupportedQuantization.
+	// Otherwise the OBJ is parsed, optimized for the vertex cache, overdraw and vertex fetch, simplified into levels of detail,
+	// quantized and written to cachePath for the next time.
+	// So only the first start or one after the OBJ changed parses it.
+	// An OBJ that isn't on disk, like one that is in the asset pack, never makes the mesh file stale.
+	bool Load(const std::string& objPath, const std::string& cachePath);
+
+	void Destroy();
+
+	// Draws a level of detail, levels the mesh doesn't have draw its coarsest one
+	void Draw(int lod = 0) const;
+
+	GLuint GetVertexBuffer() const { return m_VertexBuffer; }
+	GLuint GetIndexBuffer() const { return m_IndexBuffer; }
+	GLenum GetIndexType() const { return m_IndexType; }
+
+	unsigned int GetAttributes() const { return m_Attributes; }
+	const VertexFormat& GetVertexFormat() const { return m_Format; }
+
+	// Goes in front of the model matrix, the stored positions of a quantized mesh aren't the positions of the mesh
+	const glm::mat4& GetDequantization() const { return m_Dequantization; }
+
+	unsigned int GetVertexCount() const { return m_VertexCount; }
+	unsigned int GetIndexCount() const { return m_IndexCount; }
+
+	// The full mesh is level 0, it's the only one of a mesh that wasn't simplified
+	int GetLodCount() const { return (int)m_Lods.size(); }
+	const MeshFileLod& GetLod(int lod) const { return m_Lods[lod]; }
+	const glm::vec3& GetBoundsMin() const { return m_BoundsMin; }
+	const glm::vec3& GetBoundsMax() const { return m_BoundsMax; }
+
+private:
+	void Upload(const void* vertices, size_t vertexBytes, const void* indices, size_t indexBytes);
+
+	GLuint m_VertexBuffer;
+	GLuint m_IndexBuffer;
+	GLenum m_IndexType;
+
+	unsigned int m_Attributes;
+	VertexFormat m_Format;
+	glm::mat4 m_Dequantization;
+	unsigned int m_VertexCount;
+	unsigned int m_IndexCount;
+	std::vector<MeshFileLod> m_Lods;
+	glm::vec3 m_BoundsMin;
+	glm::vec3 m_BoundsMax;
+};
+
+// Height in pixels of the largest side of the bounds of the mesh, drawn with these matrices on a screen screenHeight pixels high.
+// The model matrix is the one without the dequantization of the mesh.
+float GetProjectedSize(const Mesh& mesh, const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj, float screenHeight);
+
+// Picks the level of detail of one object from its size on screen, the coarsest level that is off by at most maxPixelError pixels.
+// The object keeps its level while it is close to the switching distance, so it doesn't flicker between two levels:
+// it only goes to a coarser level once that one is off by hysteresis less than allowed, and back once its level is off by more.
+class LodSelector
+{
+public:
+	LodSelector(float maxPixelError = 1.0f, float hysteresis = 0.25f);
+
+	// projectedSize is the one of GetProjectedSize
+	int Select(const Mesh& mesh, float projectedSize);
+
+	int GetLod() const { return m_Lod; }
+
+private:
+	float m_MaxPixelError;
+	float m_Hysteresis;
+	int m_Lod;
+};
@@ -0,0 +1,327 @@
+#include "MeshFile.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const char MeshFileMagic[4] = { 'M', 'E', 'S', 'H' };
+
+// Goes up whenever the loader or the optimizer make different meshes, so the mesh files of older versions are made again
+static const unsigned int MeshFileVersion = 4;
+
+// The vertices start at a multiple of the memory page size
+static const size_t VertexAlignment = 4096;
+static const size_t IndexAlignment = 16;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+VertexQuantization VertexQuantization::Compact()
+{
+	VertexQuantization quantization;
+	quantization.position = VertexAttributeType::Short;
+	quantization.color = VertexAttributeType::UnsignedInt2101010;
+	quantization.texcoord = VertexAttributeType::HalfFloat;
+	quantization.normal = VertexAttributeType::Int2101010;
+	return quantization;
+}
+
+VertexFormat MakeMeshVertexFormat(unsigned int attributes, const VertexQuantization& quantization)
+{
+	VertexFormat format;
+	format.Add("position", quantization.position, 3);
+	if (attributes & MeshColors)
+		format.Add("color", quantization.color, quantization.color == VertexAttributeType::UnsignedByte ? 4 : 3);
+	if (attributes & MeshTexcoords)
+		format.Add("texcoord", quantization.texcoord, 2);
+	if (attributes & MeshNormals)
+		format.Add("normal", quantization.normal, 3);
+
+	return format;
+}
+
+static void WriteAttribute(unsigned char* destination, const VertexAttribute& attribute, const glm::vec4& value)
+{
+	switch (attribute.type)
+	{
+	case VertexAttributeType::Float:
+		std::memcpy(destination, &value[0], attribute.components * sizeof(float));
+		break;
+	case VertexAttributeType::HalfFloat:
+		for (int i = 0; i < attribute.components; ++i)
+		{
+			glm::uint16 half = glm::packHalf1x16(value[i]);
+			std::memcpy(destination + i * 2, &half, 2);
+		}
+		break;
+	case VertexAttributeType::Short:
+		for (int i = 0; i < attribute.components; ++i)
+		{
+			glm::uint16 snorm = glm::packSnorm1x16(value[i]);
+			std::memcpy(destination + i * 2, &snorm, 2);
+		}
+		break;
+	case VertexAttributeType::UnsignedByte:
+		for (int i = 0; i < attribute.components; ++i)
+			destination[i] = glm::packUnorm1x8(value[i]);
+		break;
+	case VertexAttributeType::Int2101010:
+	{
+		glm::uint32 packed = glm::packSnorm3x10_1x2(value);
+		std::memcpy(destination, &packed, 4);
+		break;
+	}
+	case VertexAttributeType::UnsignedInt2101010:
+	{
+		glm::uint32 packed = glm::packUnorm3x10_1x2(value);
+		std::memcpy(destination, &packed, 4);
+		break;
+	}
+	}
+}
+
+glm::mat4 QuantizeVertices(const MeshData& mesh, const VertexQuantization& quantization, std::vector<unsigned char>& vertices)
+{
+	VertexFormat format = MakeMeshVertexFormat(mesh.attributes, quantization);
+	size_t vertexCount = mesh.GetVertexCount();
+	unsigned int vertexSize = GetMeshVertexSize(mesh.attributes);
+	vertices.assign(vertexCount * format.GetStride(), 0);
+
+	// Positions that aren't floats go from -1 to 1 across the bounds
+	glm::vec3 scale(1.0f);
+	glm::vec3 offset(0.0f);
+	if (quantization.position != VertexAttributeType::Float)
+	{
+		offset = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+		scale = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+		for (int i = 0; i < 3; ++i)
+		{
+			if (scale[i] <= 0.0f)
+				scale[i] = 1.0f;
+		}
+	}
+
+	const VertexAttribute* position = format.Find("position");
+	const VertexAttribute* color = format.Find("color");
+	const VertexAttribute* texcoord = format.Find("texcoord");
+	const VertexAttribute* normal = format.Find("normal");
+	int colorOffset = GetMeshAttributeOffset(mesh.attributes, MeshColors);
+	int texcoordOffset = GetMeshAttributeOffset(mesh.attributes, MeshTexcoords);
+	int normalOffset = GetMeshAttributeOffset(mesh.attributes, MeshNormals);
+
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+	{
+		const float* source = &mesh.vertices[vertex * vertexSize];
+		unsigned char* destination = &vertices[vertex * format.GetStride()];
+
+		glm::vec3 p = (glm::vec3(source[0], source[1], source[2]) - offset) / scale;
+		WriteAttribute(destination + position->offset, *position, glm::vec4(p, 1.0f));
+
+		if (color)
+		{
+			const float* c = source + colorOffset;
+			WriteAttribute(destination + color->offset, *color, glm::vec4(c[0], c[1], c[2], 1.0f));
+		}
+
+		if (texcoord)
+		{
+			const float* t = source + texcoordOffset;
+			WriteAttribute(destination + texcoord->offset, *texcoord, glm::vec4(t[0], t[1], 0.0f, 0.0f));
+		}
+
+		if (normal)
+		{
+			glm::vec3 n(source[normalOffset], source[normalOffset + 1], source[normalOffset + 2]);
+			float length = glm::length(n);
+			WriteAttribute(destination + normal->offset, *normal, glm::vec4(length > 0.0f ? n / length : n, 0.0f));
+		}
+	}
+
+	return MakeDequantization(scale, offset);
+}
+
+glm::mat4 MakeDequantization(const glm::vec3& scale, const glm::vec3& offset)
+{
+	glm::mat4 dequantization(1.0f);
+	dequantization[0][0] = scale.x;
+	dequantization[1][1] = scale.y;
+	dequantization[2][2] = scale.z;
+	dequantization[3] = glm::vec4(offset, 1.0f);
+	return dequantization;
+}
+
+bool GetFileStamp(const std::string& path, unsigned long long& size, long long& time)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+
+	size = (unsigned long long)info.st_size;
+	time = (long long)info.st_mtime;
+	return true;
+}
+
+bool WriteMeshFile(const char* path, const MeshData& mesh, const VertexQuantization& quantization, unsigned long long sourceSize, long long sourceTime)
+{
+	size_t vertexCount = mesh.GetVertexCount();
+
+	std::vector<unsigned char> vertices;
+	glm::mat4 dequantization = QuantizeVertices(mesh, quantization, vertices);
+
+	MeshFileHeader header = {};
+	std::memcpy(header.magic, MeshFileMagic, sizeof(MeshFileMagic));
+	header.version = MeshFileVersion;
+	header.attributes = mesh.attributes;
+	header.attributeTypes[0] = (unsigned int)quantization.position;
+	header.attributeTypes[1] = (unsigned int)quantization.color;
+	header.attributeTypes[2] = (unsigned int)quantization.texcoord;
+	header.attributeTypes[3] = (unsigned int)quantization.normal;
+	header.vertexStride = MakeMeshVertexFormat(mesh.attributes, quantization).GetStride();
+	header.vertexCount = (unsigned int)vertexCount;
+	header.indexSize = vertexCount <= 65536 ? 2 : 4;
+
+	std::vector<unsigned int> indices = mesh.indices;
+	header.lods[0].indexCount = (unsigned int)mesh.indices.size();
+	header.lodCount = 1;
+	for (const MeshLod& lod : mesh.lods)
+	{
+		if (header.lodCount == MaxMeshLods)
+			break;
+
+		MeshFileLod& fileLod = header.lods[header.lodCount++];
+		fileLod.indexOffset = (unsigned int)indices.size();
+		fileLod.indexCount = (unsigned int)lod.indices.size();
+		fileLod.error = lod.error;
+		indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+	}
+	header.indexCount = (unsigned int)indices.size();
+	for (int i = 0; i < 3; ++i)
+	{
+		header.boundsMin[i] = mesh.boundsMin[i];
+		header.boundsMax[i] = mesh.boundsMax[i];
+		header.dequantizationScale[i] = dequantization[i][i];
+		header.dequantizationOffset[i] = dequantization[3][i];
+	}
+	header.vertexOffset = AlignUp(sizeof(header), VertexAlignment);
+	header.indexOffset = AlignUp((size_t)header.vertexOffset + vertexCount * header.vertexStride, IndexAlignment);
+	header.sourceSize = sourceSize;
+	header.sourceTime = sourceTime;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	std::vector<char> padding(VertexAlignment, 0);
+	file.write((const char*)&header, sizeof(header));
+	file.write(padding.data(), (size_t)header.vertexOffset - sizeof(header));
+	file.write((const char*)vertices.data(), vertices.size());
+	file.write(padding.data(), (size_t)header.indexOffset - (size_t)header.vertexOffset - vertices.size());
+
+	if (header.indexSize == 2)
+	{
+		std::vector<unsigned short> shortIndices(indices.begin(), indices.end());
+		file.write((const char*)shortIndices.data(), shortIndices.size() * sizeof(unsigned short));
+	}
+	else
+	{
+		file.write((const char*)indices.data(), indices.size() * sizeof(unsigned int));
+	}
+
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+MeshFile::MeshFile()
+	: m_Header()
+{
+}
+
+bool MeshFile::Open(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	if (m_File.GetSize() < sizeof(MeshFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	std::memcpy(&m_Header, m_File.GetData(), sizeof(m_Header));
+	if (std::memcmp(m_Header.magic, MeshFileMagic, sizeof(MeshFileMagic)) != 0 || m_Header.version != MeshFileVersion)
+	{
+		std::cout << path << " isn't a mesh file of version " << MeshFileVersion << "\n";
+		Close();
+		return false;
+	}
+
+	bool validTypes = true;
+	for (unsigned int type : m_Header.attributeTypes)
+		validTypes = validTypes && type <= (unsigned int)VertexAttributeType::UnsignedInt2101010;
+
+	bool validLods = m_Header.lodCount >= 1 && m_Header.lodCount <= MaxMeshLods;
+	for (unsigned int lod = 0; validLods && lod < m_Header.lodCount; ++lod)
+		validLods = (unsigned long long)m_Header.lods[lod].indexOffset + m_Header.lods[lod].indexCount <= m_Header.indexCount;
+
+	bool valid = validTypes && validLods && m_Header.vertexStride == GetVertexFormat().GetStride() && (m_Header.indexSize == 2 || m_Header.indexSize == 4)
+		&& m_Header.vertexOffset + (unsigned long long)m_Header.vertexCount * m_Header.vertexStride <= m_File.GetSize()
+		&& m_Header.indexOffset + (unsigned long long)m_Header.indexCount * m_Header.indexSize <= m_File.GetSize();
+	if (!valid)
+	{
+		std::cout << path << " is truncated\n";
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MeshFile::Close()
+{
+	m_File.Close();
+	m_Header = MeshFileHeader();
+}
+
+bool MeshFile::IsMadeFrom(unsigned long long sourceSize, long long sourceTime) const
+{
+	return m_Header.sourceSize == sourceSize && m_Header.sourceTime == sourceTime;
+}
+
+VertexQuantization MeshFile::GetQuantization() const
+{
+	VertexQuantization quantization;
+	quantization.position = (VertexAttributeType)m_Header.attributeTypes[0];
+	quantization.color = (VertexAttributeType)m_Header.attributeTypes[1];
+	quantization.texcoord = (VertexAttributeType)m_Header.attributeTypes[2];
+	quantization.normal = (VertexAttributeType)m_Header.attributeTypes[3];
+	return quantization;
+}
+
+VertexFormat MeshFile::GetVertexFormat() const
+{
+	return MakeMeshVertexFormat(m_Header.attributes, GetQuantization());
+}
+
+glm::mat4 MeshFile::GetDequantization() const
+{
+	const float* scale = m_Header.dequantizationScale;
+	const float* offset = m_Header.dequantizationOffset;
+	return MakeDequantization(glm::vec3(scale[0], scale[1], scale[2]), glm::vec3(offset[0], offset[1], offset[2]));
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "MappedFile.h"
+#include "ObjLoader.h"
+#include "VertexFormat.h"
+
+#include <string>
+#include <cstddef>
+
+// How every attribute of a mesh is stored. Positions that aren't floats are stored relative to the bounds of the mesh,
+// so they take the whole range of their type, and need the dequantization of QuantizeVertices to get them back.
+struct VertexQuantization
+{
+	// Float, HalfFloat or Short
+	VertexAttributeType position;
+
+	// Float, UnsignedByte or UnsignedInt2101010
+	VertexAttributeType color;
+
+	// Float or HalfFloat
+	VertexAttributeType texcoord;
+
+	// Float, Short or Int2101010
+	VertexAttributeType normal;
+
+	VertexQuantization()
+		: position(VertexAttributeType::Float)
+		, color(VertexAttributeType::Float)
+		, texcoord(VertexAttributeType::Float)
+		, normal(VertexAttributeType::Float)
+	{
+	}
+
+	// 16 bit positions, 10-10-10-2 colors and normals and half float texcoords.
+	// A vertex with every attribute takes 20 bytes instead of 44.
+	static VertexQuantization Compact();
+
+	bool operator==(const VertexQuantization& other) const
+	{
+		return position == other.position && color == other.color && texcoord == other.texcoord && normal == other.normal;
+	}
+};
+
+// The format of a mesh with these MeshAttributes, in the order of ObjLoader.h with the input names of the scene shaders:
+// position, color, texcoord and normal
+VertexFormat MakeMeshVertexFormat(unsigned int attributes, const VertexQuantization& quantization);
+
+// Converts the float vertices of the mesh into the format of MakeMeshVertexFormat.
+// Returns the matrix that takes a stored position back to the position of the mesh, it goes in front of the model matrix.
+glm::mat4 QuantizeVertices(const MeshData& mesh, const VertexQuantization& quantization, std::vector<unsigned char>& vertices);
+
+// The matrix QuantizeVertices returns, for positions scaled by scale and then moved by offset
+glm::mat4 MakeDequantization(const glm::vec3& scale, const glm::vec3& offset);
+
+// A mesh the way it goes to the GPU, made from an OBJ by Tools/MeshConverter or the first time a mesh is loaded.
+// Its triangles and vertices are already in the order OptimizeMesh puts them in.
+// The file starts with a header, then the interleaved vertices at 4 KB and the indices after them at a multiple of 16 bytes.
+// The vertices are quantized the way VertexQuantization says and indices are 16 bit when there are few enough vertices. Loading one is a memory mapping that is handed to glBufferData,
+// nothing is parsed or copied into a buffer of our own.
+// The indices of the levels of detail follow the ones of the full mesh, they all use the same vertices.
+
+static const unsigned int MaxMeshLods = 8;
+
+// A level of detail is a range of the indices, the full mesh is the first one
+struct MeshFileLod
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+
+	// See MeshLod
+	float error;
+	unsigned int reserved;
+};
+
+struct MeshFileHeader
+{
+	char magic[4];
+	unsigned int version;
+
+	// MeshAttributes, and the VertexAttributeType of the position, color, texcoord and normal.
+	// The layout is the one of MakeMeshVertexFormat.
+	unsigned int attributes;
+	unsigned int attributeTypes[4];
+	unsigned int vertexStride;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+
+	// 2 or 4 bytes
+	unsigned int indexSize;
+	unsigned int lodCount;
+	MeshFileLod lods[MaxMeshLods];
+
+	float boundsMin[3];
+	float boundsMax[3];
+
+	// Stored positions are scaled by this and then moved by that, see QuantizeVertices
+	float dequantizationScale[3];
+	float dequantizationOffset[3];
+
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+
+	// Size and modification time of the file the mesh was made from, to tell whether it changed since
+	unsigned long long sourceSize;
+	long long sourceTime;
+};
+
+// Size and modification time of a file, returns false when it isn't on disk
+bool GetFileStamp(const std::string& path, unsigned long long& size, long long& time);
+
+// Quantizes the vertices and writes the mesh and its levels of detail with the stamp of its source, see GetFileStamp.
+// Levels after MaxMeshLods are left out.
+bool WriteMeshFile(const char* path, const MeshData& mesh, const VertexQuantization& quantization, unsigned long long sourceSize = 0, long long sourceTime = 0);
+
+// Reads a mesh file straight from a memory mapping
+class MeshFile
+{
+public:
+	MeshFile();
+
+	MeshFile(const MeshFile&) = delete;
+	MeshFile& operator=(const MeshFile&) = delete;
+
+	// Returns false when the file doesn't exist or isn't a mesh file
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+	const MeshFileHeader& GetHeader() const { return m_Header; }
+
+	// Whether the mesh was made from a file with this stamp
+	bool IsMadeFrom(unsigned long long sourceSize, long long sourceTime) const;
+
+	VertexQuantization GetQuantization() const;
+	VertexFormat GetVertexFormat() const;
+
+	// Goes in front of the model matrix, see QuantizeVertices
+	glm::mat4 GetDequantization() const;
+
+	const void* GetVertices() const { return m_File.GetData() + m_Header.vertexOffset; }
+	size_t GetVertexBytes() const { return (size_t)m_Header.vertexCount * m_Header.vertexStride; }
+
+	const void* GetIndices() const { return m_File.GetData() + m_Header.indexOffset; }
+	size_t GetIndexBytes() const { return (size_t)m_Header.indexCount * m_Header.indexSize; }
+
+private:
+	MappedFile m_File;
+	MeshFileHeader m_Header;
+};
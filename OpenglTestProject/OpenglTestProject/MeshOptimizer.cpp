@@ -0,0 +1,345 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cmath>
+
+// A FIFO post-transform cache: a vertex stays in it until cacheSize other vertices were put in after it
+class VertexCacheSimulator
+{
+public:
+	VertexCacheSimulator(size_t vertexCount, int cacheSize)
+		: m_CachedAt(vertexCount, 0)
+		, m_Misses(0)
+		, m_CacheSize((unsigned int)cacheSize)
+	{
+	}
+
+	// Returns true when the vertex had to be transformed
+	bool Access(unsigned int vertex)
+	{
+		if (m_CachedAt[vertex] != 0 && m_Misses - m_CachedAt[vertex] < m_CacheSize)
+			return false;
+
+		m_CachedAt[vertex] = ++m_Misses;
+		return true;
+	}
+
+	// Pushes every vertex out, like drawing something else in between would
+	void Flush()
+	{
+		m_Misses += m_CacheSize;
+	}
+
+private:
+	std::vector<unsigned int> m_CachedAt;
+	unsigned int m_Misses;
+	unsigned int m_CacheSize;
+};
+
+MeshCacheStats AnalyzeMesh(const MeshData& mesh, int cacheSize)
+{
+	MeshCacheStats stats;
+	size_t vertexCount = mesh.GetVertexCount();
+	size_t triangleCount = mesh.indices.size() / 3;
+	if (triangleCount == 0 || vertexCount == 0)
+		return stats;
+
+	VertexCacheSimulator cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	size_t usedCount = 0;
+	size_t misses = 0;
+
+	// The vertex fetch: 64 byte lines in a direct mapped cache of 4 KB
+	const size_t lineSize = 64;
+	const size_t lineCount = 64;
+	std::vector<size_t> lines(lineCount, SIZE_MAX);
+	size_t vertexBytes = GetMeshVertexSize(mesh.attributes) * sizeof(float);
+	size_t fetchedBytes = 0;
+
+	for (unsigned int index : mesh.indices)
+	{
+		if (!used[index])
+		{
+			used[index] = true;
+			++usedCount;
+		}
+
+		if (!cache.Access(index))
+			continue;
+
+		++misses;
+		for (size_t line = index * vertexBytes / lineSize; line <= (index * vertexBytes + vertexBytes - 1) / lineSize; ++line)
+		{
+			if (lines[line % lineCount] != line)
+			{
+				lines[line % lineCount] = line;
+				fetchedBytes += lineSize;
+			}
+		}
+	}
+
+	stats.acmr = (float)misses / triangleCount;
+	stats.atvr = (float)misses / usedCount;
+	stats.overfetch = (float)fetchedBytes / (vertexCount * vertexBytes);
+	return stats;
+}
+
+std::vector<unsigned int> OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize)
+{
+	std::vector<unsigned int> clusters;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return clusters;
+
+	// The triangles of every vertex, the ones of vertex v are adjacency[offsets[v]] up to adjacency[offsets[v + 1]]
+	std::vector<unsigned int> live(vertexCount, 0);
+	for (unsigned int index : indices)
+		++live[index];
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		offsets[vertex + 1] = offsets[vertex] + live[vertex];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); ++i)
+		adjacency[filled[indices[i]]++] = (unsigned int)(i / 3);
+
+	// A vertex is in the cache while time - cacheTime is at most cacheSize
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = (unsigned int)cacheSize + 1;
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnd;
+	std::vector<unsigned int> candidates;
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+
+	size_t cursor = 0;
+	while (cursor < vertexCount && live[cursor] == 0)
+		++cursor;
+
+	clusters.push_back(0);
+	long long fanning = cursor < vertexCount ? (long long)cursor : -1;
+	while (fanning >= 0)
+	{
+		// Every triangle around the vertex that isn't drawn yet
+		candidates.clear();
+		for (unsigned int a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+		{
+			unsigned int triangle = adjacency[a];
+			if (emitted[triangle])
+				continue;
+
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int vertex = indices[triangle * 3 + corner];
+				result.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+
+				if (time - cacheTime[vertex] > (unsigned int)cacheSize)
+					cacheTime[vertex] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Go on with the vertex that has been in the cache the longest, as long as fanning around it won't push it out
+		long long next = -1;
+		long long bestPriority = -1;
+		for (unsigned int vertex : candidates)
+		{
+			if (live[vertex] == 0)
+				continue;
+
+			long long priority = 0;
+			if (time - cacheTime[vertex] + 2 * live[vertex] <= (unsigned int)cacheSize)
+				priority = time - cacheTime[vertex];
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		// A dead end: the most recent vertex that still has triangles, or the next one in the buffer
+		if (next == -1)
+		{
+			while (!deadEnd.empty() && next == -1)
+			{
+				unsigned int vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[vertex] > 0)
+					next = vertex;
+			}
+
+			while (next == -1 && cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					next = (long long)cursor;
+				else
+					++cursor;
+			}
+
+			if (next != -1)
+				clusters.push_back((unsigned int)(result.size() / 3));
+		}
+
+		fanning = next;
+	}
+
+	indices.swap(result);
+	return clusters;
+}
+
+void OptimizeOverdraw(MeshData& mesh, const std::vector<unsigned int>& clusters, float threshold, int cacheSize)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.GetVertexCount();
+	if (triangleCount == 0 || clusters.empty())
+		return;
+
+	const std::vector<unsigned int>& indices = mesh.indices;
+	VertexCacheSimulator cache(vertexCount, cacheSize);
+
+	auto countMisses = [&indices, &cache](size_t triangle)
+	{
+		return (int)cache.Access(indices[triangle * 3]) + (int)cache.Access(indices[triangle * 3 + 1]) + (int)cache.Access(indices[triangle * 3 + 2]);
+	};
+
+	// Cuts every cluster wherever the part before the cut is already about as good as the whole cluster
+	std::vector<size_t> starts;
+	for (size_t cluster = 0; cluster < clusters.size(); ++cluster)
+	{
+		size_t begin = clusters[cluster];
+		size_t end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+
+		cache.Flush();
+		size_t clusterMisses = 0;
+		for (size_t triangle = begin; triangle < end; ++triangle)
+			clusterMisses += countMisses(triangle);
+		float clusterAcmr = (float)clusterMisses / (end - begin);
+
+		cache.Flush();
+		starts.push_back(begin);
+		size_t misses = 0;
+		size_t count = 0;
+		for (size_t triangle = begin; triangle < end; ++triangle)
+		{
+			misses += countMisses(triangle);
+			++count;
+
+			if (triangle + 1 < end && misses <= threshold * clusterAcmr * count)
+			{
+				starts.push_back(triangle + 1);
+				cache.Flush();
+				misses = 0;
+				count = 0;
+			}
+		}
+	}
+
+	unsigned int vertexSize = GetMeshVertexSize(mesh.attributes);
+	auto getPosition = [&mesh, vertexSize](unsigned int vertex)
+	{
+		const float* position = &mesh.vertices[(size_t)vertex * vertexSize];
+		return glm::vec3(position[0], position[1], position[2]);
+	};
+
+	// Area weighted middle of every cluster and of the whole mesh, and the area weighted normal of every cluster
+	std::vector<glm::vec3> centers(starts.size());
+	std::vector<glm::vec3> normals(starts.size());
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < starts.size(); ++cluster)
+	{
+		size_t end = cluster + 1 < starts.size() ? starts[cluster + 1] : triangleCount;
+
+		glm::vec3 center(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (size_t triangle = starts[cluster]; triangle < end; ++triangle)
+		{
+			glm::vec3 a = getPosition(indices[triangle * 3]);
+			glm::vec3 b = getPosition(indices[triangle * 3 + 1]);
+			glm::vec3 c = getPosition(indices[triangle * 3 + 2]);
+
+			glm::vec3 cross = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(cross);
+			center += (a + b + c) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+
+		meshCenter += center;
+		meshArea += area;
+		centers[cluster] = area > 0.0f ? center / area : center;
+		normals[cluster] = normal;
+	}
+
+	if (meshArea > 0.0f)
+		meshCenter /= meshArea;
+
+	// Clusters whose normal points away from the middle first
+	std::vector<float> keys(starts.size());
+	std::vector<size_t> order(starts.size());
+	for (size_t cluster = 0; cluster < starts.size(); ++cluster)
+	{
+		float length = glm::length(normals[cluster]);
+		keys[cluster] = length > 0.0f ? glm::dot(centers[cluster] - meshCenter, normals[cluster] / length) : 0.0f;
+		order[cluster] = cluster;
+	}
+	std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+	std::vector<unsigned int> sorted;
+	sorted.reserve(indices.size());
+	for (size_t cluster : order)
+	{
+		size_t end = cluster + 1 < starts.size() ? starts[cluster + 1] : triangleCount;
+		sorted.insert(sorted.end(), indices.begin() + starts[cluster] * 3, indices.begin() + end * 3);
+	}
+
+	mesh.indices.swap(sorted);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+	unsigned int vertexSize = GetMeshVertexSize(mesh.attributes);
+	std::vector<unsigned int> remap(mesh.GetVertexCount(), UINT_MAX);
+	std::vector<float> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	unsigned int next = 0;
+	auto remapIndices = [&](std::vector<unsigned int>& indices)
+	{
+		for (unsigned int& index : indices)
+		{
+			if (remap[index] == UINT_MAX)
+			{
+				remap[index] = next++;
+				const float* vertex = &mesh.vertices[(size_t)index * vertexSize];
+				vertices.insert(vertices.end(), vertex, vertex + vertexSize);
+			}
+
+			index = remap[index];
+		}
+	};
+
+	// The levels of detail only use vertices of the full mesh, so the full mesh decides the order
+	remapIndices(mesh.indices);
+	for (MeshLod& lod : mesh.lods)
+		remapIndices(lod.indices);
+
+	mesh.vertices.swap(vertices);
+}
+
+void OptimizeMesh(MeshData& mesh, int cacheSize)
+{
+	std::vector<unsigned int> clusters = OptimizeVertexCache(mesh.indices, mesh.GetVertexCount(), cacheSize);
+	OptimizeOverdraw(mesh, clusters, 1.05f, cacheSize);
+	OptimizeVertexFetch(mesh);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ObjLoader.h"
+
+#include <vector>
+#include <cstddef>
+
+// How well the triangle and vertex order of a mesh suits the GPU
+struct MeshCacheStats
+{
+	// Vertices transformed per triangle with a FIFO post-transform cache, 0.5 is the best a regular grid can do and 3 the worst
+	float acmr;
+
+	// Vertices transformed per vertex of the mesh, 1 is perfect
+	float atvr;
+
+	// Bytes read from the vertex buffer per byte in it, with 64 byte lines and a small cache. 1 is perfect
+	float overfetch;
+
+	MeshCacheStats() : acmr(0.0f), atvr(0.0f), overfetch(0.0f) {}
+};
+
+MeshCacheStats AnalyzeMesh(const MeshData& mesh, int cacheSize = 16);
+
+// Reorders the triangles with Tipsify (Sander, Nehab and Barczak, 2007): it fans around a vertex until the vertices
+// it would go on with are about to fall out of the cache, which keeps the ACMR close to that of Forsyth's algorithm in linear time.
+// Returns the first triangle of every cluster, the places where it had to jump to a vertex that isn't in the cache anymore.
+std::vector<unsigned int> OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, int cacheSize = 16);
+
+// Sorts the clusters of OptimizeVertexCache so the ones facing away from the middle of the mesh are drawn first,
+// those are the ones most likely to hide the others. Clusters are cut into smaller ones first wherever that keeps their ACMR
+// within threshold of the whole cluster, so there's more to sort without losing much of the cache order.
+void OptimizeOverdraw(MeshData& mesh, const std::vector<unsigned int>& clusters, float threshold = 1.05f, int cacheSize = 16);
+
+// Puts the vertices in the order the triangles use them first, so the vertex fetch reads the buffer front to back.
+// Vertices no triangle uses are removed, the levels of detail in mesh.lods are remapped along.
+void OptimizeVertexFetch(MeshData& mesh);
+
+// All 3 of them in that order, for a mesh that is loaded and drawn as it is
+void OptimizeMesh(MeshData& mesh, int cacheSize = 16);
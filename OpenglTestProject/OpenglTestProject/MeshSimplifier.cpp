@@ -0,0 +1,380 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+// The sum of the squared distances to a set of planes, weighted by the area of the triangles they came from:
+// a symmetric 4x4 matrix that is evaluated as p^T A p + 2 b.p + c
+struct Quadric
+{
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2;
+	double c;
+
+	// The sum of the weights, dividing by it makes the error an average squared distance
+	double weight;
+
+	Quadric() : a00(0), a11(0), a22(0), a01(0), a02(0), a12(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+	// The plane n.p + d = 0 with a unit normal
+	void AddPlane(const glm::dvec3& n, double d, double w)
+	{
+		a00 += w * n.x * n.x;
+		a11 += w * n.y * n.y;
+		a22 += w * n.z * n.z;
+		a01 += w * n.x * n.y;
+		a02 += w * n.x * n.z;
+		a12 += w * n.y * n.z;
+		b0 += w * n.x * d;
+		b1 += w * n.y * d;
+		b2 += w * n.z * d;
+		c += w * d * d;
+		weight += w;
+	}
+
+	void Add(const Quadric& other)
+	{
+		a00 += other.a00;
+		a11 += other.a11;
+		a22 += other.a22;
+		a01 += other.a01;
+		a02 += other.a02;
+		a12 += other.a12;
+		b0 += other.b0;
+		b1 += other.b1;
+		b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	double Evaluate(const glm::dvec3& p) const
+	{
+		double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z + 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+			+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+		return std::fabs(r) / (weight > 0.0 ? weight : 1.0);
+	}
+};
+
+// Borders pull harder than the surface, an outline that moves shows more than a surface that bends a little
+static const double BorderWeight = 10.0;
+
+// The triangles around every position, in the layout of a compressed sparse row matrix
+struct TriangleAdjacency
+{
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> triangles;
+
+	void Build(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionOf, size_t positionCount)
+	{
+		offsets.assign(positionCount + 1, 0);
+		for (unsigned int index : indices)
+			++offsets[positionOf[index] + 1];
+		for (size_t i = 0; i < positionCount; ++i)
+			offsets[i + 1] += offsets[i];
+
+		std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+		triangles.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); ++i)
+			triangles[next[positionOf[indices[i]]]++] = (unsigned int)(i / 3);
+	}
+};
+
+struct EdgeCollapse
+{
+	unsigned int from;
+	unsigned int to;
+	float error;
+};
+
+std::vector<unsigned int> SimplifyMesh(const MeshData& mesh, const std::vector<unsigned int>& indices, size_t targetIndexCount,
+	float targetError, float* resultError)
+{
+	size_t vertexCount = mesh.GetVertexCount();
+	unsigned int vertexSize = GetMeshVertexSize(mesh.attributes);
+
+	// Positions relative to the bounds, so errors are relative to the size of the mesh
+	glm::vec3 extent = mesh.boundsMax - mesh.boundsMin;
+	float scale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-20f));
+	std::vector<glm::dvec3> positions(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const float* p = &mesh.vertices[i * vertexSize];
+		positions[i] = glm::dvec3((glm::vec3(p[0], p[1], p[2]) - mesh.boundsMin) / scale);
+	}
+
+	// Vertices with the same position but other texcoords or normals are one position to the topology
+	std::vector<unsigned int> order(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+		order[i] = (unsigned int)i;
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		const glm::dvec3& pa = positions[a];
+		const glm::dvec3& pb = positions[b];
+		return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+	});
+
+	std::vector<unsigned int> positionOf(vertexCount);
+	size_t positionCount = 0;
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		if (i > 0 && positions[order[i]] != positions[order[i - 1]])
+			++positionCount;
+		positionOf[order[i]] = (unsigned int)positionCount;
+	}
+	positionCount = vertexCount > 0 ? positionCount + 1 : 0;
+
+	// A position with more than one vertex is on a seam, collapsing it would tear the texture mapping apart
+	std::vector<unsigned int> vertexOfPosition(positionCount, UINT_MAX);
+	std::vector<bool> seam(positionCount, false);
+	for (unsigned int index : indices)
+	{
+		unsigned int& vertex = vertexOfPosition[positionOf[index]];
+		if (vertex != UINT_MAX && vertex != index)
+			seam[positionOf[index]] = true;
+		vertex = index;
+	}
+
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const glm::dvec3& p0 = positions[indices[i]];
+		glm::dvec3 normal = glm::cross(positions[indices[i + 1]] - p0, positions[indices[i + 2]] - p0);
+		double length = glm::length(normal);
+		if (length <= 0.0)
+			continue;
+
+		normal /= length;
+		for (int corner = 0; corner < 3; ++corner)
+			quadrics[positionOf[indices[i + corner]]].AddPlane(normal, -glm::dot(normal, p0), length * 0.5);
+	}
+
+	std::vector<unsigned int> result = indices;
+	std::vector<unsigned int> collapseTo(vertexCount);
+	std::vector<bool> border(positionCount);
+	std::vector<bool> locked(positionCount);
+	std::vector<EdgeCollapse> collapses;
+	TriangleAdjacency adjacency;
+	double maxError = 0.0;
+	double errorLimit = (double)targetError * targetError;
+	bool firstPass = true;
+
+	while (result.size() > targetIndexCount)
+	{
+		adjacency.Build(result, positionOf, positionCount);
+
+		// Whether a triangle has the edge from a to b, in its winding order
+		auto hasEdge = [&](unsigned int a, unsigned int b)
+		{
+			for (unsigned int t = adjacency.offsets[a]; t < adjacency.offsets[a + 1]; ++t)
+			{
+				const unsigned int* triangle = &result[adjacency.triangles[t] * 3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					if (positionOf[triangle[corner]] == a && positionOf[triangle[(corner + 1) % 3]] == b)
+						return true;
+				}
+			}
+			return false;
+		};
+
+		// An edge only one triangle has is on a border
+		std::fill(border.begin(), border.end(), false);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int a = positionOf[result[i + corner]];
+				unsigned int b = positionOf[result[i + (corner + 1) % 3]];
+				if (hasEdge(b, a))
+					continue;
+
+				border[a] = true;
+				border[b] = true;
+
+				// A plane through the border that stands on the triangle keeps the border from moving sideways, added once
+				if (firstPass)
+				{
+					const glm::dvec3& pa = positions[result[i + corner]];
+					const glm::dvec3& pb = positions[result[i + (corner + 1) % 3]];
+					glm::dvec3 normal = glm::cross(pb - pa, positions[result[i + (corner + 2) % 3]] - pa);
+					glm::dvec3 edgeNormal = glm::cross(pb - pa, normal);
+					double length = glm::length(edgeNormal);
+					if (length <= 0.0)
+						continue;
+
+					edgeNormal /= length;
+					double weight = glm::length(pb - pa) * BorderWeight;
+					quadrics[a].AddPlane(edgeNormal, -glm::dot(edgeNormal, pa), weight);
+					quadrics[b].AddPlane(edgeNormal, -glm::dot(edgeNormal, pa), weight);
+				}
+			}
+		}
+		firstPass = false;
+
+		auto canCollapse = [&](unsigned int from, unsigned int to)
+		{
+			unsigned int a = positionOf[from];
+			unsigned int b = positionOf[to];
+			if (seam[a])
+				return false;
+
+			// Along the border only
+			return !border[a] || !hasEdge(a, b) || !hasEdge(b, a);
+		};
+
+		auto collapseError = [&](unsigned int from, unsigned int to)
+		{
+			Quadric quadric = quadrics[positionOf[from]];
+			quadric.Add(quadrics[positionOf[to]]);
+			return quadric.Evaluate(positions[to]);
+		};
+
+		// Every edge once, in the cheaper of its two directions
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				unsigned int v0 = result[i + corner];
+				unsigned int v1 = result[i + (corner + 1) % 3];
+				unsigned int a = positionOf[v0];
+				unsigned int b = positionOf[v1];
+				if (a == b || (a > b && hasEdge(b, a)))
+					continue;
+
+				bool forward = canCollapse(v0, v1);
+				bool backward = canCollapse(v1, v0);
+				if (!forward && !backward)
+					continue;
+
+				double forwardError = forward ? collapseError(v0, v1) : 0.0;
+				double backwardError = backward ? collapseError(v1, v0) : 0.0;
+
+				EdgeCollapse collapse;
+				bool useForward = forward && (!backward || forwardError <= backwardError);
+				collapse.from = useForward ? v0 : v1;
+				collapse.to = useForward ? v1 : v0;
+				collapse.error = (float)(useForward ? forwardError : backwardError);
+				if (collapse.error <= errorLimit)
+					collapses.push_back(collapse);
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.error < b.error; });
+
+		// Collapses whose triangles don't overlap are made in the same pass, the ones they'd touch wait for the next pass
+		std::fill(locked.begin(), locked.end(), false);
+		for (size_t i = 0; i < vertexCount; ++i)
+			collapseTo[i] = (unsigned int)i;
+
+		size_t triangleCount = result.size() / 3;
+		size_t targetTriangleCount = targetIndexCount / 3;
+		size_t collapsed = 0;
+		for (const EdgeCollapse& collapse : collapses)
+		{
+			if (triangleCount <= targetTriangleCount)
+				break;
+
+			unsigned int a = positionOf[collapse.from];
+			unsigned int b = positionOf[collapse.to];
+			if (locked[a] || locked[b])
+				continue;
+
+			// The triangles that keep existing mustn't turn over
+			bool flips = false;
+			size_t removed = 0;
+			for (unsigned int t = adjacency.offsets[a]; t < adjacency.offsets[a + 1] && !flips; ++t)
+			{
+				const unsigned int* triangle = &result[adjacency.triangles[t] * 3];
+				glm::dvec3 before[3];
+				glm::dvec3 after[3];
+				bool degenerate = false;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					unsigned int position = positionOf[triangle[corner]];
+					degenerate = degenerate || position == b;
+					before[corner] = positions[triangle[corner]];
+					after[corner] = position == a ? positions[collapse.to] : before[corner];
+				}
+
+				if (degenerate)
+				{
+					++removed;
+					continue;
+				}
+
+				glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normalBefore, normalAfter) <= 1e-2 * glm::length(normalBefore) * glm::length(normalAfter);
+			}
+
+			if (flips)
+				continue;
+
+			collapseTo[collapse.from] = collapse.to;
+			quadrics[b].Add(quadrics[a]);
+			maxError = std::max(maxError, (double)collapse.error);
+			triangleCount -= removed;
+			++collapsed;
+
+			locked[a] = true;
+			locked[b] = true;
+			for (unsigned int t = adjacency.offsets[a]; t < adjacency.offsets[a + 1]; ++t)
+			{
+				const unsigned int* triangle = &result[adjacency.triangles[t] * 3];
+				for (int corner = 0; corner < 3; ++corner)
+					locked[positionOf[triangle[corner]]] = true;
+			}
+		}
+
+		if (collapsed == 0)
+			break;
+
+		// Triangles that lost a corner are gone
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int v0 = collapseTo[result[i]];
+			unsigned int v1 = collapseTo[result[i + 1]];
+			unsigned int v2 = collapseTo[result[i + 2]];
+			if (positionOf[v0] == positionOf[v1] || positionOf[v1] == positionOf[v2] || positionOf[v0] == positionOf[v2])
+				continue;
+
+			result[write++] = v0;
+			result[write++] = v1;
+			result[write++] = v2;
+		}
+		result.resize(write);
+	}
+
+	if (resultError)
+		*resultError = (float)std::sqrt(maxError);
+
+	return result;
+}
+
+void GenerateLods(MeshData& mesh, int lodCount, float reduction, float maxError)
+{
+	mesh.lods.clear();
+
+	float error = 0.0f;
+	for (int level = 1; level < lodCount; ++level)
+	{
+		const std::vector<unsigned int>& previous = mesh.lods.empty() ? mesh.indices : mesh.lods.back().indices;
+		size_t targetIndexCount = (size_t)(previous.size() / 3 * reduction) * 3;
+
+		// Every level is simplified from the one before, so its error is at most the sum of theirs
+		float levelError = 0.0f;
+		MeshLod lod;
+		lod.indices = SimplifyMesh(mesh, previous, targetIndexCount, maxError - error, &levelError);
+		if (lod.indices.empty() || lod.indices.size() > previous.size() * (1.0f + reduction) * 0.5f)
+			break;
+
+		error += levelError;
+		lod.error = error;
+		OptimizeVertexCache(lod.indices, mesh.GetVertexCount());
+		mesh.lods.push_back(std::move(lod));
+	}
+}
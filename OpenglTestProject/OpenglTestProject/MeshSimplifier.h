@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ObjLoader.h"
+
+#include <vector>
+#include <cstddef>
+
+// Simplifies the triangles with edge collapses ordered by the quadric error metric (Garland and Heckbert, 1997).
+// A vertex is always collapsed onto one of its neighbours instead of a new position, so the result uses the vertices of the mesh
+// and levels of detail can share its vertex buffer. Vertices on a border only move along the border, vertices on a seam of the
+// texcoords or normals don't move at all, so the outline and the texture mapping stay where they are.
+//
+// Collapses until there are at most targetIndexCount indices left or the next one would move the surface further than targetError,
+// which is relative to the largest side of the bounds. The error it got to is written to resultError.
+// Doesn't touch OpenGL, so it can run on any thread.
+std::vector<unsigned int> SimplifyMesh(const MeshData& mesh, const std::vector<unsigned int>& indices, size_t targetIndexCount,
+	float targetError, float* resultError = nullptr);
+
+// Fills mesh.lods with up to lodCount - 1 levels after the full mesh, each simplified from the one before to about reduction
+// times its triangles and optimized for the vertex cache. Stops early when a level would be off by more than maxError
+// or hardly gets simpler, so a mesh with few triangles or seams everywhere gets fewer levels.
+void GenerateLods(MeshData& mesh, int lodCount = 4, float reduction = 0.5f, float maxError = 0.05f);
@@ -0,0 +1,322 @@
+#include "MipGenerator.h"
+
+#include <cmath>
+#include <algorithm>
+
+// SSE2 is always there on x64, on x86 it's enabled with /arch:SSE2 or -msse2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// The source pixels that contribute to one destination pixel and how much
+struct FilterTaps
+{
+	int start;
+	std::vector<float> weights;
+};
+
+static const float Pi = 3.14159265358979f;
+
+// Half the width of the filters, in destination pixels
+static const float BoxRadius = 0.5f;
+static const float KaiserRadius = 2.0f;
+static const float KaiserAlpha = 4.0f;
+
+// Modified Bessel function of the first kind, the series converges quickly for the values the Kaiser window uses
+static float Bessel0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	float halfX = x * 0.5f;
+	for (int k = 1; k < 16; ++k)
+	{
+		term *= (halfX / k) * (halfX / k);
+		sum += term;
+	}
+
+	return sum;
+}
+
+static float Sinc(float x)
+{
+	if (std::fabs(x) < 1e-5f)
+		return 1.0f;
+
+	return std::sin(Pi * x) / (Pi * x);
+}
+
+static float EvaluateFilter(MipFilter filter, float t)
+{
+	if (filter == MipFilter::Box)
+		return std::fabs(t) <= BoxRadius ? 1.0f : 0.0f;
+
+	float x = t / KaiserRadius;
+	if (std::fabs(x) >= 1.0f)
+		return 0.0f;
+
+	return Sinc(t) * Bessel0(KaiserAlpha * std::sqrt(1.0f - x * x)) / Bessel0(KaiserAlpha);
+}
+
+// The weights only depend on the position in the row, so they're calculated once per level and reused for every row.
+// Taps outside of the image are added to the edge pixel, like GL_CLAMP_TO_EDGE.
+static std::vector<FilterTaps> CalculateTaps(int sourceSize, int destinationSize, MipFilter filter)
+{
+	float scale = (float)sourceSize / destinationSize;
+	float radius = (filter == MipFilter::Box ? BoxRadius : KaiserRadius) * scale;
+
+	std::vector<FilterTaps> taps(destinationSize);
+	for (int x = 0; x < destinationSize; ++x)
+	{
+		float center = (x + 0.5f) * scale;
+		int first = (int)std::floor(center - radius);
+		int last = (int)std::ceil(center + radius);
+
+		FilterTaps& tap = taps[x];
+		tap.start = std::max(first, 0);
+		tap.weights.assign(std::min(last, sourceSize - 1) - tap.start + 1, 0.0f);
+
+		float total = 0.0f;
+		for (int i = first; i <= last; ++i)
+		{
+			float weight = EvaluateFilter(filter, (i + 0.5f - center) / scale);
+			int index = std::min(std::max(i, 0), sourceSize - 1);
+			tap.weights[index - tap.start] += weight;
+			total += weight;
+		}
+
+		for (float& weight : tap.weights)
+			weight /= total;
+	}
+
+	return taps;
+}
+
+// Filters every row of RGBA float pixels to the new width
+static void FilterRows(const float* source, int sourceWidth, int rows, float* destination, int destinationWidth, const std::vector<FilterTaps>& taps)
+{
+	for (int y = 0; y < rows; ++y)
+	{
+		const float* sourceRow = source + (size_t)y * sourceWidth * 4;
+		float* destinationRow = destination + (size_t)y * destinationWidth * 4;
+
+		for (int x = 0; x < destinationWidth; ++x)
+		{
+			const FilterTaps& tap = taps[x];
+			const float* pixel = sourceRow + (size_t)tap.start * 4;
+
+#ifdef MIP_GENERATOR_SSE2
+			// One pixel is exactly one register, RGBA
+			__m128 sum = _mm_setzero_ps();
+			for (size_t i = 0; i < tap.weights.size(); ++i)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(tap.weights[i]), _mm_loadu_ps(pixel + i * 4)));
+
+			_mm_storeu_ps(destinationRow + x * 4, sum);
+#else
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (size_t i = 0; i < tap.weights.size(); ++i)
+			{
+				for (int c = 0; c < 4; ++c)
+					sum[c] += tap.weights[i] * pixel[i * 4 + c];
+			}
+
+			for (int c = 0; c < 4; ++c)
+				destinationRow[x * 4 + c] = sum[c];
+#endif
+		}
+	}
+}
+
+// Filters the columns to the new height. Whole rows are added up with their weight, which keeps the memory access linear.
+static void FilterColumns(const float* source, int width, float* destination, int destinationHeight, const std::vector<FilterTaps>& taps)
+{
+	size_t rowFloats = (size_t)width * 4;
+
+	for (int y = 0; y < destinationHeight; ++y)
+	{
+		float* destinationRow = destination + y * rowFloats;
+		std::fill(destinationRow, destinationRow + rowFloats, 0.0f);
+
+		const FilterTaps& tap = taps[y];
+		for (size_t i = 0; i < tap.weights.size(); ++i)
+		{
+			const float* sourceRow = source + (tap.start + i) * rowFloats;
+			float weight = tap.weights[i];
+
+#ifdef MIP_GENERATOR_SSE2
+			__m128 weights = _mm_set1_ps(weight);
+			for (size_t f = 0; f < rowFloats; f += 4)
+				_mm_storeu_ps(destinationRow + f, _mm_add_ps(_mm_loadu_ps(destinationRow + f), _mm_mul_ps(weights, _mm_loadu_ps(sourceRow + f))));
+#else
+			for (size_t f = 0; f < rowFloats; ++f)
+				destinationRow[f] += weight * sourceRow[f];
+#endif
+		}
+	}
+}
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+// Converting back to sRGB with pow for every pixel would cost more than the filtering itself, so look it up instead.
+// 4096 steps are enough to hit the right 8 bit value, even in the dark part where sRGB has the most precision.
+static const int LinearToSrgbTableSize = 4096;
+
+struct SrgbTables
+{
+	float toLinear[256];
+	unsigned char toSrgb[LinearToSrgbTableSize];
+
+	SrgbTables()
+	{
+		for (int i = 0; i < 256; ++i)
+			toLinear[i] = SrgbToLinear(i / 255.0f);
+
+		for (int i = 0; i < LinearToSrgbTableSize; ++i)
+			toSrgb[i] = (unsigned char)(LinearToSrgb(i / (float)(LinearToSrgbTableSize - 1)) * 255.0f + 0.5f);
+	}
+};
+
+static const SrgbTables& GetSrgbTables()
+{
+	static const SrgbTables tables;
+	return tables;
+}
+
+static std::vector<unsigned char> ToBytes(const std::vector<float>& pixels, bool srgb)
+{
+	const SrgbTables& tables = GetSrgbTables();
+	std::vector<unsigned char> bytes(pixels.size());
+
+	// Color channels are scaled to a position in the table, alpha straight to 8 bits
+	float colorScale = srgb ? (float)(LinearToSrgbTableSize - 1) : 255.0f;
+
+#ifdef MIP_GENERATOR_SSE2
+	__m128 scale = _mm_set_ps(255.0f, colorScale, colorScale, colorScale);
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.0f);
+#endif
+
+	for (size_t i = 0; i < pixels.size(); i += 4)
+	{
+		int values[4];
+
+#ifdef MIP_GENERATOR_SSE2
+		// The negative lobes of the Kaiser filter can overshoot a little
+		__m128 pixel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&pixels[i]), zero), one);
+		_mm_storeu_si128((__m128i*)values, _mm_cvtps_epi32(_mm_mul_ps(pixel, scale)));
+#else
+		for (int c = 0; c < 4; ++c)
+		{
+			float value = std::min(std::max(pixels[i + c], 0.0f), 1.0f);
+			values[c] = (int)(value * (c == 3 ? 255.0f : colorScale) + 0.5f);
+		}
+#endif
+
+		for (int c = 0; c < 3; ++c)
+			bytes[i + c] = srgb ? tables.toSrgb[values[c]] : (unsigned char)values[c];
+		bytes[i + 3] = (unsigned char)values[3];
+	}
+
+	return bytes;
+}
+
+int GetMipLevelCount(int width, int height)
+{
+	int levels = 1;
+	int size = std::max(width, height);
+	while (size > 1)
+	{
+		size /= 2;
+		++levels;
+	}
+
+	return levels;
+}
+
+std::vector<unsigned char> DownsampleBox(const unsigned char* rgba, int width, int height, bool srgb)
+{
+	const SrgbTables& tables = GetSrgbTables();
+
+	int halfWidth = width / 2;
+	int halfHeight = height / 2;
+	std::vector<unsigned char> half((size_t)halfWidth * halfHeight * 4);
+
+	size_t rowBytes = (size_t)width * 4;
+	for (int y = 0; y < halfHeight; ++y)
+	{
+		const unsigned char* top = rgba + (size_t)y * 2 * rowBytes;
+		const unsigned char* bottom = top + rowBytes;
+		unsigned char* destination = &half[(size_t)y * halfWidth * 4];
+
+		for (int x = 0; x < halfWidth; ++x, top += 8, bottom += 8, destination += 4)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				if (srgb)
+				{
+					float sum = tables.toLinear[top[c]] + tables.toLinear[top[c + 4]] + tables.toLinear[bottom[c]] + tables.toLinear[bottom[c + 4]];
+					destination[c] = tables.toSrgb[(int)(sum * 0.25f * (LinearToSrgbTableSize - 1) + 0.5f)];
+				}
+				else
+				{
+					destination[c] = (unsigned char)((top[c] + top[c + 4] + bottom[c] + bottom[c + 4] + 2) / 4);
+				}
+			}
+
+			destination[3] = (unsigned char)((top[3] + top[7] + bottom[3] + bottom[7] + 2) / 4);
+		}
+	}
+
+	return half;
+}
+
+std::vector<std::vector<unsigned char>> GenerateMipChain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb, int maxLevels)
+{
+	std::vector<std::vector<unsigned char>> levels;
+	levels.push_back(std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4));
+
+	const SrgbTables& tables = GetSrgbTables();
+	std::vector<float> current((size_t)width * height * 4);
+	for (size_t i = 0; i < current.size(); i += 4)
+	{
+		for (int c = 0; c < 3; ++c)
+			current[i + c] = srgb ? tables.toLinear[rgba[i + c]] : rgba[i + c] / 255.0f;
+		current[i + 3] = rgba[i + 3] / 255.0f;
+	}
+
+	std::vector<float> rows;
+	std::vector<float> next;
+
+	int levelCount = GetMipLevelCount(width, height);
+	if (maxLevels > 0)
+		levelCount = std::min(levelCount, maxLevels);
+	for (int level = 1; level < levelCount; ++level)
+	{
+		int nextWidth = std::max(1, width / 2);
+		int nextHeight = std::max(1, height / 2);
+
+		// Separable: first make the rows narrower, then the columns shorter.
+		// Doing it in 2 passes costs the number of taps in each direction added instead of multiplied.
+		rows.resize((size_t)nextWidth * height * 4);
+		FilterRows(current.data(), width, height, rows.data(), nextWidth, CalculateTaps(width, nextWidth, filter));
+
+		next.resize((size_t)nextWidth * nextHeight * 4);
+		FilterColumns(rows.data(), nextWidth, next.data(), nextHeight, CalculateTaps(height, nextHeight, filter));
+
+		levels.push_back(ToBytes(next, srgb));
+
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return levels;
+}
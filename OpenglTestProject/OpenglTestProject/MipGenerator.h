@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+enum class MipFilter
+{
+	// Averages 2x2 pixels, fast but a bit blurry and it lets some aliasing through
+	Box,
+
+	// Windowed sinc, keeps the levels sharp without ringing much. Costs about 4 times as much as the box filter.
+	Kaiser
+};
+
+// Number of levels down to 1x1, including the image itself
+int GetMipLevelCount(int width, int height);
+
+// Builds the whole mip chain of an RGBA8 image, level 0 is a copy of the image itself.
+// With srgb set the color channels are converted to linear before filtering and back after it, averaging the
+// encoded values would make every level darker than the one before. Alpha is always filtered as it is.
+// Every level is filtered from the one before in floating point, so rounding errors don't pile up.
+// maxLevels stops the chain early, 0 goes all the way down to 1x1.
+// Doesn't touch OpenGL, so it can run on a loader thread or in a tool.
+std::vector<std::vector<unsigned char>> GenerateMipChain(const unsigned char* rgba, int width, int height, MipFilter filter, bool srgb = true, int maxLevels = 0);
+
+// Halves an RGBA8 image with a 2x2 box filter, width and height have to be even.
+// Works on 2 rows at a time without a floating point copy, for images that are too big for GenerateMipChain like the source of a virtual texture.
+std::vector<unsigned char> DownsampleBox(const unsigned char* rgba, int width, int height, bool srgb = true);
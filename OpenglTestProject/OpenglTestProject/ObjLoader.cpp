@@ -0,0 +1,683 @@
+#include "ObjLoader.h"
+#include "AssetPack.h"
+
+#include <iostream>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <cfloat>
+
+static const size_t MinChunkSize = 256 * 1024;
+
+unsigned int GetMeshVertexSize(unsigned int attributes)
+{
+	return 3 + ((attributes & MeshColors) ? 3 : 0) + ((attributes & MeshTexcoords) ? 2 : 0) + ((attributes & MeshNormals) ? 3 : 0);
+}
+
+int GetMeshAttributeOffset(unsigned int attributes, MeshAttributes attribute)
+{
+	if ((attributes & attribute) == 0)
+		return -1;
+
+	int offset = 3;
+	if (attribute == MeshColors)
+		return offset;
+
+	offset += (attributes & MeshColors) ? 3 : 0;
+	if (attribute == MeshTexcoords)
+		return offset;
+
+	return offset + ((attributes & MeshTexcoords) ? 2 : 0);
+}
+
+static bool IsDigit(char c)
+{
+	return (unsigned int)(c - '0') < 10;
+}
+
+static bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p != end && IsSpace(*p))
+		++p;
+	return p;
+}
+
+// strtod needs a terminated string, a number in an OBJ is never this long
+static const char* ParseFloatSlow(const char* p, const char* end, float& value)
+{
+	char buffer[64];
+	size_t length = std::min((size_t)(end - p), sizeof(buffer) - 1);
+	std::memcpy(buffer, p, length);
+	buffer[length] = '\0';
+
+	char* parsedEnd;
+	double result = std::strtod(buffer, &parsedEnd);
+	if (parsedEnd == buffer)
+		return nullptr;
+
+	value = (float)result;
+	return p + (parsedEnd - buffer);
+}
+
+static const double PowersOf10[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// Parses a number like strtof does, without needing a terminated string and without looking at the locale.
+// Returns where the number ends, nullptr when there is no number.
+// Every power of 10 up to 1e22 is exact as a double, so a number with at most 19 digits that fit in 53 bits and an exponent
+// within 22 is one multiplication or division of 2 exact doubles. That's every number exporters write, the rest goes to strtod.
+static const char* ParseFloat(const char* p, const char* end, float& value)
+{
+	const char* start = p;
+
+	bool negative = false;
+	if (p != end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	unsigned long long mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	bool truncated = false;
+
+	for (; p != end && IsDigit(*p); ++p)
+	{
+		anyDigits = true;
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			significantDigits += mantissa != 0;
+		}
+		else
+		{
+			++exponent;
+			truncated = true;
+		}
+	}
+
+	if (p != end && *p == '.')
+	{
+		for (++p; p != end && IsDigit(*p); ++p)
+		{
+			anyDigits = true;
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				significantDigits += mantissa != 0;
+				--exponent;
+			}
+			else
+			{
+				truncated = true;
+			}
+		}
+	}
+
+	// nan, inf and whatever else strtod knows
+	if (!anyDigits)
+		return ParseFloatSlow(start, end, value);
+
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		const char* e = p + 1;
+		bool negativeExponent = false;
+		if (e != end && (*e == '-' || *e == '+'))
+		{
+			negativeExponent = *e == '-';
+			++e;
+		}
+
+		if (e != end && IsDigit(*e))
+		{
+			int written = 0;
+			for (; e != end && IsDigit(*e); ++e)
+			{
+				if (written < 100000)
+					written = written * 10 + (*e - '0');
+			}
+			exponent += negativeExponent ? -written : written;
+			p = e;
+		}
+	}
+
+	if (mantissa == 0)
+	{
+		value = negative ? -0.0f : 0.0f;
+		return p;
+	}
+
+	if (truncated || mantissa > (1ull << 53) || exponent < -22 || exponent > 22)
+		return ParseFloatSlow(start, end, value);
+
+	double result = (double)mantissa;
+	result = exponent < 0 ? result / PowersOf10[-exponent] : result * PowersOf10[exponent];
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+static const char* ParseIndex(const char* p, const char* end, int& value)
+{
+	bool negative = false;
+	if (p != end && *p == '-')
+	{
+		negative = true;
+		++p;
+	}
+
+	if (p == end || !IsDigit(*p))
+		return nullptr;
+
+	long long result = 0;
+	for (; p != end && IsDigit(*p); ++p)
+	{
+		result = result * 10 + (*p - '0');
+		if (result > INT_MAX)
+			return nullptr;
+	}
+
+	value = negative ? -(int)result : (int)result;
+	return p;
+}
+
+// Returns where the line goes on after the keyword, nullptr when it doesn't start with it
+static const char* MatchKeyword(const char* p, const char* end, const char* keyword)
+{
+	for (; *keyword; ++keyword, ++p)
+	{
+		if (p == end || *p != *keyword)
+			return nullptr;
+	}
+
+	return p != end && IsSpace(*p) ? p : nullptr;
+}
+
+enum ObjComponent
+{
+	ObjPosition,
+	ObjTexcoord,
+	ObjNormal,
+};
+
+// A corner of a face as the file has it
+struct ObjCorner
+{
+	int index[3];
+
+	// Bit i is set when the corner has index[i]. Bit i + 3 is set when index[i] counts from the start of the chunk
+	// instead of the start of the file, it was a negative index then and the chunk doesn't know how many came before it.
+	unsigned int flags;
+};
+
+// A part of the file that is parsed on a thread of its own
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+
+	// 3 for every triangle
+	std::vector<ObjCorner> corners;
+
+	size_t lineCount;
+
+	// Where parsing stopped, nullptr when the whole chunk is valid
+	const char* errorLine;
+	const char* errorLineEnd;
+
+	// Attributes the faces of the chunk use
+	unsigned int usedAttributes;
+	bool invalidIndex;
+
+	ObjChunk() : begin(nullptr), end(nullptr), lineCount(0), errorLine(nullptr), errorLineEnd(nullptr), usedAttributes(0), invalidIndex(false) {}
+
+	size_t GetCount(int component) const
+	{
+		return component == ObjPosition ? positions.size() / 3 : component == ObjTexcoord ? texcoords.size() / 2 : normals.size() / 3;
+	}
+};
+
+static bool ParseFloats(const char* p, const char* end, float* values, int maxCount, int& count)
+{
+	count = 0;
+	p = SkipSpaces(p, end);
+	while (p != end && count < maxCount)
+	{
+		p = ParseFloat(p, end, values[count]);
+		if (!p)
+			return false;
+
+		++count;
+		p = SkipSpaces(p, end);
+	}
+
+	return true;
+}
+
+static bool ParseFace(ObjChunk& chunk, const char* p, const char* end, std::vector<ObjCorner>& polygon)
+{
+	polygon.clear();
+
+	p = SkipSpaces(p, end);
+	while (p != end)
+	{
+		ObjCorner corner = {};
+		for (int component = ObjPosition; component <= ObjNormal; ++component)
+		{
+			// v, v/vt, v//vn or v/vt/vn
+			if (component != ObjPosition)
+			{
+				if (p == end || *p != '/')
+					break;
+				++p;
+				if (component == ObjTexcoord && p != end && *p == '/')
+					continue;
+			}
+
+			int index;
+			p = ParseIndex(p, end, index);
+			if (!p || index == 0)
+				return false;
+
+			corner.flags |= 1u << component;
+			if (index > 0)
+			{
+				corner.index[component] = index - 1;
+			}
+			else
+			{
+				corner.index[component] = (int)chunk.GetCount(component) + index;
+				corner.flags |= 8u << component;
+			}
+		}
+
+		if (p != end && !IsSpace(*p))
+			return false;
+
+		polygon.push_back(corner);
+		p = SkipSpaces(p, end);
+	}
+
+	if (polygon.size() < 3)
+		return false;
+
+	for (size_t i = 2; i < polygon.size(); ++i)
+	{
+		chunk.corners.push_back(polygon[0]);
+		chunk.corners.push_back(polygon[i - 1]);
+		chunk.corners.push_back(polygon[i]);
+	}
+
+	return true;
+}
+
+static bool ParseLine(ObjChunk& chunk, const char* p, const char* end, std::vector<ObjCorner>& polygon)
+{
+	p = SkipSpaces(p, end);
+	if (p == end || *p == '#')
+		return true;
+
+	const char* rest;
+	float values[6];
+	int count;
+
+	if ((rest = MatchKeyword(p, end, "v")) != nullptr)
+	{
+		if (!ParseFloats(rest, end, values, 6, count) || count < 3)
+			return false;
+
+		chunk.positions.insert(chunk.positions.end(), values, values + 3);
+
+		// Vertices before the first one with a color are white
+		if (count == 6 && chunk.colors.empty())
+			chunk.colors.resize(chunk.positions.size() - 3, 1.0f);
+
+		if (count == 6)
+			chunk.colors.insert(chunk.colors.end(), values + 3, values + 6);
+		else if (!chunk.colors.empty())
+			chunk.colors.insert(chunk.colors.end(), 3, 1.0f);
+		return true;
+	}
+
+	if ((rest = MatchKeyword(p, end, "vt")) != nullptr)
+	{
+		if (!ParseFloats(rest, end, values, 3, count) || count < 1)
+			return false;
+
+		chunk.texcoords.push_back(values[0]);
+		chunk.texcoords.push_back(count > 1 ? values[1] : 0.0f);
+		return true;
+	}
+
+	if ((rest = MatchKeyword(p, end, "vn")) != nullptr)
+	{
+		if (!ParseFloats(rest, end, values, 3, count) || count < 3)
+			return false;
+
+		chunk.normals.insert(chunk.normals.end(), values, values + 3);
+		return true;
+	}
+
+	if ((rest = MatchKeyword(p, end, "f")) != nullptr)
+		return ParseFace(chunk, rest, end, polygon);
+
+	// Groups, objects, materials, smoothing groups, lines and points don't change the triangles
+	return true;
+}
+
+static void ParseChunk(ObjChunk& chunk)
+{
+	std::vector<ObjCorner> polygon;
+
+	const char* p = chunk.begin;
+	while (p != chunk.end)
+	{
+		const char* lineEnd = (const char*)std::memchr(p, '\n', chunk.end - p);
+		if (!lineEnd)
+			lineEnd = chunk.end;
+
+		++chunk.lineCount;
+		if (!ParseLine(chunk, p, lineEnd, polygon))
+		{
+			chunk.errorLine = p;
+			chunk.errorLineEnd = lineEnd;
+			return;
+		}
+
+		p = lineEnd == chunk.end ? lineEnd : lineEnd + 1;
+	}
+}
+
+// Makes every index of the chunk count from the start of the file, base is what the chunks before it have
+static void ResolveChunk(ObjChunk& chunk, const size_t* base, const size_t* total)
+{
+	for (ObjCorner& corner : chunk.corners)
+	{
+		for (int component = ObjPosition; component <= ObjNormal; ++component)
+		{
+			if ((corner.flags & (1u << component)) == 0)
+			{
+				corner.index[component] = -1;
+				continue;
+			}
+
+			long long index = corner.index[component];
+			if (corner.flags & (8u << component))
+				index += (long long)base[component];
+
+			if (index < 0 || index >= (long long)total[component])
+			{
+				chunk.invalidIndex = true;
+				return;
+			}
+
+			corner.index[component] = (int)index;
+			chunk.usedAttributes |= component == ObjTexcoord ? (unsigned int)MeshTexcoords : component == ObjNormal ? (unsigned int)MeshNormals : 0u;
+		}
+	}
+}
+
+// Runs function(i) for every i below count, the first one on this thread
+template <typename Function>
+static void RunOnThreads(size_t count, Function function)
+{
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < count; ++i)
+		threads.emplace_back(function, i);
+
+	function(0);
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+// Finds the unique combinations of position, texcoord and normal with open addressing, a slot is empty while its vertex is UINT_MAX
+class ObjVertexTable
+{
+public:
+	explicit ObjVertexTable(size_t expectedCount)
+		: m_Count(0)
+	{
+		size_t size = 64;
+		while (size < expectedCount * 2)
+			size *= 2;
+		m_Slots.resize(size);
+	}
+
+	// Returns the vertex of the corner, added is set when it's a new one
+	unsigned int Insert(const ObjCorner& corner, bool& added)
+	{
+		if ((m_Count + 1) * 2 > m_Slots.size())
+			Grow();
+
+		size_t mask = m_Slots.size() - 1;
+		for (size_t slot = Hash(corner.index) & mask;; slot = (slot + 1) & mask)
+		{
+			Slot& entry = m_Slots[slot];
+			if (entry.vertex == UINT_MAX)
+			{
+				std::memcpy(entry.key, corner.index, sizeof(entry.key));
+				entry.vertex = (unsigned int)m_Count++;
+				added = true;
+				return entry.vertex;
+			}
+
+			if (entry.key[0] == corner.index[0] && entry.key[1] == corner.index[1] && entry.key[2] == corner.index[2])
+			{
+				added = false;
+				return entry.vertex;
+			}
+		}
+	}
+
+private:
+	struct Slot
+	{
+		int key[3];
+		unsigned int vertex;
+
+		Slot() : key(), vertex(UINT_MAX) {}
+	};
+
+	static size_t Hash(const int* key)
+	{
+		unsigned long long hash = (unsigned int)key[0] * 0x9E3779B97F4A7C15ull ^ (unsigned int)key[1] * 0xC2B2AE3D27D4EB4Full
+			^ (unsigned int)key[2] * 0x165667B19E3779F9ull;
+		return (size_t)(hash ^ (hash >> 32));
+	}
+
+	void Grow()
+	{
+		std::vector<Slot> old(m_Slots.size() * 2);
+		old.swap(m_Slots);
+
+		size_t mask = m_Slots.size() - 1;
+		for (const Slot& entry : old)
+		{
+			if (entry.vertex == UINT_MAX)
+				continue;
+
+			size_t slot = Hash(entry.key) & mask;
+			while (m_Slots[slot].vertex != UINT_MAX)
+				slot = (slot + 1) & mask;
+			m_Slots[slot] = entry;
+		}
+	}
+
+	std::vector<Slot> m_Slots;
+	size_t m_Count;
+};
+
+bool ParseObj(const char* text, size_t size, MeshData& mesh, int threadCount)
+{
+	mesh = MeshData();
+
+	size_t chunkCount = threadCount > 0 ? (size_t)threadCount : std::max(1u, std::thread::hardware_concurrency());
+	chunkCount = std::max<size_t>(1, std::min(chunkCount, size / MinChunkSize));
+
+	// Every chunk ends after a line end, so no line is cut in two
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* end = text + size;
+	const char* begin = text;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const char* chunkEnd = i + 1 == chunkCount ? end : std::max(begin, text + size * (i + 1) / chunkCount);
+		if (chunkEnd != end)
+		{
+			const char* lineEnd = (const char*)std::memchr(chunkEnd, '\n', end - chunkEnd);
+			chunkEnd = lineEnd ? lineEnd + 1 : end;
+		}
+
+		chunks[i].begin = begin;
+		chunks[i].end = chunkEnd;
+		begin = chunkEnd;
+	}
+
+	RunOnThreads(chunkCount, [&chunks](size_t i) { ParseChunk(chunks[i]); });
+
+	size_t lineCount = 0;
+	for (const ObjChunk& chunk : chunks)
+	{
+		lineCount += chunk.lineCount;
+		if (chunk.errorLine)
+		{
+			std::cout << "Line " << lineCount << " of the OBJ isn't valid: " << std::string(chunk.errorLine, chunk.errorLineEnd) << "\n";
+			return false;
+		}
+	}
+
+	// Where the positions, texcoords and normals of every chunk start in the file
+	std::vector<size_t> bases(chunkCount * 3);
+	size_t total[3] = {};
+	bool anyColors = false;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		for (int component = ObjPosition; component <= ObjNormal; ++component)
+		{
+			bases[i * 3 + component] = total[component];
+			total[component] += chunks[i].GetCount(component);
+		}
+		anyColors = anyColors || !chunks[i].colors.empty();
+	}
+
+	RunOnThreads(chunkCount, [&chunks, &bases, &total](size_t i) { ResolveChunk(chunks[i], &bases[i * 3], total); });
+
+	mesh.attributes = anyColors ? (unsigned int)MeshColors : 0u;
+	size_t cornerCount = 0;
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.invalidIndex)
+		{
+			std::cout << "A face of the OBJ uses a vertex that isn't there\n";
+			return false;
+		}
+
+		mesh.attributes |= chunk.usedAttributes;
+		cornerCount += chunk.corners.size();
+	}
+
+	if (cornerCount == 0)
+	{
+		std::cout << "The OBJ doesn't have any faces\n";
+		return false;
+	}
+
+	// The parts of a vertex by the index the file gives them
+	std::vector<float> positions;
+	std::vector<float> colors;
+	std::vector<float> texcoords;
+	std::vector<float> normals;
+	positions.reserve(total[ObjPosition] * 3);
+	texcoords.reserve(total[ObjTexcoord] * 2);
+	normals.reserve(total[ObjNormal] * 3);
+	for (const ObjChunk& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		if (anyColors && chunk.colors.empty())
+			colors.insert(colors.end(), chunk.positions.size(), 1.0f);
+		else
+			colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+	}
+
+	unsigned int vertexSize = GetMeshVertexSize(mesh.attributes);
+	mesh.indices.reserve(cornerCount);
+	mesh.vertices.reserve(total[ObjPosition] * vertexSize);
+	mesh.boundsMin = glm::vec3(FLT_MAX);
+	mesh.boundsMax = glm::vec3(-FLT_MAX);
+
+	ObjVertexTable table(total[ObjPosition]);
+	for (const ObjChunk& chunk : chunks)
+	{
+		for (const ObjCorner& corner : chunk.corners)
+		{
+			bool added;
+			mesh.indices.push_back(table.Insert(corner, added));
+			if (!added)
+				continue;
+
+			const float* position = &positions[(size_t)corner.index[ObjPosition] * 3];
+			mesh.vertices.insert(mesh.vertices.end(), position, position + 3);
+			mesh.boundsMin = glm::min(mesh.boundsMin, glm::vec3(position[0], position[1], position[2]));
+			mesh.boundsMax = glm::max(mesh.boundsMax, glm::vec3(position[0], position[1], position[2]));
+
+			if (mesh.attributes & MeshColors)
+			{
+				const float* color = &colors[(size_t)corner.index[ObjPosition] * 3];
+				mesh.vertices.insert(mesh.vertices.end(), color, color + 3);
+			}
+
+			// Corners without a texcoord or normal in a mesh that has them get zeros
+			if (mesh.attributes & MeshTexcoords)
+			{
+				const float* texcoord = corner.index[ObjTexcoord] >= 0 ? &texcoords[(size_t)corner.index[ObjTexcoord] * 2] : nullptr;
+				mesh.vertices.push_back(texcoord ? texcoord[0] : 0.0f);
+				mesh.vertices.push_back(texcoord ? texcoord[1] : 0.0f);
+			}
+
+			if (mesh.attributes & MeshNormals)
+			{
+				const float* normal = corner.index[ObjNormal] >= 0 ? &normals[(size_t)corner.index[ObjNormal] * 3] : nullptr;
+				mesh.vertices.push_back(normal ? normal[0] : 0.0f);
+				mesh.vertices.push_back(normal ? normal[1] : 0.0f);
+				mesh.vertices.push_back(normal ? normal[2] : 0.0f);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool LoadObj(const std::string& path, MeshData& mesh, int threadCount)
+{
+	AssetData data;
+	if (!ReadAsset(path, data))
+	{
+		std::cout << "Can't read " << path << "\n";
+		return false;
+	}
+
+	if (!ParseObj((const char*)data.GetData(), data.GetSize(), mesh, threadCount))
+	{
+		std::cout << "Can't load " << path << "\n";
+		return false;
+	}
+
+	return true;
+}
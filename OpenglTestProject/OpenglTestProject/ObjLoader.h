@@ -0,0 +1,64 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// What a mesh vertex has besides its position. The attributes are interleaved in this order:
+// position (3 floats), color (3 floats), texcoord (2 floats), normal (3 floats), the ones a mesh doesn't have are left out.
+enum MeshAttributes : unsigned int
+{
+	MeshColors = 1,
+	MeshTexcoords = 2,
+	MeshNormals = 4,
+};
+
+// Floats per vertex with these attributes
+unsigned int GetMeshVertexSize(unsigned int attributes);
+
+// Float offset of an attribute in a vertex, -1 when the vertex doesn't have it
+int GetMeshAttributeOffset(unsigned int attributes, MeshAttributes attribute);
+
+// A level of detail with fewer triangles over the same vertices
+struct MeshLod
+{
+	std::vector<unsigned int> indices;
+
+	// How far its surface is from the full mesh at most, relative to the largest side of the bounds
+	float error;
+
+	MeshLod() : error(0.0f) {}
+};
+
+// Indexed triangles with interleaved vertices, every combination of position, texcoord and normal that the faces use is one vertex
+struct MeshData
+{
+	unsigned int attributes;
+	std::vector<float> vertices;
+	std::vector<unsigned int> indices;
+
+	// The levels after the full mesh in indices, from GenerateLods
+	std::vector<MeshLod> lods;
+
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	MeshData() : attributes(0), boundsMin(0.0f), boundsMax(0.0f) {}
+
+	size_t GetVertexCount() const { return vertices.size() / GetMeshVertexSize(attributes); }
+};
+
+// Parses a Wavefront OBJ file: v, vt, vn and f, everything else like groups, materials and smoothing is skipped.
+// A v with 6 numbers has a vertex color after its position, like MeshLab and ZBrush write them.
+// Polygons are triangulated as fans and negative indices count back from the last vertex before them.
+// Texture coordinates are kept the way the file has them.
+//
+// The text is cut into chunks at line ends that are parsed on threadCount threads, 0 uses a thread per core.
+// Small files are parsed on fewer threads, a chunk is at least 256 KB. Only finding the unique vertices runs on a single thread.
+// Doesn't touch OpenGL, so it can run on any thread. Returns false when the text isn't a valid OBJ.
+bool ParseObj(const char* text, size_t size, MeshData& mesh, int threadCount = 0);
+
+// Reads the file with ReadAsset and parses it
+bool LoadObj(const std::string& path, MeshData& mesh, int threadCount = 0);
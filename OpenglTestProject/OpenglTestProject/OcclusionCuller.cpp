@@ -0,0 +1,291 @@
+#include "OcclusionCuller.h"
+#include "VertexLayout.h"
+#include "ShaderLibrary.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+
+static const char* boxVertexSource = R"glsl(
+#version 150 core
+
+in vec3 position;
+
+uniform mat4 viewProj;
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main()
+{
+	gl_Position = viewProj * vec4(mix(boxMin, boxMax, position), 1.0f);
+}
+)glsl";
+
+typedef VertexLayout<VertexInput<PositionName, glm::vec3>> BoxVertexLayout;
+
+// Color writes are off, only whether a sample passed the depth test matters
+static const char* boxFragmentSource = R"glsl(
+#version 150 core
+
+void main()
+{
+}
+)glsl";
+
+OcclusionCuller::OcclusionCuller()
+	: m_Program(0)
+	, m_Vao(0)
+	, m_Vbo(0)
+	, m_UniViewProj(-1)
+	, m_UniBoxMin(-1)
+	, m_UniBoxMax(-1)
+	, m_QueryTarget(GL_SAMPLES_PASSED)
+	, m_ConditionalRender(false)
+	, m_Conditional(false)
+{
+	m_Shaders[0] = m_Shaders[1] = 0;
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+	Destroy();
+}
+
+bool OcclusionCuller::Create()
+{
+	Destroy();
+
+	m_QueryTarget = GLEW_VERSION_3_3 || GLEW_ARB_occlusion_query2 ? GL_ANY_SAMPLES_PASSED : GL_SAMPLES_PASSED;
+	m_ConditionalRender = GLEW_VERSION_3_0 || GLEW_NV_conditional_render;
+	if (!m_ConditionalRender)
+		std::cout << "Conditional rendering isn't supported, occluded objects show up a few frames after they come into view\n";
+
+	m_Shaders[0] = CompileShader(GL_VERTEX_SHADER, boxVertexSource, "Occlusion box vertex shader");
+	m_Shaders[1] = CompileShader(GL_FRAGMENT_SHADER, boxFragmentSource, "Occlusion box fragment shader");
+
+	m_Program = glCreateProgram();
+	glAttachShader(m_Program, m_Shaders[0]);
+	glAttachShader(m_Program, m_Shaders[1]);
+	glLinkProgram(m_Program);
+
+	GLint status;
+	glGetProgramiv(m_Program, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		std::cout << "Occlusion box program link error\n";
+		Destroy();
+		return false;
+	}
+
+	m_UniViewProj = glGetUniformLocation(m_Program, "viewProj");
+	m_UniBoxMin = glGetUniformLocation(m_Program, "boxMin");
+	m_UniBoxMax = glGetUniformLocation(m_Program, "boxMax");
+
+	// Two triangles for each side of a box from 0 to 1, the shader stretches it over the bounds
+	glm::vec3 vertices[36];
+	glm::vec3* vertex = vertices;
+	static const float corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		for (int side = 0; side < 2; ++side)
+		{
+			for (const float* corner : corners)
+			{
+				(*vertex)[axis] = (float)side;
+				(*vertex)[(axis + 1) % 3] = corner[0];
+				(*vertex)[(axis + 2) % 3] = corner[1];
+				++vertex;
+			}
+		}
+	}
+
+	glGenVertexArrays(1, &m_Vao);
+	glBindVertexArray(m_Vao);
+
+	glGenBuffers(1, &m_Vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+	BoxVertexLayout::Specify(m_Program);
+	glBindVertexArray(0);
+
+	for (Object& object : m_Objects)
+		glGenQueries(1, &object.query);
+
+	return true;
+}
+
+void OcclusionCuller::Destroy()
+{
+	for (Object& object : m_Objects)
+	{
+		if (object.query != 0)
+		{
+			glDeleteQueries(1, &object.query);
+			object.query = 0;
+		}
+
+		object.pending = false;
+		object.visible = true;
+	}
+
+	if (m_Vbo != 0)
+	{
+		glDeleteBuffers(1, &m_Vbo);
+		glDeleteVertexArrays(1, &m_Vao);
+		m_Vbo = 0;
+		m_Vao = 0;
+	}
+
+	if (m_Program != 0)
+	{
+		glDeleteProgram(m_Program);
+		glDeleteShader(m_Shaders[0]);
+		glDeleteShader(m_Shaders[1]);
+		m_Program = 0;
+		m_Shaders[0] = m_Shaders[1] = 0;
+	}
+}
+
+int OcclusionCuller::Add()
+{
+	Object object;
+	object.min = glm::vec3(0.0f);
+	object.max = glm::vec3(0.0f);
+	object.query = 0;
+	object.pending = false;
+	object.cut = false;
+	object.visible = true;
+
+	if (m_Program != 0)
+		glGenQueries(1, &object.query);
+
+	m_Objects.push_back(object);
+	return (int)m_Objects.size() - 1;
+}
+
+void OcclusionCuller::Clear()
+{
+	for (Object& object : m_Objects)
+	{
+		if (object.query != 0)
+			glDeleteQueries(1, &object.query);
+	}
+
+	m_Objects.clear();
+}
+
+void OcclusionCuller::SetBounds(int object, const glm::vec3& min, const glm::vec3& max)
+{
+	m_Objects[object].min = min;
+	m_Objects[object].max = max;
+}
+
+void OcclusionCuller::BeginFrame()
+{
+	for (Object& object : m_Objects)
+	{
+		if (object.pending)
+		{
+			GLint available = 0;
+			glGetQueryObjectiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available)
+			{
+				GLuint samples = 0;
+				glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &samples);
+				object.visible = samples != 0;
+				object.pending = false;
+			}
+		}
+
+		if (object.cut)
+			object.visible = true;
+	}
+}
+
+// A box reaching in front of the near plane would be clipped, the part behind the camera could hide the object wrongly
+bool OcclusionCuller::IsCutByNearPlane(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max)
+{
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		glm::vec4 position(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.0f);
+		glm::vec4 clip = viewProj * position;
+		if (clip.z < -clip.w)
+			return true;
+	}
+
+	return false;
+}
+
+void OcclusionCuller::Test(const glm::mat4& viewProj)
+{
+	if (m_Program == 0)
+		return;
+
+	// Depth test stays on, nothing is written so the boxes don't hide each other or the objects drawn later
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+	GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_CULL_FACE);
+
+	glUseProgram(m_Program);
+	glBindVertexArray(m_Vao);
+	glUniformMatrix4fv(m_UniViewProj, 1, GL_FALSE, glm::value_ptr(viewProj));
+
+	for (Object& object : m_Objects)
+	{
+		object.cut = IsCutByNearPlane(viewProj, object.min, object.max);
+		if (object.cut || object.pending)
+			continue;
+
+		glUniform3fv(m_UniBoxMin, 1, glm::value_ptr(object.min));
+		glUniform3fv(m_UniBoxMax, 1, glm::value_ptr(object.max));
+
+		glBeginQuery(m_QueryTarget, object.query);
+		glDrawArrays(GL_TRIANGLES, 0, 36);
+		glEndQuery(m_QueryTarget);
+		object.pending = true;
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+
+	if (cullFace)
+		glEnable(GL_CULL_FACE);
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+bool OcclusionCuller::BeginConditionalDraw(int object)
+{
+	const Object& o = m_Objects[object];
+
+	// Untested boxes are visible. An occluded object whose last query is still on its way uses that one,
+	// the GPU waits for it without the CPU noticing.
+	if (o.cut)
+		return true;
+
+	if (!m_ConditionalRender || o.query == 0)
+		return false;
+
+	if (GLEW_VERSION_3_0)
+		glBeginConditionalRender(o.query, GL_QUERY_WAIT);
+	else
+		glBeginConditionalRenderNV(o.query, GL_QUERY_WAIT_NV);
+
+	m_Conditional = true;
+	return true;
+}
+
+void OcclusionCuller::EndConditionalDraw()
+{
+	if (!m_Conditional)
+		return;
+
+	if (GLEW_VERSION_3_0)
+		glEndConditionalRender();
+	else
+		glEndConditionalRenderNV();
+
+	m_Conditional = false;
+}
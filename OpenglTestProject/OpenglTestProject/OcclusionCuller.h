@@ -0,0 +1,85 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Hardware occlusion culling: the bounding box of every object is drawn with a GL_ANY_SAMPLES_PASSED query around it,
+// and an object whose box didn't pass the depth test anywhere is hidden behind what was drawn before.
+// Reading a result right after the query would stall until the GPU caught up, so the objects are drawn by what earlier frames found
+// (temporal coherence, Bittner et al., "Coherent Hierarchical Culling Revisited"). Every frame:
+// 1) BeginFrame reads back the queries that are done, without waiting. An object whose query isn't done yet stays as it was.
+// 2) Draw the objects that were visible, they're the occluders for the rest.
+// 3) Test draws the boxes of all objects against that depth buffer.
+// 4) Draw the objects that were occluded between BeginConditionalDraw and EndConditionalDraw. The GPU skips their commands
+//    when their box didn't pass this frame, so an object that comes into view shows up right away without the CPU reading anything.
+//    Without conditional rendering they stay hidden until a query comes back visible.
+// Boxes that the near plane cuts through aren't tested, they could be drawn away, so their objects are always visible.
+class OcclusionCuller
+{
+public:
+	OcclusionCuller();
+	~OcclusionCuller();
+
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	bool Create();
+	void Destroy();
+
+	// Returns the index of the object, which starts out visible
+	int Add();
+	void Clear();
+
+	// The box in world space the object is tested with
+	void SetBounds(int object, const glm::vec3& min, const glm::vec3& max);
+
+	void BeginFrame();
+
+	// Whether the last query that came back found a sample of the object's box
+	bool IsVisible(int object) const { return m_Objects[object].visible; }
+
+	// Draws the boxes into the framebuffer that is bound, without writing color or depth.
+	// Binds its own program and vertex array, which are unbound again afterwards.
+	void Test(const glm::mat4& viewProj);
+
+	// Returns false when the object can't be drawn conditionally and has to be skipped, EndConditionalDraw isn't needed then
+	bool BeginConditionalDraw(int object);
+	void EndConditionalDraw();
+
+private:
+	struct Object
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+		GLuint query;
+
+		// Set while the query is on its way, a new one isn't started until its result was read
+		bool pending;
+
+		// Set when the near plane cut through the box in the last Test, so it wasn't tested
+		bool cut;
+
+		bool visible;
+	};
+
+	static bool IsCutByNearPlane(const glm::mat4& viewProj, const glm::vec3& min, const glm::vec3& max);
+
+	std::vector<Object> m_Objects;
+
+	GLuint m_Shaders[2];
+	GLuint m_Program;
+	GLuint m_Vao;
+	GLuint m_Vbo;
+	GLint m_UniViewProj;
+	GLint m_UniBoxMin;
+	GLint m_UniBoxMax;
+
+	// GL_ANY_SAMPLES_PASSED needs OpenGL 3.3 or ARB_occlusion_query2, GL_SAMPLES_PASSED counts every sample instead
+	GLenum m_QueryTarget;
+	bool m_ConditionalRender;
+
+	// Set between BeginConditionalDraw and EndConditionalDraw when conditional rendering was started
+	bool m_Conditional;
+};
@@ -0,0 +1,218 @@
+#include "PageFile.h"
+#include "MipGenerator.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+static const char PageFileMagic[4] = { 'V', 'T', 'P', 'F' };
+static const unsigned int PageFileVersion = 1;
+
+// Pages start at a multiple of the memory page size
+static const size_t PageAlignment = 4096;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+int GetPagesPerSide(int width, int height, int pageSize)
+{
+	int pages = 1;
+	while (pages * pageSize < std::max(width, height))
+		pages *= 2;
+
+	return pages;
+}
+
+// Copies one page with its border out of a level, the border repeats the edge pixels of the level
+static void CopyPage(const unsigned char* level, int levelSize, int pageX, int pageY, int pageSize, int border, unsigned char* page)
+{
+	int paddedSize = pageSize + 2 * border;
+	for (int y = 0; y < paddedSize; ++y)
+	{
+		int sourceY = std::min(std::max(pageY * pageSize + y - border, 0), levelSize - 1);
+		const unsigned char* sourceRow = level + (size_t)sourceY * levelSize * 4;
+
+		for (int x = 0; x < paddedSize; ++x)
+		{
+			int sourceX = std::min(std::max(pageX * pageSize + x - border, 0), levelSize - 1);
+			std::memcpy(page + ((size_t)y * paddedSize + x) * 4, sourceRow + (size_t)sourceX * 4, 4);
+		}
+	}
+}
+
+bool WritePageFile(const char* path, const unsigned char* rgba, int size, int pageSize, int border, bool srgb)
+{
+	int pagesPerSide = size / pageSize;
+	if (pagesPerSide * pageSize != size || (pagesPerSide & (pagesPerSide - 1)) != 0)
+	{
+		std::cout << "A virtual texture of " << size << " pixels can't be cut into a power of 2 number of pages of " << pageSize << "\n";
+		return false;
+	}
+
+	PageFileHeader header = {};
+	std::memcpy(header.magic, PageFileMagic, sizeof(PageFileMagic));
+	header.version = PageFileVersion;
+	header.size = (unsigned int)size;
+	header.pageSize = (unsigned int)pageSize;
+	header.border = (unsigned int)border;
+
+	for (int pages = pagesPerSide; pages >= 1; pages /= 2)
+	{
+		++header.levelCount;
+		header.pageCount += (unsigned int)(pages * pages);
+	}
+
+	// Every page has the same size, so where they go is known before any of them is made
+	int paddedSize = pageSize + 2 * border;
+	size_t pageBytes = (size_t)paddedSize * paddedSize * 4;
+	size_t pageStride = AlignUp(pageBytes, PageAlignment);
+	size_t firstPage = AlignUp(sizeof(header) + header.pageCount * sizeof(unsigned long long), PageAlignment);
+
+	std::vector<unsigned long long> offsets(header.pageCount);
+	for (size_t i = 0; i < offsets.size(); ++i)
+		offsets[i] = firstPage + i * pageStride;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Can't write " << path << "\n";
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)offsets.data(), offsets.size() * sizeof(unsigned long long));
+
+	std::vector<unsigned char> page(pageStride, 0);
+	std::vector<unsigned char> level;
+	const unsigned char* levelPixels = rgba;
+	int levelSize = size;
+	size_t pageIndex = 0;
+
+	for (unsigned int l = 0; l < header.levelCount; ++l)
+	{
+		int pages = pagesPerSide >> l;
+		for (int y = 0; y < pages; ++y)
+		{
+			for (int x = 0; x < pages; ++x, ++pageIndex)
+			{
+				CopyPage(levelPixels, levelSize, x, y, pageSize, border, page.data());
+
+				file.seekp((std::streamoff)offsets[pageIndex]);
+				file.write((const char*)page.data(), pageStride);
+			}
+		}
+
+		// The next level is made from this one, so the full image is never in memory twice
+		if (l + 1 < header.levelCount)
+		{
+			level = DownsampleBox(levelPixels, levelSize, levelSize, srgb);
+			levelPixels = level.data();
+			levelSize /= 2;
+		}
+	}
+
+	return file.good();
+}
+
+PageFile::PageFile()
+	: m_Header()
+	, m_Offsets(nullptr)
+{
+}
+
+bool PageFile::Open(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path))
+		return false;
+
+	if (m_File.GetSize() < sizeof(PageFileHeader))
+	{
+		std::cout << path << " is not a page file\n";
+		Close();
+		return false;
+	}
+
+	std::memcpy(&m_Header, m_File.GetData(), sizeof(m_Header));
+	if (std::memcmp(m_Header.magic, PageFileMagic, sizeof(PageFileMagic)) != 0 || m_Header.version != PageFileVersion)
+	{
+		std::cout << path << " is not a page file\n";
+		Close();
+		return false;
+	}
+
+	// The levels and pages have to be the ones WritePageFile makes for that size, GetPage finds a page by counting them
+	unsigned int pagesPerSide = m_Header.pageSize != 0 ? m_Header.size / m_Header.pageSize : 0;
+	unsigned int levelCount = 0;
+	unsigned long long pageCount = 0;
+	for (unsigned int pages = pagesPerSide; pages >= 1; pages /= 2)
+	{
+		++levelCount;
+		pageCount += (unsigned long long)pages * pages;
+	}
+
+	bool validSize = pagesPerSide != 0 && pagesPerSide * m_Header.pageSize == m_Header.size && (pagesPerSide & (pagesPerSide - 1)) == 0
+		&& m_Header.size <= 0x7FFFFFFF && m_Header.pageSize + 2ull * m_Header.border <= 0x7FFF;
+	if (!validSize || m_Header.levelCount != levelCount || m_Header.pageCount != pageCount)
+	{
+		std::cout << path << " has a damaged header\n";
+		Close();
+		return false;
+	}
+
+	size_t tableEnd = sizeof(PageFileHeader) + (size_t)m_Header.pageCount * sizeof(unsigned long long);
+	if (m_File.GetSize() < tableEnd)
+	{
+		std::cout << path << " is truncated\n";
+		Close();
+		return false;
+	}
+
+	m_Offsets = (const unsigned long long*)(m_File.GetData() + sizeof(PageFileHeader));
+	for (unsigned int i = 0; i < m_Header.pageCount; ++i)
+	{
+		if (m_File.GetSize() < GetPageBytes() || m_Offsets[i] > m_File.GetSize() - GetPageBytes())
+		{
+			std::cout << path << " is truncated\n";
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void PageFile::Close()
+{
+	m_File.Close();
+	m_Header = PageFileHeader();
+	m_Offsets = nullptr;
+}
+
+int PageFile::GetPagesPerSide(int level) const
+{
+	return (int)(m_Header.size / m_Header.pageSize) >> level;
+}
+
+const unsigned char* PageFile::GetPage(int level, int x, int y) const
+{
+	if (level < 0 || level >= GetLevelCount())
+		return nullptr;
+
+	int pages = GetPagesPerSide(level);
+	if (x < 0 || y < 0 || x >= pages || y >= pages)
+		return nullptr;
+
+	// The levels before this one are all stored first
+	size_t index = 0;
+	for (int l = 0; l < level; ++l)
+		index += (size_t)GetPagesPerSide(l) * GetPagesPerSide(l);
+	index += (size_t)y * pages + x;
+
+	return m_File.GetData() + m_Offsets[index];
+}
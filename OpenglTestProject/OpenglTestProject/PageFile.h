@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+
+// A virtual texture cut into pages, made by Tools/VirtualTextureBuilder.
+// The texture is square with a power of 2 number of pages per side, so every page of a level covers exactly 4 pages of the level
+// before it, down to the last level that is a single page. Every page has a border of the pixels around it, so a page can be
+// filtered bilinearly on its own wherever it ends up in the physical texture.
+//
+// The file starts with a header, then the offset of every page: level 0 first, row by row. The pages are stored as RGBA8,
+// each one starting at a multiple of 4 KB so it takes as few memory pages as possible when it's mapped.
+struct PageFileHeader
+{
+	char magic[4];
+	unsigned int version;
+
+	// Pixels per side of level 0
+	unsigned int size;
+
+	// Pixels per side of a page, without the border
+	unsigned int pageSize;
+	unsigned int border;
+
+	unsigned int levelCount;
+	unsigned int pageCount;
+	unsigned int reserved;
+};
+
+// Pages per side of level 0 for an image of that size, rounded up to a power of 2
+int GetPagesPerSide(int width, int height, int pageSize);
+
+// Cuts a square RGBA8 image into pages with their borders and writes it with all of its levels.
+// size has to be pageSize times a power of 2. Only one level is kept in memory at a time.
+bool WritePageFile(const char* path, const unsigned char* rgba, int size, int pageSize, int border, bool srgb = true);
+
+// Reads the pages of a page file straight from a memory mapping
+class PageFile
+{
+public:
+	PageFile();
+
+	PageFile(const PageFile&) = delete;
+	PageFile& operator=(const PageFile&) = delete;
+
+	// Returns false when the file doesn't exist, isn't a page file or its header doesn't match its pages
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	int GetSize() const { return (int)m_Header.size; }
+	int GetPageSize() const { return (int)m_Header.pageSize; }
+	int GetBorder() const { return (int)m_Header.border; }
+	int GetLevelCount() const { return (int)m_Header.levelCount; }
+
+	// Width and height of a page with its border on both sides
+	int GetPaddedPageSize() const { return (int)(m_Header.pageSize + 2 * m_Header.border); }
+	size_t GetPageBytes() const { return (size_t)GetPaddedPageSize() * GetPaddedPageSize() * 4; }
+
+	int GetPagesPerSide(int level) const;
+
+	// RGBA8 pixels of a page with its border, nullptr when the page doesn't exist
+	const unsigned char* GetPage(int level, int x, int y) const;
+
+private:
+	MappedFile m_File;
+	PageFileHeader m_Header;
+	const unsigned long long* m_Offsets;
+};
@@ -0,0 +1,271 @@
+#include "PlanarReflection.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+const char* reflectiveFloorVertexSource = R"glsl(
+#version 150 core
+
+in vec3 position;
+in vec3 color;
+in vec2 texcoord;
+
+out vec3 Color;
+out vec4 ReflectionCoord;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 proj;
+
+void main()
+{
+	Color = color;
+	gl_Position = proj * view * model * vec4(position, 1.0f);
+
+	// The reflection was rendered from the same camera, so the screen position of the
+	// floor fragment is also the position to sample the reflection texture at.
+	ReflectionCoord = gl_Position;
+}
+)glsl";
+
+const char* reflectiveFloorFragmentSource = R"glsl(
+#version 150 core
+
+in vec3 Color;
+in vec4 ReflectionCoord;
+
+out vec4 outColor;
+
+uniform sampler2D texReflection;
+uniform float reflectivity;
+
+void main()
+{
+	// Perspective divide and map from [-1, 1] to [0, 1]
+	vec2 uv = ReflectionCoord.xy / ReflectionCoord.w * 0.5f + 0.5f;
+	vec4 reflection = texture(texReflection, uv);
+
+	outColor = mix(vec4(Color, 1.0f), reflection, reflectivity);
+}
+)glsl";
+
+glm::mat4 CalculateReflectionMatrix(const glm::vec4& plane)
+{
+	glm::vec3 n(plane);
+	float d = plane.w;
+
+	// Mirroring a point p in a plane is p - 2 * (dot(n, p) + d) * n.
+	// Written as a matrix, GLM stores matrices column by column.
+	glm::mat4 reflection(1.0f);
+	for (int column = 0; column < 3; ++column)
+	{
+		for (int row = 0; row < 3; ++row)
+			reflection[column][row] -= 2.0f * n[row] * n[column];
+	}
+
+	reflection[3] = glm::vec4(-2.0f * d * n, 1.0f);
+
+	return reflection;
+}
+
+static float Sign(float value)
+{
+	if (value > 0.0f) return 1.0f;
+	if (value < 0.0f) return -1.0f;
+	return 0.0f;
+}
+
+glm::mat4 CalculateObliqueProjection(const glm::mat4& proj, const glm::vec4& viewSpaceClipPlane)
+{
+	// Calculate the clip space corner point opposite the clipping plane
+	// and transform it into view space by multiplying it with the inverse projection matrix.
+	glm::vec4 q = glm::inverse(proj) * glm::vec4(Sign(viewSpaceClipPlane.x), Sign(viewSpaceClipPlane.y), 1.0f, 1.0f);
+
+	// Scale the plane so the far plane still goes through q
+	glm::vec4 c = viewSpaceClipPlane * (2.0f / glm::dot(viewSpaceClipPlane, q));
+
+	// Replace the third row of the projection matrix
+	glm::mat4 result = proj;
+	for (int column = 0; column < 4; ++column)
+		result[column][2] = c[column] - proj[column][3];
+
+	return result;
+}
+
+PlanarReflection::PlanarReflection()
+	: m_FrameBuffer(0)
+	, m_ColorTexture(0)
+	, m_DepthBuffer(0)
+	, m_ScreenWidth(0)
+	, m_ScreenHeight(0)
+	, m_Width(0)
+	, m_Height(0)
+	, m_ResolutionScale(0.5f)
+	, m_Plane(0.0f, 0.0f, 1.0f, 0.0f)
+	, m_LastView(1.0f)
+	, m_LastProj(1.0f)
+	, m_SceneDirty(true)
+	, m_PrevFrameBuffer(0)
+{
+	m_PrevViewport[0] = m_PrevViewport[1] = m_PrevViewport[2] = m_PrevViewport[3] = 0;
+}
+
+PlanarReflection::~PlanarReflection()
+{
+	Destroy();
+}
+
+bool PlanarReflection::Create(int screenWidth, int screenHeight, float resolutionScale)
+{
+	m_ScreenWidth = screenWidth;
+	m_ScreenHeight = screenHeight;
+	m_ResolutionScale = std::min(std::max(resolutionScale, 0.1f), 1.0f);
+
+	glGenFramebuffers(1, &m_FrameBuffer);
+	CreateAttachments();
+
+	GLint prevFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFrameBuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFrameBuffer);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Reflection framebuffer is not complete\n";
+		return false;
+	}
+
+	return true;
+}
+
+void PlanarReflection::Destroy()
+{
+	DestroyAttachments();
+
+	if (m_FrameBuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_FrameBuffer);
+		m_FrameBuffer = 0;
+	}
+}
+
+void PlanarReflection::Resize(int screenWidth, int screenHeight)
+{
+	if (screenWidth == m_ScreenWidth && screenHeight == m_ScreenHeight)
+		return;
+
+	m_ScreenWidth = screenWidth;
+	m_ScreenHeight = screenHeight;
+
+	DestroyAttachments();
+	CreateAttachments();
+}
+
+void PlanarReflection::SetResolutionScale(float resolutionScale)
+{
+	resolutionScale = std::min(std::max(resolutionScale, 0.1f), 1.0f);
+	if (resolutionScale == m_ResolutionScale)
+		return;
+
+	m_ResolutionScale = resolutionScale;
+
+	DestroyAttachments();
+	CreateAttachments();
+}
+
+void PlanarReflection::SetPlane(const glm::vec3& point, const glm::vec3& normal)
+{
+	glm::vec3 n = glm::normalize(normal);
+	m_Plane = glm::vec4(n, -glm::dot(n, point));
+	m_SceneDirty = true;
+}
+
+bool PlanarReflection::NeedsUpdate(const glm::mat4& view, const glm::mat4& proj) const
+{
+	return m_SceneDirty || view != m_LastView || proj != m_LastProj;
+}
+
+void PlanarReflection::Begin(const glm::mat4& view, const glm::mat4& proj, glm::mat4& reflectedView, glm::mat4& obliqueProj)
+{
+	m_LastView = view;
+	m_LastProj = proj;
+	m_SceneDirty = false;
+
+	reflectedView = view * CalculateReflectionMatrix(m_Plane);
+
+	// Planes are transformed with the inverse transpose of the matrix that transforms the points.
+	glm::vec4 viewSpacePlane = glm::transpose(glm::inverse(reflectedView)) * m_Plane;
+	obliqueProj = CalculateObliqueProjection(proj, viewSpacePlane);
+
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_PrevFrameBuffer);
+	glGetIntegerv(GL_VIEWPORT, m_PrevViewport);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffer);
+	glViewport(0, 0, m_Width, m_Height);
+
+	glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// Mirroring turns the winding order of every triangle around,
+	// without this back face culling would remove the wrong faces.
+	glFrontFace(GL_CW);
+}
+
+void PlanarReflection::End()
+{
+	glFrontFace(GL_CCW);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_PrevFrameBuffer);
+	glViewport(m_PrevViewport[0], m_PrevViewport[1], m_PrevViewport[2], m_PrevViewport[3]);
+}
+
+void PlanarReflection::CreateAttachments()
+{
+	m_Width = std::max(1, (int)(m_ScreenWidth * m_ResolutionScale));
+	m_Height = std::max(1, (int)(m_ScreenHeight * m_ResolutionScale));
+
+	GLint prevFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFrameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffer);
+
+	glGenTextures(1, &m_ColorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_Width, m_Height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+
+	// The reflection is magnified when it's sampled, so linear filtering hides the lower resolution.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0);
+
+	// The reflection pass only needs depth testing, no stencil.
+	glGenRenderbuffers(1, &m_DepthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_Width, m_Height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFrameBuffer);
+
+	m_SceneDirty = true;
+}
+
+void PlanarReflection::DestroyAttachments()
+{
+	if (m_DepthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_DepthBuffer);
+		m_DepthBuffer = 0;
+	}
+
+	if (m_ColorTexture != 0)
+	{
+		glDeleteTextures(1, &m_ColorTexture);
+		m_ColorTexture = 0;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+// A planar reflection renders the scene mirrored in a plane once into an offscreen texture,
+// which the reflective surface then samples in its own fragment shader.
+// Compared to the stencil approach (draw the scene a second time, mirrored and masked by the floor)
+// this has 2 big advantages:
+// 1) The reflection can be rendered at a lower resolution than the screen, reflections are usually blurry or tinted anyway.
+// 2) The texture can be kept across frames as long as neither the camera nor the reflected objects moved.
+
+// Floor shaders that sample the reflection texture.
+// They use the same position/color/texcoord layout as the scene vertices, so the floor quad in vertices[] can be drawn with them.
+extern const char* reflectiveFloorVertexSource;
+extern const char* reflectiveFloorFragmentSource;
+
+// Returns the matrix that mirrors points in the plane dot(normal, x) + plane.w = 0
+glm::mat4 CalculateReflectionMatrix(const glm::vec4& plane);
+
+// Modifies the near plane of a projection matrix so it coincides with the given view space clip plane.
+// Everything behind the mirror is clipped for free, without needing gl_ClipDistance in every scene shader.
+// See Eric Lengyel, "Oblique View Frustum Depth Projection and Clipping".
+glm::mat4 CalculateObliqueProjection(const glm::mat4& proj, const glm::vec4& viewSpaceClipPlane);
+
+class PlanarReflection
+{
+public:
+	PlanarReflection();
+	~PlanarReflection();
+
+	// Owns OpenGL objects, so it can't be copied
+	PlanarReflection(const PlanarReflection&) = delete;
+	PlanarReflection& operator=(const PlanarReflection&) = delete;
+
+	// The resolution scale is relative to the screen size, 0.5f renders the reflection at a quarter of the pixels.
+	bool Create(int screenWidth, int screenHeight, float resolutionScale = 0.5f);
+	void Destroy();
+
+	void Resize(int screenWidth, int screenHeight);
+	void SetResolutionScale(float resolutionScale);
+	float GetResolutionScale() const { return m_ResolutionScale; }
+
+	// The plane goes through point and faces the side of normal, which is the side that gets reflected.
+	void SetPlane(const glm::vec3& point, const glm::vec3& normal);
+	const glm::vec4& GetPlane() const { return m_Plane; }
+
+	// Call this whenever something that is visible in the reflection has moved.
+	void MarkSceneDirty() { m_SceneDirty = true; }
+
+	// Returns false if the texture rendered last time is still valid for this camera.
+	bool NeedsUpdate(const glm::mat4& view, const glm::mat4& proj) const;
+
+	// Binds the reflection framebuffer and calculates the matrices the scene has to be rendered with.
+	// Every draw call between Begin and End ends up in the reflection texture.
+	void Begin(const glm::mat4& view, const glm::mat4& proj, glm::mat4& reflectedView, glm::mat4& obliqueProj);
+	void End();
+
+	GLuint GetTexture() const { return m_ColorTexture; }
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+
+private:
+	void CreateAttachments();
+	void DestroyAttachments();
+
+	GLuint m_FrameBuffer;
+	GLuint m_ColorTexture;
+	GLuint m_DepthBuffer;
+
+	int m_ScreenWidth;
+	int m_ScreenHeight;
+	int m_Width;
+	int m_Height;
+	float m_ResolutionScale;
+
+	glm::vec4 m_Plane;
+
+	glm::mat4 m_LastView;
+	glm::mat4 m_LastProj;
+	bool m_SceneDirty;
+
+	// State that is overwritten by Begin and restored by End
+	GLint m_PrevFrameBuffer;
+	GLint m_PrevViewport[4];
+};
@@ -0,0 +1,159 @@
+#include "ReflectionManager.h"
+
+#include <algorithm>
+
+ReflectionManager::ReflectionManager()
+	: m_ScreenWidth(800)
+	, m_ScreenHeight(600)
+	, m_MaxReflectionsPerFrame(2)
+	, m_MinScreenArea(0.001f)
+{
+}
+
+ReflectionManager::~ReflectionManager()
+{
+	Clear();
+}
+
+void ReflectionManager::SetScreenSize(int screenWidth, int screenHeight)
+{
+	m_ScreenWidth = screenWidth;
+	m_ScreenHeight = screenHeight;
+
+	for (PlanarReflector& reflector : m_Reflectors)
+		reflector.reflection->Resize(screenWidth, screenHeight);
+}
+
+int ReflectionManager::AddReflector(const glm::vec3& center, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec2& halfExtents, float resolutionScale)
+{
+	PlanarReflector reflector;
+	reflector.center = center;
+	reflector.normal = glm::normalize(normal);
+	reflector.tangent = glm::normalize(tangent);
+	reflector.halfExtents = halfExtents;
+	reflector.screenArea = 0.0f;
+	reflector.visible = false;
+
+	reflector.reflection.reset(new PlanarReflection());
+	reflector.reflection->Create(m_ScreenWidth, m_ScreenHeight, resolutionScale);
+	reflector.reflection->SetPlane(center, normal);
+
+	m_Reflectors.push_back(std::move(reflector));
+	return (int)m_Reflectors.size() - 1;
+}
+
+void ReflectionManager::Clear()
+{
+	// The unique pointers delete the framebuffers and textures
+	m_Reflectors.clear();
+	m_Selected.clear();
+}
+
+void ReflectionManager::MarkSceneDirty()
+{
+	for (PlanarReflector& reflector : m_Reflectors)
+		reflector.reflection->MarkSceneDirty();
+}
+
+const std::vector<int>& ReflectionManager::Update(const glm::mat4& view, const glm::mat4& proj)
+{
+	glm::mat4 viewProj = proj * view;
+	Frustum frustum(viewProj);
+
+	// The camera sits at the origin of view space
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+
+	m_Selected.clear();
+
+	for (int i = 0; i < (int)m_Reflectors.size(); ++i)
+	{
+		PlanarReflector& reflector = m_Reflectors[i];
+		reflector.visible = false;
+		reflector.screenArea = 0.0f;
+
+		// A mirror seen from behind doesn't reflect anything
+		if (glm::dot(reflector.normal, cameraPosition - reflector.center) <= 0.0f)
+			continue;
+
+		glm::vec3 bitangent = glm::cross(reflector.normal, reflector.tangent);
+		glm::vec3 extent = glm::abs(reflector.tangent) * reflector.halfExtents.x + glm::abs(bitangent) * reflector.halfExtents.y;
+		if (!frustum.IsAabbVisible(reflector.center - extent, reflector.center + extent))
+			continue;
+
+		reflector.screenArea = CalculateScreenArea(reflector, viewProj);
+		if (reflector.screenArea < m_MinScreenArea)
+			continue;
+
+		m_Selected.push_back(i);
+	}
+
+	// Spend the reflection passes on the reflectors that cover most of the screen
+	std::sort(m_Selected.begin(), m_Selected.end(), [this](int a, int b)
+	{
+		return m_Reflectors[a].screenArea > m_Reflectors[b].screenArea;
+	});
+
+	if ((int)m_Selected.size() > m_MaxReflectionsPerFrame)
+		m_Selected.resize(m_MaxReflectionsPerFrame);
+
+	for (int id : m_Selected)
+		m_Reflectors[id].visible = true;
+
+	return m_Selected;
+}
+
+void ReflectionManager::Render(const glm::mat4& view, const glm::mat4& proj, const DrawSceneFunction& drawScene)
+{
+	for (int id : m_Selected)
+	{
+		PlanarReflection& reflection = *m_Reflectors[id].reflection;
+		if (!reflection.NeedsUpdate(view, proj))
+			continue;
+
+		glm::mat4 reflectedView, obliqueProj;
+		reflection.Begin(view, proj, reflectedView, obliqueProj);
+		drawScene(reflectedView, obliqueProj);
+		reflection.End();
+	}
+}
+
+float ReflectionManager::CalculateScreenArea(const PlanarReflector& reflector, const glm::mat4& viewProj) const
+{
+	glm::vec3 bitangent = glm::cross(reflector.normal, reflector.tangent);
+	glm::vec3 u = reflector.tangent * reflector.halfExtents.x;
+	glm::vec3 v = bitangent * reflector.halfExtents.y;
+
+	glm::vec3 corners[4] =
+	{
+		reflector.center - u - v,
+		reflector.center + u - v,
+		reflector.center + u + v,
+		reflector.center - u + v
+	};
+
+	glm::vec2 minNdc(1.0f);
+	glm::vec2 maxNdc(-1.0f);
+
+	for (const glm::vec3& corner : corners)
+	{
+		glm::vec4 clip = viewProj * glm::vec4(corner, 1.0f);
+
+		// A corner behind the camera means the reflector reaches past the screen,
+		// there's no meaningful projection so treat it as covering the whole screen.
+		if (clip.w <= 0.0f)
+			return 1.0f;
+
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		minNdc = glm::min(minNdc, ndc);
+		maxNdc = glm::max(maxNdc, ndc);
+	}
+
+	// Use the screen space bounding rectangle, clamped to the screen
+	minNdc = glm::clamp(minNdc, glm::vec2(-1.0f), glm::vec2(1.0f));
+	maxNdc = glm::clamp(maxNdc, glm::vec2(-1.0f), glm::vec2(1.0f));
+
+	glm::vec2 size = glm::max(maxNdc - minNdc, glm::vec2(0.0f));
+
+	// Normalized device coordinates span 2 units in each direction
+	return size.x * size.y * 0.25f;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "PlanarReflection.h"
+#include "Frustum.h"
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+// A reflective surface in the scene: a mirror, a water plane, a polished floor...
+// The surface is a rectangle around center, spanned by tangent and cross(normal, tangent).
+struct PlanarReflector
+{
+	glm::vec3 center;
+	glm::vec3 normal;
+	glm::vec3 tangent;
+	glm::vec2 halfExtents;
+
+	// Fraction of the screen covered by the reflector this frame, calculated by ReflectionManager::Update
+	float screenArea;
+	bool visible;
+
+	std::unique_ptr<PlanarReflection> reflection;
+};
+
+// Every reflector costs an extra render of the scene, so with many mirrors in a scene
+// only the ones that actually matter this frame should be rendered.
+// The manager removes reflectors that are outside the view frustum or that face away from the camera,
+// sorts the remaining ones by how much of the screen they cover and renders at most a fixed number of them.
+// Reflectors that lose out keep their texture from the last time they were rendered.
+class ReflectionManager
+{
+public:
+	// Called once per rendered reflector with the matrices the mirrored scene has to be drawn with.
+	typedef std::function<void(const glm::mat4& view, const glm::mat4& proj)> DrawSceneFunction;
+
+	ReflectionManager();
+	~ReflectionManager();
+
+	void SetScreenSize(int screenWidth, int screenHeight);
+
+	// Maximum number of reflection passes per frame
+	void SetMaxReflectionsPerFrame(int maxReflections) { m_MaxReflectionsPerFrame = maxReflections; }
+
+	// Reflectors that cover less than this fraction of the screen are skipped
+	void SetMinScreenArea(float minScreenArea) { m_MinScreenArea = minScreenArea; }
+
+	// Returns the id of the reflector, which is used to get its texture later on.
+	int AddReflector(const glm::vec3& center, const glm::vec3& normal, const glm::vec3& tangent, const glm::vec2& halfExtents, float resolutionScale = 0.5f);
+	void Clear();
+
+	// Marks all reflection textures as outdated, call this when something in the scene moved.
+	void MarkSceneDirty();
+
+	// Culls and sorts the reflectors for this frame, returns the ids of the ones that will be rendered.
+	const std::vector<int>& Update(const glm::mat4& view, const glm::mat4& proj);
+
+	// Renders the reflections that were selected by Update.
+	void Render(const glm::mat4& view, const glm::mat4& proj, const DrawSceneFunction& drawScene);
+
+	int GetReflectorCount() const { return (int)m_Reflectors.size(); }
+	const PlanarReflector& GetReflector(int id) const { return m_Reflectors[id]; }
+
+	bool IsVisible(int id) const { return m_Reflectors[id].visible; }
+	GLuint GetTexture(int id) const { return m_Reflectors[id].reflection->GetTexture(); }
+
+private:
+	float CalculateScreenArea(const PlanarReflector& reflector, const glm::mat4& viewProj) const;
+
+	std::vector<PlanarReflector> m_Reflectors;
+	std::vector<int> m_Selected;
+
+	int m_ScreenWidth;
+	int m_ScreenHeight;
+	int m_MaxReflectionsPerFrame;
+	float m_MinScreenArea;
+};
@@ -0,0 +1,475 @@
+#include "RenderGraph.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+GLuint RenderGraphContext::GetTexture(RenderGraphResource resource) const
+{
+	return m_Graph.GetId(resource);
+}
+
+const RenderTargetDesc& RenderGraphContext::GetDesc(RenderGraphResource resource) const
+{
+	return m_Graph.m_Resources[resource].desc;
+}
+
+RenderGraph::RenderGraph()
+	: m_ResolveFrameBuffer(0)
+	, m_Compiled(false)
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+	if (!m_FrameBuffers.empty())
+		glDeleteFramebuffers((GLsizei)m_FrameBuffers.size(), m_FrameBuffers.data());
+
+	if (m_ResolveFrameBuffer != 0)
+		glDeleteFramebuffers(1, &m_ResolveFrameBuffer);
+}
+
+void RenderGraph::Reset()
+{
+	m_Resources.clear();
+	m_Passes.clear();
+	m_Physical.clear();
+	m_Order.clear();
+	m_Compiled = false;
+}
+
+RenderGraphResource RenderGraph::CreateTexture(const std::string& name, const RenderTargetDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.imported = false;
+	resource.importedId = 0;
+	resource.physical = -1;
+	resource.firstUse = -1;
+	resource.lastUse = -1;
+
+	m_Resources.push_back(resource);
+	return (RenderGraphResource)m_Resources.size() - 1;
+}
+
+RenderGraphResource RenderGraph::ImportTexture(const std::string& name, GLuint id, const RenderTargetDesc& desc)
+{
+	RenderGraphResource resource = CreateTexture(name, desc);
+	m_Resources[resource].imported = true;
+	m_Resources[resource].importedId = id;
+	return resource;
+}
+
+RenderGraphPass RenderGraph::AddPass(const std::string& name, const ExecuteFunction& execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.sideEffect = false;
+	pass.culled = false;
+
+	m_Passes.push_back(pass);
+	return (RenderGraphPass)m_Passes.size() - 1;
+}
+
+void RenderGraph::Read(RenderGraphPass pass, RenderGraphResource resource)
+{
+	m_Passes[pass].reads.push_back(resource);
+}
+
+void RenderGraph::Write(RenderGraphPass pass, RenderGraphResource resource)
+{
+	m_Passes[pass].writes.push_back(resource);
+}
+
+void RenderGraph::SetSideEffect(RenderGraphPass pass)
+{
+	m_Passes[pass].sideEffect = true;
+}
+
+RenderGraphPass RenderGraph::AddResolvePass(const std::string& name, RenderGraphResource source, RenderGraphResource destination, int width, int height)
+{
+	RenderGraphPass pass = AddPass(name, [this, source, destination, width, height](const RenderGraphContext&)
+	{
+		// The destination is already bound as draw framebuffer, only the source needs a framebuffer to be read from.
+		if (m_ResolveFrameBuffer == 0)
+			glGenFramebuffers(1, &m_ResolveFrameBuffer);
+
+		GLint drawFrameBuffer;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFrameBuffer);
+
+		RenderTarget target;
+		target.desc = m_Resources[source].desc;
+		target.id = GetId(source);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_ResolveFrameBuffer);
+		AttachRenderTarget(GL_COLOR_ATTACHMENT0, target, GL_READ_FRAMEBUFFER);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+		// Blitting from a multisampled to a single sampled framebuffer averages the samples of every pixel.
+		// The rectangles have to be the same size, multisampled blits can't scale.
+		const RenderTargetDesc& desc = m_Resources[destination].desc;
+		int blitWidth = width > 0 ? width : desc.width;
+		int blitHeight = height > 0 ? height : desc.height;
+		glBlitFramebuffer(0, 0, blitWidth, blitHeight, 0, 0, blitWidth, blitHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, drawFrameBuffer);
+	});
+
+	Read(pass, source);
+	Write(pass, destination);
+	return pass;
+}
+
+bool RenderGraph::Compile()
+{
+	CullPasses();
+
+	if (!SortPasses())
+	{
+		m_Compiled = false;
+		return false;
+	}
+
+	AssignPhysical();
+
+	m_Compiled = true;
+	return true;
+}
+
+void RenderGraph::CullPasses()
+{
+	// Walk backwards from the outputs: a pass is needed if it writes something that is needed,
+	// and everything a needed pass reads becomes needed as well. Repeat until nothing changes,
+	// so the result doesn't depend on the order the passes were declared in.
+	std::vector<bool> resourceNeeded(m_Resources.size(), false);
+	for (size_t i = 0; i < m_Resources.size(); ++i)
+		resourceNeeded[i] = m_Resources[i].imported;
+
+	for (Pass& pass : m_Passes)
+		pass.culled = true;
+
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (Pass& pass : m_Passes)
+		{
+			if (!pass.culled)
+				continue;
+
+			bool needed = pass.sideEffect;
+			for (RenderGraphResource resource : pass.writes)
+				needed = needed || resourceNeeded[resource];
+
+			if (!needed)
+				continue;
+
+			pass.culled = false;
+			changed = true;
+
+			for (RenderGraphResource resource : pass.reads)
+				resourceNeeded[resource] = true;
+		}
+	}
+}
+
+bool RenderGraph::SortPasses()
+{
+	// Pass b has to run after pass a when a writes a resource x and
+	// 1) b only reads x, then b sees the final contents of x, after every pass that writes it,
+	// 2) b reads and writes x (like blending on top of it) and a was declared first,
+	// 3) both only write x, then the declaration order decides.
+	// Kahn's algorithm, always picking the lowest declared pass that is ready, keeps the declaration order where possible.
+	size_t passCount = m_Passes.size();
+	std::vector<std::vector<RenderGraphPass>> dependents(passCount);
+	std::vector<int> dependencyCount(passCount, 0);
+
+	for (size_t a = 0; a < passCount; ++a)
+	{
+		if (m_Passes[a].culled)
+			continue;
+
+		for (size_t b = 0; b < passCount; ++b)
+		{
+			if (a == b || m_Passes[b].culled)
+				continue;
+
+			const Pass& passB = m_Passes[b];
+
+			bool dependsOn = false;
+			for (RenderGraphResource x : m_Passes[a].writes)
+			{
+				bool bReads = std::find(passB.reads.begin(), passB.reads.end(), x) != passB.reads.end();
+				bool bWrites = std::find(passB.writes.begin(), passB.writes.end(), x) != passB.writes.end();
+
+				if ((bReads && !bWrites) || (bWrites && a < b))
+					dependsOn = true;
+			}
+
+			if (dependsOn)
+			{
+				dependents[a].push_back((RenderGraphPass)b);
+				++dependencyCount[b];
+			}
+		}
+	}
+
+	m_Order.clear();
+	std::vector<bool> done(passCount, false);
+
+	size_t activeCount = 0;
+	for (const Pass& pass : m_Passes)
+		activeCount += pass.culled ? 0 : 1;
+
+	while (m_Order.size() < activeCount)
+	{
+		int next = -1;
+		for (size_t i = 0; i < passCount; ++i)
+		{
+			if (!m_Passes[i].culled && !done[i] && dependencyCount[i] == 0)
+			{
+				next = (int)i;
+				break;
+			}
+		}
+
+		if (next == -1)
+		{
+			std::cout << "Render graph has a cycle, can't order the passes\n";
+			return false;
+		}
+
+		done[next] = true;
+		m_Order.push_back(next);
+
+		for (RenderGraphPass dependent : dependents[next])
+			--dependencyCount[dependent];
+	}
+
+	return true;
+}
+
+void RenderGraph::AssignPhysical()
+{
+	for (Resource& resource : m_Resources)
+	{
+		resource.physical = -1;
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+	}
+
+	// Lifetime of every resource, in positions of the execution order
+	for (int position = 0; position < (int)m_Order.size(); ++position)
+	{
+		const Pass& pass = m_Passes[m_Order[position]];
+
+		std::vector<RenderGraphResource> used = pass.reads;
+		used.insert(used.end(), pass.writes.begin(), pass.writes.end());
+
+		for (RenderGraphResource id : used)
+		{
+			Resource& resource = m_Resources[id];
+			if (resource.firstUse == -1)
+				resource.firstUse = position;
+			resource.lastUse = position;
+		}
+	}
+
+	// Hand out textures in execution order. A texture whose last user already ran can be taken over
+	// by a new resource with the same description, that's where the memory savings come from.
+	m_Physical.clear();
+	for (int position = 0; position < (int)m_Order.size(); ++position)
+	{
+		for (size_t id = 0; id < m_Resources.size(); ++id)
+		{
+			Resource& resource = m_Resources[id];
+			if (resource.imported || resource.firstUse != position)
+				continue;
+
+			int physicalIndex = -1;
+			for (size_t i = 0; i < m_Physical.size(); ++i)
+			{
+				if (m_Physical[i].freeAfter < position && m_Physical[i].desc == resource.desc)
+				{
+					physicalIndex = (int)i;
+					break;
+				}
+			}
+
+			if (physicalIndex == -1)
+			{
+				Physical physical;
+				physical.desc = resource.desc;
+				m_Physical.push_back(physical);
+				physicalIndex = (int)m_Physical.size() - 1;
+			}
+
+			m_Physical[physicalIndex].freeAfter = resource.lastUse;
+			resource.physical = physicalIndex;
+		}
+	}
+}
+
+void RenderGraph::Execute(RenderTargetPool& pool)
+{
+	if (!m_Compiled && !Compile())
+		return;
+
+	for (Physical& physical : m_Physical)
+		physical.target = pool.Acquire(physical.desc);
+
+	if (m_FrameBuffers.size() < m_Order.size())
+	{
+		size_t oldSize = m_FrameBuffers.size();
+		m_FrameBuffers.resize(m_Order.size());
+		glGenFramebuffers((GLsizei)(m_Order.size() - oldSize), &m_FrameBuffers[oldSize]);
+	}
+
+	for (int position = 0; position < (int)m_Order.size(); ++position)
+	{
+		BindFrameBuffer(position);
+
+		RenderGraphContext context(*this, m_Order[position]);
+		m_Passes[m_Order[position]].execute(context);
+	}
+
+	for (Physical& physical : m_Physical)
+	{
+		pool.Release(physical.target);
+		physical.target = RenderTarget();
+	}
+}
+
+void RenderGraph::BindFrameBuffer(int position)
+{
+	const Pass& pass = m_Passes[m_Order[position]];
+	if (pass.writes.empty())
+		return;
+
+	// Writing the default framebuffer, which can't be combined with other attachments
+	for (RenderGraphResource id : pass.writes)
+	{
+		const Resource& resource = m_Resources[id];
+		if (resource.imported && resource.importedId == 0)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(0, 0, resource.desc.width, resource.desc.height);
+			return;
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffers[position]);
+
+	// The framebuffer may have been used by a different pass last frame, so detach everything first
+	const int maxColorAttachments = 4;
+	for (int i = 0; i < maxColorAttachments; ++i)
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_RENDERBUFFER, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+
+	GLenum drawBuffers[maxColorAttachments];
+	int colorCount = 0;
+	int width = 0;
+	int height = 0;
+
+	for (RenderGraphResource id : pass.writes)
+	{
+		const Resource& resource = m_Resources[id];
+
+		RenderTarget target;
+		target.desc = resource.desc;
+		target.id = GetId(id);
+
+		GLenum attachment;
+		if (HasStencil(resource.desc.internalFormat))
+			attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+		else if (IsDepthFormat(resource.desc.internalFormat))
+			attachment = GL_DEPTH_ATTACHMENT;
+		else if (colorCount < maxColorAttachments)
+		{
+			attachment = GL_COLOR_ATTACHMENT0 + colorCount;
+			drawBuffers[colorCount++] = attachment;
+		}
+		else
+		{
+			std::cout << "Render graph pass " << pass.name << " writes too many color targets\n";
+			continue;
+		}
+
+		AttachRenderTarget(attachment, target);
+
+		width = resource.desc.width;
+		height = resource.desc.height;
+	}
+
+	if (colorCount > 0)
+		glDrawBuffers(colorCount, drawBuffers);
+	else
+		glDrawBuffer(GL_NONE);
+
+	glViewport(0, 0, width, height);
+}
+
+GLuint RenderGraph::GetId(RenderGraphResource resource) const
+{
+	const Resource& r = m_Resources[resource];
+	if (r.imported)
+		return r.importedId;
+
+	if (r.physical < 0)
+		return 0;
+
+	return m_Physical[r.physical].target.id;
+}
+
+size_t RenderGraph::GetTransientBytes() const
+{
+	size_t bytes = 0;
+	for (const Resource& resource : m_Resources)
+	{
+		if (!resource.imported && resource.physical >= 0)
+			bytes += GetRenderTargetBytes(resource.desc);
+	}
+
+	return bytes;
+}
+
+size_t RenderGraph::GetAliasedBytes() const
+{
+	size_t bytes = 0;
+	for (const Physical& physical : m_Physical)
+		bytes += GetRenderTargetBytes(physical.desc);
+
+	return bytes;
+}
+
+void RenderGraph::PrintReport(std::ostream& stream) const
+{
+	stream << "Render graph: " << m_Order.size() << " of " << m_Passes.size() << " passes\n";
+	for (RenderGraphPass pass : m_Order)
+		stream << "  " << m_Passes[pass].name << "\n";
+
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.culled)
+			stream << "  culled: " << pass.name << "\n";
+	}
+
+	for (const Resource& resource : m_Resources)
+	{
+		if (resource.imported)
+			continue;
+
+		stream << "  " << resource.name << " -> ";
+		if (resource.physical < 0)
+			stream << "unused\n";
+		else
+			stream << "texture " << resource.physical << " (passes " << resource.firstUse << " to " << resource.lastUse << ")\n";
+	}
+
+	stream << std::fixed << std::setprecision(2);
+	stream << "  transient memory: " << GetTransientBytes() / (1024.0 * 1024.0) << " MB, "
+		<< "after aliasing: " << GetAliasedBytes() / (1024.0 * 1024.0) << " MB\n";
+}
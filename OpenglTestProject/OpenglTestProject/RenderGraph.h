@@ -0,0 +1,137 @@
+#pragma once
+
+#include "RenderTargetPool.h"
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <iosfwd>
+
+typedef int RenderGraphResource;
+typedef int RenderGraphPass;
+
+class RenderGraph;
+
+// Handed to a pass while it executes. The framebuffer with the pass's writes is already bound
+// and the viewport covers it, the pass only has to clear and draw.
+class RenderGraphContext
+{
+public:
+	RenderGraphContext(const RenderGraph& graph, RenderGraphPass pass) : m_Graph(graph), m_Pass(pass) {}
+
+	// Texture name of a resource the pass reads
+	GLuint GetTexture(RenderGraphResource resource) const;
+	const RenderTargetDesc& GetDesc(RenderGraphResource resource) const;
+
+private:
+	const RenderGraph& m_Graph;
+	RenderGraphPass m_Pass;
+};
+
+// Instead of wiring framebuffers and textures together by hand, every pass declares which resources it reads and writes.
+// From that the graph works out:
+// 1) which passes contribute to the output at all, the others are culled,
+// 2) the order the passes have to run in,
+// 3) how long every transient resource lives. Resources whose lifetimes don't overlap share the same texture.
+// The graph is meant to be declared again every frame, compiling it is cheap.
+// The physical textures come from a RenderTargetPool, so they're the same from frame to frame.
+class RenderGraph
+{
+public:
+	typedef std::function<void(const RenderGraphContext& context)> ExecuteFunction;
+
+	RenderGraph();
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	// Forgets all passes and resources, the framebuffers are kept for the next frame.
+	void Reset();
+
+	// A texture that only exists while the graph executes
+	RenderGraphResource CreateTexture(const std::string& name, const RenderTargetDesc& desc);
+
+	// A texture that lives outside of the graph. Id 0 imports the default framebuffer.
+	// Imported resources are never aliased and count as output of the graph.
+	RenderGraphResource ImportTexture(const std::string& name, GLuint id, const RenderTargetDesc& desc);
+
+	RenderGraphPass AddPass(const std::string& name, const ExecuteFunction& execute);
+	void Read(RenderGraphPass pass, RenderGraphResource resource);
+	void Write(RenderGraphPass pass, RenderGraphResource resource);
+
+	// Passes with side effects outside of the graph are never culled
+	void SetSideEffect(RenderGraphPass pass);
+
+	// A pass that resolves a multisampled color resource into a single sampled one with glBlitFramebuffer.
+	// Both resources need the same size, the destination may be the imported default framebuffer.
+	// Only the lower left width x height pixels are resolved, 0 resolves the whole resource.
+	RenderGraphPass AddResolvePass(const std::string& name, RenderGraphResource source, RenderGraphResource destination, int width = 0, int height = 0);
+
+	bool Compile();
+	void Execute(RenderTargetPool& pool);
+
+	// Memory of all transient resources if each of them had its own texture
+	size_t GetTransientBytes() const;
+
+	// Memory that is actually needed after aliasing, this is the peak render target memory of a frame
+	size_t GetAliasedBytes() const;
+
+	void PrintReport(std::ostream& stream) const;
+
+private:
+	friend class RenderGraphContext;
+
+	struct Resource
+	{
+		std::string name;
+		RenderTargetDesc desc;
+		bool imported;
+		GLuint importedId;
+
+		// Index into m_Physical, -1 for imported resources and resources of culled passes
+		int physical;
+
+		// Position of the first and last pass using this resource in m_Order
+		int firstUse;
+		int lastUse;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<RenderGraphResource> reads;
+		std::vector<RenderGraphResource> writes;
+		bool sideEffect;
+		bool culled;
+	};
+
+	struct Physical
+	{
+		RenderTargetDesc desc;
+		RenderTarget target;
+
+		// Position in m_Order after which the texture can be given to another resource
+		int freeAfter;
+	};
+
+	void CullPasses();
+	bool SortPasses();
+	void AssignPhysical();
+	void BindFrameBuffer(int orderIndex);
+	GLuint GetId(RenderGraphResource resource) const;
+
+	std::vector<Resource> m_Resources;
+	std::vector<Pass> m_Passes;
+	std::vector<Physical> m_Physical;
+	std::vector<RenderGraphPass> m_Order;
+
+	// One framebuffer per executed pass, kept across frames
+	std::vector<GLuint> m_FrameBuffers;
+
+	// Read framebuffer for the source of resolve passes
+	GLuint m_ResolveFrameBuffer;
+
+	bool m_Compiled;
+};
@@ -0,0 +1,272 @@
+#include "RenderTargetPool.h"
+
+#include <iostream>
+
+RenderTargetDesc::RenderTargetDesc()
+	: width(0)
+	, height(0)
+	, internalFormat(GL_RGBA8)
+	, samples(0)
+	, renderbuffer(false)
+{
+}
+
+RenderTargetDesc::RenderTargetDesc(int width, int height, GLenum internalFormat, int samples, bool renderbuffer)
+	: width(width)
+	, height(height)
+	, internalFormat(internalFormat)
+	, samples(samples)
+	, renderbuffer(renderbuffer)
+{
+}
+
+bool RenderTargetDesc::operator==(const RenderTargetDesc& other) const
+{
+	return width == other.width
+		&& height == other.height
+		&& internalFormat == other.internalFormat
+		&& samples == other.samples
+		&& renderbuffer == other.renderbuffer;
+}
+
+size_t GetBytesPerPixel(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+
+	// Drivers pad 3 component formats to 4 components
+	case GL_RGB8:
+	case GL_RGBA8:
+	case GL_SRGB8:
+	case GL_SRGB8_ALPHA8:
+	case GL_RGB10_A2:
+	case GL_R11F_G11F_B10F:
+	case GL_RG16F:
+	case GL_R32F:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+		return 4;
+	case GL_RGB16F:
+	case GL_RGBA16F:
+	case GL_RG32F:
+	case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F:
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+size_t GetRenderTargetBytes(const RenderTargetDesc& desc)
+{
+	size_t samples = desc.samples > 0 ? desc.samples : 1;
+	return (size_t)desc.width * desc.height * samples * GetBytesPerPixel(desc.internalFormat);
+}
+
+bool IsDepthFormat(GLenum internalFormat)
+{
+	return internalFormat == GL_DEPTH_COMPONENT16
+		|| internalFormat == GL_DEPTH_COMPONENT24
+		|| internalFormat == GL_DEPTH_COMPONENT32F
+		|| internalFormat == GL_DEPTH24_STENCIL8
+		|| internalFormat == GL_DEPTH32F_STENCIL8;
+}
+
+bool HasStencil(GLenum internalFormat)
+{
+	return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
+}
+
+void AttachRenderTarget(GLenum attachment, const RenderTarget& target, GLenum framebufferTarget)
+{
+	if (target.desc.renderbuffer)
+		glFramebufferRenderbuffer(framebufferTarget, attachment, GL_RENDERBUFFER, target.id);
+	else if (target.desc.samples > 0)
+		glFramebufferTexture2D(framebufferTarget, attachment, GL_TEXTURE_2D_MULTISAMPLE, target.id, 0);
+	else
+		glFramebufferTexture2D(framebufferTarget, attachment, GL_TEXTURE_2D, target.id, 0);
+}
+
+RenderTargetPool::RenderTargetPool()
+	: m_Frame(0)
+	, m_MaxIdleFrames(3)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+	Clear();
+}
+
+RenderTarget RenderTargetPool::Acquire(const RenderTargetDesc& desc)
+{
+	for (Entry& entry : m_Entries)
+	{
+		if (!entry.inUse && entry.target.desc == desc)
+		{
+			entry.inUse = true;
+			entry.lastUsedFrame = m_Frame;
+			return entry.target;
+		}
+	}
+
+	Entry entry;
+	entry.target = Create(desc);
+	entry.inUse = true;
+	entry.lastUsedFrame = m_Frame;
+	m_Entries.push_back(entry);
+
+	return entry.target;
+}
+
+void RenderTargetPool::Release(const RenderTarget& target)
+{
+	for (Entry& entry : m_Entries)
+	{
+		if (entry.target.id == target.id && entry.target.desc.renderbuffer == target.desc.renderbuffer)
+		{
+			entry.inUse = false;
+			return;
+		}
+	}
+
+	std::cout << "Released a render target that doesn't belong to the pool\n";
+}
+
+void RenderTargetPool::EndFrame()
+{
+	for (size_t i = 0; i < m_Entries.size();)
+	{
+		Entry& entry = m_Entries[i];
+		if (!entry.inUse && m_Frame - entry.lastUsedFrame > (unsigned int)m_MaxIdleFrames)
+		{
+			Delete(entry.target);
+			m_Entries[i] = m_Entries.back();
+			m_Entries.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	++m_Frame;
+}
+
+void RenderTargetPool::Trim()
+{
+	for (size_t i = 0; i < m_Entries.size();)
+	{
+		if (!m_Entries[i].inUse)
+		{
+			Delete(m_Entries[i].target);
+			m_Entries[i] = m_Entries.back();
+			m_Entries.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void RenderTargetPool::Clear()
+{
+	for (Entry& entry : m_Entries)
+		Delete(entry.target);
+
+	m_Entries.clear();
+}
+
+size_t RenderTargetPool::GetAllocatedBytes() const
+{
+	size_t bytes = 0;
+	for (const Entry& entry : m_Entries)
+		bytes += GetRenderTargetBytes(entry.target.desc);
+
+	return bytes;
+}
+
+RenderTarget RenderTargetPool::Create(const RenderTargetDesc& desc)
+{
+	RenderTarget target;
+	target.desc = desc;
+
+	if (desc.renderbuffer)
+	{
+		GLint prevRenderbuffer;
+		glGetIntegerv(GL_RENDERBUFFER_BINDING, &prevRenderbuffer);
+
+		glGenRenderbuffers(1, &target.id);
+		glBindRenderbuffer(GL_RENDERBUFFER, target.id);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, desc.samples, desc.internalFormat, desc.width, desc.height);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, prevRenderbuffer);
+		return target;
+	}
+
+	glGenTextures(1, &target.id);
+
+	if (desc.samples > 0)
+	{
+		GLint prevTexture;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D_MULTISAMPLE, &prevTexture);
+
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, target.id);
+		glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.internalFormat, desc.width, desc.height, GL_TRUE);
+
+		glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, prevTexture);
+		return target;
+	}
+
+	GLint prevTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &prevTexture);
+	glBindTexture(GL_TEXTURE_2D, target.id);
+
+	// No data is uploaded, but format and type still have to be a valid combination for the internal format.
+	GLenum format = GL_RGBA;
+	GLenum type = GL_UNSIGNED_BYTE;
+	if (HasStencil(desc.internalFormat))
+	{
+		format = GL_DEPTH_STENCIL;
+		type = desc.internalFormat == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV : GL_UNSIGNED_INT_24_8;
+	}
+	else if (IsDepthFormat(desc.internalFormat))
+	{
+		format = GL_DEPTH_COMPONENT;
+		type = GL_FLOAT;
+	}
+
+	glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, NULL);
+
+	// Render targets are sampled at their own resolution by post processing passes, so no mipmaps.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D, prevTexture);
+	return target;
+}
+
+void RenderTargetPool::Delete(RenderTarget& target)
+{
+	if (target.id == 0)
+		return;
+
+	if (target.desc.renderbuffer)
+		glDeleteRenderbuffers(1, &target.id);
+	else
+		glDeleteTextures(1, &target.id);
+
+	target.id = 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <vector>
+#include <cstddef>
+
+// Everything that decides whether 2 render targets can be swapped for each other
+struct RenderTargetDesc
+{
+	int width;
+	int height;
+	GLenum internalFormat;
+	int samples;
+
+	// Renderbuffers can't be sampled in a shader, but may be faster to render to.
+	// Use them for attachments like depth-stencil that are never read back.
+	bool renderbuffer;
+
+	RenderTargetDesc();
+	RenderTargetDesc(int width, int height, GLenum internalFormat, int samples = 0, bool renderbuffer = false);
+
+	bool operator==(const RenderTargetDesc& other) const;
+	bool operator!=(const RenderTargetDesc& other) const { return !(*this == other); }
+};
+
+struct RenderTarget
+{
+	// A texture name, or a renderbuffer name if desc.renderbuffer is set
+	GLuint id;
+	RenderTargetDesc desc;
+
+	RenderTarget() : id(0) {}
+	bool IsValid() const { return id != 0; }
+};
+
+// Estimated size in bytes of a single pixel of the internal format, per sample.
+size_t GetBytesPerPixel(GLenum internalFormat);
+
+// Estimated size in bytes of a whole render target, including all samples.
+size_t GetRenderTargetBytes(const RenderTargetDesc& desc);
+
+bool IsDepthFormat(GLenum internalFormat);
+bool HasStencil(GLenum internalFormat);
+
+// Attaches a render target to the currently bound framebuffer, works for both textures and renderbuffers.
+// Pass GL_READ_FRAMEBUFFER or GL_DRAW_FRAMEBUFFER as framebufferTarget to attach to only one of the 2 bindings, e.g. for a blit.
+void AttachRenderTarget(GLenum attachment, const RenderTarget& target, GLenum framebufferTarget = GL_FRAMEBUFFER);
+
+// Hands out framebuffer attachments and takes them back when a pass is done with them.
+// A released target is given to the next pass that asks for the same size, format and sample count,
+// so passes that don't overlap in time share memory, and the same targets are reused from frame to frame.
+// When the window is resized new targets are created the first time they're asked for,
+// the old ones are deleted once they haven't been used for a few frames.
+class RenderTargetPool
+{
+public:
+	RenderTargetPool();
+	~RenderTargetPool();
+
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+	RenderTarget Acquire(const RenderTargetDesc& desc);
+	void Release(const RenderTarget& target);
+
+	// Deletes targets that haven't been acquired for more than the maximum amount of idle frames.
+	void EndFrame();
+
+	// Deletes every target that isn't in use right now
+	void Trim();
+	void Clear();
+
+	void SetMaxIdleFrames(int frames) { m_MaxIdleFrames = frames; }
+
+	int GetTargetCount() const { return (int)m_Entries.size(); }
+	size_t GetAllocatedBytes() const;
+
+private:
+	struct Entry
+	{
+		RenderTarget target;
+		bool inUse;
+		unsigned int lastUsedFrame;
+	};
+
+	static RenderTarget Create(const RenderTargetDesc& desc);
+	static void Delete(RenderTarget& target);
+
+	std::vector<Entry> m_Entries;
+	unsigned int m_Frame;
+	int m_MaxIdleFrames;
+};
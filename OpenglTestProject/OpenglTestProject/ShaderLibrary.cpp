@@ -0,0 +1,414 @@
+#include "ShaderLibrary.h"
+#include "AssetPack.h"
+
+#include <iostream>
+#include <chrono>
+
+bool LoadTextFile(const std::string& path, std::string& text)
+{
+	AssetData file;
+	if (!ReadAsset(path, file))
+		return false;
+
+	text.assign((const char*)file.GetData(), file.GetSize());
+	return true;
+}
+
+static std::string GetShaderLog(GLuint shader)
+{
+	GLint length = 0;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+	std::string log(length > 0 ? length : 1, '\0');
+	glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+	return log.c_str();
+}
+
+static std::string GetProgramLog(GLuint program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+	std::string log(length > 0 ? length : 1, '\0');
+	glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+	return log.c_str();
+}
+
+GLuint CompileShader(GLenum type, const char* source, const char* name)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status == GL_FALSE)
+		std::cout << name << " compile error\n" << GetShaderLog(shader) << "\n";
+
+	return shader;
+}
+
+ShaderLibrary::ShaderLibrary()
+	: m_ParallelCompile(false)
+	, m_ReloadCount(0)
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	Destroy();
+}
+
+void ShaderLibrary::Create()
+{
+	Destroy();
+
+	// Let the driver use as many threads as it likes
+	m_ParallelCompile = GLEW_ARB_parallel_shader_compile != GL_FALSE;
+	if (m_ParallelCompile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+}
+
+void ShaderLibrary::Destroy()
+{
+	for (ShaderProgram& shaderProgram : m_Programs)
+	{
+		// The loader thread may still be reading the files
+		if (shaderProgram.sources.valid())
+			shaderProgram.sources.wait();
+
+		DiscardPending(shaderProgram);
+		if (shaderProgram.program != 0)
+			glDeleteProgram(shaderProgram.program);
+	}
+
+	m_Programs.clear();
+}
+
+int ShaderLibrary::Load(const std::string& vertexPath, const std::string& fragmentPath, const char* builtInVertexSource, const char* builtInFragmentSource)
+{
+	ShaderProgram shaderProgram;
+	shaderProgram.vertexPath = vertexPath;
+	shaderProgram.fragmentPath = fragmentPath;
+	shaderProgram.builtInVertexSource = builtInVertexSource;
+	shaderProgram.builtInGeometrySource = nullptr;
+	shaderProgram.builtInFragmentSource = builtInFragmentSource;
+
+	return Add(shaderProgram);
+}
+
+int ShaderLibrary::LoadFeedback(const std::string& vertexPath, const std::string& geometryPath, const char* builtInVertexSource, const char* builtInGeometrySource,
+	const std::vector<std::string>& varyings)
+{
+	ShaderProgram shaderProgram;
+	shaderProgram.vertexPath = vertexPath;
+	shaderProgram.geometryPath = geometryPath;
+	shaderProgram.builtInVertexSource = builtInVertexSource;
+	shaderProgram.builtInGeometrySource = builtInGeometrySource;
+	shaderProgram.builtInFragmentSource = nullptr;
+	shaderProgram.feedbackVaryings = varyings;
+
+	return Add(shaderProgram);
+}
+
+int ShaderLibrary::Add(ShaderProgram& shaderProgram)
+{
+	shaderProgram.program = 0;
+	shaderProgram.stage = BuildStage::Idle;
+	shaderProgram.pendingVertexShader = 0;
+	shaderProgram.pendingGeometryShader = 0;
+	shaderProgram.pendingFragmentShader = 0;
+	shaderProgram.pendingProgram = 0;
+	shaderProgram.reloadQueued = false;
+
+	// Nothing is drawn yet, so the program is built right away and waited for
+	Sources sources = ReadSources(shaderProgram.vertexPath, shaderProgram.geometryPath, shaderProgram.fragmentPath,
+		shaderProgram.builtInVertexSource, shaderProgram.builtInGeometrySource, shaderProgram.builtInFragmentSource);
+	if (!sources.valid)
+	{
+		std::cout << "Can't read " << GetFileNames(shaderProgram) << ", using the built-in shaders\n";
+		sources = GetBuiltInSources(shaderProgram);
+	}
+
+	StartCompile(shaderProgram, sources);
+	if (!FinishCompile(shaderProgram) || !FinishLink(shaderProgram))
+	{
+		std::cout << "Using the built-in shaders instead of " << GetFileNames(shaderProgram) << "\n";
+		sources = GetBuiltInSources(shaderProgram);
+
+		StartCompile(shaderProgram, sources);
+		if (FinishCompile(shaderProgram))
+			FinishLink(shaderProgram);
+	}
+
+	m_Programs.push_back(std::move(shaderProgram));
+	return (int)m_Programs.size() - 1;
+}
+
+std::vector<std::string> ShaderLibrary::GetPaths() const
+{
+	std::vector<std::string> paths;
+	for (const ShaderProgram& shaderProgram : m_Programs)
+	{
+		if (!shaderProgram.vertexPath.empty())
+			paths.push_back(shaderProgram.vertexPath);
+		if (!shaderProgram.geometryPath.empty())
+			paths.push_back(shaderProgram.geometryPath);
+		if (!shaderProgram.fragmentPath.empty())
+			paths.push_back(shaderProgram.fragmentPath);
+	}
+
+	return paths;
+}
+
+// An empty path uses the built-in source, a stage without either isn't there
+static bool ReadSource(const std::string& path, const char* builtInSource, std::string& source)
+{
+	if (!path.empty())
+		return LoadTextFile(path, source);
+
+	source = builtInSource ? builtInSource : "";
+	return true;
+}
+
+ShaderLibrary::Sources ShaderLibrary::ReadSources(std::string vertexPath, std::string geometryPath, std::string fragmentPath,
+	const char* builtInVertexSource, const char* builtInGeometrySource, const char* builtInFragmentSource)
+{
+	Sources sources;
+	sources.valid = ReadSource(vertexPath, builtInVertexSource, sources.vertex);
+	sources.valid = ReadSource(geometryPath, builtInGeometrySource, sources.geometry) && sources.valid;
+	sources.valid = ReadSource(fragmentPath, builtInFragmentSource, sources.fragment) && sources.valid;
+	return sources;
+}
+
+ShaderLibrary::Sources ShaderLibrary::GetBuiltInSources(const ShaderProgram& shaderProgram)
+{
+	return ReadSources("", "", "", shaderProgram.builtInVertexSource, shaderProgram.builtInGeometrySource, shaderProgram.builtInFragmentSource);
+}
+
+std::string ShaderLibrary::GetFileNames(const ShaderProgram& shaderProgram)
+{
+	std::string names;
+	for (const std::string* path : { &shaderProgram.vertexPath, &shaderProgram.geometryPath, &shaderProgram.fragmentPath })
+	{
+		if (path->empty())
+			continue;
+
+		if (!names.empty())
+			names += " and ";
+		names += *path;
+	}
+
+	return names.empty() ? "the built-in shaders" : names;
+}
+
+bool ShaderLibrary::Reload(const std::string& path)
+{
+	bool found = false;
+	for (ShaderProgram& shaderProgram : m_Programs)
+	{
+		if (shaderProgram.vertexPath != path && shaderProgram.geometryPath != path && shaderProgram.fragmentPath != path)
+			continue;
+
+		found = true;
+
+		// What is being built may have been read before this change
+		if (shaderProgram.stage != BuildStage::Idle)
+			shaderProgram.reloadQueued = true;
+		else
+			StartReload(shaderProgram);
+	}
+
+	return found;
+}
+
+void ShaderLibrary::StartReload(ShaderProgram& shaderProgram)
+{
+	// The paths are copied into the task, so the loader thread doesn't share anything with the render thread
+	shaderProgram.stage = BuildStage::Reading;
+	shaderProgram.sources = std::async(std::launch::async, ReadSources, shaderProgram.vertexPath, shaderProgram.geometryPath, shaderProgram.fragmentPath,
+		shaderProgram.builtInVertexSource, shaderProgram.builtInGeometrySource, shaderProgram.builtInFragmentSource);
+}
+
+// Returns 0 for a stage that isn't part of the program
+static GLuint StartShader(GLenum type, const std::string& source)
+{
+	if (source.empty())
+		return 0;
+
+	const char* text = source.c_str();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &text, NULL);
+	glCompileShader(shader);
+	return shader;
+}
+
+// Prints the log and returns false when the shader didn't compile
+static bool CheckShader(GLuint shader, const char* stageName, const std::string& path)
+{
+	if (shader == 0)
+		return true;
+
+	GLint status;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_FALSE)
+		return true;
+
+	std::cout << stageName << " shader compile error in " << path << "\n" << GetShaderLog(shader) << "\n";
+	return false;
+}
+
+void ShaderLibrary::StartCompile(ShaderProgram& shaderProgram, const Sources& sources)
+{
+	shaderProgram.pendingVertexShader = StartShader(GL_VERTEX_SHADER, sources.vertex);
+	shaderProgram.pendingGeometryShader = StartShader(GL_GEOMETRY_SHADER, sources.geometry);
+	shaderProgram.pendingFragmentShader = StartShader(GL_FRAGMENT_SHADER, sources.fragment);
+
+	shaderProgram.stage = BuildStage::Compiling;
+}
+
+bool ShaderLibrary::FinishCompile(ShaderProgram& shaderProgram)
+{
+	bool vertexCompiled = CheckShader(shaderProgram.pendingVertexShader, "Vertex", shaderProgram.vertexPath);
+	bool geometryCompiled = CheckShader(shaderProgram.pendingGeometryShader, "Geometry", shaderProgram.geometryPath);
+	bool fragmentCompiled = CheckShader(shaderProgram.pendingFragmentShader, "Fragment", shaderProgram.fragmentPath);
+
+	if (!vertexCompiled || !geometryCompiled || !fragmentCompiled)
+	{
+		DiscardPending(shaderProgram);
+		return false;
+	}
+
+	shaderProgram.pendingProgram = glCreateProgram();
+	for (GLuint shader : { shaderProgram.pendingVertexShader, shaderProgram.pendingGeometryShader, shaderProgram.pendingFragmentShader })
+	{
+		if (shader != 0)
+			glAttachShader(shaderProgram.pendingProgram, shader);
+	}
+
+	if (shaderProgram.pendingFragmentShader != 0)
+		glBindFragDataLocation(shaderProgram.pendingProgram, 0, "outColor");
+
+	if (!shaderProgram.feedbackVaryings.empty())
+	{
+		std::vector<const char*> varyings;
+		for (const std::string& varying : shaderProgram.feedbackVaryings)
+			varyings.push_back(varying.c_str());
+		glTransformFeedbackVaryings(shaderProgram.pendingProgram, (GLsizei)varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+	}
+
+	glLinkProgram(shaderProgram.pendingProgram);
+
+	shaderProgram.stage = BuildStage::Linking;
+	return true;
+}
+
+bool ShaderLibrary::FinishLink(ShaderProgram& shaderProgram)
+{
+	GLint status;
+	glGetProgramiv(shaderProgram.pendingProgram, GL_LINK_STATUS, &status);
+	if (status == GL_FALSE)
+	{
+		std::cout << "Link error in " << GetFileNames(shaderProgram) << "\n" << GetProgramLog(shaderProgram.pendingProgram) << "\n";
+		DiscardPending(shaderProgram);
+		return false;
+	}
+	GLuint old = shaderProgram.program;
+	shaderProgram.program = shaderProgram.pendingProgram;
+	shaderProgram.pendingProgram = 0;
+
+	// The program keeps the shaders it was linked from alive
+	DiscardPending(shaderProgram);
+
+	if (old != 0)
+	{
+		if (shaderProgram.onSwap)
+			shaderProgram.onSwap(shaderProgram.program);
+		glDeleteProgram(old);
+	}
+
+	return true;
+}
+
+void ShaderLibrary::DiscardPending(ShaderProgram& shaderProgram)
+{
+	if (shaderProgram.pendingVertexShader != 0)
+		glDeleteShader(shaderProgram.pendingVertexShader);
+	if (shaderProgram.pendingGeometryShader != 0)
+		glDeleteShader(shaderProgram.pendingGeometryShader);
+	if (shaderProgram.pendingFragmentShader != 0)
+		glDeleteShader(shaderProgram.pendingFragmentShader);
+	if (shaderProgram.pendingProgram != 0)
+		glDeleteProgram(shaderProgram.pendingProgram);
+
+	shaderProgram.pendingVertexShader = 0;
+	shaderProgram.pendingGeometryShader = 0;
+	shaderProgram.pendingFragmentShader = 0;
+	shaderProgram.pendingProgram = 0;
+	shaderProgram.stage = BuildStage::Idle;
+}
+
+bool ShaderLibrary::IsShaderDone(GLuint shader) const
+{
+	if (!m_ParallelCompile || shader == 0)
+		return true;
+
+	GLint done = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPLETION_STATUS_ARB, &done);
+	return done != GL_FALSE;
+}
+
+bool ShaderLibrary::IsProgramDone(GLuint program) const
+{
+	if (!m_ParallelCompile)
+		return true;
+
+	GLint done = GL_FALSE;
+	glGetProgramiv(program, GL_COMPLETION_STATUS_ARB, &done);
+	return done != GL_FALSE;
+}
+
+void ShaderLibrary::Update()
+{
+	for (ShaderProgram& shaderProgram : m_Programs)
+	{
+		// Without the extension every stage is done right away, so a reload goes through all of them in one call
+		if (shaderProgram.stage == BuildStage::Reading)
+		{
+			if (shaderProgram.sources.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+				continue;
+
+			// An editor that replaces the file may not have put the new one there yet, the next change brings it
+			Sources sources = shaderProgram.sources.get();
+			if (sources.valid)
+				StartCompile(shaderProgram, sources);
+			else
+				shaderProgram.stage = BuildStage::Idle;
+		}
+
+		if (shaderProgram.stage == BuildStage::Compiling)
+		{
+			if (!IsShaderDone(shaderProgram.pendingVertexShader) || !IsShaderDone(shaderProgram.pendingGeometryShader)
+				|| !IsShaderDone(shaderProgram.pendingFragmentShader))
+				continue;
+
+			FinishCompile(shaderProgram);
+		}
+
+		if (shaderProgram.stage == BuildStage::Linking)
+		{
+			if (!IsProgramDone(shaderProgram.pendingProgram))
+				continue;
+
+			if (FinishLink(shaderProgram))
+			{
+				++m_ReloadCount;
+				std::cout << "Reloaded " << GetFileNames(shaderProgram) << "\n";
+			}
+		}
+
+		if (shaderProgram.stage == BuildStage::Idle && shaderProgram.reloadQueued)
+		{
+			shaderProgram.reloadQueued = false;
+			StartReload(shaderProgram);
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include <string>
+#include <vector>
+#include <future>
+#include <functional>
+
+// Reads a whole text file through ReadAsset, so from the mounted asset pack when it has it. Returns false when it can't be read.
+bool LoadTextFile(const std::string& path, std::string& text);
+
+// Compiles a shader that is built into the program right away. When it doesn't compile the log is printed after the name,
+// the shader is returned either way.
+GLuint CompileShader(GLenum type, const char* source, const char* name);
+
+// Shader programs whose sources are files, so they can be edited while the program runs.
+// Every program has a built-in source for each stage as well, which is used when the file isn't there or doesn't compile.
+// A program has a vertex shader and a fragment shader, or a vertex shader and a geometry shader whose outputs are captured with transform feedback.
+//
+// A reload reads the files on a loader thread and builds the new program next to the old one, which is drawn with until then.
+// With GL_ARB_parallel_shader_compile the driver compiles and links on its own threads, Update only asks whether it's done,
+// so a frame never waits for the compiler. Without it the new program is built in the Update after the files were read.
+// A program that doesn't compile or link is thrown away with its log printed, the old one stays.
+class ShaderLibrary
+{
+public:
+	ShaderLibrary();
+	~ShaderLibrary();
+
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	void Create();
+	void Destroy();
+
+	// Builds a program right away and returns its handle. An empty path always uses the built-in source of that stage.
+	int Load(const std::string& vertexPath, const std::string& fragmentPath, const char* builtInVertexSource, const char* builtInFragmentSource);
+
+	// A program without a fragment shader, the varyings are written to one transform feedback buffer interleaved, in this order.
+	int LoadFeedback(const std::string& vertexPath, const std::string& geometryPath, const char* builtInVertexSource, const char* builtInGeometrySource,
+		const std::vector<std::string>& varyings);
+
+	GLuint GetProgram(int handle) const { return m_Programs[handle].program; }
+
+	// Called with the new program when a reload replaces the old one, to get its uniform locations and set its uniforms.
+	// The old program is deleted after this returns.
+	void SetOnSwap(int handle, std::function<void(GLuint)> onSwap) { m_Programs[handle].onSwap = onSwap; }
+
+	// The files every program was loaded from, to hand to a file watcher
+	std::vector<std::string> GetPaths() const;
+
+	// Starts reloading every program that uses the file, returns false when none does
+	bool Reload(const std::string& path);
+
+	// Swaps in the programs that are done building, call it at the start of a frame before anything is drawn
+	void Update();
+
+	int GetReloadCount() const { return m_ReloadCount; }
+
+private:
+	// A stage without a path or a built-in source isn't part of the program, its source stays empty
+	struct Sources
+	{
+		std::string vertex;
+		std::string geometry;
+		std::string fragment;
+		bool valid;
+	};
+
+	enum class BuildStage
+	{
+		Idle,
+		Reading,
+		Compiling,
+		Linking
+	};
+
+	struct ShaderProgram
+	{
+		std::string vertexPath;
+		std::string geometryPath;
+		std::string fragmentPath;
+		const char* builtInVertexSource;
+		const char* builtInGeometrySource;
+		const char* builtInFragmentSource;
+
+		// Outputs captured with transform feedback, bound before every link
+		std::vector<std::string> feedbackVaryings;
+
+		GLuint program;
+		std::function<void(GLuint)> onSwap;
+
+		// The program that is being built
+		BuildStage stage;
+		std::future<Sources> sources;
+		GLuint pendingVertexShader;
+		GLuint pendingGeometryShader;
+		GLuint pendingFragmentShader;
+		GLuint pendingProgram;
+
+		// A file changed again while the program was being built, the build has to start over when it's done
+		bool reloadQueued;
+	};
+
+	int Add(ShaderProgram& shaderProgram);
+
+	// Runs on the loader thread, so it gets copies of the paths
+	static Sources ReadSources(std::string vertexPath, std::string geometryPath, std::string fragmentPath,
+		const char* builtInVertexSource, const char* builtInGeometrySource, const char* builtInFragmentSource);
+	static Sources GetBuiltInSources(const ShaderProgram& shaderProgram);
+
+	// The files of a program for messages, like "a.vert and a.frag"
+	static std::string GetFileNames(const ShaderProgram& shaderProgram);
+
+	// The stages of building a program. Each one only starts work for the driver, the next one asks for the result.
+	// A stage that fails prints the log, deletes what was built so far and returns false.
+	void StartCompile(ShaderProgram& shaderProgram, const Sources& sources);
+	bool FinishCompile(ShaderProgram& shaderProgram);
+	bool FinishLink(ShaderProgram& shaderProgram);
+	void DiscardPending(ShaderProgram& shaderProgram);
+	void StartReload(ShaderProgram& shaderProgram);
+
+	// Whether the driver is done with a shader or program, always true without the extension
+	bool IsShaderDone(GLuint shader) const;
+	bool IsProgramDone(GLuint program) const;
+
+	std::vector<ShaderProgram> m_Programs;
+
+	bool m_ParallelCompile;
+	int m_ReloadCount;
+};
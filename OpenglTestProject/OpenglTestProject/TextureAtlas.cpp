@@ -0,0 +1,364 @@
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+SkylinePacker::SkylinePacker()
+	: m_Width(0)
+	, m_Height(0)
+	, m_UsedArea(0)
+{
+}
+
+void SkylinePacker::Reset(int width, int height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_UsedArea = 0;
+
+	Segment ground;
+	ground.x = 0;
+	ground.y = 0;
+	ground.width = width;
+
+	m_Skyline.clear();
+	m_Skyline.push_back(ground);
+}
+
+int SkylinePacker::FitAt(size_t segment, int width, int height) const
+{
+	int x = m_Skyline[segment].x;
+	if (x + width > m_Width)
+		return -1;
+
+	// The rectangle rests on the highest segment below it
+	int y = 0;
+	int widthLeft = width;
+	for (size_t i = segment; widthLeft > 0; ++i)
+	{
+		y = std::max(y, m_Skyline[i].y);
+		if (y + height > m_Height)
+			return -1;
+
+		widthLeft -= m_Skyline[i].width;
+	}
+
+	return y;
+}
+
+bool SkylinePacker::Pack(int width, int height, int& x, int& y)
+{
+	int bestIndex = -1;
+	int bestTop = m_Height + 1;
+	int bestWidth = m_Width + 1;
+
+	for (size_t i = 0; i < m_Skyline.size(); ++i)
+	{
+		int fitY = FitAt(i, width, height);
+		if (fitY == -1)
+			continue;
+
+		// Lowest top edge first, then the narrowest segment so wide gaps stay free for wide rectangles
+		int top = fitY + height;
+		if (top < bestTop || (top == bestTop && m_Skyline[i].width < bestWidth))
+		{
+			bestIndex = (int)i;
+			bestTop = top;
+			bestWidth = m_Skyline[i].width;
+		}
+	}
+
+	if (bestIndex == -1)
+		return false;
+
+	x = m_Skyline[bestIndex].x;
+	y = bestTop - height;
+
+	Segment top;
+	top.x = x;
+	top.y = bestTop;
+	top.width = width;
+	m_Skyline.insert(m_Skyline.begin() + bestIndex, top);
+
+	// Cut away the segments that are now below the new one
+	for (size_t i = bestIndex + 1; i < m_Skyline.size();)
+	{
+		const Segment& previous = m_Skyline[i - 1];
+		int overlap = previous.x + previous.width - m_Skyline[i].x;
+		if (overlap <= 0)
+			break;
+
+		m_Skyline[i].x += overlap;
+		m_Skyline[i].width -= overlap;
+		if (m_Skyline[i].width > 0)
+			break;
+
+		m_Skyline.erase(m_Skyline.begin() + i);
+	}
+
+	// Neighbours at the same height are one segment
+	for (size_t i = 1; i < m_Skyline.size();)
+	{
+		if (m_Skyline[i - 1].y == m_Skyline[i].y)
+		{
+			m_Skyline[i - 1].width += m_Skyline[i].width;
+			m_Skyline.erase(m_Skyline.begin() + i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+
+	m_UsedArea += (size_t)width * height;
+	return true;
+}
+
+float SkylinePacker::GetOccupancy() const
+{
+	if (m_Width == 0 || m_Height == 0)
+		return 0.0f;
+
+	return (float)m_UsedArea / ((float)m_Width * m_Height);
+}
+
+TextureAtlas::TextureAtlas()
+	: m_LayerCount(0)
+	, m_PageSize(2048)
+	, m_Padding(8)
+	, m_Occupancy(0.0f)
+	, m_Packed(false)
+	, m_Texture(0)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	Destroy();
+}
+
+int TextureAtlas::Add(const unsigned char* rgba, int width, int height)
+{
+	if (m_Packed)
+	{
+		std::cout << "TextureAtlas::Add called after Pack\n";
+		return -1;
+	}
+
+	// An empty image has no edge pixels to fill its border with
+	if (rgba == nullptr || width <= 0 || height <= 0)
+	{
+		std::cout << "Can't add an image of " << width << "x" << height << " to the atlas\n";
+		return -1;
+	}
+
+	Image image;
+	image.width = width;
+	image.height = height;
+	image.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+	m_Images.push_back(image);
+
+	AtlasEntry entry = {};
+	m_Entries.push_back(entry);
+
+	return (int)m_Entries.size() - 1;
+}
+
+int TextureAtlas::AddFile(const std::string& path)
+{
+	// Only the image itself, the atlas builds the mipmaps of its pages
+	DecodedImage image = DecodeImage(path, MipFilter::Box, TextureFormat::RGBA8, 1);
+	if (image.levels.empty())
+	{
+		std::cout << "Failed to load " << path << "\n";
+		return -1;
+	}
+
+	return Add(image.levels[0].data(), image.width, image.height);
+}
+
+// Rounds up to a multiple of alignment, which is a power of 2
+static int AlignUp(int value, int alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+bool TextureAtlas::Pack()
+{
+	if (m_Packed)
+	{
+		std::cout << "TextureAtlas::Pack called twice, its images were freed by the first call\n";
+		return false;
+	}
+
+	// With a border of n pixels, level log2(n) is the last one where it's still a pixel wide
+	int levelCount = 1;
+	for (int border = m_Padding; border > 1; border /= 2)
+		++levelCount;
+
+	// Every cell starts and ends on a multiple of the pixels that become one pixel of the last level,
+	// so no pixel of any level is made of 2 cells. The extra space goes to the right and bottom border.
+	int alignment = 1 << (levelCount - 1);
+
+	// Tall images first, that leaves the flattest skyline for the rest
+	std::vector<int> order(m_Images.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = (int)i;
+
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		if (m_Images[a].height != m_Images[b].height)
+			return m_Images[a].height > m_Images[b].height;
+		return m_Images[a].width > m_Images[b].width;
+	});
+
+	std::vector<SkylinePacker> pages;
+
+	for (int id : order)
+	{
+		const Image& image = m_Images[id];
+		int paddedWidth = AlignUp(image.width + m_Padding * 2, alignment);
+		int paddedHeight = AlignUp(image.height + m_Padding * 2, alignment);
+
+		if (paddedWidth > m_PageSize || paddedHeight > m_PageSize)
+		{
+			std::cout << "Image of " << image.width << "x" << image.height << " doesn't fit in an atlas page of " << m_PageSize << "\n";
+			return false;
+		}
+
+		AtlasEntry& entry = m_Entries[id];
+		entry.layer = -1;
+
+		for (size_t page = 0; page < pages.size() && entry.layer == -1; ++page)
+		{
+			if (pages[page].Pack(paddedWidth, paddedHeight, entry.x, entry.y))
+				entry.layer = (int)page;
+		}
+
+		if (entry.layer == -1)
+		{
+			pages.push_back(SkylinePacker());
+			pages.back().Reset(m_PageSize, m_PageSize);
+			pages.back().Pack(paddedWidth, paddedHeight, entry.x, entry.y);
+			entry.layer = (int)pages.size() - 1;
+		}
+
+		entry.x += m_Padding;
+		entry.y += m_Padding;
+		entry.width = image.width;
+		entry.height = image.height;
+		entry.uvRect = glm::vec4(
+			(float)entry.x / m_PageSize, (float)entry.y / m_PageSize,
+			(float)entry.width / m_PageSize, (float)entry.height / m_PageSize);
+	}
+
+	m_Occupancy = 0.0f;
+	for (const SkylinePacker& page : pages)
+		m_Occupancy += page.GetOccupancy() / pages.size();
+
+	m_Layers.clear();
+	m_LayerCount = (int)pages.size();
+
+	for (int layer = 0; layer < m_LayerCount; ++layer)
+	{
+		std::vector<unsigned char> page((size_t)m_PageSize * m_PageSize * 4, 0);
+		for (size_t id = 0; id < m_Images.size(); ++id)
+		{
+			if (m_Entries[id].layer == layer)
+				CopyWithBorder(m_Images[id], m_Entries[id], alignment, page);
+		}
+
+		// The box filter only averages the pixels of the cell, wider filters like Kaiser would reach past the border into the next cell
+		m_Layers.push_back(GenerateMipChain(page.data(), m_PageSize, m_PageSize, MipFilter::Box, true, levelCount));
+	}
+
+	// The pages have their own copy now
+	m_Images.clear();
+	m_Packed = true;
+	return true;
+}
+
+void TextureAtlas::CopyWithBorder(const Image& image, const AtlasEntry& entry, int alignment, std::vector<unsigned char>& page) const
+{
+	// The right and bottom border also fill the space the cell was rounded up by
+	int rightPadding = AlignUp(image.width + m_Padding * 2, alignment) - image.width - m_Padding;
+	int bottomPadding = AlignUp(image.height + m_Padding * 2, alignment) - image.height - m_Padding;
+
+	// Every pixel of the border repeats the closest edge pixel, like GL_CLAMP_TO_EDGE would
+	for (int y = -m_Padding; y < image.height + bottomPadding; ++y)
+	{
+		int sourceY = std::min(std::max(y, 0), image.height - 1);
+		unsigned char* destination = &page[((size_t)(entry.y + y) * m_PageSize + entry.x - m_Padding) * 4];
+		const unsigned char* sourceRow = &image.pixels[(size_t)sourceY * image.width * 4];
+
+		for (int x = 0; x < m_Padding; ++x, destination += 4)
+			std::memcpy(destination, sourceRow, 4);
+
+		std::memcpy(destination, sourceRow, (size_t)image.width * 4);
+		destination += (size_t)image.width * 4;
+
+		for (int x = 0; x < rightPadding; ++x, destination += 4)
+			std::memcpy(destination, sourceRow + (size_t)(image.width - 1) * 4, 4);
+	}
+}
+
+void TextureAtlas::Upload()
+{
+	if (m_Layers.empty())
+		return;
+
+	if (m_Texture == 0)
+		glGenTextures(1, &m_Texture);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_Texture);
+
+	int levelCount = (int)m_Layers[0].size();
+	for (int level = 0; level < levelCount; ++level)
+	{
+		int size = std::max(1, m_PageSize >> level);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, size, size, m_LayerCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		for (int layer = 0; layer < m_LayerCount; ++layer)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, m_Layers[layer][level].data());
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	m_Layers.clear();
+}
+
+void TextureAtlas::Destroy()
+{
+	if (m_Texture != 0)
+		glDeleteTextures(1, &m_Texture);
+
+	m_Texture = 0;
+	m_Images.clear();
+	m_Entries.clear();
+	m_Layers.clear();
+	m_LayerCount = 0;
+	m_Packed = false;
+}
+
+glm::vec2 TextureAtlas::RemapUv(int id, const glm::vec2& uv) const
+{
+	const glm::vec4& rect = m_Entries[id].uvRect;
+	return glm::vec2(rect.x, rect.y) + uv * glm::vec2(rect.z, rect.w);
+}
+
+void TextureAtlas::RemapUvs(int id, float* vertices, size_t vertexCount, size_t stride, size_t uvOffset) const
+{
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		float* uv = vertices + i * stride + uvOffset;
+		glm::vec2 remapped = RemapUv(id, glm::vec2(uv[0], uv[1]));
+		uv[0] = remapped.x;
+		uv[1] = remapped.y;
+	}
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+#include "MipGenerator.h"
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Places rectangles in a page by keeping track of the skyline, the top edge of everything placed so far.
+// A new rectangle goes where it ends up lowest, on the segment that wastes the least space.
+// That's nearly as tight as maxrects for textures, and a lot simpler and faster.
+class SkylinePacker
+{
+public:
+	SkylinePacker();
+
+	void Reset(int width, int height);
+
+	// Returns false when the rectangle doesn't fit anymore
+	bool Pack(int width, int height, int& x, int& y);
+
+	// Part of the page that is covered by rectangles
+	float GetOccupancy() const;
+
+private:
+	struct Segment
+	{
+		int x;
+		int y;
+		int width;
+	};
+
+	// Height the rectangle would be placed at when its left side is at the segment, -1 if it doesn't fit there
+	int FitAt(size_t segment, int width, int height) const;
+
+	std::vector<Segment> m_Skyline;
+	int m_Width;
+	int m_Height;
+	size_t m_UsedArea;
+};
+
+struct AtlasEntry
+{
+	// Pixels of the image itself, without the padding
+	int x;
+	int y;
+	int width;
+	int height;
+	int layer;
+
+	// xy is the offset and zw the scale that take a texture coordinate of the image to the atlas
+	glm::vec4 uvRect;
+};
+
+// Packs many small images into the layers of one GL_TEXTURE_2D_ARRAY, so everything drawn with them needs a single texture bind.
+// Every image gets a border of its own edge pixels, so filtering and the smaller mip levels don't pick up the neighbouring images.
+// The border only protects a few mip levels, so the atlas stops at the level where it would be less than a pixel wide.
+// The cells are aligned to that level and the levels are built with the box filter, a wider filter would reach into the next cell.
+class TextureAtlas
+{
+public:
+	TextureAtlas();
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// Width and height of every layer
+	void SetPageSize(int size) { m_PageSize = size; }
+
+	// Width of the border around every image, a power of 2
+	void SetPadding(int padding) { m_Padding = padding; }
+
+	// Copies the RGBA8 pixels, returns the id of the entry or -1 for an empty image or after Pack
+	int Add(const unsigned char* rgba, int width, int height);
+
+	// Decodes an image file and adds it, returns -1 when it can't be loaded
+	int AddFile(const std::string& path);
+
+	// Packs the images into layers, and builds the layers with their mip levels.
+	// Doesn't touch OpenGL, so it can run on a loader thread. Returns false when an image is larger than a page.
+	// The images are freed afterwards, so it can only be called once. Destroy starts over with no images.
+	bool Pack();
+
+	// Uploads the packed layers, must be called on the thread that owns the GL context.
+	// The pixels are freed afterwards.
+	void Upload();
+
+	void Destroy();
+
+	GLuint GetTexture() const { return m_Texture; }
+	int GetLayerCount() const { return m_LayerCount; }
+	const AtlasEntry& GetEntry(int id) const { return m_Entries[id]; }
+
+	// Takes a texture coordinate of an image to its place in the atlas
+	glm::vec2 RemapUv(int id, const glm::vec2& uv) const;
+
+	// Remaps the texture coordinates of interleaved vertex data in place, so meshes with different images can be drawn in one batch.
+	// Stride and offset are counted in floats. The layer still has to come from somewhere else, like a vertex attribute or uniform.
+	void RemapUvs(int id, float* vertices, size_t vertexCount, size_t stride, size_t uvOffset) const;
+
+	// Part of all layers that is covered by images and their borders
+	float GetOccupancy() const { return m_Occupancy; }
+
+private:
+	struct Image
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> pixels;
+	};
+
+	void CopyWithBorder(const Image& image, const AtlasEntry& entry, int alignment, std::vector<unsigned char>& page) const;
+
+	std::vector<Image> m_Images;
+	std::vector<AtlasEntry> m_Entries;
+
+	// Every layer with its mip levels, until they're uploaded
+	std::vector<std::vector<std::vector<unsigned char>>> m_Layers;
+	int m_LayerCount;
+
+	int m_PageSize;
+	int m_Padding;
+	float m_Occupancy;
+	bool m_Packed;
+
+	GLuint m_Texture;
+};
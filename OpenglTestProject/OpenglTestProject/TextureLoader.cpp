@@ -0,0 +1,331 @@
+#include "TextureLoader.h"
+#include "AssetPack.h"
+
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+bool IsBlockCompressionSupported()
+{
+	return GLEW_EXT_texture_compression_s3tc != GL_FALSE;
+}
+
+GLenum GetInternalFormat(TextureFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		// Our BC1 blocks never use the 3 color mode with transparent black, so the format without alpha is enough
+		return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	case TextureFormat::BC3:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	default:
+		return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+GLuint CreateTexture(const TextureImage& image, TextureMemoryInfo* info)
+{
+	if (image.levels.empty())
+		return 0;
+
+	// The sRGB block formats come from EXT_texture_sRGB, GL_SRGB8_ALPHA8 is always there
+	bool compressed = IsBlockCompressed(image.format);
+	bool noBlocks = !IsBlockCompressionSupported();
+	bool noSrgbBlocks = image.srgb && !GLEW_EXT_texture_sRGB;
+	bool decompress = compressed && (noBlocks || noSrgbBlocks);
+	if (decompress && noBlocks)
+		std::cout << "The GPU can't sample block compressed textures (no EXT_texture_compression_s3tc), decompressing\n";
+	else if (decompress)
+		std::cout << "The GPU can't sample sRGB block compressed textures (no EXT_texture_sRGB), decompressing\n";
+
+	GLenum uncompressedFormat = GetInternalFormat(TextureFormat::RGBA8, image.srgb);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	size_t gpuBytes = 0;
+	size_t uncompressedBytes = 0;
+
+	for (size_t level = 0; level < image.levels.size(); ++level)
+	{
+		const TextureLevel& textureLevel = image.levels[level];
+		uncompressedBytes += GetTextureBytes(TextureFormat::RGBA8, textureLevel.width, textureLevel.height);
+
+		if (decompress)
+		{
+			std::vector<unsigned char> rgba = DecompressImage(textureLevel.data, textureLevel.width, textureLevel.height, image.format);
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, uncompressedFormat, textureLevel.width, textureLevel.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+			gpuBytes += rgba.size();
+		}
+		else if (compressed)
+		{
+			// The blocks go to the GPU exactly as they are stored in the file, nothing is decoded on the CPU.
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, GetInternalFormat(image.format, image.srgb), textureLevel.width, textureLevel.height, 0, (GLsizei)textureLevel.size, textureLevel.data);
+			gpuBytes += textureLevel.size;
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, (GLint)level, uncompressedFormat, textureLevel.width, textureLevel.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, textureLevel.data);
+			gpuBytes += textureLevel.size;
+		}
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// Without this the texture is incomplete when the file doesn't go all the way down to 1x1
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (info)
+	{
+		info->gpuBytes = gpuBytes;
+		info->uncompressedBytes = uncompressedBytes;
+		info->compressed = compressed && !decompress;
+	}
+
+	return texture;
+}
+
+static bool ParseTextureFile(const AssetData& file, TextureImage& image)
+{
+	return IsKtx2(file.GetData(), file.GetSize())
+		? ParseKtx2(file.GetData(), file.GetSize(), image)
+		: ParseDds(file.GetData(), file.GetSize(), image);
+}
+
+GLuint LoadTextureFile(const char* path, TextureMemoryInfo* info)
+{
+	AssetData file;
+	if (!ReadAsset(path, file))
+		return 0;
+
+	TextureImage image;
+	if (!ParseTextureFile(file, image))
+	{
+		std::cout << "Failed to load " << path << "\n";
+		return 0;
+	}
+
+	// The driver copies the levels during the upload, so the file can be unmapped when this returns.
+	return CreateTexture(image, info);
+}
+
+void PrintTextureMemory(std::ostream& stream, const char* name, const TextureMemoryInfo& info)
+{
+	double kilobytes = info.gpuBytes / 1024.0;
+	double uncompressedKilobytes = info.uncompressedBytes / 1024.0;
+	double saved = info.uncompressedBytes > 0 ? 100.0 * (1.0 - (double)info.gpuBytes / info.uncompressedBytes) : 0.0;
+
+	std::ios::fmtflags flags = stream.flags();
+	stream << std::fixed << std::setprecision(1);
+	stream << name << ": " << kilobytes << " KB instead of " << uncompressedKilobytes << " KB, saved " << saved << "%"
+		<< (info.compressed ? "" : " (uncompressed)") << "\n";
+	stream.flags(flags);
+}
+
+DecodedImage DecodeImage(const std::string& path, MipFilter filter, TextureFormat format, int maxLevels)
+{
+	DecodedImage image;
+
+	AssetData file;
+	if (!ReadAsset(path, file))
+		return image;
+
+	// Hashing the file costs a fraction of decoding it
+	const ImageCache* cache = GetImageCache();
+	unsigned long long key = 0;
+	if (cache)
+	{
+		key = MakeImageCacheKey(file.GetData(), file.GetSize(), filter, format, maxLevels);
+		if (cache->Load(key, image))
+			return image;
+	}
+
+	if (!DecodeImageFile(file.GetData(), file.GetSize(), filter, format, maxLevels, image))
+		return DecodedImage();
+
+	if (cache)
+		cache->Store(key, path, filter, maxLevels, image);
+
+	return image;
+}
+
+// Points at the levels of the image starting at firstLevel, nothing is copied
+static TextureImage GetLevels(const DecodedImage& image, int firstLevel)
+{
+	TextureImage view;
+	view.format = image.format;
+	view.width = std::max(1, image.width >> firstLevel);
+	view.height = std::max(1, image.height >> firstLevel);
+	view.srgb = image.srgb;
+
+	for (size_t level = firstLevel; level < image.levels.size(); ++level)
+	{
+		TextureLevel textureLevel;
+		textureLevel.width = std::max(1, image.width >> level);
+		textureLevel.height = std::max(1, image.height >> level);
+		textureLevel.data = image.levels[level].data();
+		textureLevel.size = image.levels[level].size();
+		view.levels.push_back(textureLevel);
+	}
+
+	return view;
+}
+
+GLuint CreateTexture(const DecodedImage& image, TextureMemoryInfo* info)
+{
+	return CreateTexture(GetLevels(image, 0), info);
+}
+
+static bool IsPrebuiltPath(const std::string& path)
+{
+	std::string::size_type dot = path.rfind('.');
+	if (dot == std::string::npos)
+		return false;
+
+	std::string extension = path.substr(dot);
+	return extension == ".dds" || extension == ".ktx2";
+}
+
+TextureLoadRequest::TextureLoadRequest()
+	: m_Filter(MipFilter::Kaiser)
+	, m_FirstLevel(0)
+	, m_Prebuilt(false)
+	, m_Pending(false)
+	, m_Format(TextureFormat::RGBA8)
+	, m_Width(0)
+	, m_Height(0)
+	, m_LevelCount(0)
+{
+}
+
+void TextureLoadRequest::Start(const std::string& path, MipFilter filter, int firstLevel)
+{
+	// Another image, or the same one with another filter, has another size and other levels
+	if (path != m_Path || filter != m_Filter)
+		Forget();
+
+	m_Path = path;
+	m_Filter = filter;
+	m_FirstLevel = firstLevel;
+	m_Prebuilt = IsPrebuiltPath(path);
+	m_Pending = true;
+
+	if (m_LevelCount == 0)
+		ReadHeader();
+
+	if (!m_Prebuilt && !m_Decoded.valid())
+		m_Decoded = std::async(std::launch::async, [path, filter]() { return DecodeImage(path, filter); });
+}
+
+void TextureLoadRequest::ReadHeader()
+{
+	// The file is only mapped, parsing it or asking stb_image for the size doesn't touch the pixels
+	AssetData file;
+	if (!ReadAsset(m_Path, file))
+		return;
+
+	if (m_Prebuilt)
+	{
+		TextureImage image;
+		if (!ParseTextureFile(file, image))
+			return;
+
+		m_Format = image.format;
+		m_Width = image.width;
+		m_Height = image.height;
+		m_LevelCount = (int)image.levels.size();
+		return;
+	}
+
+	int width, height, channels;
+	if (!stbi_info_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &channels))
+		return;
+
+	// DecodeImage makes the whole chain in RGBA8
+	m_Format = TextureFormat::RGBA8;
+	m_Width = width;
+	m_Height = height;
+	m_LevelCount = GetMipLevelCount(width, height);
+}
+
+void TextureLoadRequest::Start(const std::string& prebuiltPath, const std::string& imagePath, MipFilter filter)
+{
+	if (AssetExists(prebuiltPath))
+		Start(prebuiltPath, filter);
+	else
+		Start(imagePath, filter);
+}
+
+void TextureLoadRequest::Forget()
+{
+	if (m_Decoded.valid())
+		m_Decoded.wait();
+
+	m_Decoded = std::future<DecodedImage>();
+	m_Pending = false;
+
+	// The file may have another size when it's read again
+	m_LevelCount = 0;
+}
+
+bool TextureLoadRequest::IsReady() const
+{
+	return !m_Decoded.valid() || m_Decoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+GLuint TextureLoadRequest::Finish(TextureMemoryInfo* info)
+{
+	GLuint texture = 0;
+	m_Pending = false;
+
+	if (m_Prebuilt)
+	{
+		AssetData file;
+		TextureImage image;
+		if (ReadAsset(m_Path, file) && ParseTextureFile(file, image))
+		{
+			m_Format = image.format;
+			m_Width = image.width;
+			m_Height = image.height;
+			m_LevelCount = (int)image.levels.size();
+
+			// The levels above the first one stay in the mapping, the driver only copies the ones that are uploaded
+			if (m_FirstLevel < m_LevelCount)
+			{
+				image.levels.erase(image.levels.begin(), image.levels.begin() + m_FirstLevel);
+				image.width = image.levels[0].width;
+				image.height = image.levels[0].height;
+				texture = CreateTexture(image, info);
+			}
+		}
+	}
+	else if (m_Decoded.valid())
+	{
+		// The levels are freed when this returns, the driver has its own copy of the ones that were uploaded
+		DecodedImage image = m_Decoded.get();
+		if (!image.levels.empty())
+		{
+			m_Format = image.format;
+			m_Width = image.width;
+			m_Height = image.height;
+			m_LevelCount = (int)image.levels.size();
+
+			if (m_FirstLevel < m_LevelCount)
+				texture = CreateTexture(GetLevels(image, m_FirstLevel), info);
+		}
+	}
+
+	if (texture == 0)
+		std::cout << "Failed to load " << m_Path << "\n";
+
+	return texture;
+}
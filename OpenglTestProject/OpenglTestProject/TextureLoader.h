@@ -0,0 +1,110 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include "DdsFile.h"
+#include "KtxFile.h"
+#include "MipGenerator.h"
+#include "ImageCache.h"
+
+#include <iosfwd>
+#include <string>
+#include <future>
+
+struct TextureMemoryInfo
+{
+	// Memory the texture takes on the GPU, with all of its levels
+	size_t gpuBytes;
+
+	// Memory the same levels would take as RGBA8, drivers pad RGB8 to 4 bytes as well
+	size_t uncompressedBytes;
+
+	// False when the file was compressed but the GPU couldn't sample it, so it was decompressed while loading
+	bool compressed;
+
+	TextureMemoryInfo() : gpuBytes(0), uncompressedBytes(0), compressed(false) {}
+};
+
+// Whether the GPU can sample the BC1 and BC3 formats, almost every desktop GPU can
+bool IsBlockCompressionSupported();
+
+// The sRGB formats make the GPU decode the colors to linear when they're sampled
+GLenum GetInternalFormat(TextureFormat format, bool srgb = false);
+
+// Creates a texture from levels that are already in their GPU format, block compressed levels are uploaded as they are
+// with glCompressedTexImage2D. When the GPU doesn't support the format they're decompressed to RGBA8 first.
+GLuint CreateTexture(const TextureImage& image, TextureMemoryInfo* info = nullptr);
+
+// Loads a DDS or KTX2 file with all of its levels, returns 0 when it can't be loaded.
+// The file is memory mapped and every level is handed to OpenGL straight from the mapping,
+// nothing is decoded or copied into a buffer of our own.
+GLuint LoadTextureFile(const char* path, TextureMemoryInfo* info = nullptr);
+
+void PrintTextureMemory(std::ostream& stream, const char* name, const TextureMemoryInfo& info);
+
+// Decodes an image and builds its mip chain, see DecodeImageFile. Doesn't touch OpenGL, so it can run on any thread.
+// With an image cache set the result is stored in it, and the next time the same file is loaded with the same parameters
+// it's read from the cache instead of decoded.
+// Returns an image without levels when the file can't be read.
+DecodedImage DecodeImage(const std::string& path, MipFilter filter, TextureFormat format = TextureFormat::RGBA8, int maxLevels = 0);
+
+GLuint CreateTexture(const DecodedImage& image, TextureMemoryInfo* info = nullptr);
+
+// Loads a texture in 2 halves: Start kicks off the CPU work on a loader thread, Finish uploads it on the thread that owns the GL context.
+// Prebuilt DDS and KTX2 files already have their mip chain, they're only memory mapped and uploaded in Finish.
+// Other images are decoded and get their mipmaps on the loader thread, so the render thread never decodes or filters anything.
+// Nothing is kept after Finish. Starting the image again with another first level decodes it again,
+// which is only a read of the image cache when one is set.
+class TextureLoadRequest
+{
+public:
+	TextureLoadRequest();
+
+	TextureLoadRequest(const TextureLoadRequest&) = delete;
+	TextureLoadRequest& operator=(const TextureLoadRequest&) = delete;
+
+	TextureLoadRequest(TextureLoadRequest&&) = default;
+	TextureLoadRequest& operator=(TextureLoadRequest&&) = default;
+
+	// Loads the levels starting at firstLevel, a texture streamed back in with fewer levels starts further down
+	void Start(const std::string& path, MipFilter filter = MipFilter::Kaiser, int firstLevel = 0);
+
+	// Uses the prebuilt file when it exists, the image otherwise
+	void Start(const std::string& prebuiltPath, const std::string& imagePath, MipFilter filter = MipFilter::Kaiser);
+
+	// Drops whatever is still loading and the size read from the header, the next Start reads the file again.
+	// Waits for the loader thread if it isn't done yet.
+	void Forget();
+
+	// Started and not finished yet
+	bool IsPending() const { return m_Pending; }
+
+	// Finish won't have to wait for the loader thread
+	bool IsReady() const;
+
+	// Waits for the loader thread if it isn't done yet, returns 0 when the texture couldn't be loaded.
+	GLuint Finish(TextureMemoryInfo* info = nullptr);
+
+	// The whole texture, from its first level. Start reads them from the header of the file, so they're known before it's loaded.
+	// No levels when the header couldn't be read.
+	TextureFormat GetFormat() const { return m_Format; }
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+	int GetLevelCount() const { return m_LevelCount; }
+
+private:
+	void ReadHeader();
+
+	std::string m_Path;
+	MipFilter m_Filter;
+	int m_FirstLevel;
+	bool m_Prebuilt;
+	bool m_Pending;
+
+	std::future<DecodedImage> m_Decoded;
+
+	TextureFormat m_Format;
+	int m_Width;
+	int m_Height;
+	int m_LevelCount;
+};
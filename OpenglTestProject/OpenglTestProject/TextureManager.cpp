@@ -0,0 +1,307 @@
+#include "TextureManager.h"
+#include "AssetPack.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+TextureManager::TextureManager()
+	: m_Budget(0)
+	, m_ResidentBytes(0)
+	, m_ProjectedBytes(0)
+	, m_Frame(0)
+	, m_EvictionCount(0)
+	, m_DroppedLevelCount(0)
+	, m_Placeholder(0)
+{
+}
+
+TextureManager::~TextureManager()
+{
+	Destroy();
+}
+
+void TextureManager::Create(size_t budgetBytes)
+{
+	m_Budget = budgetBytes;
+
+	// Grey, so a texture that is still loading doesn't stand out as much
+	unsigned char grey[4] = { 128, 128, 128, 255 };
+	glGenTextures(1, &m_Placeholder);
+	glBindTexture(GL_TEXTURE_2D, m_Placeholder);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void TextureManager::Destroy()
+{
+	for (ManagedTexture& texture : m_Textures)
+	{
+		// The loader thread may still be working on it
+		texture.request.Forget();
+
+		if (texture.texture != 0)
+			glDeleteTextures(1, &texture.texture);
+	}
+
+	m_Textures.clear();
+	m_ResidentBytes = 0;
+	m_ProjectedBytes = 0;
+
+	if (m_Placeholder != 0)
+		glDeleteTextures(1, &m_Placeholder);
+	m_Placeholder = 0;
+}
+
+int TextureManager::Load(const std::string& path, MipFilter filter)
+{
+	ManagedTexture texture;
+	texture.path = path;
+	texture.filter = filter;
+	texture.texture = 0;
+	texture.gpuBytes = 0;
+	texture.firstLevel = -1;
+	texture.format = TextureFormat::RGBA8;
+	texture.width = 0;
+	texture.height = 0;
+	texture.levelCount = 0;
+	texture.requestedLevel = -1;
+	texture.failed = false;
+	texture.reloadQueued = false;
+	texture.lastUsedFrame = m_Frame;
+	texture.projectedBytes = 0;
+
+	m_Textures.push_back(std::move(texture));
+	Request(m_Textures.back(), 0);
+
+	return (int)m_Textures.size() - 1;
+}
+
+int TextureManager::Load(const std::string& prebuiltPath, const std::string& imagePath, MipFilter filter)
+{
+	if (AssetExists(prebuiltPath))
+		return Load(prebuiltPath, filter);
+
+	return Load(imagePath, filter);
+}
+
+void TextureManager::Request(ManagedTexture& texture, int firstLevel)
+{
+	texture.requestedLevel = firstLevel;
+	texture.request.Start(texture.path, texture.filter, firstLevel);
+
+	// The header tells how big the texture is before it's loaded, so its first load counts against the budget as well
+	if (texture.levelCount == 0)
+	{
+		texture.format = texture.request.GetFormat();
+		texture.width = texture.request.GetWidth();
+		texture.height = texture.request.GetHeight();
+		texture.levelCount = texture.request.GetLevelCount();
+	}
+
+	UpdateProjectedBytes(texture);
+}
+
+void TextureManager::Evict(ManagedTexture& texture)
+{
+	glDeleteTextures(1, &texture.texture);
+	m_ResidentBytes -= texture.gpuBytes;
+
+	texture.texture = 0;
+	texture.gpuBytes = 0;
+	texture.firstLevel = -1;
+	UpdateProjectedBytes(texture);
+}
+
+size_t TextureManager::EstimateBytes(const ManagedTexture& texture, int firstLevel) const
+{
+	// Nothing is known about the texture when its header couldn't be read
+	if (texture.levelCount == 0)
+		return texture.gpuBytes;
+
+	size_t bytes = 0;
+	for (int level = firstLevel; level < texture.levelCount; ++level)
+		bytes += GetTextureBytes(texture.format, std::max(1, texture.width >> level), std::max(1, texture.height >> level));
+
+	return bytes;
+}
+
+void TextureManager::UpdateProjectedBytes(ManagedTexture& texture)
+{
+	m_ProjectedBytes -= texture.projectedBytes;
+	texture.projectedBytes = texture.requestedLevel != -1 ? EstimateBytes(texture, texture.requestedLevel) : texture.gpuBytes;
+	m_ProjectedBytes += texture.projectedBytes;
+}
+
+bool TextureManager::Reload(const std::string& path)
+{
+	bool found = false;
+	for (ManagedTexture& texture : m_Textures)
+	{
+		if (texture.path != path)
+			continue;
+
+		found = true;
+		if (texture.request.IsPending())
+		{
+			texture.reloadQueued = true;
+			continue;
+		}
+
+		// The new version can have another size, so it's loaded whole like the first time.
+		// If that's too big for the budget EndFrame drops its top levels again.
+		texture.request.Forget();
+		texture.levelCount = 0;
+		texture.failed = false;
+		Request(texture, 0);
+	}
+
+	return found;
+}
+
+GLuint TextureManager::Use(int handle)
+{
+	ManagedTexture& texture = m_Textures[handle];
+	texture.lastUsedFrame = m_Frame;
+
+	if (!texture.failed && !texture.request.IsPending() && texture.firstLevel != 0 && texture.levelCount != 0)
+	{
+		// Go up as many levels as fit in the budget next to everything else
+		int current = texture.firstLevel == -1 ? texture.levelCount : texture.firstLevel;
+		size_t otherBytes = m_ProjectedBytes - texture.projectedBytes;
+
+		int level = current;
+		while (level > 0 && otherBytes + EstimateBytes(texture, level - 1) <= m_Budget)
+			--level;
+
+		// A texture that is used needs at least its smallest level, the other textures make room for it at the end of the frame
+		if (level == texture.levelCount)
+			level = texture.levelCount - 1;
+
+		if (level < current)
+			Request(texture, level);
+	}
+
+	return texture.texture != 0 ? texture.texture : m_Placeholder;
+}
+
+void TextureManager::BeginFrame()
+{
+	for (ManagedTexture& texture : m_Textures)
+	{
+		if (!texture.request.IsPending() || !texture.request.IsReady())
+			continue;
+
+		int level = texture.requestedLevel;
+		texture.requestedLevel = -1;
+
+		if (texture.reloadQueued)
+		{
+			texture.reloadQueued = false;
+			texture.request.Forget();
+			texture.levelCount = 0;
+			texture.failed = false;
+			Request(texture, 0);
+			continue;
+		}
+
+		TextureMemoryInfo info;
+		GLuint created = texture.request.Finish(&info);
+		if (created == 0)
+		{
+			texture.failed = true;
+			UpdateProjectedBytes(texture);
+			continue;
+		}
+
+		// The first load is always the whole texture, it's only unknown here when the header couldn't be read before
+		if (texture.levelCount == 0)
+		{
+			texture.format = texture.request.GetFormat();
+			texture.width = texture.request.GetWidth();
+			texture.height = texture.request.GetHeight();
+			texture.levelCount = texture.request.GetLevelCount();
+		}
+
+		// The old texture was drawn with until now, a texture can't lose or gain levels in place
+		if (texture.texture != 0)
+			Evict(texture);
+
+		texture.texture = created;
+		texture.gpuBytes = info.gpuBytes;
+		texture.firstLevel = level;
+		m_ResidentBytes += info.gpuBytes;
+		UpdateProjectedBytes(texture);
+	}
+}
+
+void TextureManager::EndFrame()
+{
+	while (m_ProjectedBytes > m_Budget)
+	{
+		// Textures that weren't used this frame go first, the one that was used the longest time ago
+		ManagedTexture* victim = nullptr;
+		for (ManagedTexture& texture : m_Textures)
+		{
+			if (texture.texture == 0 || texture.request.IsPending() || texture.lastUsedFrame == m_Frame)
+				continue;
+
+			if (!victim || texture.lastUsedFrame < victim->lastUsedFrame)
+				victim = &texture;
+		}
+
+		if (victim)
+		{
+			Evict(*victim);
+			++m_EvictionCount;
+			continue;
+		}
+
+		// Everything is in use, so the biggest texture loses as many top levels as it takes to fit.
+		// It's loaded again without those levels, the old one stays until then.
+		for (ManagedTexture& texture : m_Textures)
+		{
+			if (texture.texture == 0 || texture.request.IsPending() || texture.firstLevel >= texture.levelCount - 1)
+				continue;
+
+			if (!victim || texture.gpuBytes > victim->gpuBytes)
+				victim = &texture;
+		}
+
+		if (!victim)
+			break;
+
+		size_t otherBytes = m_ProjectedBytes - victim->projectedBytes;
+		int level = victim->firstLevel + 1;
+		while (level < victim->levelCount - 1 && otherBytes + EstimateBytes(*victim, level) > m_Budget)
+			++level;
+
+		m_DroppedLevelCount += level - victim->firstLevel;
+		Request(*victim, level);
+	}
+
+	++m_Frame;
+}
+
+void TextureManager::PrintReport(std::ostream& stream) const
+{
+	std::ios::fmtflags flags = stream.flags();
+	stream << std::fixed << std::setprecision(1);
+
+	stream << "Textures: " << m_ResidentBytes / 1024.0 << " KB of " << m_Budget / 1024.0 << " KB, "
+		<< m_EvictionCount << " evicted, " << m_DroppedLevelCount << " levels dropped\n";
+
+	for (const ManagedTexture& texture : m_Textures)
+	{
+		stream << "  " << texture.path << ": ";
+		if (texture.firstLevel == -1)
+			stream << "not resident";
+		else
+			stream << std::max(1, texture.width >> texture.firstLevel) << "x" << std::max(1, texture.height >> texture.firstLevel)
+				<< " from level " << texture.firstLevel << ", " << texture.gpuBytes / 1024.0 << " KB";
+		stream << "\n";
+	}
+
+	stream.flags(flags);
+}
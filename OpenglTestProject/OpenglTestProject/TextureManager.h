@@ -0,0 +1,117 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include "TextureLoader.h"
+
+#include <vector>
+#include <string>
+#include <iosfwd>
+#include <cstddef>
+
+// Keeps the textures of a scene within a budget of GPU memory.
+// Every texture is loaded on a loader thread and the manager knows how many bytes each one takes with all of its levels.
+// Nothing but the GPU copy is kept, so the budget covers all the memory the textures take. Streaming an image back in
+// decodes it again, from the image cache when one is set.
+// When the textures don't fit anymore, the ones that weren't used for the longest time are deleted first.
+// When everything is in use, the biggest texture loses its top mip level, which is 3/4 of its memory.
+// Deleted and shrunk textures are streamed back in when they're used again and there's room for them.
+class TextureManager
+{
+public:
+	TextureManager();
+	~TextureManager();
+
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+
+	void Create(size_t budgetBytes);
+	void Destroy();
+
+	void SetBudget(size_t budgetBytes) { m_Budget = budgetBytes; }
+	size_t GetBudget() const { return m_Budget; }
+
+	// Registers a texture and starts loading it, returns the handle to use it with
+	int Load(const std::string& path, MipFilter filter = MipFilter::Kaiser);
+
+	// Uses the prebuilt file when it exists, the image otherwise
+	int Load(const std::string& prebuiltPath, const std::string& imagePath, MipFilter filter = MipFilter::Kaiser);
+
+	// Returns the texture to bind and marks it as used this frame.
+	// Until the texture is loaded this is a 1x1 placeholder.
+	GLuint Use(int handle);
+
+	// Loads every texture that comes from the file again, e.g. after it was edited. Returns false when none does.
+	// The texture keeps being drawn with until the new version is uploaded in BeginFrame.
+	bool Reload(const std::string& path);
+
+	const std::string& GetPath(int handle) const { return m_Textures[handle].path; }
+
+	// Uploads the textures that are done loading, call it before anything is drawn
+	void BeginFrame();
+
+	// Deletes and shrinks textures until they fit in the budget again
+	void EndFrame();
+
+	// First level that is on the GPU, -1 when the texture isn't there at all
+	int GetFirstLevel(int handle) const { return m_Textures[handle].firstLevel; }
+
+	size_t GetResidentBytes() const { return m_ResidentBytes; }
+	int GetEvictionCount() const { return m_EvictionCount; }
+	int GetDroppedLevelCount() const { return m_DroppedLevelCount; }
+
+	void PrintReport(std::ostream& stream) const;
+
+private:
+	struct ManagedTexture
+	{
+		std::string path;
+		MipFilter filter;
+
+		GLuint texture;
+		size_t gpuBytes;
+		int firstLevel;
+
+		// Known once the whole texture has been loaded the first time
+		TextureFormat format;
+		int width;
+		int height;
+		int levelCount;
+
+		// Level that is loading, -1 when nothing is
+		int requestedLevel;
+		TextureLoadRequest request;
+		bool failed;
+
+		// The file changed while it was being loaded, what's loading may be the old version
+		bool reloadQueued;
+
+		unsigned int lastUsedFrame;
+
+		// What the texture adds to m_ProjectedBytes
+		size_t projectedBytes;
+	};
+
+	void Request(ManagedTexture& texture, int firstLevel);
+	void Evict(ManagedTexture& texture);
+
+	// What the texture will take once the levels starting at firstLevel are loaded
+	size_t EstimateBytes(const ManagedTexture& texture, int firstLevel) const;
+
+	// Call after the levels or the size of a texture changed, keeps m_ProjectedBytes up to date
+	void UpdateProjectedBytes(ManagedTexture& texture);
+
+	std::vector<ManagedTexture> m_Textures;
+
+	size_t m_Budget;
+	size_t m_ResidentBytes;
+
+	// Memory the textures take once every pending load is done
+	size_t m_ProjectedBytes;
+	unsigned int m_Frame;
+
+	int m_EvictionCount;
+	int m_DroppedLevelCount;
+
+	GLuint m_Placeholder;
+};
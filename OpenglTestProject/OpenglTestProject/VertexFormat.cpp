@@ -0,0 +1,72 @@
+#include "VertexFormat.h"
+
+static unsigned int AlignUp(unsigned int value, unsigned int alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static bool IsPacked(VertexAttributeType type)
+{
+	return type == VertexAttributeType::Int2101010 || type == VertexAttributeType::UnsignedInt2101010;
+}
+
+unsigned int GetVertexAttributeBytes(VertexAttributeType type, int components)
+{
+	switch (type)
+	{
+	case VertexAttributeType::Float:
+		return 4 * components;
+	case VertexAttributeType::HalfFloat:
+	case VertexAttributeType::Short:
+		return 2 * components;
+	case VertexAttributeType::UnsignedByte:
+		return components;
+	default:
+		return 4;
+	}
+}
+
+bool IsVertexAttributeNormalized(VertexAttributeType type)
+{
+	return type != VertexAttributeType::Float && type != VertexAttributeType::HalfFloat;
+}
+
+VertexFormat& VertexFormat::Add(const std::string& name, VertexAttributeType type, int components)
+{
+	VertexAttribute attribute;
+	attribute.name = name;
+	attribute.type = type;
+	attribute.components = IsPacked(type) ? 4 : components;
+	attribute.offset = AlignUp(m_Stride, 4);
+
+	m_Attributes.push_back(attribute);
+	m_Stride = AlignUp(attribute.offset + GetVertexAttributeBytes(type, attribute.components), 4);
+	return *this;
+}
+
+const VertexAttribute* VertexFormat::Find(const std::string& name) const
+{
+	for (const VertexAttribute& attribute : m_Attributes)
+	{
+		if (attribute.name == name)
+			return &attribute;
+	}
+
+	return nullptr;
+}
+
+bool VertexFormat::operator==(const VertexFormat& other) const
+{
+	if (m_Stride != other.m_Stride || m_Attributes.size() != other.m_Attributes.size())
+		return false;
+
+	for (size_t i = 0; i < m_Attributes.size(); ++i)
+	{
+		const VertexAttribute& a = m_Attributes[i];
+		const VertexAttribute& b = other.m_Attributes[i];
+		if (a.name != b.name || a.type != b.type || a.components != b.components || a.offset != b.offset)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// How the components of a vertex attribute are stored. Everything but Float and HalfFloat is normalized,
+// so the vertex shader gets floats in 0 to 1 or -1 to 1 either way.
+enum class VertexAttributeType : unsigned int
+{
+	Float,
+	HalfFloat,
+
+	// -1 to 1 in 16 bits
+	Short,
+
+	// 0 to 1 in 8 bits
+	UnsignedByte,
+
+	// x, y and z in 10 bits and w in 2 bits of one 32 bit word, always 4 components.
+	// The signed one is -1 to 1 and made for normals, the unsigned one is 0 to 1 and made for colors.
+	Int2101010,
+	UnsignedInt2101010,
+};
+
+// Bytes that count components of a type take
+unsigned int GetVertexAttributeBytes(VertexAttributeType type, int components);
+
+// Whether the vertex shader gets the values mapped to 0 to 1 or -1 to 1
+bool IsVertexAttributeNormalized(VertexAttributeType type);
+
+struct VertexAttribute
+{
+	// Name of the input of the vertex shader
+	std::string name;
+	VertexAttributeType type;
+	int components;
+	unsigned int offset;
+};
+
+// The layout of interleaved vertices, one attribute after the other. Specifying the attributes of a program from it
+// is SpecifyVertexFormat or VertexArrayCache in VertexLayout.h, so the layout is written down in one place instead of in every glVertexAttribPointer call.
+class VertexFormat
+{
+public:
+	VertexFormat() : m_Stride(0) {}
+
+	// Appends an attribute, it starts at a multiple of 4 bytes so every attribute is aligned the way GPUs want it
+	VertexFormat& Add(const std::string& name, VertexAttributeType type, int components);
+
+	const std::vector<VertexAttribute>& GetAttributes() const { return m_Attributes; }
+	unsigned int GetStride() const { return m_Stride; }
+
+	// nullptr when the format doesn't have it
+	const VertexAttribute* Find(const std::string& name) const;
+
+	bool operator==(const VertexFormat& other) const;
+
+private:
+	std::vector<VertexAttribute> m_Attributes;
+	unsigned int m_Stride;
+};
@@ -0,0 +1,151 @@
+#include "VertexLayout.h"
+
+GLenum GetVertexAttributeGLType(VertexAttributeType type)
+{
+	switch (type)
+	{
+	case VertexAttributeType::HalfFloat:
+		return GL_HALF_FLOAT;
+	case VertexAttributeType::Short:
+		return GL_SHORT;
+	case VertexAttributeType::UnsignedByte:
+		return GL_UNSIGNED_BYTE;
+	case VertexAttributeType::Int2101010:
+		return GL_INT_2_10_10_10_REV;
+	case VertexAttributeType::UnsignedInt2101010:
+		return GL_UNSIGNED_INT_2_10_10_10_REV;
+	default:
+		return GL_FLOAT;
+	}
+}
+
+void SpecifyVertexFormat(GLuint program, const VertexFormat& format)
+{
+	for (const VertexAttribute& attribute : format.GetAttributes())
+	{
+		GLint location = glGetAttribLocation(program, attribute.name.c_str());
+		if (location == -1)
+			continue;
+
+		glVertexAttribPointer(location, attribute.components, GetVertexAttributeGLType(attribute.type), IsVertexAttributeNormalized(attribute.type),
+			format.GetStride(), (void*)(size_t)attribute.offset);
+		glEnableVertexAttribArray(location);
+	}
+}
+
+VertexArrayCache::VertexArrayCache()
+{
+}
+
+VertexArrayCache::~VertexArrayCache()
+{
+	Destroy();
+}
+
+int VertexArrayCache::Get(GLuint program, const VertexFormat& format)
+{
+	std::vector<GLint> locations;
+	for (const VertexAttribute& attribute : format.GetAttributes())
+		locations.push_back(glGetAttribLocation(program, attribute.name.c_str()));
+
+	// Inputs the format doesn't have keep the constant value, which belongs to the context and not to a vertex array
+	GLint inputCount = 0;
+	glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &inputCount);
+	for (GLint input = 0; input < inputCount; ++input)
+	{
+		GLchar name[64];
+		GLint size;
+		GLenum type;
+		glGetActiveAttrib(program, input, sizeof(name), nullptr, &size, &type, name);
+
+		GLint location = glGetAttribLocation(program, name);
+		if (location != -1 && !format.Find(name))
+			glVertexAttrib4f(location, 1.0f, 1.0f, 1.0f, 1.0f);
+	}
+
+	for (size_t i = 0; i < m_VertexArrays.size(); ++i)
+	{
+		if (m_VertexArrays[i].format == format && m_VertexArrays[i].locations == locations)
+			return (int)i;
+	}
+
+	CachedVertexArray vertexArray;
+	vertexArray.format = format;
+	vertexArray.locations = locations;
+	vertexArray.vertexBuffer = 0;
+	vertexArray.indexBuffer = 0;
+
+	glGenVertexArrays(1, &vertexArray.vao);
+	glBindVertexArray(vertexArray.vao);
+
+	// With attribute bindings the format is set once and only the buffer of binding 0 changes
+	if (GLEW_ARB_vertex_attrib_binding)
+	{
+		const std::vector<VertexAttribute>& attributes = format.GetAttributes();
+		for (size_t i = 0; i < attributes.size(); ++i)
+		{
+			if (locations[i] == -1)
+				continue;
+
+			glVertexAttribFormat(locations[i], attributes[i].components, GetVertexAttributeGLType(attributes[i].type),
+				IsVertexAttributeNormalized(attributes[i].type), attributes[i].offset);
+			glVertexAttribBinding(locations[i], 0);
+			glEnableVertexAttribArray(locations[i]);
+		}
+	}
+
+	m_VertexArrays.push_back(vertexArray);
+	return (int)m_VertexArrays.size() - 1;
+}
+
+void VertexArrayCache::PointAttributes(const CachedVertexArray& vertexArray) const
+{
+	const std::vector<VertexAttribute>& attributes = vertexArray.format.GetAttributes();
+	for (size_t i = 0; i < attributes.size(); ++i)
+	{
+		GLint location = vertexArray.locations[i];
+		if (location == -1)
+			continue;
+
+		glVertexAttribPointer(location, attributes[i].components, GetVertexAttributeGLType(attributes[i].type),
+			IsVertexAttributeNormalized(attributes[i].type), vertexArray.format.GetStride(), (void*)(size_t)attributes[i].offset);
+		glEnableVertexAttribArray(location);
+	}
+}
+
+void VertexArrayCache::Bind(int vertexArray, GLuint vertexBuffer, GLuint indexBuffer)
+{
+	CachedVertexArray& cached = m_VertexArrays[vertexArray];
+	glBindVertexArray(cached.vao);
+
+	if (cached.vertexBuffer != vertexBuffer)
+	{
+		if (GLEW_ARB_vertex_attrib_binding)
+		{
+			glBindVertexBuffer(0, vertexBuffer, 0, cached.format.GetStride());
+		}
+		else
+		{
+			// The attribute pointers take the array buffer that is bound when they are set
+			glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+			PointAttributes(cached);
+		}
+
+		cached.vertexBuffer = vertexBuffer;
+	}
+
+	// The element buffer binding is part of the vertex array
+	if (cached.indexBuffer != indexBuffer)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		cached.indexBuffer = indexBuffer;
+	}
+}
+
+void VertexArrayCache::Destroy()
+{
+	for (CachedVertexArray& vertexArray : m_VertexArrays)
+		glDeleteVertexArrays(1, &vertexArray.vao);
+
+	m_VertexArrays.clear();
+}
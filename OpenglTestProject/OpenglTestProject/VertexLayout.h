@@ -0,0 +1,150 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include "VertexFormat.h"
+
+#include <utility>
+#include <vector>
+
+GLenum GetVertexAttributeGLType(VertexAttributeType type);
+
+// Points the inputs of the program at the array buffer that is bound, for the vertex array that is bound.
+// Inputs the format doesn't have are left alone.
+void SpecifyVertexFormat(GLuint program, const VertexFormat& format);
+
+// How a C++ type of a vertex layout is read by the vertex shader
+template<typename T> struct VertexInputType;
+
+template<> struct VertexInputType<float> { static constexpr int components = 1; static constexpr VertexAttributeType type = VertexAttributeType::Float; };
+template<> struct VertexInputType<glm::vec2> { static constexpr int components = 2; static constexpr VertexAttributeType type = VertexAttributeType::Float; };
+template<> struct VertexInputType<glm::vec3> { static constexpr int components = 3; static constexpr VertexAttributeType type = VertexAttributeType::Float; };
+template<> struct VertexInputType<glm::vec4> { static constexpr int components = 4; static constexpr VertexAttributeType type = VertexAttributeType::Float; };
+template<> struct VertexInputType<glm::i16vec2> { static constexpr int components = 2; static constexpr VertexAttributeType type = VertexAttributeType::Short; };
+template<> struct VertexInputType<glm::i16vec3> { static constexpr int components = 3; static constexpr VertexAttributeType type = VertexAttributeType::Short; };
+template<> struct VertexInputType<glm::i16vec4> { static constexpr int components = 4; static constexpr VertexAttributeType type = VertexAttributeType::Short; };
+template<> struct VertexInputType<glm::u8vec4> { static constexpr int components = 4; static constexpr VertexAttributeType type = VertexAttributeType::UnsignedByte; };
+
+// Template arguments can't be strings in C++14, so the name of a shader input is a type with a Name function.
+// These are the inputs of the scene shaders and of MakeMeshVertexFormat.
+struct PositionName { static const char* Name() { return "position"; } };
+struct ColorName { static const char* Name() { return "color"; } };
+struct TexcoordName { static const char* Name() { return "texcoord"; } };
+struct NormalName { static const char* Name() { return "normal"; } };
+
+// One input of a vertex layout, like VertexInput<PositionName, glm::vec3>
+template<typename NameType, typename T>
+struct VertexInput
+{
+	typedef NameType Name;
+	static constexpr int components = VertexInputType<T>::components;
+	static constexpr VertexAttributeType type = VertexInputType<T>::type;
+	static constexpr unsigned int bytes = sizeof(T);
+};
+
+// Offset of the input at index, every input starts at a multiple of 4 bytes like in VertexFormat::Add.
+// The index after the last input gives the stride.
+template<typename... Inputs>
+constexpr unsigned int GetVertexLayoutOffset(unsigned int index)
+{
+	const unsigned int bytes[] = { Inputs::bytes..., 0u };
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < index; ++i)
+		offset = (offset + bytes[i] + 3) / 4 * 4;
+
+	return offset;
+}
+
+// Interleaved vertices whose layout is known when compiling, the stride and offsets are constants instead of
+// sizeof(float) sums typed into every glVertexAttribPointer call:
+//
+//   typedef VertexLayout<VertexInput<PositionName, glm::vec3>, VertexInput<TexcoordName, glm::vec2>> Layout;
+//   static_assert(Layout::stride == 5 * sizeof(float), "");
+//   Layout::Specify(program);
+template<typename... Inputs>
+class VertexLayout
+{
+public:
+	static constexpr unsigned int count = sizeof...(Inputs);
+	static constexpr unsigned int stride = GetVertexLayoutOffset<Inputs...>(sizeof...(Inputs));
+
+	template<unsigned int index>
+	static constexpr unsigned int Offset() { return GetVertexLayoutOffset<Inputs...>(index); }
+
+	// Points the inputs of the program at the array buffer that is bound, for the vertex array that is bound.
+	// Inputs the program doesn't have are skipped.
+	static void Specify(GLuint program)
+	{
+		SpecifyInputs(program, std::make_index_sequence<sizeof...(Inputs)>());
+	}
+
+	// The same layout as a VertexFormat, for code that gets its layouts at run time like VertexArrayCache
+	static VertexFormat GetFormat()
+	{
+		VertexFormat format;
+		int expand[] = { 0, (format.Add(Inputs::Name::Name(), Inputs::type, Inputs::components), 0)... };
+		(void)expand;
+		return format;
+	}
+
+private:
+	template<size_t... indices>
+	static void SpecifyInputs(GLuint program, std::index_sequence<indices...>)
+	{
+		int expand[] = { 0, (SpecifyInput<Inputs>(program, GetVertexLayoutOffset<Inputs...>(indices)), 0)... };
+		(void)expand;
+	}
+
+	template<typename Input>
+	static void SpecifyInput(GLuint program, unsigned int offset)
+	{
+		GLint location = glGetAttribLocation(program, Input::Name::Name());
+		if (location == -1)
+			return;
+
+		glVertexAttribPointer(location, Input::components, GetVertexAttributeGLType(Input::type), IsVertexAttributeNormalized(Input::type),
+			stride, (void*)(size_t)offset);
+		glEnableVertexAttribArray(location);
+	}
+};
+
+// Vertex arrays keyed by the vertex format and the locations a program gives its inputs. Programs that read the same layout,
+// like the scene and the feedback pass or a program that was rebuilt, share a vertex array, and so do buffers of the same format.
+// Switching buffers doesn't make a new vertex array: with ARB_vertex_attrib_binding, core from OpenGL 4.3 on, it's one glBindVertexBuffer,
+// otherwise the attribute pointers are set again with the locations that were looked up once.
+class VertexArrayCache
+{
+public:
+	VertexArrayCache();
+	~VertexArrayCache();
+
+	VertexArrayCache(const VertexArrayCache&) = delete;
+	VertexArrayCache& operator=(const VertexArrayCache&) = delete;
+
+	// The vertex array for vertices of the format read by the program, made the first time the layout is seen.
+	// Inputs of the program the format doesn't have are disabled, they read as white.
+	int Get(GLuint program, const VertexFormat& format);
+
+	// Binds the vertex array and points it at the buffers, an index buffer of 0 is for glDrawArrays
+	void Bind(int vertexArray, GLuint vertexBuffer, GLuint indexBuffer = 0);
+
+	int GetCount() const { return (int)m_VertexArrays.size(); }
+
+	void Destroy();
+
+private:
+	struct CachedVertexArray
+	{
+		VertexFormat format;
+		std::vector<GLint> locations;
+		GLuint vao;
+		GLuint vertexBuffer;
+		GLuint indexBuffer;
+	};
+
+	void PointAttributes(const CachedVertexArray& vertexArray) const;
+
+	std::vector<CachedVertexArray> m_VertexArrays;
+};
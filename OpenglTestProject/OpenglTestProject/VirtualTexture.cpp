@@ -0,0 +1,216 @@
+#include "VirtualTexture.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+const char* virtualTextureFeedbackFragmentSource = R"glsl(
+#version 150 core
+
+in vec2 Texcoord;
+
+out vec4 outFeedback;
+
+uniform float vtPages;
+uniform float vtLevelCount;
+uniform vec4 vtPage;
+uniform float vtFeedbackBias;
+
+void main()
+{
+	// The same level the scene shader picks, from how many pixels of level 0 a pixel of the screen covers
+	vec2 texel = Texcoord * vtPages * vtPage.x;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float level = floor(0.5f * log2(max(dot(dx, dx), dot(dy, dy))) + vtFeedbackBias);
+	int l = int(clamp(level, 0.0f, vtLevelCount - 1.0f));
+
+	ivec2 page = ivec2(clamp(Texcoord, 0.0f, 0.99999f) * (vtPages / exp2(float(l))));
+	outFeedback = vec4(page.x & 255, page.y & 255, ((page.x >> 8) & 15) | (((page.y >> 8) & 15) << 4), l + 1) / 255.0f;
+}
+)glsl";
+
+VirtualTexture::VirtualTexture()
+	: m_SlotsPerSide(0)
+	, m_Physical(0)
+	, m_Indirection(0)
+	, m_FeedbackIndex(0)
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		m_FeedbackBuffers[i] = 0;
+		m_FeedbackBytes[i] = 0;
+		m_FeedbackCapacity[i] = 0;
+	}
+}
+
+VirtualTexture::~VirtualTexture()
+{
+	Destroy();
+}
+
+bool VirtualTexture::Create(const char* path, int slotsPerSide)
+{
+	Destroy();
+
+	if (!m_PageFile.Open(path))
+		return false;
+
+	// The indirection texture has a byte per slot coordinate, and the physical texture has to fit on the GPU
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	int paddedPageSize = m_PageFile.GetPaddedPageSize();
+	m_SlotsPerSide = std::min(std::min(slotsPerSide, 256), maxTextureSize / paddedPageSize);
+
+	int levelCount = m_PageFile.GetLevelCount();
+	m_Cache.Reset(m_PageFile.GetPagesPerSide(0), levelCount, m_SlotsPerSide);
+
+	int physicalSize = m_SlotsPerSide * paddedPageSize;
+	glGenTextures(1, &m_Physical);
+	glBindTexture(GL_TEXTURE_2D, m_Physical);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, physicalSize, physicalSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// No mipmaps, the pages of the coarser levels are the mipmaps. The border keeps bilinear filtering inside a page.
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	// The shader reads the entries with texelFetch, so the filter doesn't matter, but the levels have to be complete
+	glGenTextures(1, &m_Indirection);
+	glBindTexture(GL_TEXTURE_2D, m_Indirection);
+	for (int level = 0; level < levelCount; ++level)
+	{
+		int pages = m_PageFile.GetPagesPerSide(level);
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, pages, pages, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glGenBuffers(2, m_FeedbackBuffers);
+
+	// The last level goes in right away, so there's something to draw in the first frame
+	Update(1);
+	return true;
+}
+
+void VirtualTexture::Destroy()
+{
+	if (m_Physical != 0)
+		glDeleteTextures(1, &m_Physical);
+	if (m_Indirection != 0)
+		glDeleteTextures(1, &m_Indirection);
+	if (m_FeedbackBuffers[0] != 0)
+		glDeleteBuffers(2, m_FeedbackBuffers);
+
+	m_Physical = 0;
+	m_Indirection = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		m_FeedbackBuffers[i] = 0;
+		m_FeedbackBytes[i] = 0;
+		m_FeedbackCapacity[i] = 0;
+	}
+
+	m_PageFile.Close();
+}
+
+void VirtualTexture::ReadFeedback(int width, int height)
+{
+	size_t bytes = (size_t)width * height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_FeedbackBuffers[m_FeedbackIndex]);
+	if (m_FeedbackCapacity[m_FeedbackIndex] < bytes)
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		m_FeedbackCapacity[m_FeedbackIndex] = bytes;
+	}
+
+	// With a pixel pack buffer bound this only queues the copy, it returns before the GPU got to it
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_FeedbackBytes[m_FeedbackIndex] = bytes;
+	m_FeedbackIndex = 1 - m_FeedbackIndex;
+}
+
+void VirtualTexture::Update(int maxUploads)
+{
+	if (!IsValid())
+		return;
+
+	// The buffer that is written next is the one that was written the longest time ago
+	if (m_FeedbackBytes[m_FeedbackIndex] > 0)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_FeedbackBuffers[m_FeedbackIndex]);
+		const unsigned char* pixels = (const unsigned char*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (pixels)
+		{
+			m_Cache.AddFeedback(pixels, m_FeedbackBytes[m_FeedbackIndex] / 4);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		m_FeedbackBytes[m_FeedbackIndex] = 0;
+	}
+
+	if (!m_Cache.Update(maxUploads, m_Uploads))
+		return;
+
+	int paddedPageSize = m_PageFile.GetPaddedPageSize();
+
+	glBindTexture(GL_TEXTURE_2D, m_Physical);
+	for (const PageUpload& upload : m_Uploads)
+	{
+		const unsigned char* page = m_PageFile.GetPage(upload.page.level, upload.page.x, upload.page.y);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, upload.slotX * paddedPageSize, upload.slotY * paddedPageSize,
+			paddedPageSize, paddedPageSize, GL_RGBA, GL_UNSIGNED_BYTE, page);
+	}
+
+	UploadIndirection();
+}
+
+void VirtualTexture::UploadIndirection()
+{
+	const std::vector<std::vector<unsigned char>>& indirection = m_Cache.GetIndirection();
+
+	glBindTexture(GL_TEXTURE_2D, m_Indirection);
+	for (size_t level = 0; level < indirection.size(); ++level)
+	{
+		int pages = m_PageFile.GetPagesPerSide((int)level);
+		glTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, 0, pages, pages, GL_RGBA, GL_UNSIGNED_BYTE, indirection[level].data());
+	}
+}
+
+void VirtualTexture::Bind(GLenum physicalUnit, GLenum indirectionUnit) const
+{
+	glActiveTexture(physicalUnit);
+	glBindTexture(GL_TEXTURE_2D, m_Physical);
+	glActiveTexture(indirectionUnit);
+	glBindTexture(GL_TEXTURE_2D, m_Indirection);
+}
+
+void VirtualTexture::SetUniforms(GLuint program) const
+{
+	int paddedPageSize = m_PageFile.GetPaddedPageSize();
+
+	glUniform1f(glGetUniformLocation(program, "vtPages"), (float)m_PageFile.GetPagesPerSide(0));
+	glUniform1f(glGetUniformLocation(program, "vtLevelCount"), (float)m_PageFile.GetLevelCount());
+	glUniform4f(glGetUniformLocation(program, "vtPage"), (float)m_PageFile.GetPageSize(), (float)m_PageFile.GetBorder(),
+		(float)paddedPageSize, (float)(m_SlotsPerSide * paddedPageSize));
+}
+
+void VirtualTexture::PrintReport(std::ostream& stream) const
+{
+	std::ios::fmtflags flags = stream.flags();
+	stream << std::fixed << std::setprecision(1);
+
+	double residentKilobytes = m_Cache.GetResidentCount() * m_PageFile.GetPageBytes() / 1024.0;
+	stream << "Virtual texture " << m_PageFile.GetSize() << "x" << m_PageFile.GetSize() << ": "
+		<< m_Cache.GetResidentCount() << " of " << m_Cache.GetSlotCount() << " slots (" << residentKilobytes << " KB), "
+		<< m_Cache.GetMissingCount() << " pages missing, " << m_Cache.GetUploadCount() << " uploaded, "
+		<< m_Cache.GetEvictionCount() << " evicted\n";
+
+	stream.flags(flags);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLEW/glew.h>
+
+#include "PageFile.h"
+#include "VirtualTextureCache.h"
+
+#include <vector>
+#include <iosfwd>
+
+// Fragment shader of the feedback pass, it goes with the scene vertex shader (Texcoord in, the vt* uniforms of SetUniforms).
+// For every pixel it writes the page the scene shader will want, in the encoding of EncodeFeedback.
+// vtFeedbackBias makes up for the feedback target being smaller than the screen: -log2 of how many times smaller it is.
+extern const char* virtualTextureFeedbackFragmentSource;
+
+// A texture that is too big to be on the GPU as a whole. Only the pages the feedback pass asks for are uploaded,
+// into the slots of a physical texture. A small indirection texture with a level per page level tells the shader in
+// which slot every page is, and falls back to a coarser page while a fine one is still being streamed.
+//
+// Pages are uploaded straight from the memory mapped page file, at most a few per frame so streaming never causes a hitch.
+// The feedback is read back through pixel buffers a frame late, so the CPU never waits for the GPU.
+//
+// Shaders sample it with 2 textures and these uniforms:
+//   sampler2D vtPhysical, vtIndirection
+//   float vtPages (pages per side of level 0), vtLevelCount
+//   vec4 vtPage (page size, border, page size with border, size of the physical texture)
+class VirtualTexture
+{
+public:
+	VirtualTexture();
+	~VirtualTexture();
+
+	VirtualTexture(const VirtualTexture&) = delete;
+	VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+	// Opens a page file made by Tools/VirtualTextureBuilder. slotsPerSide squared pages fit in the physical texture at once.
+	bool Create(const char* path, int slotsPerSide = 16);
+	void Destroy();
+
+	bool IsValid() const { return m_Physical != 0; }
+
+	// Reads the feedback from the bound read framebuffer into a pixel buffer. It's handed to the cache in the Update
+	// of the frame after the next one, by then the GPU is done with it and mapping it doesn't stall.
+	void ReadFeedback(int width, int height);
+
+	// Feeds the cache with the oldest feedback and uploads the pages it picked
+	void Update(int maxUploads = 8);
+
+	void Bind(GLenum physicalUnit, GLenum indirectionUnit) const;
+
+	// Sets the vt* uniforms of the program that is in use, except the samplers
+	void SetUniforms(GLuint program) const;
+
+	const VirtualTextureCache& GetCache() const { return m_Cache; }
+	const PageFile& GetPageFile() const { return m_PageFile; }
+
+	void PrintReport(std::ostream& stream) const;
+
+private:
+	void UploadIndirection();
+
+	PageFile m_PageFile;
+	VirtualTextureCache m_Cache;
+	std::vector<PageUpload> m_Uploads;
+
+	int m_SlotsPerSide;
+	GLuint m_Physical;
+	GLuint m_Indirection;
+
+	GLuint m_FeedbackBuffers[2];
+	size_t m_FeedbackBytes[2];
+	size_t m_FeedbackCapacity[2];
+	int m_FeedbackIndex;
+};
@@ -0,0 +1,256 @@
+#include "VirtualTextureCache.h"
+
+#include <algorithm>
+
+static const uint32_t NoPage = 0xFFFFFFFF;
+
+void EncodeFeedback(const VirtualPage& page, unsigned char* rgba)
+{
+	rgba[0] = (unsigned char)(page.x & 0xFF);
+	rgba[1] = (unsigned char)(page.y & 0xFF);
+	rgba[2] = (unsigned char)(((page.x >> 8) & 0x0F) | (((page.y >> 8) & 0x0F) << 4));
+	rgba[3] = (unsigned char)(page.level + 1);
+}
+
+bool DecodeFeedback(const unsigned char* rgba, VirtualPage& page)
+{
+	if (rgba[3] == 0)
+		return false;
+
+	page.x = rgba[0] | ((rgba[2] & 0x0F) << 8);
+	page.y = rgba[1] | ((rgba[2] >> 4) << 8);
+	page.level = rgba[3] - 1;
+	return true;
+}
+
+VirtualTextureCache::VirtualTextureCache()
+	: m_PagesPerSide(0)
+	, m_LevelCount(0)
+	, m_SlotsPerSide(0)
+	, m_Frame(0)
+	, m_MissingCount(0)
+	, m_UploadCount(0)
+	, m_EvictionCount(0)
+{
+}
+
+void VirtualTextureCache::Reset(int pagesPerSide, int levelCount, int slotsPerSide)
+{
+	m_PagesPerSide = pagesPerSide;
+	m_LevelCount = levelCount;
+	m_SlotsPerSide = slotsPerSide;
+
+	Slot empty;
+	empty.page = NoPage;
+	empty.lastWantedFrame = 0;
+	m_Slots.assign((size_t)slotsPerSide * slotsPerSide, empty);
+
+	m_Resident.clear();
+	m_Requested.clear();
+
+	m_Indirection.resize(levelCount);
+	for (int level = 0; level < levelCount; ++level)
+	{
+		int pages = pagesPerSide >> level;
+		m_Indirection[level].assign((size_t)pages * pages * 4, 0);
+	}
+
+	m_Frame = 0;
+	m_MissingCount = 0;
+	m_UploadCount = 0;
+	m_EvictionCount = 0;
+
+	// The last level is the fallback for everything, it's uploaded first and never leaves
+	VirtualPage last = { levelCount - 1, 0, 0 };
+	Request(last);
+}
+
+uint32_t VirtualTextureCache::MakeKey(const VirtualPage& page)
+{
+	return ((uint32_t)page.level << 24) | ((uint32_t)page.y << 12) | (uint32_t)page.x;
+}
+
+VirtualPage VirtualTextureCache::GetPage(uint32_t key)
+{
+	VirtualPage page;
+	page.level = (int)(key >> 24);
+	page.y = (int)((key >> 12) & 0xFFF);
+	page.x = (int)(key & 0xFFF);
+	return page;
+}
+
+void VirtualTextureCache::AddFeedback(const unsigned char* rgba, size_t pixelCount)
+{
+	uint32_t previous = NoPage;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		VirtualPage page;
+		if (!DecodeFeedback(rgba + i * 4, page))
+			continue;
+
+		// Neighbouring pixels mostly want the same page, no need to add it again
+		uint32_t key = MakeKey(page);
+		if (key == previous)
+			continue;
+
+		previous = key;
+		Request(page);
+	}
+}
+
+void VirtualTextureCache::Request(const VirtualPage& page)
+{
+	if (page.level < 0 || page.level >= m_LevelCount)
+		return;
+
+	int pages = m_PagesPerSide >> page.level;
+	if (page.x < 0 || page.y < 0 || page.x >= pages || page.y >= pages)
+		return;
+
+	m_Requested.push_back(MakeKey(page));
+}
+
+bool VirtualTextureCache::IsResident(const VirtualPage& page) const
+{
+	return m_Resident.find(MakeKey(page)) != m_Resident.end();
+}
+
+VirtualPage VirtualTextureCache::Resolve(const VirtualPage& page) const
+{
+	VirtualPage resolved = page;
+	while (resolved.level < m_LevelCount - 1 && !IsResident(resolved))
+	{
+		++resolved.level;
+		resolved.x /= 2;
+		resolved.y /= 2;
+	}
+
+	return resolved;
+}
+
+int VirtualTextureCache::FindSlot()
+{
+	int oldest = -1;
+	for (size_t i = 0; i < m_Slots.size(); ++i)
+	{
+		const Slot& slot = m_Slots[i];
+		if (slot.page == NoPage)
+			return (int)i;
+
+		// Pages that are wanted this frame stay, and so does the last level
+		if (slot.lastWantedFrame == m_Frame || GetPage(slot.page).level == m_LevelCount - 1)
+			continue;
+
+		if (oldest == -1 || slot.lastWantedFrame < m_Slots[oldest].lastWantedFrame)
+			oldest = (int)i;
+	}
+
+	return oldest;
+}
+
+bool VirtualTextureCache::Update(int maxUploads, std::vector<PageUpload>& uploads)
+{
+	uploads.clear();
+
+	// The parents of every wanted page are wanted as well, they're drawn until the page itself is in
+	size_t requestedCount = m_Requested.size();
+	for (size_t i = 0; i < requestedCount; ++i)
+	{
+		VirtualPage page = GetPage(m_Requested[i]);
+		while (++page.level < m_LevelCount)
+		{
+			page.x /= 2;
+			page.y /= 2;
+			m_Requested.push_back(MakeKey(page));
+		}
+	}
+
+	std::sort(m_Requested.begin(), m_Requested.end());
+	m_Requested.erase(std::unique(m_Requested.begin(), m_Requested.end()), m_Requested.end());
+
+	// Mark everything that is wanted first, so none of it is evicted for another page of the same frame
+	std::vector<uint32_t> missing;
+	for (uint32_t key : m_Requested)
+	{
+		std::unordered_map<uint32_t, int>::iterator resident = m_Resident.find(key);
+		if (resident != m_Resident.end())
+			m_Slots[resident->second].lastWantedFrame = m_Frame;
+		else
+			missing.push_back(key);
+	}
+
+	m_MissingCount = (int)missing.size();
+
+	// The level is in the high bits of the key, so going backwards loads the coarse pages first.
+	// They cover the most pixels and the finer pages fall back to them.
+	for (std::vector<uint32_t>::reverse_iterator key = missing.rbegin(); key != missing.rend() && (int)uploads.size() < maxUploads; ++key)
+	{
+		int index = FindSlot();
+		if (index == -1)
+			break;
+
+		Slot& slot = m_Slots[index];
+		if (slot.page != NoPage)
+		{
+			m_Resident.erase(slot.page);
+			++m_EvictionCount;
+		}
+
+		slot.page = *key;
+		slot.lastWantedFrame = m_Frame;
+		m_Resident[*key] = index;
+
+		PageUpload upload;
+		upload.page = GetPage(*key);
+		upload.slotX = index % m_SlotsPerSide;
+		upload.slotY = index / m_SlotsPerSide;
+		uploads.push_back(upload);
+	}
+
+	m_UploadCount += (int)uploads.size();
+	m_Requested.clear();
+	++m_Frame;
+
+	if (uploads.empty())
+		return false;
+
+	BuildIndirection();
+	return true;
+}
+
+void VirtualTextureCache::BuildIndirection()
+{
+	// From the last level to level 0, a page that isn't resident gets the entry of its parent
+	for (int level = m_LevelCount - 1; level >= 0; --level)
+	{
+		int pages = m_PagesPerSide >> level;
+		std::vector<unsigned char>& table = m_Indirection[level];
+
+		for (int y = 0; y < pages; ++y)
+		{
+			for (int x = 0; x < pages; ++x)
+			{
+				unsigned char* entry = &table[((size_t)y * pages + x) * 4];
+
+				VirtualPage page = { level, x, y };
+				std::unordered_map<uint32_t, int>::const_iterator resident = m_Resident.find(MakeKey(page));
+				if (resident != m_Resident.end())
+				{
+					entry[0] = (unsigned char)(resident->second % m_SlotsPerSide);
+					entry[1] = (unsigned char)(resident->second / m_SlotsPerSide);
+					entry[2] = (unsigned char)level;
+					entry[3] = 255;
+				}
+				else if (level < m_LevelCount - 1)
+				{
+					int parentPages = pages / 2;
+					const unsigned char* parent = &m_Indirection[level + 1][((size_t)(y / 2) * parentPages + x / 2) * 4];
+					entry[0] = parent[0];
+					entry[1] = parent[1];
+					entry[2] = parent[2];
+					entry[3] = parent[3];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// A page of a virtual texture, by level and position in that level
+struct VirtualPage
+{
+	int level;
+	int x;
+	int y;
+};
+
+// The feedback pass writes the page every pixel wants into an RGBA8 target: the low 8 bits of x and y in red and green,
+// their high 4 bits in blue and the level + 1 in alpha. Alpha 0 is a pixel without a virtual texture.
+// The feedback fragment shader does the same thing, so keep them in sync.
+void EncodeFeedback(const VirtualPage& page, unsigned char* rgba);
+bool DecodeFeedback(const unsigned char* rgba, VirtualPage& page);
+
+// Where a page has to be copied to in the physical texture
+struct PageUpload
+{
+	VirtualPage page;
+	int slotX;
+	int slotY;
+};
+
+// Decides which pages of a virtual texture live in the slots of the physical texture, and builds the indirection table
+// that tells the shader where to find them. Doesn't touch OpenGL or the page file, so it can be driven and checked without a GPU.
+//
+// Every frame the pages from the feedback are added, and Update hands out slots for the missing ones, coarse levels first.
+// A page that isn't there is drawn with the closest coarser level that is, and the last level is always there,
+// so every pixel has something to show while the finer pages are streamed in.
+// When the slots run out, the page that was wanted the longest time ago makes room.
+class VirtualTextureCache
+{
+public:
+	VirtualTextureCache();
+
+	// pagesPerSide is the number of pages per side of level 0, a power of 2 up to 4096. The indirection table stores slot
+	// coordinates in a byte, so slotsPerSide can't be more than 256.
+	void Reset(int pagesPerSide, int levelCount, int slotsPerSide);
+
+	// Adds the pages of a feedback readback, pixels that don't want a page are skipped
+	void AddFeedback(const unsigned char* rgba, size_t pixelCount);
+	void Request(const VirtualPage& page);
+
+	// Picks the pages to upload this frame, at most maxUploads. Returns true when the indirection table changed.
+	bool Update(int maxUploads, std::vector<PageUpload>& uploads);
+
+	// The indirection table of every level, pagesPerSide >> level texels per side of RGBA8.
+	// Each texel has the slot of the page that covers it in red and green and the level of that page in blue.
+	const std::vector<std::vector<unsigned char>>& GetIndirection() const { return m_Indirection; }
+
+	// Page that is drawn for a position in a level, that is the page itself or the closest coarser one that is resident
+	VirtualPage Resolve(const VirtualPage& page) const;
+
+	bool IsResident(const VirtualPage& page) const;
+
+	int GetSlotCount() const { return (int)m_Slots.size(); }
+	int GetResidentCount() const { return (int)m_Resident.size(); }
+	int GetMissingCount() const { return m_MissingCount; }
+	int GetUploadCount() const { return m_UploadCount; }
+	int GetEvictionCount() const { return m_EvictionCount; }
+
+private:
+	struct Slot
+	{
+		// Key of the page that is in the slot, or NoPage
+		uint32_t page;
+		unsigned int lastWantedFrame;
+	};
+
+	static uint32_t MakeKey(const VirtualPage& page);
+	static VirtualPage GetPage(uint32_t key);
+
+	int FindSlot();
+	void BuildIndirection();
+
+	int m_PagesPerSide;
+	int m_LevelCount;
+	int m_SlotsPerSide;
+
+	std::vector<Slot> m_Slots;
+	std::unordered_map<uint32_t, int> m_Resident;
+
+	// Pages wanted this frame, sorted and made unique in Update
+	std::vector<uint32_t> m_Requested;
+
+	std::vector<std::vector<unsigned char>> m_Indirection;
+
+	unsigned int m_Frame;
+	int m_MissingCount;
+	int m_UploadCount;
+	int m_EvictionCount;
+};
@@ -0,0 +1,395 @@
+#include "WaterDistortionEffect.h"
+#include "VertexLayout.h"
+#include "ShaderLibrary.h"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+static const float PI = 3.14159265358979f;
+
+// Both quads live in one buffer. LinkProgram gives both programs the same locations, so one vertex array works for both.
+typedef VertexLayout<VertexInput<PositionName, glm::vec2>, VertexInput<TexcoordName, glm::vec2>> QuadVertexLayout;
+
+static const char* plainVertexSource = R"glsl(
+#version 150 core
+
+in vec2 position;
+in vec2 texcoord;
+
+out vec2 Texcoord;
+
+void main()
+{
+	Texcoord = texcoord;
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
+)glsl";
+
+static const char* plainFragmentSource = R"glsl(
+#version 150 core
+
+in vec2 Texcoord;
+
+out vec4 outColor;
+
+uniform sampler2D texSource;
+
+void main()
+{
+	outColor = texture(texSource, Texcoord);
+}
+)glsl";
+
+static const char* waterVertexSource = R"glsl(
+#version 150 core
+
+in vec2 position;
+in vec2 texcoord;
+
+out vec2 Texcoord;
+out float DistortionCoord;
+
+uniform float time;
+uniform float distortionCount;
+uniform float speed;
+
+const float TWO_PI = 6.28318530718f;
+
+void main()
+{
+	Texcoord = texcoord;
+
+	// The phase of the wave is linear in the texture coordinate, so it can be calculated per vertex
+	// and interpolated. Dividing by 2 PI turns it into a coordinate in the lookup texture,
+	// which holds exactly one period and repeats.
+	DistortionCoord = (texcoord.y * distortionCount + time * speed) / TWO_PI;
+
+	gl_Position = vec4(position, 0.0f, 1.0f);
+}
+)glsl";
+
+static const char* waterFragmentSource = R"glsl(
+#version 150 core
+
+in vec2 Texcoord;
+in float DistortionCoord;
+
+out vec4 outColor;
+
+uniform sampler2D texSource;
+uniform sampler1D texDistortion;
+uniform float distortionHeight;
+uniform vec3 tint;
+
+void main()
+{
+	float offset = texture(texDistortion, DistortionCoord).r * distortionHeight;
+	outColor = texture(texSource, vec2(Texcoord.x + offset, 1.0f - Texcoord.y)) * vec4(tint, 1.0f);
+}
+)glsl";
+
+static GLuint LinkProgram(GLuint vertexShader, GLuint fragmentShader)
+{
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glBindAttribLocation(program, 0, "position");
+	glBindAttribLocation(program, 1, "texcoord");
+	glBindFragDataLocation(program, 0, "outColor");
+	glLinkProgram(program);
+	return program;
+}
+
+WaterDistortionEffect::WaterDistortionEffect()
+	: m_PlainProgram(0)
+	, m_WaterProgram(0)
+	, m_Vao(0)
+	, m_Vbo(0)
+	, m_LookupTexture(0)
+	, m_FrameBuffer(0)
+	, m_TargetTexture(0)
+	, m_ScreenWidth(0)
+	, m_ScreenHeight(0)
+	, m_TargetWidth(0)
+	, m_TargetHeight(0)
+	, m_RectMin(-1.0f)
+	, m_RectMax(1.0f)
+	, m_UniTime(-1)
+	, m_UniDistortionCount(-1)
+	, m_UniSpeed(-1)
+	, m_UniDistortionHeight(-1)
+	, m_UniTint(-1)
+{
+	m_Shaders[0] = m_Shaders[1] = m_Shaders[2] = m_Shaders[3] = 0;
+}
+
+WaterDistortionEffect::~WaterDistortionEffect()
+{
+	Destroy();
+}
+
+bool WaterDistortionEffect::Create(int screenWidth, int screenHeight, const WaterDistortionSettings& settings)
+{
+	m_ScreenWidth = screenWidth;
+	m_ScreenHeight = screenHeight;
+	m_Settings = settings;
+
+	m_Shaders[0] = CompileShader(GL_VERTEX_SHADER, plainVertexSource, "Plain vertex shader");
+	m_Shaders[1] = CompileShader(GL_FRAGMENT_SHADER, plainFragmentSource, "Plain fragment shader");
+	m_Shaders[2] = CompileShader(GL_VERTEX_SHADER, waterVertexSource, "Water vertex shader");
+	m_Shaders[3] = CompileShader(GL_FRAGMENT_SHADER, waterFragmentSource, "Water fragment shader");
+
+	m_PlainProgram = LinkProgram(m_Shaders[0], m_Shaders[1]);
+	m_WaterProgram = LinkProgram(m_Shaders[2], m_Shaders[3]);
+
+	glUseProgram(m_PlainProgram);
+	glUniform1i(glGetUniformLocation(m_PlainProgram, "texSource"), 0);
+
+	glUseProgram(m_WaterProgram);
+	glUniform1i(glGetUniformLocation(m_WaterProgram, "texSource"), 0);
+	glUniform1i(glGetUniformLocation(m_WaterProgram, "texDistortion"), 1);
+
+	m_UniTime = glGetUniformLocation(m_WaterProgram, "time");
+	m_UniDistortionCount = glGetUniformLocation(m_WaterProgram, "distortionCount");
+	m_UniSpeed = glGetUniformLocation(m_WaterProgram, "speed");
+	m_UniDistortionHeight = glGetUniformLocation(m_WaterProgram, "distortionHeight");
+	m_UniTint = glGetUniformLocation(m_WaterProgram, "tint");
+
+	// 2 triangle strips of 4 vertices
+	glGenVertexArrays(1, &m_Vao);
+	glBindVertexArray(m_Vao);
+
+	glGenBuffers(1, &m_Vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+	glBufferData(GL_ARRAY_BUFFER, 8 * QuadVertexLayout::stride, NULL, GL_DYNAMIC_DRAW);
+
+	QuadVertexLayout::Specify(m_WaterProgram);
+
+	UpdateVertices();
+	CreateLookupTexture();
+	CreateTarget();
+
+	return true;
+}
+
+void WaterDistortionEffect::Destroy()
+{
+	DestroyTarget();
+
+	if (m_LookupTexture != 0)
+	{
+		glDeleteTextures(1, &m_LookupTexture);
+		m_LookupTexture = 0;
+	}
+
+	if (m_Vbo != 0)
+	{
+		glDeleteBuffers(1, &m_Vbo);
+		glDeleteVertexArrays(1, &m_Vao);
+		m_Vbo = 0;
+		m_Vao = 0;
+	}
+
+	if (m_PlainProgram != 0)
+	{
+		glDeleteProgram(m_PlainProgram);
+		glDeleteProgram(m_WaterProgram);
+		for (int i = 0; i < 4; ++i)
+			glDeleteShader(m_Shaders[i]);
+
+		m_PlainProgram = 0;
+		m_WaterProgram = 0;
+	}
+}
+
+void WaterDistortionEffect::Resize(int screenWidth, int screenHeight)
+{
+	if (screenWidth == m_ScreenWidth && screenHeight == m_ScreenHeight)
+		return;
+
+	m_ScreenWidth = screenWidth;
+	m_ScreenHeight = screenHeight;
+
+	DestroyTarget();
+	CreateTarget();
+}
+
+void WaterDistortionEffect::SetSettings(const WaterDistortionSettings& settings)
+{
+	bool rebuildLookup = settings.lookupSize != m_Settings.lookupSize;
+	bool rebuildTarget = settings.resolutionScale != m_Settings.resolutionScale;
+
+	m_Settings = settings;
+
+	if (rebuildLookup)
+	{
+		glDeleteTextures(1, &m_LookupTexture);
+		CreateLookupTexture();
+	}
+
+	if (rebuildTarget)
+	{
+		DestroyTarget();
+		CreateTarget();
+	}
+}
+
+void WaterDistortionEffect::SetRect(const glm::vec2& min, const glm::vec2& max)
+{
+	m_RectMin = min;
+	m_RectMax = max;
+	UpdateVertices();
+}
+
+void WaterDistortionEffect::Render(GLuint sourceTexture, float time)
+{
+	if (m_FrameBuffer == 0)
+	{
+		DrawQuads(sourceTexture, time);
+		return;
+	}
+
+	GLint prevFrameBuffer;
+	GLint viewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFrameBuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	// Render the effect into the smaller framebuffer
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffer);
+	glViewport(0, 0, m_TargetWidth, m_TargetHeight);
+	glClear(GL_COLOR_BUFFER_BIT);
+
+	DrawQuads(sourceTexture, time);
+
+	// And scale only the covered rectangle up into the original framebuffer with linear filtering
+	glm::vec2 rectMin = m_RectMin * 0.5f + 0.5f;
+	glm::vec2 rectMax = m_RectMax * 0.5f + 0.5f;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_FrameBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevFrameBuffer);
+	glBlitFramebuffer(
+		(GLint)(rectMin.x * m_TargetWidth), (GLint)(rectMin.y * m_TargetHeight),
+		(GLint)(rectMax.x * m_TargetWidth), (GLint)(rectMax.y * m_TargetHeight),
+		viewport[0] + (GLint)(rectMin.x * viewport[2]), viewport[1] + (GLint)(rectMin.y * viewport[3]),
+		viewport[0] + (GLint)(rectMax.x * viewport[2]), viewport[1] + (GLint)(rectMax.y * viewport[3]),
+		GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFrameBuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void WaterDistortionEffect::CreateLookupTexture()
+{
+	// One period of the wave. Any periodic function could be baked here,
+	// the shader doesn't care what shape the wave has.
+	// Linear filtering returns a texel's own value only at its center, (i + 0.5) / size, and blends the two nearest texels in between.
+	// So the wave is evaluated at the centers, then the filter interpolates it exactly where the samples were taken.
+	int size = std::max(m_Settings.lookupSize, 2);
+	std::vector<float> offsets(size);
+	for (int i = 0; i < size; ++i)
+		offsets[i] = std::sin(2.0f * PI * ((float)i + 0.5f) / (float)size);
+
+	glGenTextures(1, &m_LookupTexture);
+	glBindTexture(GL_TEXTURE_1D, m_LookupTexture);
+	glTexImage1D(GL_TEXTURE_1D, 0, GL_R16F, size, 0, GL_RED, GL_FLOAT, offsets.data());
+
+	// Repeat makes the texture scroll forever, linear filtering interpolates between the baked samples.
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+void WaterDistortionEffect::CreateTarget()
+{
+	if (m_Settings.resolutionScale >= 1.0f)
+		return;
+
+	float scale = std::max(m_Settings.resolutionScale, 0.1f);
+	m_TargetWidth = std::max(1, (int)(m_ScreenWidth * scale));
+	m_TargetHeight = std::max(1, (int)(m_ScreenHeight * scale));
+
+	GLint prevFrameBuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFrameBuffer);
+
+	glGenFramebuffers(1, &m_FrameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FrameBuffer);
+
+	glGenTextures(1, &m_TargetTexture);
+	glBindTexture(GL_TEXTURE_2D, m_TargetTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, m_TargetWidth, m_TargetHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_TargetTexture, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Water distortion framebuffer is not complete\n";
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFrameBuffer);
+}
+
+void WaterDistortionEffect::DestroyTarget()
+{
+	if (m_FrameBuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_FrameBuffer);
+		glDeleteTextures(1, &m_TargetTexture);
+		m_FrameBuffer = 0;
+		m_TargetTexture = 0;
+	}
+}
+
+void WaterDistortionEffect::UpdateVertices()
+{
+	float left = m_RectMin.x;
+	float right = m_RectMax.x;
+	float top = m_RectMax.y;
+	float bottom = m_RectMin.y;
+	float middle = (top + bottom) * 0.5f;
+
+	// Texture coordinate (0, 0) is the top left corner of the image, like in the original sample.
+	// The upper quad shows the upper half of the image, the lower quad mirrors it.
+	float quadVertices[] =
+	{
+		// upper half (triangle strip)
+		left,  top,     0.0f, 0.0f,
+		right, top,     1.0f, 0.0f,
+		left,  middle,  0.0f, 0.5f,
+		right, middle,  1.0f, 0.5f,
+
+		// lower half (triangle strip)
+		left,  middle,  0.0f, 0.5f,
+		right, middle,  1.0f, 0.5f,
+		left,  bottom,  0.0f, 1.0f,
+		right, bottom,  1.0f, 1.0f
+	};
+	static_assert(sizeof(quadVertices) == 8 * QuadVertexLayout::stride, "The quads are 8 vertices of QuadVertexLayout");
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_Vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quadVertices), quadVertices);
+}
+
+void WaterDistortionEffect::DrawQuads(GLuint sourceTexture, float time)
+{
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_Vao);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, sourceTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_1D, m_LookupTexture);
+
+	glUseProgram(m_PlainProgram);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glUseProgram(m_WaterProgram);
+	glUniform1f(m_UniTime, time);
+	glUniform1f(m_UniDistortionCount, m_Settings.distortionCount);
+	glUniform1f(m_UniSpeed, m_Settings.speed);
+	glUniform1f(m_UniDistortionHeight, m_Settings.distortionHeight);
+	glUniform3fv(m_UniTint, 1, &m_Settings.tint[0]);
+	glDrawArrays(GL_TRIANGLE_STRIP, 4, 4);
+
+	glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <GLEW/glew.h>
+#include <glm/glm.hpp>
+
+struct WaterDistortionSettings
+{
+	// Number of waves over the height of the image, how fast they move and how far they push pixels sideways
+	float distortionCount = 60.0f;
+	float speed = 2.0f;
+	float distortionHeight = 0.03f;
+
+	// Color the reflection is multiplied with
+	glm::vec3 tint = glm::vec3(0.7f, 0.7f, 1.0f);
+
+	// Below 1.0f the effect is rendered into a smaller framebuffer and scaled up afterwards
+	float resolutionScale = 1.0f;
+
+	// Number of samples in the baked lookup texture for one period of the wave
+	int lookupSize = 256;
+};
+
+// Mirrors the upper half of a texture into the lower half and lets the mirror image ripple like water.
+// The original shader calculated a sine for every pixel and branched on which half the pixel was in.
+// Here the wave is baked once into a small 1D texture that is scrolled with time,
+// and each half is drawn as its own quad with its own shader, so no fragment ever has to branch.
+class WaterDistortionEffect
+{
+public:
+	WaterDistortionEffect();
+	~WaterDistortionEffect();
+
+	WaterDistortionEffect(const WaterDistortionEffect&) = delete;
+	WaterDistortionEffect& operator=(const WaterDistortionEffect&) = delete;
+
+	bool Create(int screenWidth, int screenHeight, const WaterDistortionSettings& settings = WaterDistortionSettings());
+	void Destroy();
+
+	void Resize(int screenWidth, int screenHeight);
+
+	void SetSettings(const WaterDistortionSettings& settings);
+	const WaterDistortionSettings& GetSettings() const { return m_Settings; }
+
+	// The part of the screen the effect covers, in normalized device coordinates.
+	// By default this is the whole screen.
+	void SetRect(const glm::vec2& min, const glm::vec2& max);
+
+	// Draws the source texture with the effect into the framebuffer that is currently bound.
+	void Render(GLuint sourceTexture, float time);
+
+private:
+	void CreateLookupTexture();
+	void CreateTarget();
+	void DestroyTarget();
+	void UpdateVertices();
+	void DrawQuads(GLuint sourceTexture, float time);
+
+	WaterDistortionSettings m_Settings;
+
+	GLuint m_PlainProgram;
+	GLuint m_WaterProgram;
+	GLuint m_Shaders[4];
+
+	GLuint m_Vao;
+	GLuint m_Vbo;
+	GLuint m_LookupTexture;
+
+	// Used when rendering at reduced resolution
+	GLuint m_FrameBuffer;
+	GLuint m_TargetTexture;
+
+	int m_ScreenWidth;
+	int m_ScreenHeight;
+	int m_TargetWidth;
+	int m_TargetHeight;
+
+	glm::vec2 m_RectMin;
+	glm::vec2 m_RectMax;
+
+	GLint m_UniTime;
+	GLint m_UniDistortionCount;
+	GLint m_UniSpeed;
+	GLint m_UniDistortionHeight;
+	GLint m_UniTint;
+};
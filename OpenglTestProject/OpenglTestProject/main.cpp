@@ -7,6 +7,11 @@
 #include <iostream>
 #include <thread>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <memory>
 
 #if defined GL_TEST || defined INCLUDE_ALL
 #include <GLEW/glew.h>
@@ -33,6 +38,23 @@
 // adds functionality for converting a matrix object into a float array for usage in OpenGL
 #include <glm/gtc/type_ptr.hpp>
 
+#include "ReflectionManager.h"
+#include "RenderGraph.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "TextureAtlas.h"
+#include "TextureManager.h"
+#include "VirtualTexture.h"
+#include "ShaderLibrary.h"
+#include "FileWatcher.h"
+#include "AssetPack.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "FrustumCuller.h"
+#include "Bvh.h"
+#include "OcclusionCuller.h"
+#include "GpuCuller.h"
+
 #undef main
 
 #if defined GL_TEST
@@ -171,157 +193,186 @@ int SdlTest()
 // use \n instead
 #define endl string("\n")
 
-//const char* vertexSource =
-//// from OpenGL version 3.3 shader version is equal to OpenGL version
-//// The #version preprocessor directive is used to indicate that the code that follows i GLSL 1.50 code
-//// using OpenGL's core profile.
-//"#version 150 core\n"
-//
-//// Next we specify that there is only 1 attribute, the position
-//"in vec3 position;\n"
-//"in vec3 color;\n"
-//"in vec2 texcoord;\n"
-//
-//// The color to output to the fragment shader
-//"out vec3 Color;\n"
-//"out vec2 Texcoord;\n"
-//"out float Depth;\n"
-//
-//"uniform mat4 model;"
-//"uniform mat4 view;"
-//"uniform mat4 proj;"
-//"uniform float time;"
-//
-//// Apart from regular C types, GLSL has built-in vector and matrix types
-//// identified by vec* and mat* identifiers.
-//// the values within these constructs is always a float.
-//// The number after vec specifies the number of components(x,y,z,w) and
-//// the number after mat specifies the number of rows/columns.
-//// Since the position attribute consists of only an x and y coordinate, vec2 is perfect
-//"void main()\n"
-//"{\n"
-//
-//"float redValue = color.r + 0.1f * time;"
-//"float redSin = sin(redValue);" //should be 0
-//"redSin *= 0.5f;"
-//"redSin += 0.5f;"
-//
-////"float blueSin = cos(time);" //should be 1
-////"blueSin *= 0.5f;"
-////"blueSin += 0.5f;"
-//
-//"float red = redSin;" //should be 0
-////"float blue = blueSin;" //should be 1
-//
-//"float blue = 1.0f - red;"
-//// You can be quite creative when working with vertex types.
-//// In the example above a shortcuts was used to set the first two components of the vec4
-//// to those of vec2. the following 2 lines are equal
-//// gl_Position = vec(position, 0.0f, 1.0f);
-//// gl_Position = vec(position.x, position.y, 0.0f, 1.0f);
-//// When you're working with colors, you can also access the individual components with r, g, b and a
-//// instead of x, y, z and w. this makes no difference and can help with clarity.
-//// The final position of the vertex assigned to the special gl_Position variable,
-//// because the position is needed for primitive assembly and many other built-in processes.
-//// For these to function correctly, the last value w needs to have a value of 1.0f.
-//// Other than that, you're free to do anything you want with the attributes.
-//"gl_Position = proj * view * model * vec4(position, 1.0f);\n"
-//"Color = vec3(red, color.g, blue);\n"
-////"Color = color;"
-//"Texcoord = texcoord;\n"
-////"Depth = gl_Position.z;\n"
-//"}\n";
-//
-//const char* fragmentSource =
-//"#version 150 core\n"
-//
-//// You'll immediately notice that we're not using some built-in variable for outputting the color, say gl_FragColor.
-//// This is because a fragment shader can in fact output multiple colors.
-//// The outColor variable uses the type vec4, because each color consists of a red, green, blue and alpha component.
-//// Colors in OpenGL are generally represented as floating point number between 0.0 and 1.0 instead of the common 0 and 255.
-//
-//// Vertex attributes are not the only way to pass data to shader programs. There is another way to pass data to shaders called uniforms.
-//// These are essentially global variables, having the same value for all vertices and/or fragments.
-//"in vec3 Color;\n"
-//"in vec2 Texcoord;\n"
-//"in float Depth;\n"
-//"out vec4 outColor;\n"
-//
-//"uniform sampler2D texHalo;\n"
-//"uniform sampler2D texGoogle;\n"
-//"uniform vec3 extraColor;\n"
-//
-//"void main()\n"
-//"{\n"
-//"vec4 colHalo = texture(texHalo, Texcoord);//  * vec4(Color, 1.0f);\n"
-//"vec4 colGoogle = texture(texGoogle, Texcoord);//  * vec4(Color, 1.0f);\n"
-//
-//// the mix function is a special GLSL function that linearly interpolates between 2 variables based on the third parameter.
-//// A value of 0.0 will result in the first value, a value of 1.0 will result in the second value and a value in between will
-//// result in a mixture of both.
-//"outColor = mix(colHalo, colGoogle, 0.5f);"
-//"outColor = vec4(1.0f, 1.0f, 1.0f, 1.0f);"
-//"outColor *= vec4(Color, 1.0f);"
-//"//outColor *= vec4(extraColor, 1.0f);\n"
-////"outColor = vec4(1 - Depth, 1 - Depth, 1 - Depth, 1.0f);" // display depth
-//"}\n";
-//
-//const char* screenVertexSource =
-//"#version 150 core\n"
-//"in vec2 position;\n"
-//"in vec2 texCoord;\n"
-//"out vec2 Texcoord;\n"
-//"void main() \n"
-//"{\n"
-//"Texcoord = texCoord;\n"
-//"gl_Position = vec4(position, 0.0f, 1.0f);\n"
-//"}";
+const char* vertexSource =
+// from OpenGL version 3.3 shader version is equal to OpenGL version
+// The #version preprocessor directive is used to indicate that the code that follows i GLSL 1.50 code
+// using OpenGL's core profile.
+"#version 150 core\n"
+
+// Next we specify that there is only 1 attribute, the position
+"in vec3 position;\n"
+"in vec3 color;\n"
+"in vec2 texcoord;\n"
+
+// The color to output to the fragment shader
+"out vec3 Color;\n"
+"out vec2 Texcoord;\n"
+"out float Depth;\n"
+
+"uniform mat4 model;"
+"uniform mat4 view;"
+"uniform mat4 proj;"
+"uniform float time;"
+
+// Apart from regular C types, GLSL has built-in vector and matrix types
+// identified by vec* and mat* identifiers.
+// the values within these constructs is always a float.
+// The number after vec specifies the number of components(x,y,z,w) and
+// the number after mat specifies the number of rows/columns.
+// Since the position attribute consists of only an x and y coordinate, vec2 is perfect
+"void main()\n"
+"{\n"
+
+"float redValue = color.r + 0.1f * time;"
+"float redSin = sin(redValue);" //should be 0
+"redSin *= 0.5f;"
+"redSin += 0.5f;"
+
+//"float blueSin = cos(time);" //should be 1
+//"blueSin *= 0.5f;"
+//"blueSin += 0.5f;"
+
+"float red = redSin;" //should be 0
+//"float blue = blueSin;" //should be 1
+
+"float blue = 1.0f - red;"
+// You can be quite creative when working with vertex types.
+// In the example above a shortcuts was used to set the first two components of the vec4
+// to those of vec2. the following 2 lines are equal
+// gl_Position = vec(position, 0.0f, 1.0f);
+// gl_Position = vec(position.x, position.y, 0.0f, 1.0f);
+// When you're working with colors, you can also access the individual components with r, g, b and a
+// instead of x, y, z and w. this makes no difference and can help with clarity.
+// The final position of the vertex assigned to the special gl_Position variable,
+// because the position is needed for primitive assembly and many other built-in processes.
+// For these to function correctly, the last value w needs to have a value of 1.0f.
+// Other than that, you're free to do anything you want with the attributes.
+"gl_Position = proj * view * model * vec4(position, 1.0f);\n"
+"Color = vec3(red, color.g, blue);\n"
+//"Color = color;"
+"Texcoord = texcoord;\n"
+//"Depth = gl_Position.z;\n"
+"}\n";
+
+const char* fragmentSource =
+"#version 150 core\n"
+
+// You'll immediately notice that we're not using some built-in variable for outputting the color, say gl_FragColor.
+// This is because a fragment shader can in fact output multiple colors.
+// The outColor variable uses the type vec4, because each color consists of a red, green, blue and alpha component.
+// Colors in OpenGL are generally represented as floating point number between 0.0 and 1.0 instead of the common 0 and 255.
+
+// Vertex attributes are not the only way to pass data to shader programs. There is another way to pass data to shaders called uniforms.
+// These are essentially global variables, having the same value for all vertices and/or fragments.
+"in vec3 Color;\n"
+"in vec2 Texcoord;\n"
+"in float Depth;\n"
+"out vec4 outColor;\n"
+
+// The small images are in a texture array, the rects take the texture coordinates of the cube to their place in the atlas.
+// HaloInfinite is a texture of its own, so the texture manager can stream its levels in and out.
+"uniform sampler2D texHalo;\n"
+"uniform sampler2DArray texAtlas;\n"
+"uniform vec4 googleRect;\n"
+"uniform float googleLayer;\n"
+"uniform vec3 extraColor;\n"
+
+// HaloInfinite can be a virtual texture instead, see VirtualTexture.h for the uniforms
+"uniform bool virtualHalo;\n"
+"uniform sampler2D vtPhysical;\n"
+"uniform sampler2D vtIndirection;\n"
+"uniform float vtPages;\n"
+"uniform float vtLevelCount;\n"
+"uniform vec4 vtPage;\n"
+
+// Picks the level like the feedback shader does, looks up where its page is and samples it in the physical texture.
+// When the page isn't there yet, the indirection entry points to a coarser page that covers the same part.
+"vec4 SampleVirtual(vec2 uv)\n"
+"{\n"
+"vec2 texel = uv * vtPages * vtPage.x;\n"
+"vec2 dx = dFdx(texel);\n"
+"vec2 dy = dFdy(texel);\n"
+"int level = int(clamp(floor(0.5f * log2(max(dot(dx, dx), dot(dy, dy)))), 0.0f, vtLevelCount - 1.0f));\n"
+"uv = clamp(uv, 0.0f, 0.99999f);\n"
+"vec4 entry = texelFetch(vtIndirection, ivec2(uv * (vtPages / exp2(float(level)))), level) * 255.0f;\n"
+"vec2 inPage = fract(uv * (vtPages / exp2(floor(entry.z + 0.5f))));\n"
+"vec2 physical = floor(entry.xy + 0.5f) * vtPage.z + vtPage.y + inPage * vtPage.x;\n"
+"return textureLod(vtPhysical, physical / vtPage.w, 0.0f);\n"
+"}\n"
+
+"void main()\n"
+"{\n"
+"vec4 colHalo = virtualHalo ? SampleVirtual(Texcoord) : texture(texHalo, Texcoord);//  * vec4(Color, 1.0f);\n"
+"vec4 colGoogle = texture(texAtlas, vec3(Texcoord * googleRect.zw + googleRect.xy, googleLayer));//  * vec4(Color, 1.0f);\n"
+
+// the mix function is a special GLSL function that linearly interpolates between 2 variables based on the third parameter.
+// A value of 0.0 will result in the first value, a value of 1.0 will result in the second value and a value in between will
+// result in a mixture of both.
+"outColor = mix(colHalo, colGoogle, 0.5f);"
+"outColor *= vec4(Color, 1.0f);"
+"//outColor *= vec4(extraColor, 1.0f);\n"
+//"outColor = vec4(1 - Depth, 1 - Depth, 1 - Depth, 1.0f);" // display depth
+"}\n";
+
+const char* screenVertexSource =
+"#version 150 core\n"
+"in vec2 position;\n"
+"in vec2 texCoord;\n"
+"out vec2 Texcoord;\n"
+"uniform vec2 renderScale;\n"
+"void main() \n"
+"{\n"
+"Texcoord = texCoord * renderScale;\n"
+"gl_Position = vec4(position, 0.0f, 1.0f);\n"
+"}";
+
+const char* screenFragmentSource = 
+R"glsl(
+#version 150 core
+in vec2 Texcoord;
+out vec4 outColor;
+uniform sampler2D texFramebuffer;
+uniform vec2 maxTexcoord;
+const float blurSizeH = 1.0f / 800.0f;
+const float blurSizeV = 1.0f / 800.0f;
+void main()
+{
+
+// The scene only covers the lower left part of the texture, linear filtering mustn't pick up the pixels next to it.
+outColor = texture(texFramebuffer, min(Texcoord, maxTexcoord));
+
+//vec4 top = texture(texFramebuffer, vec2(Texcoord.x, Texcoord.y + 1.0 / 200.0));
+//vec4 bottom = texture(texFramebuffer, vec2(Texcoord.x, Texcoord.y - 1.0 / 200.0));
+//vec4 left = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y));
+//vec4 right = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y));
+//vec4 topLeft = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y + 1.0 / 200.0f));
+//vec4 topRight = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y + 1.0 / 200.0f));
+//vec4 bottomLeft = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y - 1.0 / 200.0f));
+//vec4 bottomRight = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y - 1.0 / 200.0f));
 //
-//const char* screenFragmentSource = 
-//R"glsl(
-//#version 150 core
-//in vec2 Texcoord;
-//out vec4 outColor;
-//uniform sampler2D texFramebuffer;
-//const float blurSizeH = 1.0f / 800.0f;
-//const float blurSizeV = 1.0f / 800.0f;
-//void main()
+//vec4 sx = -topLeft - 2 * left - bottomLeft + topRight + 2 * right + bottomRight;
+//vec4 sy = -topLeft - 2 * top - topRight + bottomLeft + 2 * bottom + bottomRight;
+//vec4 sobel = sqrt(sx * sx + sy * sy);
+//outColor = sobel;
+
+// blur
+//vec4 sum = vec4(0.0f);
+//for (int x = -4; x <= 4; ++x)
 //{
-//
+//for (int y = -4; y <= 4; ++y)
+//{
+//sum += texture(texFramebuffer, vec2(Texcoord.x + x * blurSizeH, Texcoord.y + y * blurSizeV)) / 81.0f;
+//}
+//}
+//outColor = sum;
+
+// gray scale:
 //outColor = texture(texFramebuffer, Texcoord);
-//
-////vec4 top = texture(texFramebuffer, vec2(Texcoord.x, Texcoord.y + 1.0 / 200.0));
-////vec4 bottom = texture(texFramebuffer, vec2(Texcoord.x, Texcoord.y - 1.0 / 200.0));
-////vec4 left = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y));
-////vec4 right = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y));
-////vec4 topLeft = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y + 1.0 / 200.0f));
-////vec4 topRight = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y + 1.0 / 200.0f));
-////vec4 bottomLeft = texture(texFramebuffer, vec2(Texcoord.x - 1.0 / 300.0, Texcoord.y - 1.0 / 200.0f));
-////vec4 bottomRight = texture(texFramebuffer, vec2(Texcoord.x + 1.0 / 300.0, Texcoord.y - 1.0 / 200.0f));
-////
-////vec4 sx = -topLeft - 2 * left - bottomLeft + topRight + 2 * right + bottomRight;
-////vec4 sy = -topLeft - 2 * top - topRight + bottomLeft + 2 * bottom + bottomRight;
-////vec4 sobel = sqrt(sx * sx + sy * sy);
-////outColor = sobel;
-//
-//// blur
-////vec4 sum = vec4(0.0f);
-////for (int x = -4; x <= 4; ++x)
-////{
-////for (int y = -4; y <= 4; ++y)
-////{
-////sum += texture(texFramebuffer, vec2(Texcoord.x + x * blurSizeH, Texcoord.y + y * blurSizeV)) / 81.0f;
-////}
-////}
-////outColor = sum;
-//
-//// gray scale:
-////outColor = texture(texFramebuffer, Texcoord);
-////float avg = (outColor.r + outColor.g + outColor.b) * 0.3f;
-////float avg = 0.2126f * outColor.r + 0.7152f * outColor.g + 0.0722 * outColor.b;
-//
-//
-//})glsl";
+//float avg = (outColor.r + outColor.g + outColor.b) * 0.3f;
+//float avg = 0.2126f * outColor.r + 0.7152f * outColor.g + 0.0722 * outColor.b;
+
+
+})glsl";
 //
 //const char* vertexShaderSrc = R"glsl(
 //#version 150 core
@@ -759,68 +810,34 @@ GLuint CreateShader(GLenum type, const GLchar* src)
 	return shader;
 }
 
-void specifySceneVertexAttribute(GLuint shaderProgram)
-{
-	// Although we have our vertex data and shaders now, OpenGL still doesn't know how the attributes are formatted and ordered. 
-		// You first need to retrieve a reference to the position input in the vertex shader
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-
-	// The location is a number depending on the order of the input definitions.
-	// The first and only input position in this example will always have location 0
-	// With the reference to the input, you can specify how the data for that input is retrieved from the array.
-	// The first parameter references the input.
-	// The second parameter specifies the number of values for that input, which is the same as the number of components
-	// The third parameter specifies what type the values are
-	// The fourth parameter specifies whether the input values should be normalized between -1.0 and 1.0 or
-	// 0.0 and 1.0 depending on the format if they aren't floating point numbers.
-	// the last 2 parameters are arguably the most important here as they specify how the attribute is laid out in the vertex array.
-	// The first numbers specifies the stride, or how many bytes are between each position attribute in the array.
-	// The value 0 means that there is no data in between. This is currently the case as the position of each vertex
-	// is immediately followed by the position of the next vertex.
-	// the last parameter specifies the offset, or how many bytes from the start of the array the attribute occurs.
-	// Since there are no other attributes, this is 0 as well.
-
-	// It is important to know that this function will store not only the stride and the offset, but also the VBO that is currently bound to GL_ARRAY_BUFFER.
-	// that means that you don't have to explicitly bind the correct VBO when the actual drawing functions are called.
-	// This also implies that you can use a different VBO for each attribute
-	glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), 0);
-
-	// Last but not least, the vertexattribarray should be enabled.
-	glEnableVertexAttribArray(posAttrib);
-
-	// The same for colorAttrib
-	GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-
-	// The fifth paramter is set to 5*sizeof(float) now, because each vertex consists of 5 floating point atttribute values.
-	// The offset of 2*sizeof(float) for the color attribute is there because each vertex starts with 2 floating point
-	// values for the position that it has to skip over.
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(colAttrib);
-
-	GLint texAttrib = (glGetAttribLocation(shaderProgram, "texcoord"));
-	glEnableVertexAttribArray(texAttrib);
-	glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-	// As soon as you've bound a certain VAO, every time you call glVertexAttribPointer,
-	// that information will be stored in that VAO. This makes switching between different
-	// vertex data and vertex formats as easy as binding a different VAO!
-	// Just remember that a VAO doesn't store any vertex data by itself, it just references the VBOs
-	// you've created and how to retrieve the attribute values from them.
-
-	// Since only call after binding a VAO stick to it, make sure that you've created and bound the VAO at the start
-	// of your program. Any vertex buffers and element buffers bound before it will be ignored.
-}
+// Although we have our vertex data and shaders now, OpenGL still doesn't know how the attributes are formatted and ordered.
+// For every input of the vertex shader, VertexLayout::Specify retrieves a reference with glGetAttribLocation and
+// tells glVertexAttribPointer how the data for that input is retrieved from the array:
+// the number of components, their type, whether values that aren't floating point numbers are normalized
+// between -1.0 and 1.0 or 0.0 and 1.0, and the 2 most important ones, the stride and the offset.
+// The stride is how many bytes are between each position attribute in the array, the offset how many bytes
+// from the start of the array the attribute occurs. VertexLayout works both out when compiling from the types of the inputs.
 
-void SpecifyScreenVertexAttributes(GLuint shaderProgram)
-{
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	glEnableVertexAttribArray(posAttrib);
-	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+// It is important to know that glVertexAttribPointer will store not only the stride and the offset, but also the VBO that is currently bound to GL_ARRAY_BUFFER.
+// that means that you don't have to explicitly bind the correct VBO when the actual drawing functions are called.
+// This also implies that you can use a different VBO for each attribute
 
-	GLint texAttrib = glGetAttribLocation(shaderProgram, "texCoord");
-	glEnableVertexAttribArray(texAttrib);
-	glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-}
+// As soon as you've bound a certain VAO, every time you call glVertexAttribPointer,
+// that information will be stored in that VAO. This makes switching between different
+// vertex data and vertex formats as easy as binding a different VAO!
+// Just remember that a VAO doesn't store any vertex data by itself, it just references the VBOs
+// you've created and how to retrieve the attribute values from them.
+
+// Since only call after binding a VAO stick to it, make sure that you've created and bound the VAO at the start
+// of your program. Any vertex buffers and element buffers bound before it will be ignored.
+
+// Each vertex of the cube and the floor is a position, a color and a texture coordinate
+typedef VertexLayout<VertexInput<PositionName, glm::vec3>, VertexInput<ColorName, glm::vec3>, VertexInput<TexcoordName, glm::vec2>> SceneVertexLayout;
+static_assert(SceneVertexLayout::stride == 8 * sizeof(float), "The scene vertices are 8 floats");
+
+// The screen shader calls its texture coordinate texCoord
+struct ScreenTexcoordName { static const char* Name() { return "texCoord"; } };
+typedef VertexLayout<VertexInput<PositionName, glm::vec2>, VertexInput<ScreenTexcoordName, glm::vec2>> ScreenVertexLayout;
 
 #define THIRD_PART
 
@@ -856,7 +873,8 @@ int main()
 	const int WIDTH = 800;
 	const int HEIGHT = 600;
 
-	sf::Window window(sf::VideoMode(WIDTH, HEIGHT, 32), "OpenGL Test Project", sf::Style::Titlebar | sf::Style::Close, settings);
+	// Style::Default includes Style::Resize, all render targets follow the size of the window.
+	sf::Window window(sf::VideoMode(WIDTH, HEIGHT, 32), "OpenGL Test Project", sf::Style::Default, settings);
 
 	// Initialize GLEW
 	glewExperimental = GL_TRUE;
@@ -864,32 +882,20 @@ int main()
 
 #ifdef THIRD_PART
 
-	GLuint shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(shader, 1, &finalVertexshaderSrc, nullptr);
-	glCompileShader(shader);
-
-	GLuint geoShader = glCreateShader(GL_GEOMETRY_SHADER);
-	glShaderSource(geoShader, 1, &finalGeometryShaderSrc, nullptr);
-	glCompileShader(geoShader);
-
-
-	GLuint program = glCreateProgram();
-	glAttachShader(program, shader);
-	glAttachShader(program, geoShader);
-
-	const char* feedbackVaryings[] = { "outValue" };
-	
-	// The first parameter is self-explanatory, the second and third parameter specify
-	// th elength of the output names array and the array itself, and the final paramter
-	// specifies how the data should be written.
+	// The shaders are read from Data/Shaders, the sources at the top of this file are used when they aren't there.
+	// Saving one of them while the program runs builds the program again and runs the feedback once more with it.
+	ShaderLibrary shaders;
+	shaders.Create();
 
+	// The outputs that are written to the feedback buffer are named before the program is linked,
+	// ShaderLibrary calls glTransformFeedbackVaryings every time it links the program.
 	// the following 2 formats are avaiable:
 	// GL_INTERLEAVED_ATTRIBS: Write all attributes to a single buffer object
 	// GL_SEPARATE_ATTRIBS: Writes attributes to multiple buffer objects or at different offsets into a buffer.
-	glTransformFeedbackVaryings(program, 1, feedbackVaryings, GL_INTERLEAVED_ATTRIBS);
-
-	glLinkProgram(program);
-	glUseProgram(program);
+	// ShaderLibrary always interleaves them, there's only one output here anyway.
+	int feedbackProgram = shaders.LoadFeedback("../../Data/Shaders/feedback.vert", "../../Data/Shaders/feedback.geom",
+		finalVertexshaderSrc, finalGeometryShaderSrc, { "outValue" });
+	GLuint program = shaders.GetProgram(feedbackProgram);
 
 	GLuint vao;
 	glGenVertexArrays(1, &vao);
@@ -905,9 +911,19 @@ int main()
 	// root of and transform feedback will help us get the results back.
 	glBufferData(GL_ARRAY_BUFFER, sizeof(data), data, GL_STATIC_DRAW);
 
-	GLint inputAttrib = glGetAttribLocation(program, "inValue");
-	glEnableVertexAttribArray(inputAttrib);
-	glVertexAttribPointer(inputAttrib, 1, GL_FLOAT, GL_FALSE, 0, 0);
+	struct InValueName { static const char* Name() { return "inValue"; } };
+	typedef VertexLayout<VertexInput<InValueName, float>> FeedbackVertexLayout;
+	FeedbackVertexLayout::Specify(program);
+
+	// A rebuilt program can have its input somewhere else
+	shaders.SetOnSwap(feedbackProgram, [&](GLuint newProgram)
+	{
+		program = newProgram;
+
+		glBindVertexArray(vao);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		FeedbackVertexLayout::Specify(program);
+	});
 
 	// Trnaform feedback will return the values of outValue,
 	// but first we'll need to create a VBO to hold these, just like the input vertices.
@@ -928,66 +944,113 @@ int main()
 	GLuint query;
 	glGenQueries(1, &query);
 
-	// We don't need to render anything so disable the rasterizer
-	glEnable(GL_RASTERIZER_DISCARD);
+	auto runFeedback = [&]()
+	{
+		glUseProgram(program);
+		glBindVertexArray(vao);
 
-	// to actually bind the buffer we've created above as transform feedback buffer,
-	// we have to use a new functoin caled glBindBufferBase.
-	
-	// The first paramter is currently required to be GL_TRANSFORM_FEEDBACK_BUFFER
-	// to allow for future extensions. the second paramter is the index of the output variable, 
-	// whic is simply 0 because we only have one.
-	// The final parameter specifies the buffer object to bind.
+		// We don't need to render anything so disable the rasterizer
+		glEnable(GL_RASTERIZER_DISCARD);
 
-	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, tbo);
+		// to actually bind the buffer we've created above as transform feedback buffer,
+		// we have to use a new functoin caled glBindBufferBase.
 
-	// Before doing the draw call, you have to enter transform feedback mode
-	// The possible values for the primitive mode are:
-	// GL_POINTS - GL_POINTS
-	// GL_LINES - GL_LINES, GL_LINE_lOOP, GL_LINE_STRIP, GL_LINES_ADJACENCY, GL_LINE_STRIP_ADJACENCY
-	// GL_TRIANGLES -- GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES_ADJACENCY, GL_TRIANGLE_STRIP_ADJACENCY
+		// The first paramter is currently required to be GL_TRANSFORM_FEEDBACK_BUFFER
+		// to allow for future extensions. the second paramter is the index of the output variable, 
+		// whic is simply 0 because we only have one.
+		// The final parameter specifies the buffer object to bind.
 
-	// Right before glBeginTransformFeedback, we have to tell OpenGL to keep track
-	// of the number of primitive written
-	glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, tbo);
 
-	// When using a geometry shader, the primitive specified to glBeginTransformFeedback
-	// must match the output type of the geometry shader.
-	glBeginTransformFeedback(GL_TRIANGLES);
+		// Before doing the draw call, you have to enter transform feedback mode
+		// The possible values for the primitive mode are:
+		// GL_POINTS - GL_POINTS
+		// GL_LINES - GL_LINES, GL_LINE_lOOP, GL_LINE_STRIP, GL_LINES_ADJACENCY, GL_LINE_STRIP_ADJACENCY
+		// GL_TRIANGLES -- GL_TRIANGLES, GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN, GL_TRIANGLES_ADJACENCY, GL_TRIANGLE_STRIP_ADJACENCY
 
-	// If you only have a vertex shader, the primitive must match the one being drawn.
-	glDrawArrays(GL_POINTS, 0, 5);
+		// Right before glBeginTransformFeedback, we have to tell OpenGL to keep track
+		// of the number of primitive written
+		glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query);
 
-	glEndTransformFeedback();
-	glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+		// When using a geometry shader, the primitive specified to glBeginTransformFeedback
+		// must match the output type of the geometry shader.
+		glBeginTransformFeedback(GL_TRIANGLES);
 
-	glDisable(GL_RASTERIZER_DISCARD);
+		// If you only have a vertex shader, the primitive must match the one being drawn.
+		glDrawArrays(GL_POINTS, 0, 5);
 
-	// Normally, at the end of a drawing operation, we'd swap the buffers to present the result on the screen.
-	// We still want to make sure the rendering operation has finished before trying to access the results,
-	// so we flush OpenGL's command buffer
-	glFlush();
-	
-	// Retrieve query result:
-	GLuint primitives;
-	glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
-	
-	std::cout << primitives << " primitives written" << std::endl;
+		glEndTransformFeedback();
+		glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
 
-	// Query objects can also be used to record things such as GL_PRIMITIVES_GENERATED
-	// when dealing with just geometry shaders and GL_TIME_ELAPSED to measure time spent ont
-	// the server (GPU) doing work.
+		glDisable(GL_RASTERIZER_DISCARD);
 
-	float feedback[15];
-	glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sizeof(feedback), feedback);
+		// Normally, at the end of a drawing operation, we'd swap the buffers to present the result on the screen.
+		// We still want to make sure the rendering operation has finished before trying to access the results,
+		// so we flush OpenGL's command buffer
+		glFlush();
 
-	for (int i = 0; i < 15; ++i)
-		std::cout << feedback[i] << std::endl;
-	
-	std::cin.get();
+		// Retrieve query result:
+		GLuint primitives;
+		glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+
+		std::cout << primitives << " primitives written" << std::endl;
+
+		// Query objects can also be used to record things such as GL_PRIMITIVES_GENERATED
+		// when dealing with just geometry shaders and GL_TIME_ELAPSED to measure time spent ont
+		// the server (GPU) doing work.
+
+		float feedback[15];
+		glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, sizeof(feedback), feedback);
 
-	glDeleteProgram(program);
-	glDeleteShader(shader);
+		for (int i = 0; i < 15; ++i)
+			std::cout << feedback[i] << std::endl;
+	};
+
+	runFeedback();
+
+	// The window stays open until it's closed, the results are printed again every time a shader file is saved
+	FileWatcher watcher;
+	watcher.Create();
+	for (const std::string& path : shaders.GetPaths())
+		watcher.Watch(path);
+
+	int reloadCount = shaders.GetReloadCount();
+	bool running = true;
+
+	while (running)
+	{
+		sf::Event windowEvent;
+		while (window.pollEvent(windowEvent))
+		{
+			switch (windowEvent.type)
+			{
+			case sf::Event::Closed:
+				running = false;
+				break;
+			case sf::Event::KeyPressed:
+				if (windowEvent.key.code == sf::Keyboard::Escape)
+					running = false;
+				break;
+			}
+		}
+
+		for (const std::string& path : watcher.Poll())
+			shaders.Reload(path);
+		shaders.Update();
+
+		if (shaders.GetReloadCount() != reloadCount)
+		{
+			reloadCount = shaders.GetReloadCount();
+			runFeedback();
+		}
+
+		// Nothing is drawn, so there's no need to check the files more often than a frame would
+		std::this_thread::sleep_for(std::chrono::milliseconds(16));
+	}
+
+	watcher.Destroy();
+	shaders.Destroy();
+	glDeleteQueries(1, &query);
 	glDeleteBuffers(1, &tbo);
 	glDeleteBuffers(1, &vbo);
 
@@ -1031,17 +1094,9 @@ int main()
 	glBindVertexArray(vao);
 
 	// Sepecify layout of points data
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "pos");
-	glEnableVertexAttribArray(posAttrib);
-	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 6 * sizeof(float), 0);
-
-	GLint colorAttrib = glGetAttribLocation(shaderProgram, "color");
-	glEnableVertexAttribArray(colorAttrib);
-	glVertexAttribPointer(colorAttrib, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(2 * sizeof(float)));
-	
-	GLint sidesAttrib = glGetAttribLocation(shaderProgram, "sides");
-	glEnableVertexAttribArray(sidesAttrib);
-	glVertexAttribPointer(sidesAttrib, 1, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(5 * sizeof(float)));
+	struct PosName { static const char* Name() { return "pos"; } };
+	struct SidesName { static const char* Name() { return "sides"; } };
+	VertexLayout<VertexInput<PosName, glm::vec2>, VertexInput<ColorName, glm::vec3>, VertexInput<SidesName, float>>::Specify(shaderProgram);
 
 	bool running = true;
 
@@ -1077,12 +1132,8 @@ int main()
 
 	// Luckily, OpenGL solves that problem with Vertex Array Objects (VAO). VAOs store all of the links between the attributes and your VBOs with raw vertex data
 	// A VAO is created in the same way as a VBO.
-	GLuint vaoCube, vaoQuad;
-	glGenVertexArrays(1, &vaoCube);
-	glGenVertexArrays(1, &vaoQuad);
-
-	// To start using is, simply bind it
-	//glBindVertexArray(vaoCube);
+	// The cache makes one per vertex layout, so the scene and the feedback pass share the one of the cube.
+	VertexArrayCache vertexArrays;
 
 	// The next step is to upload this vertex data to the graphics card. 
 	// This is important because the memory on your graphics card is much faster and
@@ -1118,33 +1169,161 @@ int main()
 	glBindBuffer(GL_ARRAY_BUFFER, vboQuad);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
 
+	// With a pack made by Tools/AssetPacker everything in Data is read from that one memory mapped file,
+	// only what isn't in the pack comes from loose files.
+	AssetPack assets;
+	if (assets.Open("../../Data/Assets.pak"))
+	{
+		MountAssetPack(&assets, "../../Data/");
+		std::cout << "Asset pack with " << assets.GetEntryCount() << " assets\n";
+	}
+
+	// Decoded images are kept in Data/Cache, so from the second start on no PNG is decoded and no mip chain is built.
+	// Tools/ImageCacheTool fills it ahead of time and removes what isn't used anymore.
+	ImageCache imageCache;
+	if (imageCache.Create("../../Data/Cache"))
+		SetImageCache(&imageCache);
+
+	// With a page file made by Tools/VirtualTextureBuilder HaloInfinite is a virtual texture,
+	// only the pages the feedback pass asks for are on the GPU then.
+	VirtualTexture virtualHalo;
+	bool useVirtualHalo = virtualHalo.Create("../../Data/HaloInfinite.vtp");
+
+	// Start loading the textures while the shaders compile.
+	// The small images are packed into one atlas on a loader thread, so every material of the scene shares a single texture bind.
+	// An atlas can only be packed once, so when one of its images is saved a new atlas is packed and replaces the old one.
+	const std::string googlePath = "../../Data/img.png";
+	auto startPacking = [&googlePath](TextureAtlas* target)
+	{
+		// Returns the entry of the image, -1 when the atlas couldn't be made
+		return std::async(std::launch::async, [target, googlePath]()
+		{
+			int entry = target->AddFile(googlePath);
+			return entry != -1 && target->Pack() ? entry : -1;
+		});
+	};
+
+	std::unique_ptr<TextureAtlas> atlas(new TextureAtlas());
+	std::future<int> atlasPacked = startPacking(atlas.get());
+
+	// Big textures are loaded by the texture manager, it keeps them within a budget of GPU memory.
+	// HaloInfinite takes about 11 MB with its mip chain, press T for the smaller budgets that make it drop its top levels.
+	std::vector<size_t> textureBudgets = { 64 * 1024 * 1024, 4 * 1024 * 1024, 1024 * 1024 };
+	int textureBudget = 0;
+
+	// A DDS made by Tools/TextureCompressor is used when it's there, the PNG otherwise
+	TextureManager textures;
+	textures.Create(textureBudgets[textureBudget]);
+	int haloTexture = useVirtualHalo ? -1 : textures.Load("../../Data/HaloInfinite.dds", "../../Data/HaloInfinite.png");
+
 	// Create shader programs
-	GLuint sceneVertexShader, sceneFragmentShader, sceneShaderProgram;
-	CreateShaderProgram(vertexSource, fragmentSource, sceneVertexShader, sceneFragmentShader, sceneShaderProgram);
+	// The shaders are read from Data/Shaders, the sources at the top of this file are used when they aren't there.
+	// Saving one of the files while the program runs rebuilds the programs that use it, see the start of the main loop.
+	ShaderLibrary shaders;
+	shaders.Create();
 
-	GLuint screenVertexShader, screenFragmentShader, screenShaderProgram;
-	CreateShaderProgram(screenVertexSource, screenFragmentSource, screenVertexShader, screenFragmentShader, screenShaderProgram);
+	int sceneProgram = shaders.Load("../../Data/Shaders/scene.vert", "../../Data/Shaders/scene.frag", vertexSource, fragmentSource);
+	GLuint sceneShaderProgram = shaders.GetProgram(sceneProgram);
 
-	// Specify the layout of the vertex data
-	glBindVertexArray(vaoCube);
-	glBindBuffer(GL_ARRAY_BUFFER, vboCube);
-	specifySceneVertexAttribute(sceneShaderProgram);
+	int screenProgram = shaders.Load("../../Data/Shaders/screen.vert", "../../Data/Shaders/screen.frag", screenVertexSource, screenFragmentSource);
+	GLuint screenShaderProgram = shaders.GetProgram(screenProgram);
 
-	glBindVertexArray(vaoQuad);
-	glBindBuffer(GL_ARRAY_BUFFER, vboQuad);
-	SpecifyScreenVertexAttributes(screenShaderProgram);
+	// The cube comes from Data/Meshes. After the first start its mesh file in Data/Cache is uploaded straight from a memory mapping,
+	// the OBJ is only parsed again when it changes. The vertices at the top of this file are drawn when it isn't there.
+	Mesh cubeMesh;
+	bool useCubeMesh = cubeMesh.Load("../../Data/Meshes/cube.obj", "../../Data/Cache/cube.mesh");
 
-	// Load textures
-	GLuint texHalo = LoadTexture("../../Data/HaloInfinite.png");
-	GLuint texGoogle = LoadTexture("../../Data/img.png");
+	auto getCubeVertexArray = [&](GLuint program)
+	{
+		return vertexArrays.Get(program, useCubeMesh ? cubeMesh.GetVertexFormat() : SceneVertexLayout::GetFormat());
+	};
+
+	auto bindCube = [&](int vertexArray)
+	{
+		if (useCubeMesh)
+			vertexArrays.Bind(vertexArray, cubeMesh.GetVertexBuffer(), cubeMesh.GetIndexBuffer());
+		else
+			vertexArrays.Bind(vertexArray, vboCube);
+	};
+
+	// The cube picks its level of detail from its size on screen every frame
+	LodSelector cubeLodSelector;
+	int cubeLod = 0;
+
+	// The objects that can leave the screen are kept in a bounding volume hierarchy, which culls them against the camera
+	// and against the mirrored cameras of the reflections every frame. The floor is a reflector, the reflection manager culls it itself.
+	Bvh sceneBvh;
+	int cubeObject = sceneBvh.Add(glm::vec3(-0.5f), glm::vec3(0.5f));
+	sceneBvh.Build();
+	std::vector<unsigned int> visibleObjects;
+	bool cubeVisible = true;
 
+	// Objects that are on screen can still be hidden behind the floor or the wall, which the GPU finds out with occlusion queries
+	OcclusionCuller occlusion;
+	occlusion.Create();
+	int cubeOccludee = occlusion.Add();
+
+	auto drawCube = [&]()
+	{
+		if (useCubeMesh)
+			cubeMesh.Draw(cubeLod);
+		else
+			glDrawArrays(GL_TRIANGLES, 0, 36);
+	};
+
+	// Specify the layout of the vertex data
+	int cubeVertexArray = getCubeVertexArray(sceneShaderProgram);
+	int quadVertexArray = vertexArrays.Get(screenShaderProgram, ScreenVertexLayout::GetFormat());
+	int wallVertexArray = vertexArrays.Get(sceneShaderProgram, SceneVertexLayout::GetFormat());
+
+	// Load textures
 	glUseProgram(sceneShaderProgram);
-	glUniform1i(glGetUniformLocation(sceneShaderProgram, "texHalo"), 0);
-	glUniform1i(glGetUniformLocation(sceneShaderProgram, "texGoogle"), 1);
+	glUniform1i(glGetUniformLocation(sceneShaderProgram, "texAtlas"), 0);
+	glUniform1i(glGetUniformLocation(sceneShaderProgram, "texHalo"), 1);
+	glUniform1i(glGetUniformLocation(sceneShaderProgram, "vtPhysical"), 3);
+	glUniform1i(glGetUniformLocation(sceneShaderProgram, "vtIndirection"), 4);
+	glUniform1i(glGetUniformLocation(sceneShaderProgram, "virtualHalo"), useVirtualHalo);
+	if (useVirtualHalo)
+		virtualHalo.SetUniforms(sceneShaderProgram);
+
+	int googleEntry = atlasPacked.get();
+	bool atlasReady = googleEntry != -1;
+
+	auto setAtlasUniforms = [&](GLuint program)
+	{
+		const AtlasEntry& google = atlas->GetEntry(googleEntry);
+		glUniform4fv(glGetUniformLocation(program, "googleRect"), 1, glm::value_ptr(google.uvRect));
+		glUniform1f(glGetUniformLocation(program, "googleLayer"), (float)google.layer);
+	};
+
+	auto uploadAtlas = [&]()
+	{
+		atlas->Upload();
+		std::cout << "Atlas: " << atlas->GetLayerCount() << " layer(s), " << std::fixed << std::setprecision(1)
+			<< atlas->GetOccupancy() * 100.0f << "% occupied\n" << std::defaultfloat;
+
+		glUseProgram(sceneShaderProgram);
+		setAtlasUniforms(sceneShaderProgram);
+	};
+
+	if (atlasReady)
+		uploadAtlas();
+	GLuint texAtlas = atlas->GetTexture();
+
+	// The atlas that is packed on the loader thread after an image was saved
+	std::unique_ptr<TextureAtlas> repackedAtlas;
+	std::future<int> atlasRepacked;
+	bool atlasRepackQueued = false;
 
 	glUseProgram(screenShaderProgram);
 	glUniform1i(glGetUniformLocation(screenShaderProgram, "texFramebuffer"), 0);
 
+	// Part of the framebuffer texture the scene was rendered into, see DynamicResolution
+	GLint uniRenderScale = glGetUniformLocation(screenShaderProgram, "renderScale");
+	GLint uniMaxTexcoord = glGetUniformLocation(screenShaderProgram, "maxTexcoord");
+	glUniform2f(uniRenderScale, 1.0f, 1.0f);
+	glUniform2f(uniMaxTexcoord, 1.0f, 1.0f);
+
 	GLint uniModel = glGetUniformLocation(sceneShaderProgram, "model");
 
 	//Create framebuffer
@@ -1154,8 +1333,7 @@ int main()
 	// 2) There must be at least one color attachment (OpenGL 4.1 and earlier)
 	// 3) All attachments are copmlete (For example, a texture attachment needs to have memory reserved).
 	// 4) All attachments must have the same number of multisamples.
-	GLuint frameBuffer;
-	glGenFramebuffers(1, &frameBuffer);
+	// The framebuffers themselves are created by the render graph, one for every pass that writes to textures.
 
 	// You can check if a framebuffer is complete at any time by calling glCheckFramebufferStatus and check if it returns GL_FRAMEBUFFER_COMPLETE.
 	// you don't have to do this check, but it's usually a good thing to verify, just like checking if your shaders compiled successfully.
@@ -1164,8 +1342,6 @@ int main()
 	// OpenGL makes a distinciton here between GL_DRAW_FRAMEBUGGER and GL_READ_FRAMEBUFFER.
 	// The tramebuffer bound to read is used in calls to glReadPixels, but since this distinction in normal applications
 	// is fairly rare, you can have your actions aply to both by using GL_FRAMEBUFFER
-	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-
 	// Framebuffers can only be used as a render target if memory has been allocated to store the results.
 	// This is done by attaching images for each buffer (color, depth, stencil or a combinatoin of depth and stencil).
 	// There are 2 kinds of objects that can function as images: texture objects and renderbuffer objects.
@@ -1175,38 +1351,67 @@ int main()
 	// We'd like to be able to render a scene and then use the result in the color buffer in another rendering operation,
 	// so a texture is ideal in this case. Creating a texture for use as an image for the color buffer of the new framebuffer is as imple as
 	// creating any texture.
-	GLuint texColorBuffer;
-	glGenTextures(1, &texColorBuffer);
-	glBindTexture(GL_TEXTURE_2D, texColorBuffer);
+	// Instead of creating the texture once at a fixed size, it's taken from a pool of render targets every frame.
+	// The pool hands back the same texture every frame as long as the size doesn't change,
+	// and creates a new one after the window was resized. See the start of the main loop.
 
 	// The difference between this texture and the textures you've seen before is the NULL value for the data parameter.
 	// that makes sense, because the data is going to be created dynamically this time with rendering operations.
 	// Since this is the image for the color buffer, the format and internalFormat parameters are a bit more restricted
 	// the format parameter will typically be limited to either GL_RGB or GL_RGBA and the internalFormat to the color formats.
 	// The resolution doesn't have to match the one of the default framebuffer but don't forget a glViewport call if you decide to vary.
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// attach the image to the framebuffer
-	// the second parameter implies that you can have mulitple color attachments.
-	// a fragment shader can output different data to any of these by linking out variables to attachments with the glBindFragDataLocation
-	// function we used earlier. We'll stick to one output for now. The last parameter specifies the mipmap level the image should be attached to.
 	// Mipmapping is not of any use, since the color buffer image will be rendered at its riginal size when using it for post-processing.
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
 
 	// As we're using a depth and stencil buffer to render the spinnig cube, we'll have to create them aswell.
 	// OpenGL allows you to combine those into one image, so we'll have to create just one more before we can use the framebuffer.
 	// Although we could do this by creating another texture, it is more efficient to store htese buffers in a Renderbuffer Object,
 	// because we're only interested in reading the color buffer in a shader.
-	GLuint rboDepthStencil;
-	glGenRenderbuffers(1, &rboDepthStencil);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboDepthStencil);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, WIDTH, HEIGHT);
+	RenderTargetPool renderTargets;
 
-	// attach it
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rboDepthStencil);
+	// Every frame the passes declare which textures they read and write, the graph decides the order,
+	// culls passes whose results are never used and lets textures with non-overlapping lifetimes share memory.
+	RenderGraph renderGraph;
+	size_t reportedGraphBytes = 0;
+
+	// The scene is rendered with multisampling into renderbuffers, and resolved into the texture the screen pass samples.
+	// The default framebuffer only shows the full screen quad, so the context doesn't ask for antialiasing itself.
+	// Press M to switch to the next sample count, B to benchmark all of them.
+	GLint maxSamples = 0;
+	glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+
+	std::vector<int> msaaLevels;
+	for (int samples : { 0, 2, 4, 8 })
+	{
+		if (samples <= maxSamples)
+			msaaLevels.push_back(samples);
+	}
+
+	int msaaLevel = std::min(2, (int)msaaLevels.size() - 1);
+
+	// Measures the scene and the resolve on the GPU. Without timer queries the CPU time of the whole frame is used instead,
+	// which also counts the time spent waiting for the swap.
+	GpuTimer sceneTimer;
+	bool gpuTimed = sceneTimer.Create();
+	const char* timeUnit = gpuTimed ? " ms GPU" : " ms frame";
+	auto t_lastFrame = t_start;
+	double benchmarkFrameTotal = 0.0;
+
+	// The benchmark renders every level for a while and prints the average GPU time.
+	// The first frames of a level are skipped, they include creating the new render targets.
+	const int benchmarkWarmupFrames = 10;
+	const int benchmarkFrames = 130;
+	int benchmarkLevel = -1;
+	int benchmarkFrame = 0;
+
+	// Lowers the resolution of the scene while it takes longer than the target on the GPU, press R to turn it on or off.
+	// The render targets keep the size of the window, the scene is drawn into the lower left part and scaled up by the screen pass.
+	DynamicResolution dynamicResolution;
+	bool dynamicResolutionEnabled = true;
+	unsigned int lastTimerResult = 0;
+
+	int screenWidth = WIDTH;
+	int screenHeight = HEIGHT;
 
 	// Set up projection
 	// To create the view transformation, GLM offers the useful glm::lookAt function that simulates a moving camera.
@@ -1215,7 +1420,17 @@ int main()
 	// the third parameter to the up axis.
 	// Here's the Z axis the up vector, which implies that the XY plane is the "ground"
 
-	glm::mat4 view = glm::lookAt(glm::vec3(2.5f, 2.5f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::vec3 cameraPosition(2.5f, 2.5f, 2.0f);
+	glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+
+	// The floor can't hide the cube from up here, so a wall slides back and forth between the camera and the cube.
+	// It's the floor quad stood up to face the camera 2 units in front of it, big enough to cover the whole cube.
+	glm::vec3 wallNormal = glm::normalize(cameraPosition);
+	glm::vec3 wallRight = glm::normalize(glm::cross(glm::vec3(0.0f, 0.0f, 1.0f), wallNormal));
+	glm::vec3 wallUp = glm::cross(wallNormal, wallRight);
+	glm::vec3 wallCenter = cameraPosition - wallNormal * 2.0f;
+	glm::mat4 wallBasis(glm::vec4(wallRight * 0.9f, 0.0f), glm::vec4(wallUp * 0.9f, 0.0f), glm::vec4(wallNormal, 0.0f), glm::vec4(wallCenter + wallNormal * 0.5f, 1.0f));
+	bool cubeWasOccluded = false;
 
 	glUseProgram(sceneShaderProgram);
 
@@ -1252,6 +1467,80 @@ int main()
 
 	GLint uniColor = glGetUniformLocation(sceneShaderProgram, "extraColor");
 
+	// The floor samples a reflection texture that is rendered at a lower resolution than the screen
+	GLuint floorVertexShader, floorFragmentShader, floorShaderProgram;
+	CreateShaderProgram(reflectiveFloorVertexSource, reflectiveFloorFragmentSource, floorVertexShader, floorFragmentShader, floorShaderProgram);
+
+	int floorVertexArray = vertexArrays.Get(floorShaderProgram, SceneVertexLayout::GetFormat());
+
+	// Small cubes scattered around the floor are culled on the GPU and drawn with one instanced draw.
+	// Their matrices take locations 8 to 11, away from the ones the vertex arrays of the other programs use.
+	const GLuint instanceModelLocation = 8;
+	GLuint instancedVertexShader, instancedFragmentShader, instancedShaderProgram;
+	CreateShaderProgram(gpuCulledVertexSource, gpuCulledFragmentSource, instancedVertexShader, instancedFragmentShader, instancedShaderProgram);
+	glBindAttribLocation(instancedShaderProgram, instanceModelLocation, "instanceModel");
+	glLinkProgram(instancedShaderProgram);
+
+	int instancedVertexArray = getCubeVertexArray(instancedShaderProgram);
+
+	glUseProgram(instancedShaderProgram);
+	glUniformMatrix4fv(glGetUniformLocation(instancedShaderProgram, "dequantization"), 1, GL_FALSE, glm::value_ptr(cubeMesh.GetDequantization()));
+	glUniformMatrix4fv(glGetUniformLocation(instancedShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	GLint uniInstancedProj = glGetUniformLocation(instancedShaderProgram, "proj");
+	glUniformMatrix4fv(uniInstancedProj, 1, GL_FALSE, glm::value_ptr(proj));
+
+	// A grid of 64 by 64 cubes on the floor plane, most of it is outside of the view. The middle is left free for the floor and the cube.
+	std::vector<glm::mat4> instanceModels;
+	for (int y = 0; y < 64; ++y)
+	{
+		for (int x = 0; x < 64; ++x)
+		{
+			glm::vec3 position((x - 31.5f) * 0.25f, (y - 31.5f) * 0.25f, -0.45f);
+			if (std::abs(position.x) < 1.25f && std::abs(position.y) < 1.25f)
+				continue;
+
+			instanceModels.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.1f)));
+		}
+	}
+
+	GpuCuller instanceCuller;
+	instanceCuller.Create((int)instanceModels.size());
+	instanceCuller.SetInstances(instanceModels.data(), (int)instanceModels.size());
+	instanceCuller.SetBounds(useCubeMesh ? cubeMesh.GetBoundsMin() : glm::vec3(-0.5f), useCubeMesh ? cubeMesh.GetBoundsMax() : glm::vec3(0.5f));
+
+	glUseProgram(floorShaderProgram);
+	glUniformMatrix4fv(glGetUniformLocation(floorShaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+	glUniformMatrix4fv(glGetUniformLocation(floorShaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	GLint uniFloorProj = glGetUniformLocation(floorShaderProgram, "proj");
+	glUniformMatrix4fv(uniFloorProj, 1, GL_FALSE, glm::value_ptr(proj));
+	glUniform1i(glGetUniformLocation(floorShaderProgram, "texReflection"), 2);
+	glUniform1f(glGetUniformLocation(floorShaderProgram, "reflectivity"), 0.3f);
+
+	// The feedback pass draws the cube once more, into a small target where every pixel gets the virtual texture page it needs.
+	// It's read back a couple of frames later, so reading it never waits for the GPU.
+	const int feedbackDivisor = 8;
+
+	// It shares the vertex shader file of the scene, its fragment shader is always the one of VirtualTexture
+	int feedbackProgram = shaders.Load("../../Data/Shaders/scene.vert", "", vertexSource, virtualTextureFeedbackFragmentSource);
+	GLuint feedbackShaderProgram = shaders.GetProgram(feedbackProgram);
+
+	int feedbackVertexArray = getCubeVertexArray(feedbackShaderProgram);
+
+	glUseProgram(feedbackShaderProgram);
+	GLint uniFeedbackModel = glGetUniformLocation(feedbackShaderProgram, "model");
+	GLint uniFeedbackView = glGetUniformLocation(feedbackShaderProgram, "view");
+	GLint uniFeedbackProj = glGetUniformLocation(feedbackShaderProgram, "proj");
+	glUniform1f(glGetUniformLocation(feedbackShaderProgram, "vtFeedbackBias"), -std::log2((float)feedbackDivisor));
+	if (useVirtualHalo)
+		virtualHalo.SetUniforms(feedbackShaderProgram);
+
+	// Every reflective plane in the scene is registered with the reflection manager,
+	// which only renders the ones that are visible and covering most of the screen.
+	ReflectionManager reflections;
+	reflections.SetScreenSize(WIDTH, HEIGHT);
+	reflections.SetMaxReflectionsPerFrame(2);
+	int floorReflector = reflections.AddReflector(glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), 0.5f);
+
 #pragma region ExtraInfo
 	//-----------------------------------------------------------------------------------------------------------------------------------------------------------
 	// select frame buffer
@@ -1381,6 +1670,69 @@ int main()
 
 	GLuint uniTime = glGetUniformLocation(sceneShaderProgram, "time");
 
+	// A rebuilt program has new uniform locations and none of the uniforms that were set, so it's set up like the old one was.
+	// The passes capture the program and the locations by reference, so from the next frame on they draw with the new one.
+	shaders.SetOnSwap(sceneProgram, [&](GLuint program)
+	{
+		sceneShaderProgram = program;
+		cubeVertexArray = getCubeVertexArray(program);
+		wallVertexArray = vertexArrays.Get(program, SceneVertexLayout::GetFormat());
+
+		glUseProgram(program);
+		uniModel = glGetUniformLocation(program, "model");
+		uniView = glGetUniformLocation(program, "view");
+		uniProj = glGetUniformLocation(program, "proj");
+		uniTime = glGetUniformLocation(program, "time");
+		uniColor = glGetUniformLocation(program, "extraColor");
+		glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+
+		glUniform1i(glGetUniformLocation(program, "texAtlas"), 0);
+		glUniform1i(glGetUniformLocation(program, "texHalo"), 1);
+		glUniform1i(glGetUniformLocation(program, "vtPhysical"), 3);
+		glUniform1i(glGetUniformLocation(program, "vtIndirection"), 4);
+		glUniform1i(glGetUniformLocation(program, "virtualHalo"), useVirtualHalo);
+		if (useVirtualHalo)
+			virtualHalo.SetUniforms(program);
+
+		if (atlasReady)
+			setAtlasUniforms(program);
+	});
+
+	shaders.SetOnSwap(screenProgram, [&](GLuint program)
+	{
+		screenShaderProgram = program;
+		quadVertexArray = vertexArrays.Get(program, ScreenVertexLayout::GetFormat());
+
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "texFramebuffer"), 0);
+		uniRenderScale = glGetUniformLocation(program, "renderScale");
+		uniMaxTexcoord = glGetUniformLocation(program, "maxTexcoord");
+	});
+
+	shaders.SetOnSwap(feedbackProgram, [&](GLuint program)
+	{
+		feedbackShaderProgram = program;
+		feedbackVertexArray = getCubeVertexArray(program);
+
+		glUseProgram(program);
+		uniFeedbackModel = glGetUniformLocation(program, "model");
+		uniFeedbackView = glGetUniformLocation(program, "view");
+		uniFeedbackProj = glGetUniformLocation(program, "proj");
+		glUniform1f(glGetUniformLocation(program, "vtFeedbackBias"), -std::log2((float)feedbackDivisor));
+		if (useVirtualHalo)
+			virtualHalo.SetUniforms(program);
+	});
+
+	// Shaders, textures and the atlas are rebuilt when their files are saved
+	FileWatcher watcher;
+	watcher.Create();
+	for (const std::string& path : shaders.GetPaths())
+		watcher.Watch(path);
+	if (haloTexture != -1)
+		watcher.Watch(textures.GetPath(haloTexture));
+	watcher.Watch(googlePath);
+
 	while (running)
 	{
 		sf::Event windowEvent;
@@ -1394,25 +1746,58 @@ int main()
 			case sf::Event::KeyPressed:
 				if (windowEvent.key.code == sf::Keyboard::Escape)
 					running = false;
+				else if (windowEvent.key.code == sf::Keyboard::M && benchmarkLevel < 0)
+				{
+					msaaLevel = (msaaLevel + 1) % msaaLevels.size();
+					std::cout << "MSAA " << msaaLevels[msaaLevel] << "x\n";
+				}
+				else if (windowEvent.key.code == sf::Keyboard::B && benchmarkLevel < 0)
+				{
+					std::cout << "Benchmarking MSAA levels...\n";
+					benchmarkLevel = 0;
+					benchmarkFrame = 0;
+
+					// Every level is measured at full resolution
+					dynamicResolution.Reset();
+				}
+				else if (windowEvent.key.code == sf::Keyboard::R)
+				{
+					dynamicResolutionEnabled = !dynamicResolutionEnabled;
+					dynamicResolution.Reset();
+					std::cout << "Dynamic resolution " << (dynamicResolutionEnabled ? "on" : "off") << "\n";
+				}
+				else if (windowEvent.key.code == sf::Keyboard::T)
+				{
+					// A smaller budget makes the manager drop the top levels of the textures, a bigger one streams them back
+					textureBudget = (textureBudget + 1) % textureBudgets.size();
+					textures.SetBudget(textureBudgets[textureBudget]);
+					textures.PrintReport(std::cout);
+					if (useVirtualHalo)
+						virtualHalo.PrintReport(std::cout);
+				}
+				break;
+			case sf::Event::Resized:
+				// A minimized window reports a size of 0
+				if (windowEvent.size.width == 0 || windowEvent.size.height == 0)
+					break;
+
+				screenWidth = windowEvent.size.width;
+				screenHeight = windowEvent.size.height;
+				glViewport(0, 0, screenWidth, screenHeight);
+
+				proj = glm::perspective(glm::radians(45.0f), (float)screenWidth / (float)screenHeight, 1.0f, 10.0f);
+				glUseProgram(sceneShaderProgram);
+				glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+				glUseProgram(floorShaderProgram);
+				glUniformMatrix4fv(uniFloorProj, 1, GL_FALSE, glm::value_ptr(proj));
+				glUseProgram(instancedShaderProgram);
+				glUniformMatrix4fv(uniInstancedProj, 1, GL_FALSE, glm::value_ptr(proj));
+
+				reflections.SetScreenSize(screenWidth, screenHeight);
 				break;
 			}
 		}
 
-		//Bind our framebuffer and draw 3D scene (spinnig scene)
-		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
-		glBindVertexArray(vaoCube);
-		glEnable(GL_DEPTH_TEST);
-		glUseProgram(sceneShaderProgram);
-
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texHalo);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texGoogle);
-
-		//Clear the screen to white
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
 		//Calculate transformation
 		// The values of uniforms are changed with any of the glUnifromXY functions, where X is the number of
 		// components and Y is the type. Common types are f(float), d(double) and i(integer)
@@ -1420,73 +1805,351 @@ int main()
 		float time = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - t_start).count();
 
 		glm::mat4 model = glm::rotate(glm::mat4(1.0f), time * 0.1f * glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
 
-		// Changing the value of a uniform is just like setting vertex attributes, you first have to grab the location.
-		//GLint uniColor = glGetUniformLocation(sceneShaderProgram, "extraColor");
-		//float redValue = (sin(time) + 1.0f) * 0.5f;
-		// std::cout << redValue << std::endl;
-		//glUniform3f(uniColor, 1.0f, 1.0f, 1.0f);
+		// The cube mesh is quantized, its positions are relative to its bounds
+		glm::mat4 cubeModel = model * cubeMesh.GetDequantization();
+
+		// The wall covers the cube around every 4π seconds and leaves the screen in between
+		glm::mat4 wallModel = glm::translate(glm::mat4(1.0f), wallRight * 2.5f * std::sin(time * 0.5f)) * wallBasis;
 
-		// The first parameter is the same as with glDrawArray, but the other ones all refer to the element buffer.
-		// The second parameter specifies the number of indices to draw
-		// the third parameter specifies the type of the element data
-		// The last parameter specifies the offset.
-		// The only real difference is that you're talking about indices instead of vertices now.
-		// glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		float frameMilliseconds = std::chrono::duration<float, std::milli>(t_now - t_lastFrame).count();
+		t_lastFrame = t_now;
+
+		// Every measurement of the scene that came back from the GPU can change the render scale, or every frame time without it
+		if (!gpuTimed || sceneTimer.GetResultCount() != lastTimerResult)
+		{
+			lastTimerResult = sceneTimer.GetResultCount();
+			float milliseconds = gpuTimed ? sceneTimer.GetMilliseconds() : frameMilliseconds;
+			if (dynamicResolutionEnabled && benchmarkLevel < 0 && dynamicResolution.Update(milliseconds))
+			{
+				std::cout << std::fixed << std::setprecision(2);
+				std::cout << "Render scale " << dynamicResolution.GetScale() << " (" << dynamicResolution.GetSmoothedMilliseconds() << timeUnit << ")\n";
+				std::cout.unsetf(std::ios::fixed);
+			}
+		}
+
+		// Files that were saved are read and compiled in the background, the new programs and textures replace the old ones
+		// once they're done, so editing them never makes the frame wait
+		for (const std::string& path : watcher.Poll())
+		{
+			shaders.Reload(path);
+			textures.Reload(path);
+			if (path == googlePath)
+				atlasRepackQueued = true;
+		}
+		shaders.Update();
+
+		// The old atlas is drawn with until the new one is packed, a file saved again meanwhile is packed after that
+		if (atlasRepacked.valid() && atlasRepacked.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		{
+			int entry = atlasRepacked.get();
+			if (entry != -1)
+			{
+				atlas = std::move(repackedAtlas);
+				googleEntry = entry;
+				atlasReady = true;
+				uploadAtlas();
+				texAtlas = atlas->GetTexture();
+			}
+			else
+			{
+				std::cout << "The atlas couldn't be packed again, keeping the old one\n";
+			}
+			repackedAtlas.reset();
+		}
+
+		if (atlasRepackQueued && !atlasRepacked.valid())
+		{
+			atlasRepackQueued = false;
+			repackedAtlas.reset(new TextureAtlas());
+			atlasRepacked = startPacking(repackedAtlas.get());
+		}
+
+		int sceneWidth = dynamicResolution.GetScaledSize(screenWidth);
+		int sceneHeight = dynamicResolution.GetScaledSize(screenHeight);
+		cubeLod = cubeLodSelector.Select(cubeMesh, GetProjectedSize(cubeMesh, model, view, proj, (float)sceneHeight));
+
+		glm::vec3 cubeMin = useCubeMesh ? cubeMesh.GetBoundsMin() : glm::vec3(-0.5f);
+		glm::vec3 cubeMax = useCubeMesh ? cubeMesh.GetBoundsMax() : glm::vec3(0.5f);
+		TransformAabb(model, cubeMin, cubeMax);
+		sceneBvh.Set(cubeObject, cubeMin, cubeMax);
+		sceneBvh.Refit();
+
+		// Objects that moved far from where the tree was built make every query slower
+		if (sceneBvh.GetCostGrowth() > 2.0f)
+			sceneBvh.Build();
+
+		sceneBvh.QueryFrustum(Frustum(proj * view), visibleObjects);
+		cubeVisible = std::find(visibleObjects.begin(), visibleObjects.end(), (unsigned int)cubeObject) != visibleObjects.end();
+
+		occlusion.BeginFrame();
+		occlusion.SetBounds(cubeOccludee, cubeMin, cubeMax);
+
+		// Only queues the culling, which instances are visible never comes back to the CPU
+		instanceCuller.Cull(Frustum(proj * view));
+
+		// Declare this frame's passes and the textures flowing between them.
+		// The scene is drawn into sceneColor, which the screen pass draws onto the default framebuffer.
+		// The textures come from the render target pool, so they're the same objects as last frame unless the window was resized.
+		renderGraph.Reset();
+
+		// Textures that finished loading replace the placeholder or their smaller version from here on
+		textures.BeginFrame();
+		GLuint texHalo = haloTexture != -1 ? textures.Use(haloTexture) : 0;
+
+		// Pages the feedback asked for a few frames ago are uploaded before anything samples the virtual texture
+		virtualHalo.Update();
+
+		RenderGraphResource backBuffer = renderGraph.ImportTexture("BackBuffer", 0, RenderTargetDesc(screenWidth, screenHeight, GL_RGBA8));
+		RenderGraphResource sceneColor = renderGraph.CreateTexture("SceneColor", RenderTargetDesc(screenWidth, screenHeight, GL_RGB8));
+
+		// With multisampling the scene is drawn into a multisampled renderbuffer first, which is resolved into sceneColor.
+		// Every attachment of a framebuffer needs the same amount of samples, so the depth buffer gets them as well.
+		int samples = msaaLevels[benchmarkLevel >= 0 ? benchmarkLevel : msaaLevel];
+
+		RenderGraphResource sceneTarget = sceneColor;
+		if (samples > 0)
+			sceneTarget = renderGraph.CreateTexture("SceneColorMS", RenderTargetDesc(screenWidth, screenHeight, GL_RGB8, samples, true));
+
+		RenderGraphResource sceneDepth = renderGraph.CreateTexture("SceneDepthStencil", RenderTargetDesc(screenWidth, screenHeight, GL_DEPTH24_STENCIL8, samples, true));
 
 		// to make a reflection:
-		// 1) Draw regular cube
-		// 2) enable sencil testing and set test function and operations to write ones to all selected stencils
-		// 3) draw floor
-		// 4) set stencil function to pass if stencil value equals 1
-		// 5) draw inverted cube
-		// 6) disbale stencil testing
+		// 1) Render the mirrored cube into the reflection texture of every visible reflector, with the near plane moved onto the reflector
+		// 2) Draw regular cube
+		// 3) Draw the reflectors, which sample their reflection texture at their screen position
+		// A reflection texture is reused as long as the camera and the cube didn't move.
+		// The reflection textures are owned by the reflection manager, so to the graph this pass only has side effects.
+		RenderGraphPass reflectionPass = renderGraph.AddPass("Reflections", [&](const RenderGraphContext&)
+		{
+			bindCube(cubeVertexArray);
+			glEnable(GL_DEPTH_TEST);
+			glUseProgram(sceneShaderProgram);
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, texAtlas);
+			if (texHalo != 0)
+			{
+				glActiveTexture(GL_TEXTURE1);
+				glBindTexture(GL_TEXTURE_2D, texHalo);
+			}
+			virtualHalo.Bind(GL_TEXTURE3, GL_TEXTURE4);
+
+			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(cubeModel));
+			glUniform1f(uniTime, time);
+
+			reflections.MarkSceneDirty();
+			reflections.Update(view, proj);
+			reflections.Render(view, proj, [&](const glm::mat4& reflectedView, const glm::mat4& obliqueProj)
+			{
+				// The mirrored camera sees other objects than the camera, and nothing behind the reflector
+				std::vector<unsigned int> reflectedObjects;
+				sceneBvh.QueryFrustum(Frustum(obliqueProj * reflectedView), reflectedObjects);
+				if (std::find(reflectedObjects.begin(), reflectedObjects.end(), (unsigned int)cubeObject) == reflectedObjects.end())
+					return;
+
+				glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(reflectedView));
+				glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(obliqueProj));
+				drawCube();
+			});
+
+			glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
+			glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
+		});
+		renderGraph.SetSideEffect(reflectionPass);
+
+		if (useVirtualHalo)
+		{
+			int feedbackWidth = std::max(1, screenWidth / feedbackDivisor);
+			int feedbackHeight = std::max(1, screenHeight / feedbackDivisor);
+			RenderGraphResource feedback = renderGraph.CreateTexture("VirtualTextureFeedback", RenderTargetDesc(feedbackWidth, feedbackHeight, GL_RGBA8));
+			RenderGraphResource feedbackDepth = renderGraph.CreateTexture("VirtualTextureFeedbackDepth", RenderTargetDesc(feedbackWidth, feedbackHeight, GL_DEPTH24_STENCIL8, 0, true));
+
+			// Nothing reads the feedback on the GPU, the readback is the side effect
+			RenderGraphPass feedbackPass = renderGraph.AddPass("VirtualTextureFeedback", [&, feedbackWidth, feedbackHeight](const RenderGraphContext&)
+			{
+				bindCube(feedbackVertexArray);
+				glEnable(GL_DEPTH_TEST);
+				glUseProgram(feedbackShaderProgram);
+
+				glUniformMatrix4fv(uniFeedbackModel, 1, GL_FALSE, glm::value_ptr(cubeModel));
+				glUniformMatrix4fv(uniFeedbackView, 1, GL_FALSE, glm::value_ptr(view));
+				glUniformMatrix4fv(uniFeedbackProj, 1, GL_FALSE, glm::value_ptr(proj));
+
+				// Alpha 0 is a pixel that doesn't want a page
+				glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				if (cubeVisible)
+					drawCube();
+
+				virtualHalo.ReadFeedback(feedbackWidth, feedbackHeight);
+			});
+			renderGraph.Write(feedbackPass, feedback);
+			renderGraph.Write(feedbackPass, feedbackDepth);
+			renderGraph.SetSideEffect(feedbackPass);
+		}
+
+		//Draw 3D scene (spinnig scene), the graph has already bound a framebuffer with sceneTarget and sceneDepth attached.
+		RenderGraphPass scenePass = renderGraph.AddPass("Scene", [&](const RenderGraphContext&)
+		{
+			sceneTimer.Begin();
+
+			// Only render into the scaled part of the targets, the projection doesn't change because the aspect ratio stays the same.
+			glViewport(0, 0, sceneWidth, sceneHeight);
+
+			bindCube(cubeVertexArray);
+			glEnable(GL_DEPTH_TEST);
+			glUseProgram(sceneShaderProgram);
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, texAtlas);
+			if (texHalo != 0)
+			{
+				glActiveTexture(GL_TEXTURE1);
+				glBindTexture(GL_TEXTURE_2D, texHalo);
+			}
+			virtualHalo.Bind(GL_TEXTURE3, GL_TEXTURE4);
+
+			//Clear the screen to white
+			glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(cubeModel));
+
+			// Changing the value of a uniform is just like setting vertex attributes, you first have to grab the location.
+			//GLint uniColor = glGetUniformLocation(sceneShaderProgram, "extraColor");
+			//float redValue = (sin(time) + 1.0f) * 0.5f;
+			// std::cout << redValue << std::endl;
+			//glUniform3f(uniColor, 1.0f, 1.0f, 1.0f);
+
+			// The first parameter is the same as with glDrawArray, but the other ones all refer to the element buffer.
+			// The second parameter specifies the number of indices to draw
+			// the third parameter specifies the type of the element data
+			// The last parameter specifies the offset.
+			// The only real difference is that you're talking about indices instead of vertices now.
+			// glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+			// Draw plane first, it's the occluder
+			vertexArrays.Bind(floorVertexArray, vboCube);
+			glUseProgram(floorShaderProgram);
+			// When the floor wasn't selected this frame its texture from the last reflection pass is used.
+			glActiveTexture(GL_TEXTURE2);
+			glBindTexture(GL_TEXTURE_2D, reflections.GetTexture(floorReflector));
+			glDrawArrays(GL_TRIANGLES, 36, 6);
+
+			// The wall is the other occluder
+			vertexArrays.Bind(wallVertexArray, vboCube);
+			glUseProgram(sceneShaderProgram);
+			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(wallModel));
+			glDrawArrays(GL_TRIANGLES, 36, 6);
+			glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(cubeModel));
+
+			// draw regular cube when it wasn't hidden behind the floor or the wall last frame
+			bindCube(cubeVertexArray);
+			bool cubeOccluded = !occlusion.IsVisible(cubeOccludee);
+			if (cubeVisible && !cubeOccluded)
+				drawCube();
+
+			if (cubeOccluded != cubeWasOccluded)
+			{
+				cubeWasOccluded = cubeOccluded;
+				std::cout << (cubeOccluded ? "Cube occluded, drawn conditionally\n" : "Cube visible again\n");
+			}
 
-		// draw regular cube
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+			// Test its box against the occluders, and only when it was hidden let the GPU decide from that whether to draw it
+			occlusion.Test(proj * view);
+			if (cubeVisible && cubeOccluded && occlusion.BeginConditionalDraw(cubeOccludee))
+			{
+				bindCube(cubeVertexArray);
+				glUseProgram(sceneShaderProgram);
+				drawCube();
+				occlusion.EndConditionalDraw();
+			}
+
+			// The instances that passed the culling, with the level of detail of the full mesh
+			bindCube(instancedVertexArray);
+			glUseProgram(instancedShaderProgram);
+			if (useCubeMesh)
+			{
+				const MeshFileLod& lod = cubeMesh.GetLod(0);
+				size_t indexSize = cubeMesh.GetIndexType() == GL_UNSIGNED_SHORT ? 2 : 4;
+				instanceCuller.DrawElements(instanceModelLocation, GL_TRIANGLES, lod.indexCount, cubeMesh.GetIndexType(), lod.indexOffset * indexSize);
+			}
+			else
+			{
+				instanceCuller.DrawArrays(instanceModelLocation, GL_TRIANGLES, 0, 36);
+			}
+		});
+		renderGraph.Write(scenePass, sceneTarget);
+		renderGraph.Write(scenePass, sceneDepth);
 
-		glEnable(GL_STENCIL_TEST);
+		if (samples > 0)
+			renderGraph.AddResolvePass("Resolve", sceneTarget, sceneColor, sceneWidth, sceneHeight);
 
-		// glUniform3f(uniColor, 0.5f, 0.5f, 0.5f);
+		//Draw contents of our framebuffer onto the default framebuffer
+		RenderGraphPass screenPass = renderGraph.AddPass("Screen", [&](const RenderGraphContext& context)
+		{
+			// Everything up to here is the scene and its resolve
+			sceneTimer.End();
 
-		// Draw plane
-		glStencilFunc(GL_ALWAYS, 1, 0xFF); // Set any stencil to 1
-		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-		glStencilMask(0xFF); // Write to stencil buffer.
-		glDepthMask(GL_FALSE); // Don't write to depth buffer
-		glClear(GL_STENCIL_BUFFER_BIT); // clear stencil buffer (0 by default)
+			vertexArrays.Bind(quadVertexArray, vboQuad);
+			glDisable(GL_DEPTH_TEST);
+			glUseProgram(screenShaderProgram);
 
-		//glDrawArrays(GL_TRIANGLES, 36, 6);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, context.GetTexture(sceneColor));
 
-		// Draw cube reflection
-		glStencilFunc(GL_EQUAL, 1, 0xFF);
-		glStencilMask(0x00); // don't write anything to stencil buffer
-		glDepthMask(GL_TRUE); // Write to depth buffer
+			// Stretch the scaled part over the whole screen, the texture's linear filtering does the upscaling.
+			// Texture coordinates stop half a pixel before the edge of the scaled part.
+			glUniform2f(uniRenderScale, (float)sceneWidth / screenWidth, (float)sceneHeight / screenHeight);
+			glUniform2f(uniMaxTexcoord, (sceneWidth - 0.5f) / screenWidth, (sceneHeight - 0.5f) / screenHeight);
 
-		model = glm::scale(glm::translate(model, glm::vec3(0, 0, -1)), glm::vec3(1, 1, -1));
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+		});
+		renderGraph.Read(screenPass, sceneColor);
+		renderGraph.Write(screenPass, backBuffer);
 
-		glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
-		
-		glUniform1f(uniTime, time);
+		renderGraph.Compile();
 
-		// draw second cube
-		glUniform3f(uniColor, 0.3f, 0.3f, 0.3f);
-		//glDrawArrays(GL_TRIANGLES, 0, 36);
-		glUniform3f(uniColor, 1.0f, 1.0f, 1.0f);
+		// Print where the render target memory goes whenever it changes, e.g. after adding a pass or resizing the window.
+		if (renderGraph.GetAliasedBytes() != reportedGraphBytes)
+		{
+			renderGraph.PrintReport(std::cout);
+			reportedGraphBytes = renderGraph.GetAliasedBytes();
+		}
 
-		glDisable(GL_STENCIL_TEST);
+		renderGraph.Execute(renderTargets);
 
-		//Bind default framebuffer and draw contents of our framebuffer
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glBindVertexArray(vaoQuad);
-		glDisable(GL_DEPTH_TEST);
-		glUseProgram(screenShaderProgram);
+		if (benchmarkLevel >= 0)
+		{
+			++benchmarkFrame;
+			if (benchmarkFrame == benchmarkWarmupFrames)
+			{
+				sceneTimer.ResetAverage();
+				benchmarkFrameTotal = 0.0;
+			}
+			else if (benchmarkFrame > benchmarkWarmupFrames)
+			{
+				benchmarkFrameTotal += frameMilliseconds;
+			}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texColorBuffer);
+			if (benchmarkFrame == benchmarkFrames)
+			{
+				float milliseconds = gpuTimed ? sceneTimer.GetAverageMilliseconds() : (float)(benchmarkFrameTotal / (benchmarkFrames - benchmarkWarmupFrames));
+				std::cout << std::fixed << std::setprecision(3);
+				std::cout << "MSAA " << samples << "x:\t" << milliseconds << timeUnit << "\t"
+					<< renderGraph.GetAliasedBytes() / (1024.0f * 1024.0f) << " MB render targets\n";
+				std::cout.unsetf(std::ios::fixed);
+
+				benchmarkFrame = 0;
+				++benchmarkLevel;
+				if (benchmarkLevel == (int)msaaLevels.size())
+					benchmarkLevel = -1;
+			}
+		}
 
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		// Targets of an old window size are deleted after a few frames without use.
+		renderTargets.EndFrame();
+		textures.EndFrame();
 
 		float redValue = 1.0f + 0.1f * time;
 		float redSin = sin(redValue); //should be 0
@@ -1508,26 +2171,42 @@ int main()
 	}
 
 	//Cleanup
-	glDeleteRenderbuffers(1, &rboDepthStencil);
-	glDeleteTextures(1, &texColorBuffer);
-	glDeleteFramebuffers(1, &frameBuffer);
+	reflections.Clear();
+
+	glDeleteProgram(floorShaderProgram);
+	glDeleteShader(floorFragmentShader);
+	glDeleteShader(floorVertexShader);
+
+	instanceCuller.Destroy();
+	glDeleteProgram(instancedShaderProgram);
+	glDeleteShader(instancedFragmentShader);
+	glDeleteShader(instancedVertexShader);
+
+	renderTargets.Clear();
+	sceneTimer.Destroy();
+
+	occlusion.Clear();
+	occlusion.Destroy();
 
-	glDeleteTextures(1, &texHalo);
-	glDeleteTextures(1, &texGoogle);
+	if (atlasRepacked.valid())
+		atlasRepacked.wait();
+	repackedAtlas.reset();
+	atlas->Destroy();
+	textures.Destroy();
+	virtualHalo.Destroy();
 
-	glDeleteProgram(screenShaderProgram);
-	glDeleteShader(screenFragmentShader);
-	glDeleteShader(screenVertexShader);
+	watcher.Destroy();
+	shaders.Destroy();
 
-	glDeleteProgram(sceneShaderProgram);
-	glDeleteShader(sceneFragmentShader);
-	glDeleteShader(sceneVertexShader);
+	SetImageCache(nullptr);
+	MountAssetPack(nullptr, "");
+	assets.Close();
 
+	cubeMesh.Destroy();
 	glDeleteBuffers(1, &vboCube);
 	glDeleteBuffers(1, &vboQuad);
 
-	glDeleteVertexArrays(1, &vaoCube);
-	glDeleteVertexArrays(1, &vaoQuad);
+	vertexArrays.Destroy();
 #endif
 	window.close();
 
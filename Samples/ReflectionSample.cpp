@@ -1,6 +1,12 @@
 // Link statically with GLEW
 #define GLEW_STATIC
 
+// Also compile ../OpenglTestProject/OpenglTestProject/PlanarReflection.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/ReflectionManager.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/Frustum.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VertexLayout.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VertexFormat.cpp
+
 // Headers
 #include <GL/glew.h>
 #include <glm/glm.hpp>
@@ -10,6 +16,12 @@
 #include <SFML/Window.hpp>
 #include <chrono>
 
+#include "../OpenglTestProject/OpenglTestProject/ReflectionManager.h"
+#include "../OpenglTestProject/OpenglTestProject/VertexLayout.h"
+
+// Each vertex is a position, a color and a texture coordinate
+typedef VertexLayout<VertexInput<PositionName, glm::vec3>, VertexInput<ColorName, glm::vec3>, VertexInput<TexcoordName, glm::vec2>> SceneVertexLayout;
+
 // Shader sources
 const GLchar* vertexSource = R"glsl(
     #version 150 core
@@ -143,17 +155,32 @@ int main()
     glUseProgram(shaderProgram);
 
     // Specify the layout of the vertex data
-    GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-    glEnableVertexAttribArray(posAttrib);
-    glVertexAttribPointer(posAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), 0);
-
-    GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-    glEnableVertexAttribArray(colAttrib);
-    glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+    SceneVertexLayout::Specify(shaderProgram);
+
+    // The floor samples the reflection texture instead of being drawn as a stencil mask
+    GLuint floorVertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(floorVertexShader, 1, &reflectiveFloorVertexSource, NULL);
+    glCompileShader(floorVertexShader);
+
+    GLuint floorFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(floorFragmentShader, 1, &reflectiveFloorFragmentSource, NULL);
+    glCompileShader(floorFragmentShader);
+
+    GLuint floorProgram = glCreateProgram();
+    glAttachShader(floorProgram, floorVertexShader);
+    glAttachShader(floorProgram, floorFragmentShader);
+    glBindFragDataLocation(floorProgram, 0, "outColor");
+    glLinkProgram(floorProgram);
+
+    // The floor program may assign different attribute locations, so it gets its own VAO on the same VBO
+    GLuint floorVao;
+    glGenVertexArrays(1, &floorVao);
+    glBindVertexArray(floorVao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    SceneVertexLayout::Specify(floorProgram);
 
-    GLint texAttrib = glGetAttribLocation(shaderProgram, "texcoord");
-    glEnableVertexAttribArray(texAttrib);
-    glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+    glBindVertexArray(vao);
+    glUseProgram(shaderProgram);
 
     // Load textures
     GLuint textures[2];
@@ -202,6 +229,23 @@ int main()
     glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
 
     GLint uniColor = glGetUniformLocation(shaderProgram, "overrideColor");
+    glUniform3f(uniColor, 1.0f, 1.0f, 1.0f);
+
+    glUseProgram(floorProgram);
+    glUniformMatrix4fv(glGetUniformLocation(floorProgram, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    glUniformMatrix4fv(glGetUniformLocation(floorProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(floorProgram, "proj"), 1, GL_FALSE, glm::value_ptr(proj));
+    glUniform1i(glGetUniformLocation(floorProgram, "texReflection"), 2);
+
+    // Same darkening as the old 0.3 override color on the mirrored cube
+    glUniform1f(glGetUniformLocation(floorProgram, "reflectivity"), 0.3f);
+    glUseProgram(shaderProgram);
+
+    // The floor is the only reflector, its reflection is rendered at half the resolution of the window into a texture.
+    // More mirrors are more AddReflector calls, the manager only renders the ones that are on screen.
+    ReflectionManager reflections;
+    reflections.SetScreenSize(800, 600);
+    int floorReflector = reflections.AddReflector(glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec2(1.0f, 1.0f), 0.5f);
 
     bool running = true;
     while (running)
@@ -217,10 +261,6 @@ int main()
             }
         }
 
-        // Clear the screen to black
-        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
         // Calculate transformation
         auto t_now = std::chrono::high_resolution_clock::now();
         float time = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - t_start).count();
@@ -231,51 +271,60 @@ int main()
             time * glm::radians(180.0f),
             glm::vec3(0.0f, 0.0f, 1.0f)
         );
-        glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
 
-        // Draw cube
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        // The cube rotates, so the reflection is outdated every frame.
+        // A static scene with a static camera would keep using last frame's texture.
+        reflections.MarkSceneDirty();
 
-        glEnable(GL_STENCIL_TEST);
-
-            // Draw floor
-            glStencilFunc(GL_ALWAYS, 1, 0xFF);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
-            glStencilMask(0xFF);
-            glDepthMask(GL_FALSE);
-            glClear(GL_STENCIL_BUFFER_BIT);
+        glBindVertexArray(vao);
+        glUseProgram(shaderProgram);
+        glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
 
-            glDrawArrays(GL_TRIANGLES, 36, 6);
+        // Draw the mirrored cube once into the texture of every reflector that is on screen
+        reflections.Update(view, proj);
+        reflections.Render(view, proj, [&](const glm::mat4& reflectedView, const glm::mat4& obliqueProj)
+        {
+            glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(reflectedView));
+            glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(obliqueProj));
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+        });
 
-            // Draw cube reflection
-            glStencilFunc(GL_EQUAL, 1, 0xFF);
-            glStencilMask(0x00);
-            glDepthMask(GL_TRUE);
+        glUniformMatrix4fv(uniView, 1, GL_FALSE, glm::value_ptr(view));
+        glUniformMatrix4fv(uniProj, 1, GL_FALSE, glm::value_ptr(proj));
 
-            model = glm::scale(
-                glm::translate(model, glm::vec3(0, 0, -1)),
-                glm::vec3(1, 1, -1)
-            );
-            glUniformMatrix4fv(uniModel, 1, GL_FALSE, glm::value_ptr(model));
+        // Clear the screen to white
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            glUniform3f(uniColor, 0.3f, 0.3f, 0.3f);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-            glUniform3f(uniColor, 1.0f, 1.0f, 1.0f);
+        // Draw cube
+        glDrawArrays(GL_TRIANGLES, 0, 36);
 
-        glDisable(GL_STENCIL_TEST);
+        // Draw floor with the reflection
+        glBindVertexArray(floorVao);
+        glUseProgram(floorProgram);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, reflections.GetTexture(floorReflector));
+        glDrawArrays(GL_TRIANGLES, 36, 6);
 
         // Swap buffers
         window.display();
     }
 
+    reflections.Clear();
+
     glDeleteTextures(2, textures);
 
+    glDeleteProgram(floorProgram);
+    glDeleteShader(floorFragmentShader);
+    glDeleteShader(floorVertexShader);
+
     glDeleteProgram(shaderProgram);
     glDeleteShader(fragmentShader);
     glDeleteShader(vertexShader);
 
     glDeleteBuffers(1, &vbo);
 
+    glDeleteVertexArrays(1, &floorVao);
     glDeleteVertexArrays(1, &vao);
 
     window.close();
@@ -24,46 +24,18 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-#undef main
+#include "../OpenglTestProject/OpenglTestProject/WaterDistortionEffect.h"
+#include "../OpenglTestProject/OpenglTestProject/AssetPack.h"
 
-// Shader sources
-const GLchar* vertexSource = R"glsl(
-    #version 150 core
-    in vec2 position;
-    in vec3 color;
-    in vec2 texcoord;
-    out vec3 Color;
-    out vec2 Texcoord;
-    void main()
-    {
-        Color = color;
-        Texcoord = texcoord;
-        gl_Position = vec4(position, 0.0, 1.0);
-    }
-)glsl";
-const GLchar* fragmentSource = R"glsl(
-    #version 150 core
-    in vec3 Color;
-    in vec2 Texcoord;
-    out vec4 outColor;
-    uniform sampler2D texSampler;
-    uniform float time;
-    void main()
-    {
-        if (Texcoord.y < 0.5)
-            outColor = texture(texSampler, Texcoord);
-        else
-		{
-            const float nrOfDistortions = 60.0f;
-			const float speed = 2.0f;
-			const float distortionHeight = 0.03f;
-			float offset = sin(Texcoord.y * nrOfDistortions + time * speed) * distortionHeight;
-			outColor = texture(texSampler,
-                vec2(Texcoord.x + offset, 1.0 - Texcoord.y)
-            ) * vec4(0.7, 0.7, 1.0, 1.0);
-		}
-    }
-)glsl";
+// Also compile ../OpenglTestProject/OpenglTestProject/WaterDistortionEffect.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/ShaderLibrary.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VertexLayout.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VertexFormat.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/AssetPack.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/LzCompression.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MappedFile.cpp
+
+#undef main
 
 int main()
 {
@@ -81,68 +53,10 @@ int main()
 	glewExperimental = GL_TRUE;
 	glewInit();
 
-	// Create Vertex Array Object
-	GLuint vao;
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	// Create a Vertex Buffer Object and copy the vertex data to it
-	GLuint vbo;
-	glGenBuffers(1, &vbo);
-
-	GLfloat vertices[] = {
-		//  Position      Color             Texcoords
-			-0.5f,  0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, // Top-left
-			 0.5f,  0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, // Top-right
-			 0.5f, -0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f, // Bottom-right
-			-0.5f, -0.5f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f  // Bottom-left
-	};
-
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	// Create an element array
-	GLuint ebo;
-	glGenBuffers(1, &ebo);
-
-	GLuint elements[] = {
-		0, 1, 2,
-		2, 3, 0
-	};
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elements), elements, GL_STATIC_DRAW);
-
-	// Create and compile the vertex shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertexShader, 1, &vertexSource, NULL);
-	glCompileShader(vertexShader);
-
-	// Create and compile the fragment shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
-	glCompileShader(fragmentShader);
-
-	// Link the vertex and fragment shader into a shader program
-	GLuint shaderProgram = glCreateProgram();
-	glAttachShader(shaderProgram, vertexShader);
-	glAttachShader(shaderProgram, fragmentShader);
-	glBindFragDataLocation(shaderProgram, 0, "outColor");
-	glLinkProgram(shaderProgram);
-	glUseProgram(shaderProgram);
-
-	// Specify the layout of the vertex data
-	GLint posAttrib = glGetAttribLocation(shaderProgram, "position");
-	glEnableVertexAttribArray(posAttrib);
-	glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), 0);
-
-	GLint colAttrib = glGetAttribLocation(shaderProgram, "color");
-	glEnableVertexAttribArray(colAttrib);
-	glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
-
-	GLint texAttrib = glGetAttribLocation(shaderProgram, "texcoord");
-	glEnableVertexAttribArray(texAttrib);
-	glVertexAttribPointer(texAttrib, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void*)(5 * sizeof(GLfloat)));
+	// Read the image from the asset pack of the project when there is one, the loose file otherwise
+	AssetPack assets;
+	if (assets.Open("../../Data/Assets.pak"))
+		MountAssetPack(&assets, "../../Data/");
 
 	// Load texture
 	GLuint tex;
@@ -151,8 +65,11 @@ int main()
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, tex);
 
-	int width, height;
-	unsigned char* image = stbi_load("../../Data/img.png", &width, &height, 0, STBI_rgb);
+	int width = 0, height = 0;
+	AssetData file;
+	unsigned char* image = ReadAsset("../../Data/img.png", file)
+		? stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, 0, STBI_rgb)
+		: nullptr;
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
 	stbi_image_free(image);
 
@@ -161,9 +78,17 @@ int main()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glUniform1i(glGetUniformLocation(shaderProgram, "texKitten"), 0);
+	// The distortion is a post effect that takes any texture as input.
+	// Set resolutionScale below 1 to render it into a smaller framebuffer when the GPU can't keep up.
+	WaterDistortionSettings waterSettings;
+	waterSettings.distortionCount = 60.0f;
+	waterSettings.speed = 2.0f;
+	waterSettings.distortionHeight = 0.03f;
+	waterSettings.resolutionScale = 1.0f;
 
-	GLint uniTime = glGetUniformLocation(shaderProgram, "time");
+	WaterDistortionEffect water;
+	water.Create(800, 600, waterSettings);
+	water.SetRect(glm::vec2(-0.5f, -0.5f), glm::vec2(0.5f, 0.5f));
 
 	bool running = true;
 	while (running)
@@ -183,29 +108,20 @@ int main()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT);
 
-		// Set the time uniform
+		// Time drives the scrolling of the waves
 		auto t_now = std::chrono::high_resolution_clock::now();
 		float time = std::chrono::duration_cast<std::chrono::duration<float>>(t_now - t_start).count();
 
-		glUniform1f(uniTime, time);
-
-		// Draw a rectangle from the 2 triangles using 6 indices
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		// Draws the image and its rippling reflection
+		water.Render(tex, time);
 
 		// Swap buffers
 		window.display();
 	}
 
-	glDeleteTextures(1, &tex);
-
-	glDeleteProgram(shaderProgram);
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShader);
+	water.Destroy();
 
-	glDeleteBuffers(1, &ebo);
-	glDeleteBuffers(1, &vbo);
-
-	glDeleteVertexArrays(1, &vao);
+	glDeleteTextures(1, &tex);
 
 	window.close();
 
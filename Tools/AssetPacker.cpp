@@ -0,0 +1,259 @@
+// Packs assets into one file that the project memory maps, see AssetPack.h.
+//
+// Usage: AssetPacker [--compress] [--align N] [--root dir] output.pak files...
+//        AssetPacker --list file.pak
+//        AssetPacker --verify file.pak
+//        AssetPacker --bench [--root dir] file.pak
+// The name of an asset is its path without the root, so with --root ../Data/ the file ../Data/Shaders/scene.vert is Shaders/scene.vert.
+// The project mounts ../../Data/Assets.pak with ../../Data/ as its root.
+// --compress compresses every asset that gets at least 1/8 smaller, PNG and block compressed textures mostly don't.
+// Assets start at a multiple of 4096 bytes unless --align says otherwise.
+// --verify checks the hash of every asset, --bench reads every asset from the pack and from its loose file under the root.
+//
+// Also compile ../OpenglTestProject/OpenglTestProject/AssetPack.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/LzCompression.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MappedFile.cpp
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../OpenglTestProject/OpenglTestProject/AssetPack.h"
+
+static bool ReadFile(const std::string& path, std::vector<unsigned char>& data)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+
+	data.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)data.data(), data.size());
+	return (bool)file;
+}
+
+static std::string GetAssetName(std::string path, const std::string& root)
+{
+	std::replace(path.begin(), path.end(), '\\', '/');
+	if (!root.empty() && path.compare(0, root.size(), root) == 0)
+		path = path.substr(root.size());
+
+	return path;
+}
+
+static int Pack(const std::string& output, const std::vector<std::string>& files, const std::string& root, bool compress, unsigned int alignment)
+{
+	std::vector<AssetPackInput> assets;
+	size_t totalBytes = 0;
+
+	for (const std::string& path : files)
+	{
+		AssetPackInput asset;
+		asset.name = GetAssetName(path, root);
+		asset.compress = compress;
+		if (!ReadFile(path, asset.data))
+		{
+			std::cout << "Can't read " << path << "\n";
+			return 1;
+		}
+
+		totalBytes += asset.data.size();
+		assets.push_back(std::move(asset));
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!WriteAssetPack(output.c_str(), assets, alignment))
+		return 1;
+	auto end = std::chrono::high_resolution_clock::now();
+
+	AssetPack pack;
+	if (!pack.Open(output.c_str()))
+		return 1;
+
+	std::ifstream written(output, std::ios::binary | std::ios::ate);
+	size_t packBytes = (size_t)written.tellg();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << output << ": " << pack.GetEntryCount() << " assets, " << totalBytes / 1024.0 << " KB in "
+		<< packBytes / 1024.0 << " KB, written in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms\n";
+	return 0;
+}
+
+static int List(const std::string& path, bool verify)
+{
+	AssetPack pack;
+	if (!pack.Open(path.c_str()))
+	{
+		std::cout << "Can't open " << path << "\n";
+		return 1;
+	}
+
+	// Listed in the order they are in the file
+	std::vector<int> order(pack.GetEntryCount());
+	for (int i = 0; i < pack.GetEntryCount(); ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&pack](int a, int b) { return pack.GetEntry(a).offset < pack.GetEntry(b).offset; });
+
+	int damaged = 0;
+	std::cout << std::fixed << std::setprecision(1);
+	for (int index : order)
+	{
+		const AssetPackEntry& entry = pack.GetEntry(index);
+		std::cout << std::setw(10) << entry.offset << "  " << std::setw(10) << entry.size / 1024.0 << " KB";
+		if (entry.compression == AssetCompression::Lz)
+			std::cout << " (" << std::setw(5) << 100.0 * entry.storedSize / std::max(entry.size, 1ull) << "%)";
+		else
+			std::cout << "         ";
+		std::cout << "  " << std::hex << std::setw(16) << std::setfill('0') << entry.contentHash << std::dec << std::setfill(' ')
+			<< "  " << pack.GetName(index);
+
+		if (verify)
+		{
+			bool valid = pack.Verify(index);
+			std::cout << (valid ? "  ok" : "  DAMAGED");
+			if (!valid)
+				++damaged;
+		}
+		std::cout << "\n";
+	}
+
+	if (verify)
+		std::cout << damaged << " of " << pack.GetEntryCount() << " assets damaged\n";
+
+	return damaged == 0 ? 0 : 1;
+}
+
+static int Bench(const std::string& path, const std::string& root)
+{
+	const int passes = 20;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// Opening the pack is part of what a program pays at startup
+	unsigned long long packSum = 0;
+	size_t packBytes = 0;
+	int assetCount = 0;
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		AssetPack pack;
+		if (!pack.Open(path.c_str()))
+		{
+			std::cout << "Can't open " << path << "\n";
+			return 1;
+		}
+
+		assetCount = pack.GetEntryCount();
+		for (int i = 0; i < pack.GetEntryCount(); ++i)
+		{
+			AssetData data;
+			if (!pack.Read(pack.Find(pack.GetName(i)), data))
+				return 1;
+
+			// Touch every page, a mapping that isn't read costs nothing
+			for (size_t offset = 0; offset < data.GetSize(); offset += 4096)
+				packSum += data.GetData()[offset];
+			packBytes += data.GetSize();
+		}
+	}
+
+	auto packEnd = std::chrono::high_resolution_clock::now();
+
+	AssetPack pack;
+	pack.Open(path.c_str());
+
+	unsigned long long looseSum = 0;
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		for (int i = 0; i < pack.GetEntryCount(); ++i)
+		{
+			std::string loosePath = root + pack.GetName(i);
+			FILE* file = std::fopen(loosePath.c_str(), "rb");
+			if (!file)
+			{
+				std::cout << "Can't open " << loosePath << ", --root has to point at the files the pack was made of\n";
+				return 1;
+			}
+
+			std::fseek(file, 0, SEEK_END);
+			std::vector<unsigned char> data((size_t)std::ftell(file));
+			std::fseek(file, 0, SEEK_SET);
+			size_t read = std::fread(data.data(), 1, data.size(), file);
+			std::fclose(file);
+
+			for (size_t offset = 0; offset < read; offset += 4096)
+				looseSum += data[offset];
+		}
+	}
+
+	auto looseEnd = std::chrono::high_resolution_clock::now();
+
+	float packMilliseconds = std::chrono::duration<float, std::milli>(packEnd - start).count() / passes;
+	float looseMilliseconds = std::chrono::duration<float, std::milli>(looseEnd - packEnd).count() / passes;
+	double megabytes = packBytes / (1024.0 * 1024.0) / passes;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << assetCount << " assets, " << megabytes << " MB, average of " << passes << " passes (files in the page cache)\n";
+	std::cout << "\tpack:        " << packMilliseconds << " ms\n";
+	std::cout << "\tloose files: " << looseMilliseconds << " ms\n";
+
+	if (packSum != looseSum)
+	{
+		std::cout << "The pack doesn't have the same contents as the loose files\n";
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	bool compress = false;
+	bool list = false;
+	bool verify = false;
+	bool bench = false;
+	unsigned int alignment = 4096;
+	std::string root;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--compress")
+			compress = true;
+		else if (argument == "--list")
+			list = true;
+		else if (argument == "--verify")
+			verify = true;
+		else if (argument == "--bench")
+			bench = true;
+		else if (argument == "--align" && i + 1 < argc)
+			alignment = (unsigned int)std::atoi(argv[++i]);
+		else if (argument == "--root" && i + 1 < argc)
+			root = GetAssetName(argv[++i], "");
+		else
+			paths.push_back(argument);
+	}
+
+	if ((list || verify) && paths.size() == 1)
+		return List(paths[0], verify);
+
+	if (bench && paths.size() == 1)
+		return Bench(paths[0], root);
+
+	if (list || verify || bench || paths.size() < 2)
+	{
+		std::cout << "Usage: AssetPacker [--compress] [--align N] [--root dir] output.pak files...\n";
+		std::cout << "       AssetPacker --list file.pak\n";
+		std::cout << "       AssetPacker --verify file.pak\n";
+		std::cout << "       AssetPacker --bench [--root dir] file.pak\n";
+		return 1;
+	}
+
+	return Pack(paths[0], std::vector<std::string>(paths.begin() + 1, paths.end()), root, compress, alignment);
+}
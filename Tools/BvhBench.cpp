@@ -0,0 +1,271 @@
+// Measures how fast Bvh is built, refitted and queried, see Bvh.h.
+//
+// Usage: BvhBench [--objects N] [--queries N]
+// Scatters boxes through a cube 1000 units wide, 10000, 100000 and a million of them unless --objects gives one count, and prints
+// how long building the tree takes, refitting it after every object and after one in a hundred moved, and how much slower
+// the moves made it. Then it runs --queries frustum, ray and sphere queries, 1000 by default, and compares the frustum queries
+// with FrustumCuller::Cull and the ray, nearest ray hit and sphere queries with testing every object.
+// The tree has to find the same objects as testing every object, FrustumCuller also tests bounding spheres so it can find a few less.
+//
+// Uses the include directory of OpenglTestProject for glm.
+// Also compile ../OpenglTestProject/OpenglTestProject/Bvh.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/FrustumCuller.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/Frustum.cpp
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../OpenglTestProject/OpenglTestProject/Bvh.h"
+#include "../OpenglTestProject/OpenglTestProject/FrustumCuller.h"
+#include "../OpenglTestProject/OpenglTestProject/Frustum.h"
+
+static float GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+struct Box
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+static Frustum GetFrustum(int query)
+{
+	float angle = query * 0.05f;
+	glm::vec3 direction(std::cos(angle), std::sin(angle), 0.2f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.0f), direction, glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+	return Frustum(proj * view);
+}
+
+static void PrintTime(const char* name, float milliseconds, int queryCount)
+{
+	std::cout << "\t" << std::left << std::setw(20) << name << std::right << std::setw(10) << milliseconds / queryCount << " ms per query\n";
+}
+
+// Returns false when the objects found by the tree and by testing every object differ
+static bool Compare(const char* name, std::vector<unsigned int> found, std::vector<unsigned int> expected)
+{
+	std::sort(found.begin(), found.end());
+	std::sort(expected.begin(), expected.end());
+	if (found == expected)
+		return true;
+
+	std::cout << name << ": the tree found " << found.size() << " objects, testing every object found " << expected.size() << "\n";
+	return false;
+}
+
+static bool Run(int objectCount, int queryCount)
+{
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.1f, 5.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Box> boxes(objectCount);
+	for (Box& box : boxes)
+	{
+		glm::vec3 center(position(random), position(random), position(random));
+		glm::vec3 extent(size(random), size(random), size(random));
+		box.min = center - extent;
+		box.max = center + extent;
+	}
+
+	Bvh bvh;
+	FrustumCuller culler;
+	for (const Box& box : boxes)
+	{
+		bvh.Add(box.min, box.max);
+		culler.Add(box.min, box.max);
+	}
+
+	std::cout << objectCount << " objects\n";
+
+	auto start = std::chrono::high_resolution_clock::now();
+	bvh.Build();
+	std::cout << "\tbuild " << GetMilliseconds(start) << " ms, " << bvh.GetNodeCount() << " nodes\n";
+
+	// One in a hundred objects moves a little, then every object does
+	for (int step : { 100, 1 })
+	{
+		for (int object = 0; object < objectCount; object += step)
+		{
+			glm::vec3 offset(unit(random), unit(random), unit(random));
+			boxes[object].min += offset;
+			boxes[object].max += offset;
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int object = 0; object < objectCount; object += step)
+			bvh.Set(object, boxes[object].min, boxes[object].max);
+		bvh.Refit();
+		std::cout << "\trefit after " << (step == 1 ? "every object" : "1 in 100") << " moved " << GetMilliseconds(start)
+			<< " ms, " << bvh.GetCostGrowth() << " times the cost of the built tree\n";
+	}
+
+	for (int object = 0; object < objectCount; ++object)
+		culler.Set(object, boxes[object].min, boxes[object].max);
+
+	bool same = true;
+	std::vector<unsigned int> found;
+	std::vector<unsigned int> expected;
+
+	float bvhTime = 0.0f;
+	float cullerTime = 0.0f;
+	size_t bvhFound = 0;
+	size_t cullerFound = 0;
+	for (int query = 0; query < queryCount; ++query)
+	{
+		Frustum frustum = GetFrustum(query);
+		start = std::chrono::high_resolution_clock::now();
+		bvh.QueryFrustum(frustum, found);
+		bvhTime += GetMilliseconds(start);
+		bvhFound += found.size();
+
+		start = std::chrono::high_resolution_clock::now();
+		culler.Cull(frustum, expected);
+		cullerTime += GetMilliseconds(start);
+		cullerFound += expected.size();
+
+		if (query == 0)
+		{
+			expected.clear();
+			for (int object = 0; object < objectCount; ++object)
+			{
+				if (frustum.IsAabbVisible(boxes[object].min, boxes[object].max))
+					expected.push_back((unsigned int)object);
+			}
+			same &= Compare("frustum", found, expected);
+		}
+	}
+	PrintTime("frustum", bvhTime, queryCount);
+	PrintTime("FrustumCuller", cullerTime, queryCount);
+	std::cout << "\t" << bvhFound / queryCount << " objects found by the tree, " << cullerFound / queryCount << " by the culler\n";
+
+	// Rays of 200 units from random points, the ones that hit nothing come back with -1
+	float rayTime = 0.0f;
+	float raycastTime = 0.0f;
+	size_t rayHits = 0;
+	for (int query = 0; query < queryCount; ++query)
+	{
+		glm::vec3 origin(position(random), position(random), position(random));
+		glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+
+		start = std::chrono::high_resolution_clock::now();
+		bvh.QueryRay(origin, direction, 200.0f, found);
+		rayTime += GetMilliseconds(start);
+		rayHits += found.size();
+
+		start = std::chrono::high_resolution_clock::now();
+		float distance = 0.0f;
+		int closest = bvh.Raycast(origin, direction, 200.0f, &distance);
+		raycastTime += GetMilliseconds(start);
+
+		// Testing every object is slow, so only some rays are checked
+		if (query % 100 == 0)
+		{
+			expected.clear();
+			float closestDistance = 200.0f;
+			int expectedClosest = -1;
+			for (int object = 0; object < objectCount; ++object)
+			{
+				glm::vec3 inverse = 1.0f / direction;
+				glm::vec3 t1 = (boxes[object].min - origin) * inverse;
+				glm::vec3 t2 = (boxes[object].max - origin) * inverse;
+				glm::vec3 enters = glm::min(t1, t2);
+				glm::vec3 leaves = glm::max(t1, t2);
+				float enter = std::max(std::max(enters.x, enters.y), std::max(enters.z, 0.0f));
+				float leave = std::min(std::min(leaves.x, leaves.y), leaves.z);
+
+				if (enter <= std::min(leave, 200.0f))
+					expected.push_back((unsigned int)object);
+
+				if (enter <= std::min(leave, closestDistance) && (expectedClosest < 0 || enter < closestDistance))
+				{
+					expectedClosest = object;
+					closestDistance = enter;
+				}
+			}
+			same &= Compare("ray", found, expected);
+
+			if (closest != expectedClosest && (closest < 0 || expectedClosest < 0 || distance != closestDistance))
+			{
+				std::cout << "raycast: the tree hit " << closest << " at " << distance << ", testing every object hit " << expectedClosest << " at " << closestDistance << "\n";
+				same = false;
+			}
+		}
+	}
+	PrintTime("ray", rayTime, queryCount);
+	PrintTime("nearest ray hit", raycastTime, queryCount);
+	std::cout << "\t" << rayHits / queryCount << " objects per ray\n";
+
+	// Spheres of 20 units, about the size of a room
+	float sphereTime = 0.0f;
+	size_t sphereFound = 0;
+	for (int query = 0; query < queryCount; ++query)
+	{
+		glm::vec3 center(position(random), position(random), position(random));
+		start = std::chrono::high_resolution_clock::now();
+		bvh.QuerySphere(center, 20.0f, found);
+		sphereTime += GetMilliseconds(start);
+		sphereFound += found.size();
+
+		if (query % 100 == 0)
+		{
+			expected.clear();
+			for (int object = 0; object < objectCount; ++object)
+			{
+				glm::vec3 offset = glm::max(boxes[object].min - center, 0.0f) + glm::max(center - boxes[object].max, 0.0f);
+				if (glm::dot(offset, offset) <= 20.0f * 20.0f)
+					expected.push_back((unsigned int)object);
+			}
+			same &= Compare("sphere", found, expected);
+		}
+	}
+	PrintTime("sphere", sphereTime, queryCount);
+	std::cout << "\t" << sphereFound / queryCount << " objects per sphere\n";
+
+	return same;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<int> objectCounts = { 10000, 100000, 1000000 };
+	int queryCount = 1000;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--objects" && i + 1 < argc)
+			objectCounts = { std::atoi(argv[++i]) };
+		else if (argument == "--queries" && i + 1 < argc)
+			queryCount = std::atoi(argv[++i]);
+		else
+			queryCount = -1;
+	}
+
+	if (objectCounts[0] <= 0 || queryCount <= 0)
+	{
+		std::cout << "Usage: BvhBench [--objects N] [--queries N]\n";
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+
+	bool same = true;
+	for (int objectCount : objectCounts)
+		same &= Run(objectCount, queryCount);
+
+	return same ? 0 : 1;
+}
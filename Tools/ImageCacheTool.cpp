@@ -0,0 +1,176 @@
+// Fills the cache of decoded images ahead of time and removes the images that aren't used anymore, see ImageCache.h.
+//
+// Usage: ImageCacheTool --prewarm [--filter box|kaiser] [--format rgba8|bc1|bc3] [--levels N] cache-directory images...
+//        ImageCacheTool --gc [--max-mb N] cache-directory
+//        ImageCacheTool --stats cache-directory
+// --prewarm decodes every image the way the project loads it: the Kaiser filter, RGBA8 and the whole mip chain unless told otherwise.
+// The atlas only loads the image itself, that's --levels 1. Afterwards every image is loaded from the cache once, to compare.
+// The source paths are stored in the cache and --gc uses them to find images whose source changed, so run it from the directory
+// the project runs in, with the same paths: ImageCacheTool --prewarm ../../Data/Cache ../../Data/HaloInfinite.png
+// --gc removes damaged and stale images, then the least recently used ones until the cache fits in --max-mb (256 by default).
+//
+// Uses the include directory of OpenglTestProject for stb.
+// Also compile ../OpenglTestProject/OpenglTestProject/ImageCache.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/AssetPack.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/LzCompression.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MappedFile.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MipGenerator.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/BlockCompression.cpp
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include "../OpenglTestProject/OpenglTestProject/ImageCache.h"
+#include "../OpenglTestProject/OpenglTestProject/MappedFile.h"
+
+static float GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static int Prewarm(const ImageCache& cache, const std::vector<std::string>& images, MipFilter filter, TextureFormat format, int maxLevels)
+{
+	int failed = 0;
+	float decodeMilliseconds = 0.0f;
+	std::vector<unsigned long long> keys;
+
+	std::cout << std::fixed << std::setprecision(1);
+
+	for (const std::string& path : images)
+	{
+		MappedFile file;
+		if (!file.Open(path.c_str()))
+		{
+			std::cout << "Can't read " << path << "\n";
+			++failed;
+			continue;
+		}
+
+		unsigned long long key = MakeImageCacheKey(file.GetData(), file.GetSize(), filter, format, maxLevels);
+		keys.push_back(key);
+
+		DecodedImage image;
+		if (cache.Load(key, image))
+		{
+			std::cout << path << ": already cached\n";
+			continue;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!DecodeImageFile(file.GetData(), file.GetSize(), filter, format, maxLevels, image))
+		{
+			std::cout << "Can't decode " << path << ": " << stbi_failure_reason() << "\n";
+			++failed;
+			continue;
+		}
+		float milliseconds = GetMilliseconds(start);
+		decodeMilliseconds += milliseconds;
+
+		if (!cache.Store(key, path, filter, maxLevels, image))
+		{
+			std::cout << "Can't store " << path << " in " << cache.GetDirectory() << "\n";
+			++failed;
+			continue;
+		}
+
+		std::cout << path << ": " << image.width << "x" << image.height << ", " << image.levels.size() << " levels, decoded in "
+			<< milliseconds << " ms\n";
+	}
+
+	// What a warm start pays for the same images
+	auto start = std::chrono::high_resolution_clock::now();
+	size_t bytes = 0;
+	for (unsigned long long key : keys)
+	{
+		DecodedImage image;
+		if (cache.Load(key, image))
+		{
+			for (const std::vector<unsigned char>& level : image.levels)
+				bytes += level.size();
+		}
+	}
+	float loadMilliseconds = GetMilliseconds(start);
+
+	std::cout << keys.size() << " images, " << bytes / (1024.0 * 1024.0) << " MB: decoding took " << decodeMilliseconds
+		<< " ms, loading them from the cache " << loadMilliseconds << " ms\n";
+
+	return failed == 0 ? 0 : 1;
+}
+
+static void PrintStats(const ImageCacheStats& stats)
+{
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << stats.entryCount << " images, " << stats.bytes / (1024.0 * 1024.0) << " MB\n";
+	if (stats.removedInvalid + stats.removedStale + stats.removedOld > 0)
+	{
+		std::cout << "removed " << stats.removedInvalid << " damaged, " << stats.removedStale << " stale and " << stats.removedOld
+			<< " least recently used images, " << stats.removedBytes / (1024.0 * 1024.0) << " MB\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bool prewarm = false;
+	bool collect = false;
+	bool stats = false;
+	MipFilter filter = MipFilter::Kaiser;
+	TextureFormat format = TextureFormat::RGBA8;
+	int maxLevels = 0;
+	unsigned long long maxBytes = 256ull * 1024 * 1024;
+	bool valid = true;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--prewarm")
+			prewarm = true;
+		else if (argument == "--gc")
+			collect = true;
+		else if (argument == "--stats")
+			stats = true;
+		else if (argument == "--filter" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			filter = name == "box" ? MipFilter::Box : MipFilter::Kaiser;
+			valid = valid && (name == "box" || name == "kaiser");
+		}
+		else if (argument == "--format" && i + 1 < argc)
+		{
+			std::string name = argv[++i];
+			format = name == "bc1" ? TextureFormat::BC1 : name == "bc3" ? TextureFormat::BC3 : TextureFormat::RGBA8;
+			valid = valid && (name == "rgba8" || name == "bc1" || name == "bc3");
+		}
+		else if (argument == "--levels" && i + 1 < argc)
+			maxLevels = std::atoi(argv[++i]);
+		else if (argument == "--max-mb" && i + 1 < argc)
+			maxBytes = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		else
+			paths.push_back(argument);
+	}
+
+	if (!valid || (int)prewarm + (int)collect + (int)stats != 1 || paths.empty() || (!prewarm && paths.size() != 1) || maxLevels < 0)
+	{
+		std::cout << "Usage: ImageCacheTool --prewarm [--filter box|kaiser] [--format rgba8|bc1|bc3] [--levels N] cache-directory images...\n";
+		std::cout << "       ImageCacheTool --gc [--max-mb N] cache-directory\n";
+		std::cout << "       ImageCacheTool --stats cache-directory\n";
+		return 1;
+	}
+
+	ImageCache cache;
+	if (!cache.Create(paths[0]))
+		return 1;
+
+	if (prewarm)
+		return Prewarm(cache, std::vector<std::string>(paths.begin() + 1, paths.end()), filter, format, maxLevels);
+
+	PrintStats(collect ? cache.Collect(maxBytes) : cache.GetStats());
+	return 0;
+}
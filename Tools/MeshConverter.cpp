@@ -0,0 +1,258 @@
+// Converts Wavefront OBJ meshes into the mesh files the project uploads straight from a memory mapping, see MeshFile.h.
+//
+// Usage: MeshConverter [--threads N] [--no-optimize] [--float] [--lods N] input.obj output.mesh
+//        MeshConverter --info file.mesh
+//        MeshConverter --bench [--threads N] input.obj
+// The project makes the mesh file itself the first time it loads an OBJ, this does it ahead of time. The stamp of the OBJ is stored,
+// so converting ../../Data/Meshes/cube.obj to ../../Data/Cache/cube.mesh gives the file the project would have made.
+// --threads parses on that many threads, a thread per core by default.
+// The mesh is optimized for the vertex cache, overdraw and vertex fetch like the project does, unless --no-optimize says otherwise.
+// The ACMR, ATVR and overfetch before and after are printed, see MeshOptimizer.h.
+// Up to 4 levels of detail are made like the project does, --lods sets how many with the full mesh counted, 1 makes none.
+// The vertices are quantized with VertexQuantization::Compact unless --float keeps them as floats. The project rebuilds a mesh file
+// with floats or another quantization than it uses itself, see GetSupportedQuantization.
+// --bench parses the OBJ on 1, 2, 4... threads up to --threads and prints the throughput in MB/s, then how long loading
+// the mesh file of the same mesh takes.
+//
+// Uses the include directory of OpenglTestProject for glm.
+// Also compile ../OpenglTestProject/OpenglTestProject/ObjLoader.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MeshFile.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MeshOptimizer.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MeshSimplifier.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VertexFormat.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/AssetPack.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/LzCompression.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MappedFile.cpp
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../OpenglTestProject/OpenglTestProject/ObjLoader.h"
+#include "../OpenglTestProject/OpenglTestProject/MeshFile.h"
+#include "../OpenglTestProject/OpenglTestProject/MeshOptimizer.h"
+#include "../OpenglTestProject/OpenglTestProject/MeshSimplifier.h"
+#include "../OpenglTestProject/OpenglTestProject/MappedFile.h"
+
+static float GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static const char* VertexAttributeTypeNames[] = { "float", "half", "short", "byte", "2-10-10-10", "unsigned 2-10-10-10" };
+
+static void PrintMesh(const MeshFile& file)
+{
+	const MeshFileHeader& header = file.GetHeader();
+	std::cout << header.vertexCount << " vertices, " << header.lods[0].indexCount / 3 << " triangles, " << header.indexSize * 8 << " bit indices, "
+		<< header.vertexStride << " bytes per vertex (" << GetMeshVertexSize(header.attributes) * sizeof(float) << " as floats):";
+	VertexFormat format = file.GetVertexFormat();
+	for (const VertexAttribute& attribute : format.GetAttributes())
+		std::cout << " " << attribute.name << " " << attribute.components << "x " << VertexAttributeTypeNames[(int)attribute.type];
+
+	std::cout << "\nbounds (" << header.boundsMin[0] << ", " << header.boundsMin[1] << ", " << header.boundsMin[2] << ") to ("
+		<< header.boundsMax[0] << ", " << header.boundsMax[1] << ", " << header.boundsMax[2] << ")\n";
+
+	for (unsigned int lod = 1; lod < header.lodCount; ++lod)
+	{
+		std::cout << "\tlevel " << lod << ": " << header.lods[lod].indexCount / 3 << " triangles, off by " << std::defaultfloat
+			<< std::setprecision(3) << header.lods[lod].error * 100.0f << "% of the size\n";
+	}
+}
+
+static void PrintStats(const char* name, const MeshCacheStats& stats)
+{
+	std::cout << name << "ACMR " << stats.acmr << ", ATVR " << stats.atvr << ", overfetch " << stats.overfetch << "\n";
+}
+
+static int Convert(const std::string& input, const std::string& output, int threadCount, bool optimize, int lodCount,
+	const VertexQuantization& quantization)
+{
+	unsigned long long sourceSize = 0;
+	long long sourceTime = 0;
+	GetFileStamp(input, sourceSize, sourceTime);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	MeshData mesh;
+	if (!LoadObj(input, mesh, threadCount))
+		return 1;
+	float parseMilliseconds = GetMilliseconds(start);
+
+	MeshCacheStats before = AnalyzeMesh(mesh);
+	start = std::chrono::high_resolution_clock::now();
+	if (optimize)
+		OptimizeMesh(mesh);
+	float optimizeMilliseconds = GetMilliseconds(start);
+	MeshCacheStats after = AnalyzeMesh(mesh);
+
+	start = std::chrono::high_resolution_clock::now();
+	GenerateLods(mesh, lodCount);
+	float simplifyMilliseconds = GetMilliseconds(start);
+
+	if (!WriteMeshFile(output.c_str(), mesh, quantization, sourceSize, sourceTime))
+		return 1;
+
+	MeshFile file;
+	if (!file.Open(output.c_str()))
+		return 1;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << input << ": " << sourceSize / 1024.0 << " KB parsed in " << parseMilliseconds << " ms, "
+		<< output << ": " << (file.GetHeader().indexOffset + file.GetIndexBytes()) / 1024.0 << " KB\n";
+	std::cout << std::defaultfloat;
+	PrintMesh(file);
+
+	if (!mesh.lods.empty())
+		std::cout << std::fixed << std::setprecision(1) << "simplified in " << simplifyMilliseconds << " ms\n" << std::defaultfloat;
+
+	if (optimize)
+	{
+		std::cout << std::fixed << std::setprecision(1) << "optimized in " << optimizeMilliseconds << " ms\n" << std::setprecision(3);
+		PrintStats("\tbefore: ", before);
+		PrintStats("\tafter:  ", after);
+	}
+	else
+	{
+		std::cout << std::fixed << std::setprecision(3);
+		PrintStats("", before);
+	}
+	return 0;
+}
+
+static int Info(const std::string& path)
+{
+	MeshFile file;
+	if (!file.Open(path.c_str()))
+	{
+		std::cout << "Can't open " << path << "\n";
+		return 1;
+	}
+
+	PrintMesh(file);
+	return 0;
+}
+
+static int Bench(const std::string& input, int maxThreads)
+{
+	const int passes = 5;
+
+	MappedFile text;
+	if (!text.Open(input.c_str()))
+	{
+		std::cout << "Can't read " << input << "\n";
+		return 1;
+	}
+
+	// Every pass parses from the page cache, not from the disk.
+	// The sum is volatile so the reads of the pages aren't optimized away.
+	volatile unsigned long long sum = 0;
+	for (size_t offset = 0; offset < text.GetSize(); offset += 4096)
+		sum += text.GetData()[offset];
+
+	double megabytes = text.GetSize() / (1024.0 * 1024.0);
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << input << ": " << megabytes << " MB, best of " << passes << " passes\n";
+
+	MeshData mesh;
+	for (int threads = 1;; threads = std::min(threads * 2, maxThreads))
+	{
+		float best = 0.0f;
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			if (!ParseObj((const char*)text.GetData(), text.GetSize(), mesh, threads))
+				return 1;
+
+			float milliseconds = GetMilliseconds(start);
+			best = pass == 0 ? milliseconds : std::min(best, milliseconds);
+		}
+
+		std::cout << "\t" << std::setw(2) << threads << " threads: " << std::setw(8) << best << " ms, " << std::setw(7)
+			<< megabytes / (best / 1000.0) << " MB/s\n";
+
+		if (threads >= maxThreads)
+			break;
+	}
+
+	std::string meshPath = input + ".bench.mesh";
+	if (!WriteMeshFile(meshPath.c_str(), mesh, VertexQuantization::Compact()))
+		return 1;
+
+	// What a start with the mesh file pays instead: map it and read every page, the way glBufferData does
+	float best = 0.0f;
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshFile file;
+		if (!file.Open(meshPath.c_str()))
+			return 1;
+
+		const unsigned char* vertices = (const unsigned char*)file.GetVertices();
+		for (size_t offset = 0; offset < file.GetVertexBytes(); offset += 4096)
+			sum += vertices[offset];
+		const unsigned char* indices = (const unsigned char*)file.GetIndices();
+		for (size_t offset = 0; offset < file.GetIndexBytes(); offset += 4096)
+			sum += indices[offset];
+
+		float milliseconds = GetMilliseconds(start);
+		best = pass == 0 ? milliseconds : std::min(best, milliseconds);
+	}
+
+	std::cout << std::setprecision(3) << "\tmesh file:  " << best << " ms (" << mesh.GetVertexCount() << " vertices, "
+		<< mesh.indices.size() / 3 << " triangles)\n";
+
+	std::remove(meshPath.c_str());
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	bool info = false;
+	bool bench = false;
+	bool optimize = true;
+	VertexQuantization quantization = VertexQuantization::Compact();
+	int threadCount = 0;
+	int lodCount = 4;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--info")
+			info = true;
+		else if (argument == "--bench")
+			bench = true;
+		else if (argument == "--no-optimize")
+			optimize = false;
+		else if (argument == "--float")
+			quantization = VertexQuantization();
+		else if (argument == "--lods" && i + 1 < argc)
+			lodCount = std::atoi(argv[++i]);
+		else if (argument == "--threads" && i + 1 < argc)
+			threadCount = std::atoi(argv[++i]);
+		else
+			paths.push_back(argument);
+	}
+
+	if (info && paths.size() == 1)
+		return Info(paths[0]);
+
+	if (bench && paths.size() == 1)
+		return Bench(paths[0], threadCount > 0 ? threadCount : (int)std::max(1u, std::thread::hardware_concurrency()));
+
+	if (info || bench || paths.size() != 2 || threadCount < 0 || lodCount < 1 || lodCount > (int)MaxMeshLods)
+	{
+		std::cout << "Usage: MeshConverter [--threads N] [--no-optimize] [--float] [--lods N] input.obj output.mesh\n";
+		std::cout << "       MeshConverter --info file.mesh\n";
+		std::cout << "       MeshConverter --bench [--threads N] input.obj\n";
+		return 1;
+	}
+
+	return Convert(paths[0], paths[1], threadCount, optimize, lodCount, quantization);
+}
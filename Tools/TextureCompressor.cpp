@@ -0,0 +1,141 @@
+// Converts images to block compressed DDS files that the game uploads without decoding them.
+//
+// Usage: TextureCompressor [--bc1 | --bc3 | --rgba] [--box | --kaiser | --no-mips] [--linear] input.png output.dds
+// Without a format BC1 is used for opaque images and BC3 for images with alpha.
+// The whole mip chain is built with a Kaiser filter unless --box or --no-mips is given.
+// Colors are filtered in linear space, pass --linear for data that isn't sRGB like normal maps.
+//
+// Uses the include directory of OpenglTestProject for stb.
+// Also compile ../OpenglTestProject/OpenglTestProject/BlockCompression.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/DdsFile.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MipGenerator.cpp
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "../OpenglTestProject/OpenglTestProject/BlockCompression.h"
+#include "../OpenglTestProject/OpenglTestProject/DdsFile.h"
+#include "../OpenglTestProject/OpenglTestProject/MipGenerator.h"
+
+static const char* GetFormatName(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return "BC1";
+	case TextureFormat::BC3:
+		return "BC3";
+	default:
+		return "RGBA8";
+	}
+}
+
+static bool HasAlpha(const unsigned char* rgba, int width, int height)
+{
+	for (size_t i = 0; i < (size_t)width * height; ++i)
+	{
+		if (rgba[i * 4 + 3] != 255)
+			return true;
+	}
+
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	bool formatGiven = false;
+	TextureFormat format = TextureFormat::BC1;
+	bool mips = true;
+	MipFilter filter = MipFilter::Kaiser;
+	bool srgb = true;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--bc1")
+			format = TextureFormat::BC1, formatGiven = true;
+		else if (argument == "--bc3")
+			format = TextureFormat::BC3, formatGiven = true;
+		else if (argument == "--rgba")
+			format = TextureFormat::RGBA8, formatGiven = true;
+		else if (argument == "--box")
+			filter = MipFilter::Box;
+		else if (argument == "--kaiser")
+			filter = MipFilter::Kaiser;
+		else if (argument == "--no-mips")
+			mips = false;
+		else if (argument == "--linear")
+			srgb = false;
+		else
+			paths.push_back(argument);
+	}
+
+	if (paths.size() != 2)
+	{
+		std::cout << "Usage: TextureCompressor [--bc1 | --bc3 | --rgba] [--box | --kaiser | --no-mips] [--linear] input.png output.dds\n";
+		return 1;
+	}
+
+	int width, height;
+	unsigned char* rgba = stbi_load(paths[0].c_str(), &width, &height, nullptr, STBI_rgb_alpha);
+	if (!rgba)
+	{
+		std::cout << "Can't load " << paths[0] << ": " << stbi_failure_reason() << "\n";
+		return 1;
+	}
+
+	if (!formatGiven && HasAlpha(rgba, width, height))
+		format = TextureFormat::BC3;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::vector<unsigned char>> levels;
+	if (mips)
+		levels = GenerateMipChain(rgba, width, height, filter, srgb);
+	else
+		levels.push_back(std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4));
+
+	auto mipped = std::chrono::high_resolution_clock::now();
+
+	size_t uncompressedBytes = 0;
+	for (size_t level = 0; level < levels.size(); ++level)
+	{
+		int levelWidth = std::max(1, width >> level);
+		int levelHeight = std::max(1, height >> level);
+		uncompressedBytes += levels[level].size();
+		levels[level] = CompressImage(levels[level].data(), levelWidth, levelHeight, format);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+
+	float mipSeconds = std::chrono::duration_cast<std::chrono::duration<float>>(mipped - start).count();
+	float seconds = std::chrono::duration_cast<std::chrono::duration<float>>(end - mipped).count();
+	double megabytes = uncompressedBytes / (1024.0 * 1024.0);
+
+	stbi_image_free(rgba);
+
+	if (!WriteDds(paths[1].c_str(), format, width, height, levels))
+		return 1;
+
+	size_t compressedBytes = 0;
+	for (const std::vector<unsigned char>& level : levels)
+		compressedBytes += level.size();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << paths[0] << " (" << width << "x" << height << ") -> " << paths[1] << " " << GetFormatName(format) << ", " << levels.size() << " levels\n";
+	std::cout << "\t" << compressedBytes / 1024.0 << " KB instead of " << uncompressedBytes / 1024.0 << " KB, saved "
+		<< 100.0 * (1.0 - (double)compressedBytes / uncompressedBytes) << "%\n";
+	if (mips)
+		std::cout << "\tmipmaps built in " << mipSeconds * 1000.0f << " ms\n";
+	std::cout << "\tencoded in " << seconds * 1000.0f << " ms (" << megabytes / seconds << " MB/s)\n";
+
+	return 0;
+}
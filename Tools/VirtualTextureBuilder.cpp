@@ -0,0 +1,248 @@
+// Cuts an image into the pages of a virtual texture, and runs the page cache against a simulated camera without a GPU.
+//
+// Usage: VirtualTextureBuilder [--page N] [--border N] [--linear] input.png output.vtp
+//        VirtualTextureBuilder --simulate [--slots-per-side N] [--uploads N] file.vtp
+// A virtual texture is square with a power of 2 number of pages per side, other images are stretched to the next size that is.
+// The pages are 128 pixels with a border of 4 unless --page and --border say otherwise.
+// --simulate zooms and pans over the texture for a few hundred frames, feeds the cache what the feedback pass would see
+// and checks that every pixel always resolves to a page that is resident.
+// The physical texture of the cache holds N by N pages, 16 by 16 unless --slots-per-side says otherwise.
+//
+// Uses the include directory of OpenglTestProject for stb.
+// Also compile ../OpenglTestProject/OpenglTestProject/PageFile.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/VirtualTextureCache.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MappedFile.cpp
+// Also compile ../OpenglTestProject/OpenglTestProject/MipGenerator.cpp
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../OpenglTestProject/OpenglTestProject/PageFile.h"
+#include "../OpenglTestProject/OpenglTestProject/VirtualTextureCache.h"
+
+// Bilinear resize to a square, only used when the image isn't a virtual texture size already
+static std::vector<unsigned char> ResizeToSquare(const unsigned char* rgba, int width, int height, int size)
+{
+	std::vector<unsigned char> resized((size_t)size * size * 4);
+	for (int y = 0; y < size; ++y)
+	{
+		float sourceY = std::max((y + 0.5f) * height / size - 0.5f, 0.0f);
+		int y0 = std::min((int)sourceY, height - 1);
+		int y1 = std::min(y0 + 1, height - 1);
+		float fy = sourceY - y0;
+
+		for (int x = 0; x < size; ++x)
+		{
+			float sourceX = std::max((x + 0.5f) * width / size - 0.5f, 0.0f);
+			int x0 = std::min((int)sourceX, width - 1);
+			int x1 = std::min(x0 + 1, width - 1);
+			float fx = sourceX - x0;
+
+			for (int c = 0; c < 4; ++c)
+			{
+				float top = rgba[((size_t)y0 * width + x0) * 4 + c] * (1.0f - fx) + rgba[((size_t)y0 * width + x1) * 4 + c] * fx;
+				float bottom = rgba[((size_t)y1 * width + x0) * 4 + c] * (1.0f - fx) + rgba[((size_t)y1 * width + x1) * 4 + c] * fx;
+				resized[((size_t)y * size + x) * 4 + c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+			}
+		}
+	}
+
+	return resized;
+}
+
+static int Build(const std::string& input, const std::string& output, int pageSize, int border, bool srgb)
+{
+	int width, height;
+	unsigned char* rgba = stbi_load(input.c_str(), &width, &height, nullptr, STBI_rgb_alpha);
+	if (!rgba)
+	{
+		std::cout << "Can't load " << input << ": " << stbi_failure_reason() << "\n";
+		return 1;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int size = GetPagesPerSide(width, height, pageSize) * pageSize;
+
+	bool written;
+	if (width == size && height == size)
+	{
+		written = WritePageFile(output.c_str(), rgba, size, pageSize, border, srgb);
+	}
+	else
+	{
+		std::vector<unsigned char> resized = ResizeToSquare(rgba, width, height, size);
+		written = WritePageFile(output.c_str(), resized.data(), size, pageSize, border, srgb);
+	}
+
+	stbi_image_free(rgba);
+
+	if (!written)
+		return 1;
+
+	auto end = std::chrono::high_resolution_clock::now();
+	float seconds = std::chrono::duration_cast<std::chrono::duration<float>>(end - start).count();
+
+	PageFile pageFile;
+	if (!pageFile.Open(output.c_str()))
+		return 1;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << input << " (" << width << "x" << height << ") -> " << output << " " << size << "x" << size << ", "
+		<< pageFile.GetLevelCount() << " levels of " << pageSize << " pixel pages with a border of " << border << "\n";
+	std::cout << "\tbuilt in " << seconds * 1000.0f << " ms\n";
+
+	return 0;
+}
+
+static int Simulate(const std::string& path, int slotsPerSide, int maxUploads)
+{
+	PageFile pageFile;
+	if (!pageFile.Open(path.c_str()))
+		return 1;
+
+	VirtualTextureCache cache;
+	cache.Reset(pageFile.GetPagesPerSide(0), pageFile.GetLevelCount(), slotsPerSide);
+
+	// The feedback target of a 1280x720 screen at 1/8 of its size
+	const int screenWidth = 1280;
+	const int feedbackWidth = 160;
+	const int feedbackHeight = 90;
+	const int frameCount = 600;
+
+	std::vector<unsigned char> feedback((size_t)feedbackWidth * feedbackHeight * 4);
+	std::vector<PageUpload> uploads;
+	std::vector<VirtualPage> wanted;
+
+	int framesWithMissingPages = 0;
+	int maxMissing = 0;
+	int errors = 0;
+	unsigned int checksum = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	for (int frame = 0; frame < frameCount; ++frame)
+	{
+		// Zoom in from the whole texture to 1/64 of it and out again, while circling around the center
+		float t = (float)frame / frameCount;
+		float zoom = std::pow(64.0f, std::sin(t * 3.14159265f));
+		float viewWidth = 1.0f / zoom;
+		float viewHeight = viewWidth * feedbackHeight / feedbackWidth;
+		float centerX = 0.5f + 0.3f * std::cos(t * 6.2831853f) * (1.0f - viewWidth);
+		float centerY = 0.5f + 0.3f * std::sin(t * 6.2831853f) * (1.0f - viewWidth);
+
+		// Pixels of level 0 per pixel of the screen, the same as the derivatives in the shader
+		float density = viewWidth * pageFile.GetSize() / screenWidth;
+		int level = std::min(std::max((int)std::floor(std::log2(std::max(density, 1.0f))), 0), pageFile.GetLevelCount() - 1);
+		int pages = pageFile.GetPagesPerSide(level);
+
+		wanted.clear();
+		for (int y = 0; y < feedbackHeight; ++y)
+		{
+			for (int x = 0; x < feedbackWidth; ++x)
+			{
+				unsigned char* pixel = &feedback[((size_t)y * feedbackWidth + x) * 4];
+				float u = centerX + ((x + 0.5f) / feedbackWidth - 0.5f) * viewWidth;
+				float v = centerY + ((y + 0.5f) / feedbackHeight - 0.5f) * viewHeight;
+
+				if (u < 0.0f || v < 0.0f || u >= 1.0f || v >= 1.0f)
+				{
+					pixel[3] = 0;
+					continue;
+				}
+
+				VirtualPage page = { level, (int)(u * pages), (int)(v * pages) };
+				EncodeFeedback(page, pixel);
+				wanted.push_back(page);
+			}
+		}
+
+		// Everything drawn this frame uses the indirection table as it was before the update
+		for (const VirtualPage& page : wanted)
+		{
+			VirtualPage resolved = cache.Resolve(page);
+			const unsigned char* entry = &cache.GetIndirection()[page.level][((size_t)page.y * pages + page.x) * 4];
+			if (frame > 0 && (!cache.IsResident(resolved) || entry[2] != resolved.level))
+				++errors;
+		}
+
+		cache.AddFeedback(feedback.data(), feedback.size() / 4);
+		cache.Update(maxUploads, uploads);
+
+		// What the GPU side does with the uploads, reading the pages pulls them in from the file
+		for (const PageUpload& upload : uploads)
+		{
+			const unsigned char* page = pageFile.GetPage(upload.page.level, upload.page.x, upload.page.y);
+			for (size_t i = 0; i < pageFile.GetPageBytes(); i += 64)
+				checksum += page[i];
+		}
+
+		if (cache.GetMissingCount() > 0)
+			++framesWithMissingPages;
+		maxMissing = std::max(maxMissing, cache.GetMissingCount());
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	float seconds = std::chrono::duration_cast<std::chrono::duration<float>>(end - start).count();
+	double megabytes = cache.GetUploadCount() * pageFile.GetPageBytes() / (1024.0 * 1024.0);
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << path << ": " << frameCount << " frames, " << cache.GetSlotCount() << " slots, " << maxUploads << " uploads per frame\n";
+	std::cout << "\t" << cache.GetUploadCount() << " pages uploaded (" << megabytes << " MB), " << cache.GetEvictionCount() << " evicted\n";
+	std::cout << "\t" << framesWithMissingPages << " frames waited for pages, at most " << maxMissing << " missing at once\n";
+	std::cout << "\t" << seconds * 1000.0f / frameCount << " ms per frame on the CPU (checksum " << checksum << ")\n";
+	std::cout << "\t" << errors << " pixels resolved to a page that isn't resident\n";
+
+	return errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+	bool simulate = false;
+	int pageSize = 128;
+	int border = 4;
+	int slotsPerSide = 16;
+	int maxUploads = 8;
+	bool srgb = true;
+	std::vector<std::string> paths;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+		if (argument == "--simulate")
+			simulate = true;
+		else if (argument == "--page" && i + 1 < argc)
+			pageSize = std::atoi(argv[++i]);
+		else if (argument == "--border" && i + 1 < argc)
+			border = std::atoi(argv[++i]);
+		else if (argument == "--slots-per-side" && i + 1 < argc)
+			slotsPerSide = std::atoi(argv[++i]);
+		else if (argument == "--uploads" && i + 1 < argc)
+			maxUploads = std::atoi(argv[++i]);
+		else if (argument == "--linear")
+			srgb = false;
+		else
+			paths.push_back(argument);
+	}
+
+	if (simulate && paths.size() == 1 && slotsPerSide > 0 && slotsPerSide <= 256 && maxUploads > 0)
+		return Simulate(paths[0], slotsPerSide, maxUploads);
+
+	if (simulate || paths.size() != 2 || pageSize <= 0 || border < 0)
+	{
+		std::cout << "Usage: VirtualTextureBuilder [--page N] [--border N] [--linear] input.png output.vtp\n";
+		std::cout << "       VirtualTextureBuilder --simulate [--slots-per-side N] [--uploads N] file.vtp\n";
+		return 1;
+	}
+
+	return Build(paths[0], paths[1], pageSize, border, srgb);
+}